@@ -103,3 +103,90 @@ void Java_doug_test_box2d_TestActivity_test(JNIEnv * env, jclass cls) {
 	// When the world destructor is called, all bodies and joints are freed. This can
 	// create orphaned pointers, so be careful about your world management.
 }
+
+// A world that lives across calls, for the batch state export below.
+static b2World* s_world = NULL;
+
+extern "C"
+void Java_doug_test_box2d_TestActivity_createWorld(JNIEnv * env, jclass cls, jint boxCount) {
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-100.0f, -100.0f);
+	worldAABB.upperBound.Set(100.0f, 100.0f);
+	s_world = new b2World(worldAABB, b2Vec2(0.0f, -10.0f), true);
+
+	b2BodyDef groundBodyDef;
+	groundBodyDef.position.Set(0.0f, -10.0f);
+	b2Body* groundBody = s_world->CreateBody(&groundBodyDef);
+
+	b2PolygonDef groundShapeDef;
+	groundShapeDef.SetAsBox(50.0f, 10.0f);
+	groundBody->CreateFixture(&groundShapeDef);
+
+	// A stack of boxes, created in one call.
+	b2PolygonDef shapeDef;
+	shapeDef.SetAsBox(0.5f, 0.5f);
+	shapeDef.density = 1.0f;
+	shapeDef.friction = 0.3f;
+
+	b2BodyDef* bodyDefs = new b2BodyDef[boxCount];
+	const b2FixtureDef** fixtureDefs = new const b2FixtureDef*[boxCount];
+	int32* fixtureCounts = new int32[boxCount];
+	for (int32 i = 0; i < boxCount; ++i)
+	{
+		bodyDefs[i].position.Set(0.0f, 0.5f + 1.05f * i);
+		fixtureDefs[i] = &shapeDef;
+		fixtureCounts[i] = 1;
+	}
+
+	s_world->CreateBodies(bodyDefs, boxCount, fixtureDefs, fixtureCounts, NULL);
+
+	delete [] bodyDefs;
+	delete [] fixtureDefs;
+	delete [] fixtureCounts;
+}
+
+extern "C"
+void Java_doug_test_box2d_TestActivity_destroyWorld(JNIEnv * env, jclass cls) {
+	delete s_world;
+	s_world = NULL;
+}
+
+extern "C"
+void Java_doug_test_box2d_TestActivity_step(JNIEnv * env, jclass cls) {
+	s_world->Step(1.0f / 60.0f, 8, 1);
+}
+
+// Fill a direct ByteBuffer in native byte order with the state of every awake
+// body, so Java doesn't need a JNI call per body. The buffer holds capacity
+// body indices as ints, followed by capacity records of x, y, angle, and vx,
+// vy, w if includeVelocity is set, as floats. The capacity is the number of
+// records that fit: bytes / (4 * (1 + 3)), or bytes / (4 * (1 + 6)) with
+// velocities. Returns the number of records written, or -1 if the buffer is
+// not direct.
+extern "C"
+jint Java_doug_test_box2d_TestActivity_getBodyStates(JNIEnv * env, jclass cls,
+		jobject buffer, jboolean includeVelocity) {
+	void* address = env->GetDirectBufferAddress(buffer);
+	if (address == NULL)
+	{
+		return -1;
+	}
+
+	int32 stride = includeVelocity ? 6 : 3;
+	int32 capacity = (int32)(env->GetDirectBufferCapacity(buffer) / (4 * (1 + stride)));
+	int32* indices = (int32*)address;
+	float32* states = (float32*)(indices + capacity);
+
+	int32 count = s_world->GetBodyStates(states, indices, capacity, includeVelocity != JNI_FALSE);
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+	// Java reads floats. Convert the 16.16 values in place.
+	float* values = (float*)states;
+	for (int32 i = 0; i < count * stride; ++i)
+	{
+		values[i] = (float)states[i];
+	}
+#endif
+
+	return count;
+}
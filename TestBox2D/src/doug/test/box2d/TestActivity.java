@@ -17,8 +17,12 @@
 */
 package doug.test.box2d;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
 import android.app.Activity;
 import android.os.Bundle;
+import android.util.Log;
 
 public class TestActivity extends Activity {
     /** Called when the activity is first created. */
@@ -27,6 +31,35 @@ public class TestActivity extends Activity {
         super.onCreate(savedInstanceState);
         setContentView(R.layout.main);
         test();
+        testBodyStates();
+    }
+
+    /** Step a stack of boxes and read all body positions back in one call per step. */
+    private static void testBodyStates() {
+        final int boxCount = 20;
+        final int stride = 3;
+
+        // Static bodies are skipped, so a record per box is enough.
+        int capacity = boxCount;
+        ByteBuffer states = ByteBuffer.allocateDirect(capacity * 4 * (1 + stride));
+        states.order(ByteOrder.nativeOrder());
+
+        createWorld(boxCount);
+        for (int i = 0; i < 60; ++i) {
+            step();
+            int count = getBodyStates(states, false);
+            for (int j = 0; j < count; ++j) {
+                int index = states.getInt(4 * j);
+                int offset = 4 * (capacity + stride * j);
+                if (index == boxCount + 1) {
+                    // The top box. Index 0 is the world's ground body and 1 is ours.
+                    Log.d("TestBox2D", states.getFloat(offset) + " "
+                            + states.getFloat(offset + 4) + " "
+                            + states.getFloat(offset + 8));
+                }
+            }
+        }
+        destroyWorld();
     }
     
     static {
@@ -34,4 +67,9 @@ public class TestActivity extends Activity {
     }
     
     private static native void test();
+
+    private static native void createWorld(int boxCount);
+    private static native void destroyWorld();
+    private static native void step();
+    private static native int getBodyStates(ByteBuffer buffer, boolean includeVelocity);
 }
@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void Usage()
+{
+	printf("usage: bake [-all] scene file\n");
+	printf("scenes:");
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		printf(" %s", g_scenes[i].name);
+	}
+	printf("\n");
+}
+
+// Bakes the static bodies of a scene, or all bodies with -all, into a level
+// file for b2World::CreateBakedBodies. The file is only valid for builds with
+// the same math type and byte order, so bake with the matching build.
+int main(int argc, char** argv)
+{
+	bool staticOnly = true;
+	const char* sceneName = NULL;
+	const char* fileName = NULL;
+
+	for (int32 i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-all") == 0)
+		{
+			staticOnly = false;
+		}
+		else if (argv[i][0] == '-')
+		{
+			Usage();
+			return 1;
+		}
+		else if (sceneName == NULL)
+		{
+			sceneName = argv[i];
+		}
+		else if (fileName == NULL)
+		{
+			fileName = argv[i];
+		}
+	}
+
+	const Scene* scene = NULL;
+	for (int32 i = 0; sceneName != NULL && g_scenes[i].name != NULL; ++i)
+	{
+		if (strcmp(sceneName, g_scenes[i].name) == 0)
+		{
+			scene = g_scenes + i;
+		}
+	}
+
+	if (scene == NULL || fileName == NULL)
+	{
+		Usage();
+		return 1;
+	}
+
+	b2World* world = CreateWorld(e_sweepAndPruneBroadPhase);
+	scene->createFcn(world);
+
+	int32 size = b2BakeLevel(world, NULL, 0, staticOnly);
+	void* level = malloc(size);
+	b2BakeLevel(world, level, size, staticOnly);
+	delete world;
+
+	// Check that the level loads before writing it.
+	b2World* check = CreateWorld(e_sweepAndPruneBroadPhase);
+	bool valid = check->CreateBakedBodies(level, size, NULL);
+	int32 bodyCount = check->GetBodyCount() - 1;
+	delete check;
+
+	FILE* file = valid ? fopen(fileName, "wb") : NULL;
+	bool written = file != NULL && fwrite(level, size, 1, file) == 1;
+	if (file != NULL && fclose(file) != 0)
+	{
+		written = false;
+	}
+	free(level);
+
+	if (written == false)
+	{
+		printf("could not write %s\n", fileName);
+		return 1;
+	}
+
+	printf("%s: %d bodies, %d bytes\n", fileName, bodyCount, size);
+	return 0;
+}
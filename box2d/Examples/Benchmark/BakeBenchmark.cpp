@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+
+// A level of static geometry: a terrain edge chain, polygon rocks and circle pegs.
+const int32 k_terrainVertexCount = 2000;
+const int32 k_rockRows = 10;
+const int32 k_rockColumns = 150;
+const int32 k_pegCount = 300;
+const int32 k_dropCount = 200;
+const int32 k_loadCount = 5;
+
+static void CreateLevel(b2World* world)
+{
+	b2Vec2* vertices = new b2Vec2[k_terrainVertexCount];
+	for (int32 i = 0; i < k_terrainVertexCount; ++i)
+	{
+		float x = -190.0f + 380.0f * i / (k_terrainVertexCount - 1);
+		vertices[i].Set(x, -60.0f + 4.0f * sinf(0.1f * x) + 1.5f * sinf(0.37f * x));
+	}
+
+	b2BodyDef bd;
+	b2Body* terrain = world->CreateBody(&bd);
+	b2EdgeChainDef chainDef;
+	chainDef.vertices = vertices;
+	chainDef.vertexCount = k_terrainVertexCount;
+	chainDef.isLoop = false;
+	b2CreateEdgeChain(terrain, &chainDef);
+	delete [] vertices;
+
+	// Octagons, the largest polygons the kernels are tuned for.
+	b2PolygonDef rockDef;
+	rockDef.vertexCount = 8;
+	for (int32 i = 0; i < 8; ++i)
+	{
+		float angle = 3.14159265f * i / 4.0f;
+		rockDef.vertices[i].Set(0.6f * cosf(angle), 0.6f * sinf(angle));
+	}
+
+	b2BodyDef* rockDefs = new b2BodyDef[k_rockRows * k_rockColumns];
+	const b2FixtureDef** fixtureDefs = new const b2FixtureDef*[k_rockRows * k_rockColumns];
+	int32* fixtureCounts = new int32[k_rockRows * k_rockColumns];
+	for (int32 i = 0; i < k_rockRows; ++i)
+	{
+		for (int32 j = 0; j < k_rockColumns; ++j)
+		{
+			int32 index = i * k_rockColumns + j;
+			rockDefs[index].position.Set(-180.0f + 2.4f * j + 1.2f * (i & 1), -40.0f + 4.0f * i);
+			rockDefs[index].angle = 0.1f * j;
+			fixtureDefs[index] = &rockDef;
+			fixtureCounts[index] = 1;
+		}
+	}
+	world->CreateBodies(rockDefs, k_rockRows * k_rockColumns, fixtureDefs, fixtureCounts, NULL);
+	delete [] rockDefs;
+	delete [] fixtureDefs;
+	delete [] fixtureCounts;
+
+	b2CircleDef pegDef;
+	pegDef.radius = 0.3f;
+	for (int32 i = 0; i < k_pegCount; ++i)
+	{
+		bd.position.Set(-179.0f + 1.2f * i, 5.0f + 2.0f * (i % 3));
+		world->CreateBody(&bd)->CreateFixture(&pegDef);
+	}
+}
+
+// Drop boxes on the level and step it. Returns a checksum of the boxes.
+static float DropBoxes(b2World* world, const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	b2PolygonDef boxDef;
+	boxDef.SetAsBox(0.4f, 0.4f);
+	boxDef.density = 1.0f;
+
+	b2Body* boxes[k_dropCount];
+	for (int32 i = 0; i < k_dropCount; ++i)
+	{
+		b2BodyDef bd;
+		bd.position.Set(-170.0f + 1.7f * i, 40.0f);
+		boxes[i] = world->CreateBody(&bd);
+		boxes[i]->CreateFixture(&boxDef);
+		boxes[i]->SetMassFromShapes();
+	}
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+	}
+
+	float sum = 0.0f;
+	for (int32 i = 0; i < k_dropCount; ++i)
+	{
+		b2Vec2 p = boxes[i]->GetPosition();
+		sum += float(p.x) + float(p.y) + float(boxes[i]->GetAngle());
+	}
+	return sum;
+}
+
+// Load the same static level by building it from definitions, from a baked
+// level in memory and from a memory mapped baked level file. Then drop boxes
+// on it; the checksums of the three must be the same.
+void BakeBenchmark(const Settings& settings)
+{
+	// Bake the level once, like the bake tool does offline.
+	b2World* source = CreateWorld(e_sweepAndPruneBroadPhase);
+	CreateLevel(source);
+	int32 size = b2BakeLevel(source, NULL, 0, true);
+	void* level = malloc(size);
+	b2BakeLevel(source, level, size, true);
+	int32 fixtureCount = 0;
+	for (b2Body* b = source->GetBodyList(); b; b = b->GetNext())
+	{
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			++fixtureCount;
+		}
+	}
+	delete source;
+
+	FILE* file = tmpfile();
+	fwrite(level, size, 1, file);
+	fflush(file);
+
+	printf("baked %d fixtures into %d bytes\n", fixtureCount, size);
+	printf("%-12s %-8s %10s %12s\n", "broadphase", "load", "load (ms)", "checksum");
+
+	const char* broadPhaseNames[2] = {"sap", "tree"};
+	b2BroadPhaseType broadPhaseTypes[2] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	const char* loadNames[3] = {"defs", "baked", "mapped"};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		for (int32 load = 0; load < 3; ++load)
+		{
+			double loadTime = 0.0;
+			float checksum = 0.0f;
+			for (int32 k = 0; k < k_loadCount; ++k)
+			{
+				b2World* world = CreateWorld(broadPhaseTypes[i]);
+
+				double start = GetMilliseconds();
+				if (load == 0)
+				{
+					CreateLevel(world);
+				}
+				else if (load == 1)
+				{
+					world->CreateBakedBodies(level, size, NULL);
+				}
+				else
+				{
+					void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+					if (mapped == MAP_FAILED || world->CreateBakedBodies(mapped, size, NULL) == false)
+					{
+						printf("mapping the level failed\n");
+					}
+					munmap(mapped, size);
+				}
+				loadTime += GetMilliseconds() - start;
+
+				// Only the first load is stepped, the level is the same every time.
+				if (k == 0)
+				{
+					checksum = DropBoxes(world, settings);
+				}
+
+				delete world;
+			}
+
+			printf("%-12s %-8s %10.3f %12.3f\n", broadPhaseNames[i], loadNames[load],
+				loadTime / k_loadCount, checksum);
+		}
+	}
+
+	fclose(file);
+	free(level);
+}
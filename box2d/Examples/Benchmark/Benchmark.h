@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Box2D.h"
+
+// Command line settings shared by all benchmarks.
+struct Settings
+{
+	Settings() :
+		hz(60.0f),
+		velocityIterations(10),
+		positionIterations(8),
+		stepCount(600),
+		format("text"),
+		sceneName(NULL)
+		{}
+
+	float32 hz;
+	int32 velocityIterations;
+	int32 positionIterations;
+	int32 stepCount;
+
+	// Output of the report benchmark: "text", "csv" or "json".
+	const char* format;
+
+	// Only run this scene in the report benchmark, NULL runs all of them.
+	const char* sceneName;
+};
+
+typedef void BenchmarkFcn(const Settings& settings);
+
+struct BenchmarkEntry
+{
+	const char* name;
+	BenchmarkFcn* runFcn;
+};
+
+extern BenchmarkEntry g_benchmarkEntries[];
+
+typedef void SceneCreateFcn(b2World* world);
+
+// A scene is a copy of a TestBed test without the rendering.
+struct Scene
+{
+	const char* name;
+	SceneCreateFcn* createFcn;
+};
+
+extern Scene g_scenes[];
+
+// Create a world with the TestBed bounds and gravity.
+b2World* CreateWorld(b2BroadPhaseType broadPhaseType, int32 stackSize = b2_stackSize);
+
+// Wall clock time in milliseconds.
+double GetMilliseconds();
+
+#endif
@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+void BroadPhaseBenchmark(const Settings& settings);
+void IslandBenchmark(const Settings& settings);
+void ThreadBenchmark(const Settings& settings);
+void ContactBenchmark(const Settings& settings);
+void TOIBenchmark(const Settings& settings);
+void StackBenchmark(const Settings& settings);
+void MemoryBenchmark(const Settings& settings);
+void StepBenchmark(const Settings& settings);
+void KernelBenchmark(const Settings& settings);
+void ReportBenchmark(const Settings& settings);
+void LoadBenchmark(const Settings& settings);
+void SnapshotBenchmark(const Settings& settings);
+void BakeBenchmark(const Settings& settings);
+void ReplayBenchmark(const Settings& settings);
+void TeleportBenchmark(const Settings& settings);
+void DestroyBenchmark(const Settings& settings);
+
+BenchmarkEntry g_benchmarkEntries[] =
+{
+	{"broadphase", BroadPhaseBenchmark},
+	{"islands", IslandBenchmark},
+	{"threads", ThreadBenchmark},
+	{"contacts", ContactBenchmark},
+	{"toi", TOIBenchmark},
+	{"stack", StackBenchmark},
+	{"memory", MemoryBenchmark},
+	{"step", StepBenchmark},
+	{"kernels", KernelBenchmark},
+	{"report", ReportBenchmark},
+	{"load", LoadBenchmark},
+	{"snapshot", SnapshotBenchmark},
+	{"bake", BakeBenchmark},
+	{"replay", ReplayBenchmark},
+	{"teleport", TeleportBenchmark},
+	{"destroy", DestroyBenchmark},
+	{NULL, NULL}
+};
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// Step every scene with each broad-phase backend and report the time per step,
+// and the part of it spent synchronizing the fixtures and in the broad-phase.
+void BroadPhaseBenchmark(const Settings& settings)
+{
+	struct Backend
+	{
+		const char* name;
+		b2BroadPhaseType type;
+	};
+
+	Backend backends[2] =
+	{
+		{"sap", e_sweepAndPruneBroadPhase},
+		{"tree", e_dynamicTreeBroadPhase},
+	};
+
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-16s %-6s %8s %8s %12s %10s %10s %10s\n", "scene", "phase", "proxies", "pairs", "total (ms)", "step (ms)",
+		"sync (ms)", "bp (ms)");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2World* world = CreateWorld(backends[j].type);
+			scene.createFcn(world);
+
+			int32 maxPairs = 0;
+			b2Profile profile;
+			profile.SetZero();
+			double start = GetMilliseconds();
+			for (int32 k = 0; k < settings.stepCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				maxPairs = b2Max(maxPairs, world->GetPairCount());
+				profile.Add(world->GetProfile());
+			}
+			double total = GetMilliseconds() - start;
+			profile.Scale(1.0f / b2Max(settings.stepCount, 1));
+
+			printf("%-16s %-6s %8d %8d %12.1f %10.3f %10.3f %10.3f\n", scene.name, backends[j].name,
+				world->GetProxyCount(), maxPairs, total, total / settings.stepCount,
+				profile.synchronize, profile.broadphase);
+
+			delete world;
+		}
+	}
+}
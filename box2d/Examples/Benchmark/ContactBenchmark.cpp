@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// The highest body, to see that stacks stay up with either solver.
+static float32 GetTop(b2World* world)
+{
+	float32 top = -B2_FLT_MAX;
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->IsStatic() == false)
+		{
+			top = b2Max(top, b->GetPosition().y);
+		}
+	}
+	return top;
+}
+
+// Step every scene with the plain contact solver and with the batched
+// contact solver and report the time per step of each.
+void ContactBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-16s %8s %12s %12s %10s %10s %10s\n", "scene", "contacts", "plain (ms)", "batched (ms)", "speedup", "plain top", "batch top");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		double times[2];
+		float32 tops[2];
+		int32 contactCount = 0;
+
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+			world->SetContactBatching(j == 1);
+			scene.createFcn(world);
+
+			double start = GetMilliseconds();
+			for (int32 k = 0; k < settings.stepCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				contactCount = b2Max(contactCount, world->GetContactCount());
+			}
+			times[j] = GetMilliseconds() - start;
+			tops[j] = GetTop(world);
+
+			delete world;
+		}
+
+		int32 stepCount = b2Max(settings.stepCount, 1);
+		printf("%-16s %8d %12.3f %12.3f %10.2f %10.3f %10.3f\n", scene.name, contactCount,
+			times[0] / stepCount, times[1] / stepCount, times[1] > 0.0 ? times[0] / times[1] : 0.0,
+			float(tops[0]), float(tops[1]));
+	}
+}
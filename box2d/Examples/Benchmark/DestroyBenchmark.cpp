@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// Groups of a plank resting on four boxes with a ball dropping on the plank.
+const int32 k_destroyGroupCount = 25;
+const int32 k_destroySupportCount = 4;
+
+// Destroys a plank when a ball hits it. The plank still touches its supports, so
+// their contacts are pending in the same collide and are only marked.
+class DestroyListener : public b2ContactListener
+{
+public:
+	DestroyListener(b2World* world) : m_world(world), m_destroyCount(0) {}
+
+	void BeginContact(b2Contact* contact)
+	{
+		b2Body* bodyA = contact->GetFixtureA()->GetBody();
+		b2Body* bodyB = contact->GetFixtureB()->GetBody();
+		b2Body* plank = NULL;
+		if (bodyA->GetUserData() == &m_plankTag && bodyB->GetUserData() == &m_ballTag)
+		{
+			plank = bodyA;
+		}
+		else if (bodyB->GetUserData() == &m_plankTag && bodyA->GetUserData() == &m_ballTag)
+		{
+			plank = bodyB;
+		}
+
+		if (plank != NULL)
+		{
+			m_world->DestroyBody(plank);
+			++m_destroyCount;
+		}
+	}
+
+	b2World* m_world;
+	int32 m_destroyCount;
+
+	// Only the addresses are used, to tag the bodies.
+	char m_plankTag;
+	char m_ballTag;
+};
+
+static void CreateGroups(b2World* world, DestroyListener* listener)
+{
+	{
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		b2Body* ground = world->CreateBody(&bd);
+
+		b2PolygonDef sd;
+		sd.SetAsBox(150.0f, 10.0f);
+		ground->CreateFixture(&sd);
+	}
+
+	for (int32 i = 0; i < k_destroyGroupCount; ++i)
+	{
+		float32 x = -100.0f + 8.0f * i;
+
+		b2PolygonDef sd;
+		sd.SetAsBox(0.5f, 0.5f);
+		sd.density = 1.0f;
+		sd.friction = 0.6f;
+
+		for (int32 j = 0; j < k_destroySupportCount; ++j)
+		{
+			b2BodyDef bd;
+			bd.position.Set(x - 2.25f + 1.5f * j, 0.5f);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+		}
+
+		// The plank stays awake, so its contacts are collided every step.
+		b2BodyDef bd;
+		bd.position.Set(x, 1.25f);
+		bd.allowSleep = false;
+		bd.userData = &listener->m_plankTag;
+		b2Body* plank = world->CreateBody(&bd);
+		sd.SetAsBox(3.0f, 0.25f);
+		plank->CreateFixture(&sd);
+		plank->SetMassFromShapes();
+
+		b2CircleDef cd;
+		cd.radius = 0.25f;
+		cd.density = 1.0f;
+		bd.position.Set(x + 0.1f * i, 4.0f + 0.05f * i);
+		bd.allowSleep = true;
+		bd.userData = &listener->m_ballTag;
+		b2Body* ball = world->CreateBody(&bd);
+		ball->CreateFixture(&cd);
+		ball->SetMassFromShapes();
+	}
+}
+
+// Destroy bodies from BeginContact while their other contacts wait to be
+// finished in the same collide. Reports the mean step time, the destroyed
+// planks and whether the contact list still matches the contact count.
+void DestroyBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-12s %8s %10s %8s %10s %12s %8s\n", "broadphase", "groups", "destroyed", "bodies", "contacts", "ms/step", "check");
+
+	const char* broadPhaseNames[2] = {"sap", "tree"};
+	b2BroadPhaseType broadPhaseTypes[2] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		b2World* world = CreateWorld(broadPhaseTypes[i]);
+		DestroyListener listener(world);
+		world->SetContactListener(&listener);
+		CreateGroups(world, &listener);
+		int32 bodyCount = world->GetBodyCount();
+
+		double start = GetMilliseconds();
+		for (int32 j = 0; j < settings.stepCount; ++j)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		}
+		double stepTime = GetMilliseconds() - start;
+
+		int32 contactCount = 0;
+		for (b2Contact* c = world->GetContactList(); c; c = c->GetNext())
+		{
+			++contactCount;
+		}
+
+		bool ok = contactCount == world->GetContactCount();
+		ok = ok && world->GetBodyCount() == bodyCount - listener.m_destroyCount;
+
+		printf("%-12s %8d %10d %8d %10d %12.3f %8s\n", broadPhaseNames[i], k_destroyGroupCount, listener.m_destroyCount,
+			world->GetBodyCount(), world->GetContactCount(), stepTime / b2Max(settings.stepCount, 1), ok ? "ok" : "failed");
+
+		delete world;
+	}
+}
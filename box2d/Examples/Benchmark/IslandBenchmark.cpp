@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// Step every scene and report the time per step while the scene settles
+// and once it has gone to sleep, along with the final island counts. The
+// narrow phase and continuous collision of the second half only visit the
+// contacts of awake bodies, so their cost follows the activity of the scene.
+void IslandBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+	int32 half = settings.stepCount / 2;
+
+	printf("%-16s %8s %8s %8s %14s %14s %14s %14s\n", "scene", "bodies", "awake", "asleep", "first (ms)", "second (ms)",
+		"collide (ms)", "toi (ms)");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+		scene.createFcn(world);
+
+		double start = GetMilliseconds();
+		for (int32 k = 0; k < half; ++k)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		}
+		double first = GetMilliseconds() - start;
+
+		b2Profile profile;
+		profile.SetZero();
+
+		start = GetMilliseconds();
+		for (int32 k = half; k < settings.stepCount; ++k)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+			profile.Add(world->GetProfile());
+		}
+		double second = GetMilliseconds() - start;
+		profile.Scale(1.0f / b2Max(settings.stepCount - half, 1));
+
+		printf("%-16s %8d %8d %8d %14.3f %14.3f %14.3f %14.3f\n", scene.name, world->GetBodyCount(),
+			world->GetAwakeIslandCount(), world->GetSleepingIslandCount(),
+			first / b2Max(half, 1), second / b2Max(settings.stepCount - half, 1),
+			profile.collide, profile.solveTOI);
+
+		delete world;
+	}
+}
@@ -0,0 +1,349 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+extern int32 b2_maxToiIters;
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+static const char* s_numberType = "fixed";
+#else
+static const char* s_numberType = "float";
+#endif
+
+// How the second shape is placed against the first.
+enum PairCase
+{
+	e_overlapping,
+	e_touching,
+	e_separated,
+	e_degenerate,
+	e_pairCaseCount
+};
+
+static const char* s_pairCaseNames[e_pairCaseCount] =
+{
+	"overlapping",
+	"touching",
+	"separated",
+	"degenerate",
+};
+
+// Shape pairs generated per case. The timed loops run over all of them.
+static const int32 k_pairCount = 256;
+
+// Iteration histogram bins. Larger counts go in the last bin.
+static const int32 k_binCount = 32;
+
+// A small deterministic generator so every run tests the same pairs.
+static float32 NextRandom(uint32* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	// Divide as float, 65535 is out of range for fixed point.
+	return float32(float((*seed >> 8) & 0xffff) / 65535.0f);
+}
+
+static void MakeShape(b2CircleShape* shape, uint32* seed)
+{
+	shape->m_p.SetZero();
+	shape->m_radius = 0.2f + 0.8f * NextRandom(seed);
+}
+
+// A regular polygon with 3 to 8 sides, stretched along x.
+static void MakeShape(b2PolygonShape* shape, uint32* seed)
+{
+	int32 count = 3 + int32(*seed % (b2_maxPolygonVertices - 2));
+	float32 radius = 0.3f + 1.2f * NextRandom(seed);
+	float32 stretch = 0.2f + 0.8f * NextRandom(seed);
+
+	b2Vec2 vertices[b2_maxPolygonVertices];
+	for (int32 i = 0; i < count; ++i)
+	{
+		float32 angle = (2.0f * b2_pi / count) * i;
+		vertices[i].Set(stretch * radius * cosf(angle), radius * sinf(angle));
+	}
+	shape->Set(vertices, count);
+}
+
+// A lone edge, so both corners are flagged as not convex.
+static void MakeShape(b2EdgeShape* shape, uint32* seed)
+{
+	float32 halfLength = 0.25f + 1.25f * NextRandom(seed);
+	shape->Set(b2Vec2(-halfLength, 0.0f), b2Vec2(halfLength, 0.0f));
+	shape->SetPrevEdge(NULL, shape->GetCorner1Vector(), false);
+	shape->SetNextEdge(NULL, shape->GetCorner2Vector(), false);
+}
+
+// The radius of a circle about the shape origin that holds the shape.
+static float32 GetBoundingRadius(const b2CircleShape* shape)
+{
+	return shape->m_radius;
+}
+
+static float32 GetBoundingRadius(const b2PolygonShape* shape)
+{
+	return shape->ComputeSweepRadius(b2Vec2_zero) + shape->m_radius;
+}
+
+static float32 GetBoundingRadius(const b2EdgeShape* shape)
+{
+	return 0.5f * shape->GetLength() + shape->m_radius;
+}
+
+static void Collide(b2Manifold* manifold, const b2CircleShape* shapeA, const b2XForm& xfA, const b2CircleShape* shapeB, const b2XForm& xfB)
+{
+	b2CollideCircles(manifold, shapeA, xfA, shapeB, xfB);
+}
+
+static void Collide(b2Manifold* manifold, const b2PolygonShape* shapeA, const b2XForm& xfA, const b2CircleShape* shapeB, const b2XForm& xfB)
+{
+	b2CollidePolygonAndCircle(manifold, shapeA, xfA, shapeB, xfB);
+}
+
+static void Collide(b2Manifold* manifold, const b2PolygonShape* shapeA, const b2XForm& xfA, const b2PolygonShape* shapeB, const b2XForm& xfB)
+{
+	b2CollidePolygons(manifold, shapeA, xfA, shapeB, xfB);
+}
+
+static void Collide(b2Manifold* manifold, const b2EdgeShape* shapeA, const b2XForm& xfA, const b2CircleShape* shapeB, const b2XForm& xfB)
+{
+	b2CollideEdgeAndCircle(manifold, shapeA, xfA, shapeB, xfB);
+}
+
+static void Collide(b2Manifold* manifold, const b2PolygonShape* shapeA, const b2XForm& xfA, const b2EdgeShape* shapeB, const b2XForm& xfB)
+{
+	b2CollidePolyAndEdge(manifold, shapeA, xfA, shapeB, xfB);
+}
+
+// Two shapes with their poses. Shape A rests, shape B sweeps into its final
+// pose over the step.
+template <typename TA, typename TB>
+struct ShapePair
+{
+	TA shapeA;
+	TB shapeB;
+	b2XForm xfA, xfB;
+	b2Sweep sweepA, sweepB;
+};
+
+template <typename TA, typename TB>
+static void MakePair(ShapePair<TA, TB>* pair, PairCase pairCase, uint32* seed)
+{
+	MakeShape(&pair->shapeA, seed);
+	MakeShape(&pair->shapeB, seed);
+
+	float32 angleA = 2.0f * b2_pi * NextRandom(seed);
+	float32 angleB = 2.0f * b2_pi * NextRandom(seed);
+	float32 direction = 2.0f * b2_pi * NextRandom(seed);
+	b2Vec2 axis(cosf(direction), sinf(direction));
+
+	float32 radius = GetBoundingRadius(&pair->shapeA) + GetBoundingRadius(&pair->shapeB);
+	float32 distance = 0.0f;
+	switch (pairCase)
+	{
+	case e_overlapping:
+		distance = 0.5f * radius * NextRandom(seed);
+		break;
+
+	case e_touching:
+	case e_separated:
+		distance = radius + 0.1f + 2.0f * NextRandom(seed);
+		break;
+
+	default:
+		// Shape B sits exactly on shape A.
+		angleB = angleA;
+		break;
+	}
+
+	pair->xfA.Set(b2Vec2_zero, angleA);
+	pair->xfB.Set(distance * axis, angleB);
+
+	if (pairCase == e_touching)
+	{
+		// Slide shape B back along the closest points until the skins meet.
+		b2SimplexCache cache;
+		cache.count = 0;
+		b2DistanceInput input;
+		input.transformA = pair->xfA;
+		input.transformB = pair->xfB;
+		input.useRadii = true;
+		b2DistanceOutput output;
+		b2Distance(&output, &cache, &input, &pair->shapeA, &pair->shapeB);
+		pair->xfB.position += output.pointA - output.pointB;
+	}
+
+	pair->sweepA.localCenter.SetZero();
+	pair->sweepA.c0 = pair->sweepA.c = pair->xfA.position;
+	pair->sweepA.a0 = pair->sweepA.a = angleA;
+	pair->sweepA.t0 = 0.0f;
+
+	// Shape B comes in from further out along the axis, spinning a little.
+	// The degenerate pair does not move at all.
+	pair->sweepB.localCenter.SetZero();
+	pair->sweepB.c = pair->xfB.position;
+	pair->sweepB.a = angleB;
+	pair->sweepB.c0 = pair->sweepB.c;
+	pair->sweepB.a0 = angleB;
+	pair->sweepB.t0 = 0.0f;
+	if (pairCase != e_degenerate)
+	{
+		pair->sweepB.c0 += (1.0f + 2.0f * NextRandom(seed)) * axis;
+		pair->sweepB.a0 += NextRandom(seed) - 0.5f;
+	}
+}
+
+static void PrintHistogram(const char* label, const int32* bins)
+{
+	printf("%-8s", label);
+	for (int32 i = 0; i < k_binCount; ++i)
+	{
+		if (bins[i] > 0)
+		{
+			printf(" %d%s:%d", i, i == k_binCount - 1 ? "+" : "", bins[i]);
+		}
+	}
+	printf("\n");
+}
+
+// Time the manifold, distance and TOI kernels for one shape pair in every
+// case, then print the GJK and TOI iteration histograms.
+template <typename TA, typename TB>
+static void RunKernels(const char* name, int32 passCount)
+{
+	ShapePair<TA, TB>* pairs = new ShapePair<TA, TB>[k_pairCount];
+
+	for (int32 c = 0; c < e_pairCaseCount; ++c)
+	{
+		uint32 seed = 1234 + 77 * c;
+		for (int32 i = 0; i < k_pairCount; ++i)
+		{
+			MakePair(pairs + i, PairCase(c), &seed);
+		}
+
+		int32 callCount = passCount * k_pairCount;
+		int32 pointCount = 0;
+
+		double start = GetMilliseconds();
+		for (int32 k = 0; k < passCount; ++k)
+		{
+			for (int32 i = 0; i < k_pairCount; ++i)
+			{
+				const ShapePair<TA, TB>& pair = pairs[i];
+				b2Manifold manifold;
+				Collide(&manifold, &pair.shapeA, pair.xfA, &pair.shapeB, pair.xfB);
+				pointCount += manifold.m_pointCount;
+			}
+		}
+		double manifoldTime = GetMilliseconds() - start;
+
+		// Start every query cold, like a new contact.
+		start = GetMilliseconds();
+		for (int32 k = 0; k < passCount; ++k)
+		{
+			for (int32 i = 0; i < k_pairCount; ++i)
+			{
+				const ShapePair<TA, TB>& pair = pairs[i];
+				b2SimplexCache cache;
+				cache.count = 0;
+				b2DistanceInput input;
+				input.transformA = pair.xfA;
+				input.transformB = pair.xfB;
+				input.useRadii = true;
+				b2DistanceOutput output;
+				b2Distance(&output, &cache, &input, &pair.shapeA, &pair.shapeB);
+			}
+		}
+		double distanceTime = GetMilliseconds() - start;
+
+		start = GetMilliseconds();
+		for (int32 k = 0; k < passCount; ++k)
+		{
+			for (int32 i = 0; i < k_pairCount; ++i)
+			{
+				const ShapePair<TA, TB>& pair = pairs[i];
+				b2TOIInput input;
+				input.sweepA = pair.sweepA;
+				input.sweepB = pair.sweepB;
+				input.sweepRadiusA = pair.shapeA.ComputeSweepRadius(pair.sweepA.localCenter);
+				input.sweepRadiusB = pair.shapeB.ComputeSweepRadius(pair.sweepB.localCenter);
+				input.tolerance = b2_linearSlop;
+				b2TimeOfImpact(&input, &pair.shapeA, &pair.shapeB);
+			}
+		}
+		double toiTime = GetMilliseconds() - start;
+
+		// The histograms come from an untimed pass over the same pairs.
+		int32 gjkBins[k_binCount] = {0};
+		int32 toiBins[k_binCount] = {0};
+		for (int32 i = 0; i < k_pairCount; ++i)
+		{
+			const ShapePair<TA, TB>& pair = pairs[i];
+
+			b2SimplexCache cache;
+			cache.count = 0;
+			b2DistanceInput distanceInput;
+			distanceInput.transformA = pair.xfA;
+			distanceInput.transformB = pair.xfB;
+			distanceInput.useRadii = true;
+			b2DistanceOutput distanceOutput;
+			b2Distance(&distanceOutput, &cache, &distanceInput, &pair.shapeA, &pair.shapeB);
+			++gjkBins[b2Min(distanceOutput.iterations, k_binCount - 1)];
+
+			// b2TimeOfImpact only keeps the most iterations seen.
+			b2TOIInput toiInput;
+			toiInput.sweepA = pair.sweepA;
+			toiInput.sweepB = pair.sweepB;
+			toiInput.sweepRadiusA = pair.shapeA.ComputeSweepRadius(pair.sweepA.localCenter);
+			toiInput.sweepRadiusB = pair.shapeB.ComputeSweepRadius(pair.sweepB.localCenter);
+			toiInput.tolerance = b2_linearSlop;
+			b2_maxToiIters = 0;
+			b2TimeOfImpact(&toiInput, &pair.shapeA, &pair.shapeB);
+			++toiBins[b2Min(b2_maxToiIters, k_binCount - 1)];
+		}
+
+		double toNanoseconds = 1.0e6 / b2Max(callCount, 1);
+		printf("%-16s %-12s %10.1f %10.1f %10.1f %8.2f\n", name, s_pairCaseNames[c],
+			manifoldTime * toNanoseconds, distanceTime * toNanoseconds, toiTime * toNanoseconds,
+			double(pointCount) / b2Max(callCount, 1));
+		PrintHistogram("  gjk", gjkBins);
+		PrintHistogram("  toi", toiBins);
+	}
+
+	delete [] pairs;
+}
+
+// Run each collision kernel over seeded random shape pairs and report the
+// time per call. Run it in the float and the fixed build, see "make kernels".
+void KernelBenchmark(const Settings& settings)
+{
+	// Scale with -steps so short runs stay short.
+	int32 passCount = b2Max(settings.stepCount / 20, 1);
+
+	printf("%s, %d calls per kernel and case, iteration histograms as iterations:pairs\n", s_numberType, passCount * k_pairCount);
+	printf("%-16s %-12s %10s %10s %10s %8s\n", "pair", "case", "manifold", "distance", "toi", "points");
+	printf("%-16s %-12s %10s %10s %10s\n", "", "", "(ns/call)", "(ns/call)", "(ns/call)");
+
+	RunKernels<b2CircleShape, b2CircleShape>("circle/circle", passCount);
+	RunKernels<b2PolygonShape, b2CircleShape>("polygon/circle", passCount);
+	RunKernels<b2PolygonShape, b2PolygonShape>("polygon/polygon", passCount);
+	RunKernels<b2EdgeShape, b2CircleShape>("edge/circle", passCount);
+	RunKernels<b2PolygonShape, b2EdgeShape>("polygon/edge", passCount);
+}
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// A level of static tiles under a grid of dynamic boxes, about 2000 fixtures.
+const int32 k_tileRows = 4;
+const int32 k_tileColumns = 250;
+const int32 k_boxRows = 25;
+const int32 k_boxColumns = 40;
+const int32 k_bodyCount = k_tileRows * k_tileColumns + k_boxRows * k_boxColumns;
+const int32 k_loadCount = 5;
+
+static void GetLevel(b2BodyDef* bodyDefs, b2PolygonDef* tileDef, b2PolygonDef* boxDef)
+{
+	tileDef->SetAsBox(0.75f, 0.75f);
+
+	boxDef->SetAsBox(0.5f, 0.5f);
+	boxDef->density = 1.0f;
+	boxDef->friction = 0.3f;
+
+	int32 index = 0;
+	for (int32 i = 0; i < k_tileRows; ++i)
+	{
+		for (int32 j = 0; j < k_tileColumns; ++j)
+		{
+			bodyDefs[index++].position.Set(-187.5f + 1.5f * j, -1.5f * i);
+		}
+	}
+
+	for (int32 i = 0; i < k_boxRows; ++i)
+	{
+		for (int32 j = 0; j < k_boxColumns; ++j)
+		{
+			bodyDefs[index++].position.Set(-78.0f + 4.0f * j, 2.0f + 3.0f * i);
+		}
+	}
+}
+
+static void LoadOneByOne(b2World* world, const b2BodyDef* bodyDefs, const b2PolygonDef* tileDef, const b2PolygonDef* boxDef)
+{
+	for (int32 i = 0; i < k_bodyCount; ++i)
+	{
+		b2Body* body = world->CreateBody(bodyDefs + i);
+		if (i < k_tileRows * k_tileColumns)
+		{
+			body->CreateFixture(tileDef);
+		}
+		else
+		{
+			body->CreateFixture(boxDef);
+			body->SetMassFromShapes();
+		}
+	}
+}
+
+static void LoadBatch(b2World* world, const b2BodyDef* bodyDefs, const b2PolygonDef* tileDef, const b2PolygonDef* boxDef)
+{
+	const b2FixtureDef** fixtureDefs = new const b2FixtureDef*[k_bodyCount];
+	int32* fixtureCounts = new int32[k_bodyCount];
+	for (int32 i = 0; i < k_bodyCount; ++i)
+	{
+		fixtureDefs[i] = i < k_tileRows * k_tileColumns ? tileDef : boxDef;
+		fixtureCounts[i] = 1;
+	}
+
+	world->CreateBodies(bodyDefs, k_bodyCount, fixtureDefs, fixtureCounts, NULL);
+
+	delete [] fixtureDefs;
+	delete [] fixtureCounts;
+}
+
+// Load the same level with CreateBody/CreateFixture/SetMassFromShapes per body
+// and with one CreateBodies call. Reports the mean time of the load and of the
+// first step, which finds the initial pairs.
+void LoadBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	b2BodyDef* bodyDefs = new b2BodyDef[k_bodyCount];
+	b2PolygonDef tileDef, boxDef;
+	GetLevel(bodyDefs, &tileDef, &boxDef);
+
+	printf("%-12s %-8s %8s %10s %12s %10s\n", "broadphase", "load", "bodies", "load (ms)", "step (ms)", "pairs");
+
+	const char* broadPhaseNames[2] = {"sap", "tree"};
+	b2BroadPhaseType broadPhaseTypes[2] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		for (int32 batch = 0; batch < 2; ++batch)
+		{
+			double loadTime = 0.0, stepTime = 0.0;
+			int32 pairCount = 0;
+			for (int32 k = 0; k < k_loadCount; ++k)
+			{
+				b2World* world = CreateWorld(broadPhaseTypes[i]);
+
+				double start = GetMilliseconds();
+				if (batch)
+				{
+					LoadBatch(world, bodyDefs, &tileDef, &boxDef);
+				}
+				else
+				{
+					LoadOneByOne(world, bodyDefs, &tileDef, &boxDef);
+				}
+				loadTime += GetMilliseconds() - start;
+
+				start = GetMilliseconds();
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				stepTime += GetMilliseconds() - start;
+
+				pairCount = world->GetPairCount();
+				delete world;
+			}
+
+			printf("%-12s %-8s %8d %10.3f %12.3f %10d\n", broadPhaseNames[i], batch ? "batch" : "single",
+				k_bodyCount, loadTime / k_loadCount, stepTime / k_loadCount, pairCount);
+		}
+	}
+
+	delete [] bodyDefs;
+}
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void Usage()
+{
+	printf("usage: benchmark [-steps n] [-hz n] [-vel n] [-pos n] [-format text|csv|json] [-scene name] [name...]\n");
+	printf("benchmarks:");
+	for (int32 i = 0; g_benchmarkEntries[i].name != NULL; ++i)
+	{
+		printf(" %s", g_benchmarkEntries[i].name);
+	}
+	printf("\n");
+}
+
+// Runs the named benchmarks, or all of them, without a window.
+int main(int argc, char** argv)
+{
+	Settings settings;
+	const char* names[32];
+	int32 nameCount = 0;
+
+	for (int32 i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-' && i + 1 < argc)
+		{
+			int32 value = atoi(argv[i + 1]);
+			if (strcmp(argv[i], "-format") == 0)
+			{
+				settings.format = argv[i + 1];
+				if (strcmp(settings.format, "text") != 0 && strcmp(settings.format, "csv") != 0 && strcmp(settings.format, "json") != 0)
+				{
+					Usage();
+					return 1;
+				}
+			}
+			else if (strcmp(argv[i], "-scene") == 0)
+			{
+				settings.sceneName = argv[i + 1];
+			}
+			else if (strcmp(argv[i], "-steps") == 0)
+			{
+				settings.stepCount = value;
+			}
+			else if (strcmp(argv[i], "-hz") == 0)
+			{
+				settings.hz = float32(value);
+			}
+			else if (strcmp(argv[i], "-vel") == 0)
+			{
+				settings.velocityIterations = value;
+			}
+			else if (strcmp(argv[i], "-pos") == 0)
+			{
+				settings.positionIterations = value;
+			}
+			else
+			{
+				Usage();
+				return 1;
+			}
+			++i;
+		}
+		else if (argv[i][0] == '-')
+		{
+			Usage();
+			return 1;
+		}
+		else if (nameCount < 32)
+		{
+			names[nameCount++] = argv[i];
+		}
+	}
+
+	int32 runCount = 0;
+	for (int32 i = 0; g_benchmarkEntries[i].name != NULL; ++i)
+	{
+		bool selected = nameCount == 0;
+		for (int32 j = 0; j < nameCount; ++j)
+		{
+			selected = selected || strcmp(names[j], g_benchmarkEntries[i].name) == 0;
+		}
+
+		if (selected)
+		{
+			// Keep csv and json output clean for scripts.
+			bool text = strcmp(settings.format, "text") == 0;
+			if (text)
+			{
+				printf("== %s ==\n", g_benchmarkEntries[i].name);
+			}
+			g_benchmarkEntries[i].runFcn(settings);
+			if (text)
+			{
+				printf("\n");
+			}
+			++runCount;
+		}
+	}
+
+	if (runCount == 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	return 0;
+}
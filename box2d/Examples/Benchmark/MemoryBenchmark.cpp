@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+static int32 GetTotal(const int32* bytes)
+{
+	int32 total = 0;
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		total += bytes[i];
+	}
+	return total;
+}
+
+// Step every scene, destroy every other dynamic body and trim the block
+// allocator. Reports the live blocks before, the live bytes after, the
+// chunk bytes before and after and the time the trim took. Chunks that
+// still hold a live block can't be released.
+void MemoryBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-16s %8s %12s %12s %12s %12s %10s\n", "scene", "blocks", "live after", "chunks", "chunks after", "released", "trim (ms)");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+		scene.createFcn(world);
+
+		for (int32 k = 0; k < settings.stepCount; ++k)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		}
+
+		b2BlockAllocatorStats stats;
+		world->GetBlockAllocatorStats(&stats);
+		int32 blockCount = stats.liveBlockCount;
+		int32 chunkBytes = GetTotal(stats.chunkBytes);
+
+		bool destroy = false;
+		b2Body* next = NULL;
+		for (b2Body* b = world->GetBodyList(); b; b = next)
+		{
+			next = b->GetNext();
+			if (b->IsStatic() == false)
+			{
+				if (destroy)
+				{
+					world->DestroyBody(b);
+				}
+				destroy = !destroy;
+			}
+		}
+
+		double start = GetMilliseconds();
+		int32 released = world->TrimMemory();
+		double time = GetMilliseconds() - start;
+
+		world->GetBlockAllocatorStats(&stats);
+
+		printf("%-16s %8d %12d %12d %12d %12d %10.3f\n", scene.name, blockCount, GetTotal(stats.liveBytes),
+			chunkBytes, GetTotal(stats.chunkBytes), released, time);
+
+		delete world;
+	}
+}
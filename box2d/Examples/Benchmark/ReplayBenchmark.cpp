@@ -0,0 +1,202 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// A recorded input: an impulse on the body at a position in the body list.
+struct InputEvent
+{
+	int32 step;
+	int32 body;
+	b2Vec2 impulse;
+};
+
+static const int32 k_inputInterval = 8;
+
+// Record a pseudo random input log. It only depends on the seed, never on the world.
+static InputEvent* RecordInputs(int32 stepCount, int32 bodyCount, int32* eventCount)
+{
+	*eventCount = stepCount / k_inputInterval;
+	InputEvent* events = (InputEvent*)malloc(b2Max(*eventCount, 1) * sizeof(InputEvent));
+
+	uint32 seed = 12345;
+	for (int32 i = 0; i < *eventCount; ++i)
+	{
+		InputEvent& e = events[i];
+		e.step = i * k_inputInterval;
+		seed = seed * 1664525 + 1013904223;
+		e.body = int32((seed >> 8) % uint32(bodyCount));
+		seed = seed * 1664525 + 1013904223;
+		float x = float((seed >> 8) & 0xff) / 128.0f - 1.0f;
+		seed = seed * 1664525 + 1013904223;
+		float y = float((seed >> 8) & 0xff) / 128.0f;
+		e.impulse.Set(4.0f * x, 4.0f * y);
+	}
+
+	return events;
+}
+
+// Apply the inputs of each step, step the world and store the world checksum.
+static void Simulate(b2World* world, const Settings& settings, const InputEvent* events, int32 eventCount,
+					 int32 firstStep, int32 lastStep, uint32* checksums)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	for (int32 step = firstStep; step < lastStep; ++step)
+	{
+		for (int32 i = 0; i < eventCount; ++i)
+		{
+			if (events[i].step != step)
+			{
+				continue;
+			}
+
+			b2Body* b = world->GetBodyList();
+			for (int32 k = 0; b && k < events[i].body; ++k)
+			{
+				b = b->GetNext();
+			}
+
+			if (b && b->IsStatic() == false)
+			{
+				b->ApplyImpulse(b->GetMass() * events[i].impulse, b->GetWorldCenter());
+			}
+		}
+
+		world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		checksums[step] = world->GetChecksum();
+	}
+}
+
+// Get the first step where the checksums differ, or -1.
+static int32 FindDesync(const uint32* expected, const uint32* actual, int32 firstStep, int32 lastStep)
+{
+	for (int32 step = firstStep; step < lastStep; ++step)
+	{
+		if (expected[step] != actual[step])
+		{
+			return step;
+		}
+	}
+
+	return -1;
+}
+
+static void PrintDesync(int32 step)
+{
+	if (step < 0)
+	{
+		printf(" %12s", "ok");
+	}
+	else
+	{
+		printf(" %12d", step);
+	}
+}
+
+// Record an input log and the per step checksums of every scene, then check that
+// a fresh world replaying the log, and a world restored from a snapshot half way,
+// produce the same checksums. The columns show the first step that differs. The
+// last column repeats the rollback with the deterministic mode off.
+void ReplayBenchmark(const Settings& settings)
+{
+	int32 stepCount = settings.stepCount;
+	int32 halfCount = stepCount / 2;
+
+	const b2BroadPhaseType types[] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	const char* typeNames[] = {"sap", "tree"};
+
+	uint32* expected = (uint32*)malloc(b2Max(stepCount, 1) * sizeof(uint32));
+	uint32* actual = (uint32*)malloc(b2Max(stepCount, 1) * sizeof(uint32));
+
+	printf("%-16s %6s %8s %12s %12s %12s\n", "scene", "broad", "bodies", "replay", "rollback", "rollback off");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		for (int32 t = 0; t < 2; ++t)
+		{
+			int32 bodyCount = 0;
+			int32 eventCount = 0;
+			InputEvent* events = NULL;
+
+			for (int32 mode = 0; mode < 2; ++mode)
+			{
+				bool deterministic = mode == 0;
+
+				// Record.
+				b2World* world = CreateWorld(types[t]);
+				world->SetDeterministic(deterministic);
+				scene.createFcn(world);
+
+				if (events == NULL)
+				{
+					bodyCount = world->GetBodyCount();
+					events = RecordInputs(stepCount, bodyCount, &eventCount);
+					printf("%-16s %6s %8d", scene.name, typeNames[t], bodyCount);
+				}
+
+				Simulate(world, settings, events, eventCount, 0, halfCount, expected);
+
+				int32 size = world->WriteSnapshot(NULL, 0);
+				void* snapshot = malloc(size);
+				world->WriteSnapshot(snapshot, size);
+
+				Simulate(world, settings, events, eventCount, halfCount, stepCount, expected);
+				delete world;
+
+				// Replay from the start.
+				if (deterministic)
+				{
+					world = CreateWorld(types[t]);
+					world->SetDeterministic(true);
+					scene.createFcn(world);
+					Simulate(world, settings, events, eventCount, 0, stepCount, actual);
+					PrintDesync(FindDesync(expected, actual, 0, stepCount));
+					delete world;
+				}
+
+				// Roll back to the snapshot and replay the second half.
+				world = CreateWorld(types[t]);
+				world->SetDeterministic(deterministic);
+				bool ok = world->ReadSnapshot(snapshot, size);
+				free(snapshot);
+
+				if (ok)
+				{
+					Simulate(world, settings, events, eventCount, halfCount, stepCount, actual);
+					PrintDesync(FindDesync(expected, actual, halfCount, stepCount));
+				}
+				else
+				{
+					printf(" %12s", "failed");
+				}
+				delete world;
+			}
+
+			printf("\n");
+			free(events);
+		}
+	}
+
+	free(actual);
+	free(expected);
+}
@@ -0,0 +1,209 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+static const char* s_numberType = "fixed";
+#else
+static const char* s_numberType = "float";
+#endif
+
+// What one scene run measured.
+struct SceneReport
+{
+	const char* name;
+	int32 bodyCount;
+	int32 jointCount;
+	int32 stepCount;
+	double minTime;
+	double medianTime;
+	double p99Time;
+	double meanTime;
+	int32 contactCount;
+	int32 maxContactCount;
+	int32 pairCount;
+	int32 maxPairCount;
+	int32 proxyCount;
+	int32 stackPeak;
+	int32 stackCapacity;
+	int32 chunkCount;
+	int32 liveBlockCount;
+	int32 liveBytes;
+	int32 chunkBytes;
+	b2Profile meanProfile;
+};
+
+static int CompareTimes(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void RunScene(SceneReport* report, const Scene& scene, const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+	int32 stepCount = b2Max(settings.stepCount, 1);
+
+	b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+	scene.createFcn(world);
+
+	memset(report, 0, sizeof(SceneReport));
+	report->name = scene.name;
+	report->stepCount = stepCount;
+
+	double* times = new double[stepCount];
+	double total = 0.0;
+	report->meanProfile.SetZero();
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		double start = GetMilliseconds();
+		world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		times[i] = GetMilliseconds() - start;
+		total += times[i];
+		report->meanProfile.Add(world->GetProfile());
+
+		report->maxContactCount = b2Max(report->maxContactCount, world->GetContactCount());
+		report->maxPairCount = b2Max(report->maxPairCount, world->GetPairCount());
+		report->stackPeak = b2Max(report->stackPeak, world->GetStackPeak());
+	}
+
+	qsort(times, stepCount, sizeof(double), CompareTimes);
+	report->minTime = times[0];
+	report->medianTime = times[stepCount / 2];
+	report->p99Time = times[b2Min(stepCount - 1, (99 * stepCount) / 100)];
+	report->meanTime = total / stepCount;
+	report->meanProfile.Scale(1.0f / stepCount);
+	delete [] times;
+
+	report->bodyCount = world->GetBodyCount();
+	report->jointCount = world->GetJointCount();
+	report->contactCount = world->GetContactCount();
+	report->pairCount = world->GetPairCount();
+	report->proxyCount = world->GetProxyCount();
+	report->stackCapacity = world->GetStackCapacity();
+
+	b2BlockAllocatorStats stats;
+	world->GetBlockAllocatorStats(&stats);
+	report->chunkCount = stats.chunkCount;
+	report->liveBlockCount = stats.liveBlockCount;
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		report->liveBytes += stats.liveBytes[i];
+		report->chunkBytes += stats.chunkBytes[i];
+	}
+
+	delete world;
+}
+
+static void PrintHeader(const Settings& settings)
+{
+	if (strcmp(settings.format, "csv") == 0)
+	{
+		printf("scene,type,bodies,joints,steps,min_ms,median_ms,p99_ms,mean_ms,"
+			"contacts,max_contacts,pairs,max_pairs,proxies,"
+			"stack_peak,stack_capacity,chunks,live_blocks,live_bytes,chunk_bytes,"
+			"collide_ms,solve_ms,islands_ms,solve_init_ms,solve_velocity_ms,solve_position_ms,"
+			"synchronize_ms,broadphase_ms,solve_toi_ms\n");
+	}
+	else if (strcmp(settings.format, "json") == 0)
+	{
+		printf("{\n\t\"type\": \"%s\",\n\t\"hz\": %g,\n\t\"velocityIterations\": %d,\n\t\"positionIterations\": %d,\n\t\"scenes\": [",
+			s_numberType, double(settings.hz), settings.velocityIterations, settings.positionIterations);
+	}
+	else
+	{
+		printf("%-14s %6s %6s %9s %9s %9s %8s %8s %8s %10s %10s\n",
+			"scene", "type", "bodies", "min ms", "median ms", "p99 ms", "contacts", "pairs", "proxies", "stack", "blocks");
+	}
+}
+
+static void PrintReport(const SceneReport& r, const Settings& settings, bool first)
+{
+	const b2Profile& p = r.meanProfile;
+	if (strcmp(settings.format, "csv") == 0)
+	{
+		printf("%s,%s,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,",
+			r.name, s_numberType, r.bodyCount, r.jointCount, r.stepCount,
+			r.minTime, r.medianTime, r.p99Time, r.meanTime,
+			r.contactCount, r.maxContactCount, r.pairCount, r.maxPairCount, r.proxyCount,
+			r.stackPeak, r.stackCapacity, r.chunkCount, r.liveBlockCount, r.liveBytes, r.chunkBytes);
+		printf("%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+			p.collide, p.solve, p.islands, p.solveInit, p.solveVelocity, p.solvePosition,
+			p.synchronize, p.broadphase, p.solveTOI);
+	}
+	else if (strcmp(settings.format, "json") == 0)
+	{
+		printf("%s\n\t\t{\"scene\": \"%s\", \"bodies\": %d, \"joints\": %d, \"steps\": %d,\n", first ? "" : ",",
+			r.name, r.bodyCount, r.jointCount, r.stepCount);
+		printf("\t\t\"stepMs\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"mean\": %.4f},\n",
+			r.minTime, r.medianTime, r.p99Time, r.meanTime);
+		printf("\t\t\"contacts\": %d, \"maxContacts\": %d, \"pairs\": %d, \"maxPairs\": %d, \"proxies\": %d,\n",
+			r.contactCount, r.maxContactCount, r.pairCount, r.maxPairCount, r.proxyCount);
+		printf("\t\t\"stack\": {\"peak\": %d, \"capacity\": %d},\n", r.stackPeak, r.stackCapacity);
+		printf("\t\t\"blocks\": {\"chunks\": %d, \"live\": %d, \"liveBytes\": %d, \"chunkBytes\": %d},\n",
+			r.chunkCount, r.liveBlockCount, r.liveBytes, r.chunkBytes);
+		printf("\t\t\"profileMs\": {\"collide\": %.4f, \"solve\": %.4f, \"islands\": %.4f, \"solveInit\": %.4f, "
+			"\"solveVelocity\": %.4f, \"solvePosition\": %.4f, \"synchronize\": %.4f, \"broadphase\": %.4f, \"solveTOI\": %.4f}}",
+			p.collide, p.solve, p.islands, p.solveInit, p.solveVelocity, p.solvePosition,
+			p.synchronize, p.broadphase, p.solveTOI);
+	}
+	else
+	{
+		printf("%-14s %6s %6d %9.3f %9.3f %9.3f %8d %8d %8d %10d %10d\n",
+			r.name, s_numberType, r.bodyCount, r.minTime, r.medianTime, r.p99Time,
+			r.maxContactCount, r.maxPairCount, r.proxyCount, r.stackPeak, r.chunkBytes);
+	}
+}
+
+// Step each scene, or the one given with -scene, and report per step times,
+// mean phase times, broad-phase counts and allocator use. Use -format csv or -format json to
+// track the numbers from a script.
+void ReportBenchmark(const Settings& settings)
+{
+	PrintHeader(settings);
+
+	int32 runCount = 0;
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		if (settings.sceneName != NULL && strcmp(settings.sceneName, g_scenes[i].name) != 0)
+		{
+			continue;
+		}
+
+		SceneReport report;
+		RunScene(&report, g_scenes[i], settings);
+		PrintReport(report, settings, runCount == 0);
+		++runCount;
+	}
+
+	if (strcmp(settings.format, "json") == 0)
+	{
+		printf("\n\t]\n}\n");
+	}
+
+	if (runCount == 0)
+	{
+		fprintf(stderr, "unknown scene %s\n", settings.sceneName);
+	}
+}
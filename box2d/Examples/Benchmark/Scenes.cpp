@@ -0,0 +1,685 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <sys/time.h>
+
+static void CreateGround(b2World* world, float32 halfWidth)
+{
+	b2PolygonDef sd;
+	sd.SetAsBox(halfWidth, 10.0f);
+
+	b2BodyDef bd;
+	bd.position.Set(0.0f, -10.0f);
+	b2Body* ground = world->CreateBody(&bd);
+	ground->CreateFixture(&sd);
+}
+
+static void CreatePyramidBoxes(b2World* world, int32 count, float32 offsetX)
+{
+	b2PolygonDef sd;
+	float32 a = 0.5f;
+	sd.SetAsBox(a, a);
+	sd.density = 5.0f;
+
+	b2Vec2 x(-0.5625f * count + 4.0625f + offsetX, 0.75f);
+	b2Vec2 y;
+	b2Vec2 deltaX(0.5625f, 1.25f);
+	b2Vec2 deltaY(1.125f, 0.0f);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		y = x;
+
+		for (int32 j = i; j < count; ++j)
+		{
+			b2BodyDef bd;
+			bd.position = y;
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+
+			y += deltaY;
+		}
+
+		x += deltaX;
+	}
+}
+
+static void CreatePyramid(b2World* world, int32 count)
+{
+	CreateGround(world, 50.0f);
+	CreatePyramidBoxes(world, count, 0.0f);
+}
+
+static void CreatePyramid(b2World* world)
+{
+	CreatePyramid(world, 25);
+}
+
+// Too many proxies for a fixed size broad-phase.
+static void CreateLargePyramid(b2World* world)
+{
+	CreatePyramid(world, 60);
+}
+
+static void CreateVerticalStack(b2World* world)
+{
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f, b2Vec2(0.0f, -10.0f), 0.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, 0.0f);
+		b2Body* ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+
+		sd.SetAsBox(0.1f, 10.0f, b2Vec2(20.0f, 10.0f), 0.0f);
+		ground->CreateFixture(&sd);
+	}
+
+	float32 xs[5] = {0.0f, -10.0f, -5.0f, 5.0f, 10.0f};
+
+	for (int32 j = 0; j < 5; ++j)
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.5f, 0.5f);
+		sd.density = 1.0f;
+		sd.friction = 0.3f;
+
+		for (int32 i = 0; i < 16; ++i)
+		{
+			b2BodyDef bd;
+			bd.position.Set(xs[j], 0.752f + 1.54f * i);
+			b2Body* body = world->CreateBody(&bd);
+
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+		}
+	}
+}
+
+static void CreateWeb(b2World* world)
+{
+	b2Body* ground = NULL;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+	}
+
+	b2PolygonDef sd;
+	sd.SetAsBox(0.5f, 0.5f);
+	sd.density = 5.0f;
+	sd.friction = 0.2f;
+
+	b2Vec2 positions[4] =
+	{
+		b2Vec2(-5.0f, 5.0f), b2Vec2(5.0f, 5.0f), b2Vec2(5.0f, 15.0f), b2Vec2(-5.0f, 15.0f)
+	};
+
+	b2Body* bodies[4];
+	for (int32 i = 0; i < 4; ++i)
+	{
+		b2BodyDef bd;
+		bd.position = positions[i];
+		bodies[i] = world->CreateBody(&bd);
+		bodies[i]->CreateFixture(&sd);
+		bodies[i]->SetMassFromShapes();
+	}
+
+	// The joints of the TestBed Web: four to the ground, four around the square.
+	struct Link
+	{
+		int32 body1, body2;
+		b2Vec2 anchor1, anchor2;
+	};
+
+	Link links[8] =
+	{
+		{-1, 0, b2Vec2(-10.0f, 10.0f), b2Vec2(-0.5f, -0.5f)},
+		{-1, 1, b2Vec2(10.0f, 10.0f), b2Vec2(0.5f, -0.5f)},
+		{-1, 2, b2Vec2(10.0f, 30.0f), b2Vec2(0.5f, 0.5f)},
+		{-1, 3, b2Vec2(-10.0f, 30.0f), b2Vec2(-0.5f, 0.5f)},
+		{0, 1, b2Vec2(0.5f, 0.0f), b2Vec2(-0.5f, 0.0f)},
+		{1, 2, b2Vec2(0.0f, 0.5f), b2Vec2(0.0f, -0.5f)},
+		{2, 3, b2Vec2(-0.5f, 0.0f), b2Vec2(0.5f, 0.0f)},
+		{3, 0, b2Vec2(0.0f, -0.5f), b2Vec2(0.0f, 0.5f)},
+	};
+
+	b2DistanceJointDef jd;
+	jd.frequencyHz = 4.0f;
+	jd.dampingRatio = 0.5f;
+
+	for (int32 i = 0; i < 8; ++i)
+	{
+		jd.body1 = links[i].body1 < 0 ? ground : bodies[links[i].body1];
+		jd.body2 = bodies[links[i].body2];
+		jd.localAnchor1 = links[i].anchor1;
+		jd.localAnchor2 = links[i].anchor2;
+		b2Vec2 d = jd.body2->GetWorldPoint(jd.localAnchor2) - jd.body1->GetWorldPoint(jd.localAnchor1);
+		jd.length = d.Length();
+		world->CreateJoint(&jd);
+	}
+}
+
+// Many small stacks that come to rest and fall asleep one by one.
+static void CreateStacks(b2World* world)
+{
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		b2Body* ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+	}
+
+	b2PolygonDef sd;
+	sd.SetAsBox(0.5f, 0.5f);
+	sd.density = 1.0f;
+	sd.friction = 0.3f;
+
+	for (int32 j = 0; j < 32; ++j)
+	{
+		for (int32 i = 0; i < 6; ++i)
+		{
+			b2BodyDef bd;
+			bd.position.Set(-46.5f + 3.0f * j, 0.752f + 1.04f * i + 0.25f * j);
+			b2Body* body = world->CreateBody(&bd);
+
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+		}
+	}
+}
+
+// Many independent islands of the same size, for parallel island solving.
+static void CreatePyramids(b2World* world)
+{
+	CreateGround(world, 190.0f);
+
+	for (int32 i = 0; i < 16; ++i)
+	{
+		CreatePyramidBoxes(world, 12, -183.0f + 24.0f * i);
+	}
+}
+
+static void CreateDominos(b2World* world)
+{
+	b2Body* b1;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		b1 = world->CreateBody(&bd);
+		b1->CreateFixture(&sd);
+	}
+
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(6.0f, 0.25f);
+
+		b2BodyDef bd;
+		bd.position.Set(-1.5f, 10.0f);
+		b2Body* ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+	}
+
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.1f, 1.0f);
+		sd.density = 20.0f;
+		sd.friction = 0.1f;
+
+		for (int i = 0; i < 10; ++i)
+		{
+			b2BodyDef bd;
+			bd.position.Set(-6.0f + 1.0f * i, 11.25f);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+		}
+	}
+
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(7.0f, 0.25f, b2Vec2_zero, 0.3f);
+
+		b2BodyDef bd;
+		bd.position.Set(1.0f, 6.0f);
+		b2Body* ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+	}
+
+	b2Body* b2;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.25f, 1.5f);
+
+		b2BodyDef bd;
+		bd.position.Set(-7.0f, 4.0f);
+		b2 = world->CreateBody(&bd);
+		b2->CreateFixture(&sd);
+	}
+
+	b2Body* b3;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(6.0f, 0.125f);
+		sd.density = 10.0f;
+
+		b2BodyDef bd;
+		bd.position.Set(-0.9f, 1.0f);
+		bd.angle = -0.15f;
+
+		b3 = world->CreateBody(&bd);
+		b3->CreateFixture(&sd);
+		b3->SetMassFromShapes();
+	}
+
+	b2RevoluteJointDef jd;
+	b2Vec2 anchor;
+
+	anchor.Set(-2.0f, 1.0f);
+	jd.Initialize(b1, b3, anchor);
+	jd.collideConnected = true;
+	world->CreateJoint(&jd);
+
+	b2Body* b4;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.25f, 0.25f);
+		sd.density = 10.0f;
+
+		b2BodyDef bd;
+		bd.position.Set(-10.0f, 15.0f);
+		b4 = world->CreateBody(&bd);
+		b4->CreateFixture(&sd);
+		b4->SetMassFromShapes();
+	}
+
+	anchor.Set(-7.0f, 15.0f);
+	jd.Initialize(b2, b4, anchor);
+	world->CreateJoint(&jd);
+
+	b2Body* b5;
+	{
+		b2BodyDef bd;
+		bd.position.Set(6.5f, 3.0f);
+		b5 = world->CreateBody(&bd);
+
+		b2PolygonDef sd;
+		sd.density = 10.0f;
+		sd.friction = 0.1f;
+
+		sd.SetAsBox(1.0f, 0.1f, b2Vec2(0.0f, -0.9f), 0.0f);
+		b5->CreateFixture(&sd);
+
+		sd.SetAsBox(0.1f, 1.0f, b2Vec2(-0.9f, 0.0f), 0.0f);
+		b5->CreateFixture(&sd);
+
+		sd.SetAsBox(0.1f, 1.0f, b2Vec2(0.9f, 0.0f), 0.0f);
+		b5->CreateFixture(&sd);
+
+		b5->SetMassFromShapes();
+	}
+
+	anchor.Set(6.0f, 2.0f);
+	jd.Initialize(b1, b5, anchor);
+	world->CreateJoint(&jd);
+
+	b2Body* b6;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(1.0f, 0.1f);
+		sd.density = 30.0f;
+		sd.friction = 0.2f;
+
+		b2BodyDef bd;
+		bd.position.Set(6.5f, 4.1f);
+		b6 = world->CreateBody(&bd);
+		b6->CreateFixture(&sd);
+		b6->SetMassFromShapes();
+	}
+
+	anchor.Set(7.5f, 4.0f);
+	jd.Initialize(b5, b6, anchor);
+	world->CreateJoint(&jd);
+
+	b2Body* b7;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.1f, 1.0f);
+		sd.density = 10.0f;
+
+		b2BodyDef bd;
+		bd.position.Set(7.4f, 1.0f);
+
+		b7 = world->CreateBody(&bd);
+		b7->CreateFixture(&sd);
+		b7->SetMassFromShapes();
+	}
+
+	b2DistanceJointDef djd;
+	djd.body1 = b3;
+	djd.body2 = b7;
+	djd.localAnchor1.Set(6.0f, 0.0f);
+	djd.localAnchor2.Set(0.0f, -1.0f);
+	b2Vec2 d = djd.body2->GetWorldPoint(djd.localAnchor2) - djd.body1->GetWorldPoint(djd.localAnchor1);
+	djd.length = d.Length();
+	world->CreateJoint(&djd);
+
+	{
+		b2CircleDef sd;
+		sd.radius = 0.2f;
+		sd.density = 10.0f;
+
+		for (int32 i = 0; i < 4; ++i)
+		{
+			b2BodyDef bd;
+			bd.position.Set(5.9f + 2.0f * sd.radius * i, 2.4f);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+		}
+	}
+}
+
+static void CreateBridge(b2World* world)
+{
+	b2Body* ground = NULL;
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+	}
+
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(0.5f, 0.125f);
+		sd.density = 20.0f;
+		sd.friction = 0.2f;
+
+
+		b2RevoluteJointDef jd;
+		const int32 numPlanks = 30;
+
+		b2Body* prevBody = ground;
+		for (int32 i = 0; i < numPlanks; ++i)
+		{
+			b2BodyDef bd;
+			bd.position.Set(-14.5f + 1.0f * i, 5.0f);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+			body->SetMassFromShapes();
+
+			b2Vec2 anchor(-15.0f + 1.0f * i, 5.0f);
+			jd.Initialize(prevBody, body, anchor);
+			world->CreateJoint(&jd);
+
+			prevBody = body;
+		}
+
+		b2Vec2 anchor(-15.0f + 1.0f * numPlanks, 5.0f);
+		jd.Initialize(prevBody, ground, anchor);
+		world->CreateJoint(&jd);
+	}
+
+	for (int32 i = 0; i < 2; ++i)
+	{
+		b2PolygonDef sd;
+		sd.vertexCount = 3;
+		sd.vertices[0].Set(-0.5f, 0.0f);
+		sd.vertices[1].Set(0.5f, 0.0f);
+		sd.vertices[2].Set(0.0f, 1.5f);
+		sd.density = 1.0f;
+
+		b2BodyDef bd;
+		bd.position.Set(-8.0f + 8.0f * i, 12.0f);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&sd);
+		body->SetMassFromShapes();
+	}
+
+	for (int32 i = 0; i < 3; ++i)
+	{
+		b2CircleDef sd;
+		sd.radius = 0.5f;
+		sd.density = 1.0f;
+
+		b2BodyDef bd;
+		bd.position.Set(-6.0f + 6.0f * i, 10.0f);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&sd);
+		body->SetMassFromShapes();
+	}
+}
+
+static void CreateTheoJansenLeg(b2World* world, float32 s, const b2Vec2& wheelAnchor, const b2Vec2& offset, b2Body* chassis, b2Body* wheel)
+{
+	b2Vec2 p1(5.4f * s, -6.1f);
+	b2Vec2 p2(7.2f * s, -1.2f);
+	b2Vec2 p3(4.3f * s, -1.9f);
+	b2Vec2 p4(3.1f * s, 0.8f);
+	b2Vec2 p5(6.0f * s, 1.5f);
+	b2Vec2 p6(2.5f * s, 3.7f);
+
+	b2PolygonDef sd1, sd2;
+	sd1.vertexCount = 3;
+	sd2.vertexCount = 3;
+	sd1.filter.groupIndex = -1;
+	sd2.filter.groupIndex = -1;
+	sd1.density = 1.0f;
+	sd2.density = 1.0f;
+
+	if (s > 0.0f)
+	{
+		sd1.vertices[0] = p1;
+		sd1.vertices[1] = p2;
+		sd1.vertices[2] = p3;
+
+		sd2.vertices[0] = b2Vec2_zero;
+		sd2.vertices[1] = p5 - p4;
+		sd2.vertices[2] = p6 - p4;
+	}
+	else
+	{
+		sd1.vertices[0] = p1;
+		sd1.vertices[1] = p3;
+		sd1.vertices[2] = p2;
+
+		sd2.vertices[0] = b2Vec2_zero;
+		sd2.vertices[1] = p6 - p4;
+		sd2.vertices[2] = p5 - p4;
+	}
+
+	b2BodyDef bd1, bd2;
+	bd1.position = offset;
+	bd2.position = p4 + offset;
+
+	bd1.angularDamping = 10.0f;
+	bd2.angularDamping = 10.0f;
+
+	b2Body* body1 = world->CreateBody(&bd1);
+	b2Body* body2 = world->CreateBody(&bd2);
+
+	body1->CreateFixture(&sd1);
+	body2->CreateFixture(&sd2);
+
+	body1->SetMassFromShapes();
+	body2->SetMassFromShapes();
+
+	b2DistanceJointDef djd;
+
+	// Using a soft distance constraint can reduce some jitter.
+	// It also makes the structure seem a bit more fluid by
+	// acting like a suspension system.
+	djd.dampingRatio = 0.5f;
+	djd.frequencyHz = 10.0f;
+
+	djd.Initialize(body1, body2, p2 + offset, p5 + offset);
+	world->CreateJoint(&djd);
+
+	djd.Initialize(body1, body2, p3 + offset, p4 + offset);
+	world->CreateJoint(&djd);
+
+	djd.Initialize(body1, wheel, p3 + offset, wheelAnchor + offset);
+	world->CreateJoint(&djd);
+
+	djd.Initialize(body2, wheel, p6 + offset, wheelAnchor + offset);
+	world->CreateJoint(&djd);
+
+	b2RevoluteJointDef rjd;
+
+	rjd.Initialize(body2, chassis, p4 + offset);
+	world->CreateJoint(&rjd);
+}
+
+// The TestBed walker with its motor on, driving to the right.
+static void CreateTheoJansen(b2World* world)
+{
+	b2Vec2 offset(0.0f, 8.0f);
+	b2Vec2 pivot(0.0f, 0.8f);
+
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(50.0f, 10.0f);
+
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		b2Body* ground = world->CreateBody(&bd);
+		ground->CreateFixture(&sd);
+
+		sd.SetAsBox(0.5f, 5.0f, b2Vec2(-50.0f, 15.0f), 0.0f);
+		ground->CreateFixture(&sd);
+
+		sd.SetAsBox(0.5f, 5.0f, b2Vec2(50.0f, 15.0f), 0.0f);
+		ground->CreateFixture(&sd);
+	}
+
+	for (int32 i = 0; i < 40; ++i)
+	{
+		b2CircleDef sd;
+		sd.density = 1.0f;
+		sd.radius = 0.25f;
+
+		b2BodyDef bd;
+		bd.position.Set(-40.0f + 2.0f * i, 0.5f);
+
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&sd);
+		body->SetMassFromShapes();
+	}
+
+	b2Body* chassis;
+	{
+		b2PolygonDef sd;
+		sd.density = 1.0f;
+		sd.SetAsBox(2.5f, 1.0f);
+		sd.filter.groupIndex = -1;
+		b2BodyDef bd;
+		bd.position = pivot + offset;
+		chassis = world->CreateBody(&bd);
+		chassis->CreateFixture(&sd);
+		chassis->SetMassFromShapes();
+	}
+
+	b2Body* wheel;
+	{
+		b2CircleDef sd;
+		sd.density = 1.0f;
+		sd.radius = 1.6f;
+		sd.filter.groupIndex = -1;
+		b2BodyDef bd;
+		bd.position = pivot + offset;
+		wheel = world->CreateBody(&bd);
+		wheel->CreateFixture(&sd);
+		wheel->SetMassFromShapes();
+	}
+
+	{
+		b2RevoluteJointDef jd;
+		jd.Initialize(wheel, chassis, pivot + offset);
+		jd.collideConnected = false;
+		jd.motorSpeed = 2.0f;
+		jd.maxMotorTorque = 400.0f;
+		jd.enableMotor = true;
+		world->CreateJoint(&jd);
+	}
+
+	b2Vec2 wheelAnchor;
+	
+	wheelAnchor = pivot + b2Vec2(0.0f, -0.8f);
+
+	CreateTheoJansenLeg(world, -1.0f, wheelAnchor, offset, chassis, wheel);
+	CreateTheoJansenLeg(world, 1.0f, wheelAnchor, offset, chassis, wheel);
+
+	wheel->SetXForm(wheel->GetPosition(), 120.0f * b2_pi / 180.0f);
+	CreateTheoJansenLeg(world, -1.0f, wheelAnchor, offset, chassis, wheel);
+	CreateTheoJansenLeg(world, 1.0f, wheelAnchor, offset, chassis, wheel);
+
+	wheel->SetXForm(wheel->GetPosition(), -120.0f * b2_pi / 180.0f);
+	CreateTheoJansenLeg(world, -1.0f, wheelAnchor, offset, chassis, wheel);
+	CreateTheoJansenLeg(world, 1.0f, wheelAnchor, offset, chassis, wheel);
+}
+
+Scene g_scenes[] =
+{
+	{"Pyramid", CreatePyramid},
+	{"VerticalStack", CreateVerticalStack},
+	{"Web", CreateWeb},
+	{"LargePyramid", CreateLargePyramid},
+	{"Stacks", CreateStacks},
+	{"Pyramids", CreatePyramids},
+	{"Dominos", CreateDominos},
+	{"Bridge", CreateBridge},
+	{"TheoJansen", CreateTheoJansen},
+	{NULL, NULL}
+};
+
+b2World* CreateWorld(b2BroadPhaseType broadPhaseType, int32 stackSize)
+{
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-200.0f, -100.0f);
+	worldAABB.upperBound.Set(200.0f, 200.0f);
+	b2Vec2 gravity;
+	gravity.Set(0.0f, -10.0f);
+	bool doSleep = true;
+
+	return new b2World(worldAABB, gravity, doSleep, broadPhaseType, stackSize);
+}
+
+double GetMilliseconds()
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	return 1000.0 * t.tv_sec + 0.001 * t.tv_usec;
+}
@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// The largest position or angle difference between the bodies of two worlds.
+// The bodies of a restored world are in the same list order.
+static float GetMaxError(b2World* worldA, b2World* worldB)
+{
+	float maxError = 0.0f;
+	b2Body* bA = worldA->GetBodyList();
+	b2Body* bB = worldB->GetBodyList();
+	for (; bA && bB; bA = bA->GetNext(), bB = bB->GetNext())
+	{
+		if (bA->GetIndex() != bB->GetIndex())
+		{
+			return -1.0f;
+		}
+
+		b2Vec2 d = bA->GetPosition() - bB->GetPosition();
+		float32 da = bA->GetAngle() - bB->GetAngle();
+		float error = float(b2Max(b2Max(b2Abs(d.x), b2Abs(d.y)), b2Abs(da)));
+		if (error > maxError)
+		{
+			maxError = error;
+		}
+	}
+
+	return bA == bB ? maxError : -1.0f;
+}
+
+// Step every scene half way, write a snapshot and restore it into a new world.
+// Then step both for the other half and compare them. An error of zero means
+// the restored world continues exactly like the original. The sweep and prune
+// pair manager reports new pairs in proxy id order, and a restore renumbers
+// the proxies, so large scenes can drift apart. The deterministic mode
+// avoids that, see the replay benchmark.
+void SnapshotBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+	int32 halfCount = settings.stepCount / 2;
+
+	const b2BroadPhaseType types[] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	const char* typeNames[] = {"sap", "tree"};
+
+	printf("%-16s %6s %8s %10s %10s %10s %12s\n", "scene", "broad", "bodies", "bytes", "write ms", "read ms", "max error");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		for (int32 t = 0; t < 2; ++t)
+		{
+			b2World* world = CreateWorld(types[t]);
+			scene.createFcn(world);
+
+			for (int32 k = 0; k < halfCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+			}
+
+			int32 size = world->WriteSnapshot(NULL, 0);
+			void* buffer = malloc(size);
+
+			double start = GetMilliseconds();
+			world->WriteSnapshot(buffer, size);
+			double writeTime = GetMilliseconds() - start;
+
+			b2World* restored = CreateWorld(types[t]);
+
+			start = GetMilliseconds();
+			bool ok = restored->ReadSnapshot(buffer, size);
+			double readTime = GetMilliseconds() - start;
+
+			free(buffer);
+
+			for (int32 k = 0; k < halfCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				restored->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+			}
+
+			float error = ok ? GetMaxError(world, restored) : -1.0f;
+
+			printf("%-16s %6s %8d %10d %10.3f %10.3f %12.6f\n", scene.name, typeNames[t], world->GetBodyCount(),
+				size, writeTime, readTime, error);
+
+			delete restored;
+			delete world;
+		}
+	}
+}
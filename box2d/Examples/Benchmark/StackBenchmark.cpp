@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// Step every scene starting with a small and with the default stack size.
+// Reports the peak stack use of any step, the final stack size, how many
+// allocations fell back to b2Alloc and the time per step.
+void StackBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-16s %10s %10s %10s %10s %10s\n", "scene", "initial", "peak", "final", "overflows", "ms/step");
+
+	const int32 stackSizes[] = {16 * 1024, b2_stackSize};
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2World* world = CreateWorld(e_dynamicTreeBroadPhase, stackSizes[j]);
+			scene.createFcn(world);
+
+			int32 peak = 0;
+			double start = GetMilliseconds();
+			for (int32 k = 0; k < settings.stepCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				peak = b2Max(peak, world->GetStackPeak());
+			}
+			double time = GetMilliseconds() - start;
+
+			printf("%-16s %10d %10d %10d %10d %10.3f\n", scene.name, stackSizes[j], peak,
+				world->GetStackCapacity(), world->GetStackOverflowCount(), time / b2Max(settings.stepCount, 1));
+
+			delete world;
+		}
+	}
+}
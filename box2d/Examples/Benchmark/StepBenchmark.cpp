@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+static const char* s_numberType = "fixed";
+#else
+static const char* s_numberType = "float";
+#endif
+
+// The sum of all body positions and angles, to compare builds.
+static float GetChecksum(b2World* world)
+{
+	float sum = 0.0f;
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		b2Vec2 p = b->GetPosition();
+		sum += float(p.x) + float(p.y) + float(b->GetAngle());
+	}
+	return sum;
+}
+
+// Step every scene and report the time per step and a checksum. Run it in
+// the float and the fixed build to compare them, see "make compare".
+void StepBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-16s %8s %8s %12s %14s\n", "scene", "type", "bodies", "ms/step", "checksum");
+
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		const Scene& scene = g_scenes[i];
+
+		b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+		scene.createFcn(world);
+
+		double start = GetMilliseconds();
+		for (int32 k = 0; k < settings.stepCount; ++k)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+		}
+		double time = GetMilliseconds() - start;
+
+		printf("%-16s %8s %8d %12.3f %14.3f\n", scene.name, s_numberType, world->GetBodyCount(),
+			time / b2Max(settings.stepCount, 1), GetChecksum(world));
+
+		delete world;
+	}
+}
@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// Inside of the arena walls.
+static const float32 k_arenaHalfWidth = 40.0f;
+static const float32 k_arenaHeight = 60.0f;
+
+// A small deterministic generator so every run fires the same shots.
+static float32 NextRandom(uint32* seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return float32(int32((*seed >> 8) & 0xffff)) / 65535.0f;
+}
+
+// A closed arena of thin static walls with static pegs inside.
+static void CreateArena(b2World* world)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	float32 w = k_arenaHalfWidth;
+	float32 h = k_arenaHeight;
+	float32 t = 0.1f;
+
+	b2PolygonDef sd;
+	sd.friction = 0.3f;
+	sd.SetAsBox(w + t, t, b2Vec2(0.0f, -t), 0.0f);
+	ground->CreateFixture(&sd);
+	sd.SetAsBox(w + t, t, b2Vec2(0.0f, h + t), 0.0f);
+	ground->CreateFixture(&sd);
+	sd.SetAsBox(t, 0.5f * h, b2Vec2(-w - t, 0.5f * h), 0.0f);
+	ground->CreateFixture(&sd);
+	sd.SetAsBox(t, 0.5f * h, b2Vec2(w + t, 0.5f * h), 0.0f);
+	ground->CreateFixture(&sd);
+
+	// Thin baffles the projectiles must not pass through.
+	for (int32 i = 0; i < 4; ++i)
+	{
+		float32 x = -30.0f + 20.0f * i;
+		sd.SetAsBox(t, 8.0f, b2Vec2(x, 20.0f + 10.0f * (i & 1)), 0.3f * (i - 1.5f));
+		ground->CreateFixture(&sd);
+	}
+
+	b2CircleDef cd;
+	cd.radius = 0.5f;
+	for (int32 i = 0; i < 8; ++i)
+	{
+		for (int32 j = 0; j < 3; ++j)
+		{
+			cd.localPosition.Set(-35.0f + 10.0f * i, 45.0f + 5.0f * j);
+			ground->CreateFixture(&cd);
+		}
+	}
+}
+
+// Rows of resting balls on the floor. They add many contacts that are not
+// TOI events.
+static void CreateBalls(b2World* world)
+{
+	b2CircleDef cd;
+	cd.radius = 0.4f;
+	cd.density = 1.0f;
+	cd.friction = 0.3f;
+
+	for (int32 i = 0; i < 4; ++i)
+	{
+		for (int32 j = 0; j < 80; ++j)
+		{
+			b2BodyDef bd;
+			bd.position.Set(-39.5f + 1.0f * j, 0.4f + 0.8f * i);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&cd);
+			body->SetMassFromShapes();
+		}
+	}
+}
+
+// Fire projectiles from the middle of the arena in random directions. Every
+// fourth projectile is a bullet so that dynamic versus dynamic TOIs happen too.
+static void CreateProjectiles(b2World* world, int32 count)
+{
+	uint32 seed = 12345;
+
+	b2CircleDef cd;
+	cd.radius = 0.25f;
+	cd.density = 1.0f;
+	cd.restitution = 0.9f;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2BodyDef bd;
+		bd.position.Set(-20.0f + 40.0f * NextRandom(&seed), 10.0f + 25.0f * NextRandom(&seed));
+		bd.isBullet = (i & 3) == 0;
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&cd);
+		body->SetMassFromShapes();
+
+		float32 angle = 2.0f * b2_pi * NextRandom(&seed);
+		float32 speed = 100.0f + 100.0f * NextRandom(&seed);
+		body->SetLinearVelocity(speed * b2Vec2(cosf(angle), sinf(angle)));
+	}
+}
+
+// The number of projectiles that tunneled out of the arena.
+static int32 GetEscapedCount(b2World* world)
+{
+	int32 count = 0;
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->IsStatic())
+		{
+			continue;
+		}
+
+		b2Vec2 p = b->GetPosition();
+		if (p.x < -k_arenaHalfWidth || k_arenaHalfWidth < p.x || p.y < 0.0f || k_arenaHeight < p.y)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+// Step fast projectiles in a closed arena with and without continuous physics
+// and report the time per step and how many projectiles escaped.
+void TOIBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	printf("%-12s %12s %16s %12s %16s\n", "projectiles", "ccd (ms)", "discrete (ms)", "ccd escaped", "discrete escaped");
+
+	const int32 counts[] = {100, 200, 400, 800};
+	for (int32 i = 0; i < 4; ++i)
+	{
+		double times[2];
+		int32 escaped[2];
+
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+			world->SetContinuousPhysics(j == 0);
+			CreateArena(world);
+			CreateBalls(world);
+			CreateProjectiles(world, counts[i]);
+
+			double start = GetMilliseconds();
+			for (int32 k = 0; k < settings.stepCount; ++k)
+			{
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+			}
+			times[j] = GetMilliseconds() - start;
+			escaped[j] = GetEscapedCount(world);
+
+			delete world;
+		}
+
+		int32 stepCount = b2Max(settings.stepCount, 1);
+		printf("%-12d %12.3f %16.3f %12d %16d\n", counts[i],
+			times[0] / stepCount, times[1] / stepCount, escaped[0], escaped[1]);
+	}
+}
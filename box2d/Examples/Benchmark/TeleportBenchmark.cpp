@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include "Benchmark.h"
+
+#include <cstdio>
+
+// A pool of dynamic boxes on a ground box. Every frame all of them respawn.
+const int32 k_teleportCount = 1000;
+
+static void CreatePool(b2World* world, b2Body** bodies)
+{
+	{
+		b2BodyDef bd;
+		bd.position.Set(0.0f, -10.0f);
+		b2Body* ground = world->CreateBody(&bd);
+
+		b2PolygonDef sd;
+		sd.SetAsBox(150.0f, 10.0f);
+		ground->CreateFixture(&sd);
+	}
+
+	b2PolygonDef sd;
+	sd.SetAsBox(0.5f, 0.5f);
+	sd.density = 1.0f;
+	sd.friction = 0.3f;
+
+	for (int32 i = 0; i < k_teleportCount; ++i)
+	{
+		b2BodyDef bd;
+		bd.position.Set(-100.0f + 2.0f * (i % 100), 1.0f + 2.0f * (i / 100));
+		bodies[i] = world->CreateBody(&bd);
+		bodies[i]->CreateFixture(&sd);
+		bodies[i]->SetMassFromShapes();
+	}
+}
+
+// Get the respawn points of a frame. Some of the boxes overlap each other.
+static void GetSpawnPoints(int32 frame, b2Vec2* positions, float32* angles)
+{
+	uint32 seed = 12345 + 7919 * frame;
+	for (int32 i = 0; i < k_teleportCount; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		float x = float((seed >> 8) % 2000) / 10.0f - 100.0f;
+		seed = seed * 1664525 + 1013904223;
+		float y = float((seed >> 8) % 400) / 10.0f + 1.0f;
+		positions[i].Set(x, y);
+		angles[i] = 0.01f * float(i % 314);
+	}
+}
+
+// Respawn 1000 bodies per frame with a b2Body::SetXForm call per body and with
+// one b2World::SetXForms call, then step. SetXForm commits the broad-phase for
+// every body. Reports the mean teleport and step times and the contact count
+// right after the last teleport, which must match. The two methods create the
+// contacts in a different order, so the solver rounds differently and the
+// counts after stepping may drift apart.
+void TeleportBenchmark(const Settings& settings)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+	int32 frameCount = b2Max(settings.stepCount / 10, 1);
+
+	b2Body* bodies[k_teleportCount];
+	b2Vec2 positions[k_teleportCount];
+	float32 angles[k_teleportCount];
+
+	printf("%-12s %-8s %8s %14s %12s %10s\n", "broadphase", "method", "bodies", "teleport (ms)", "step (ms)", "contacts");
+
+	const char* broadPhaseNames[2] = {"sap", "tree"};
+	b2BroadPhaseType broadPhaseTypes[2] = {e_sweepAndPruneBroadPhase, e_dynamicTreeBroadPhase};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		for (int32 batch = 0; batch < 2; ++batch)
+		{
+			b2World* world = CreateWorld(broadPhaseTypes[i]);
+			CreatePool(world, bodies);
+
+			double teleportTime = 0.0, stepTime = 0.0;
+			int32 contactCount = 0;
+			for (int32 frame = 0; frame < frameCount; ++frame)
+			{
+				GetSpawnPoints(frame, positions, angles);
+
+				double start = GetMilliseconds();
+				if (batch)
+				{
+					world->SetXForms(bodies, positions, angles, k_teleportCount);
+				}
+				else
+				{
+					for (int32 k = 0; k < k_teleportCount; ++k)
+					{
+						bodies[k]->SetXForm(positions[k], angles[k]);
+					}
+				}
+				teleportTime += GetMilliseconds() - start;
+				contactCount = world->GetContactCount();
+
+				start = GetMilliseconds();
+				world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+				stepTime += GetMilliseconds() - start;
+			}
+
+			printf("%-12s %-8s %8d %14.3f %12.3f %10d\n", broadPhaseNames[i], batch ? "batch" : "single",
+				k_teleportCount, teleportTime / frameCount, stepTime / frameCount, contactCount);
+
+			delete world;
+		}
+	}
+}
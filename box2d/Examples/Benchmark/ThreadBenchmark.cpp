@@ -0,0 +1,145 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Counts the PostSolve calls and sums the impulses, so listener buffering
+// is part of the measurement and of the comparison.
+class ImpulseListener : public b2ContactListener
+{
+public:
+	ImpulseListener() : m_count(0), m_sum(0.0f) {}
+
+	void PostSolve(const b2Contact* contact, const b2ContactImpulse* impulse)
+	{
+		const b2Manifold* manifold = const_cast<b2Contact*>(contact)->GetManifold();
+		for (int32 i = 0; i < manifold->m_pointCount; ++i)
+		{
+			m_sum += impulse->normalImpulses[i];
+		}
+		++m_count;
+	}
+
+	int32 m_count;
+	float32 m_sum;
+};
+
+// The sum of all body positions and angles, to check that the thread
+// count doesn't change the simulation.
+static float32 GetChecksum(b2World* world)
+{
+	float32 sum = 0.0f;
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		b2Vec2 p = b->GetPosition();
+		sum += p.x + p.y + b->GetAngle();
+	}
+	return sum;
+}
+
+// Step a scene without a task scheduler and with thread pools of increasing
+// size. Reports the time per step, the speedup over the serial run and
+// whether the result matches the serial run.
+static void RunScene(const Settings& settings, const char* sceneName)
+{
+	float32 timeStep = settings.hz > 0.0f ? 1.0f / settings.hz : float32(0.0f);
+
+	const Scene* scene = NULL;
+	for (int32 i = 0; g_scenes[i].name != NULL; ++i)
+	{
+		if (strcmp(g_scenes[i].name, sceneName) == 0)
+		{
+			scene = g_scenes + i;
+		}
+	}
+	b2Assert(scene != NULL);
+
+	const int32 threadCounts[] = {0, 1, 2, 4, 8};
+	const int32 runCount = sizeof(threadCounts) / sizeof(threadCounts[0]);
+
+	double serialTime = 0.0;
+	float32 serialChecksum = 0.0f;
+	float32 serialImpulse = 0.0f;
+
+	for (int32 i = 0; i < runCount; ++i)
+	{
+		b2World* world = CreateWorld(e_dynamicTreeBroadPhase);
+		scene->createFcn(world);
+
+		ImpulseListener listener;
+		world->SetContactListener(&listener);
+
+		b2ThreadPool* pool = NULL;
+		if (threadCounts[i] > 0)
+		{
+			pool = new b2ThreadPool(threadCounts[i]);
+			world->SetTaskScheduler(pool);
+		}
+
+		// The islands are linked during the first step.
+		int32 islandCount = 0;
+
+		double start = GetMilliseconds();
+		for (int32 k = 0; k < settings.stepCount; ++k)
+		{
+			world->Step(timeStep, settings.velocityIterations, settings.positionIterations);
+			islandCount = b2Max(islandCount, world->GetAwakeIslandCount());
+		}
+		double time = GetMilliseconds() - start;
+
+		float32 checksum = GetChecksum(world);
+		if (pool == NULL)
+		{
+			serialTime = time;
+			serialChecksum = checksum;
+			serialImpulse = listener.m_sum;
+		}
+
+		bool matches = checksum == serialChecksum && listener.m_sum == serialImpulse;
+
+		char name[16];
+		if (pool)
+		{
+			sprintf(name, "%d", threadCounts[i]);
+		}
+		else
+		{
+			sprintf(name, "serial");
+		}
+
+		printf("%-16s %-8s %8d %12.3f %10.2f %10d %10s\n", scene->name, name, islandCount,
+			time / b2Max(settings.stepCount, 1), time > 0.0 ? serialTime / time : 0.0,
+			listener.m_count, matches ? "yes" : "no");
+
+		delete world;
+		delete pool;
+	}
+}
+
+// Pyramids has many small islands to solve in parallel. LargePyramid is a
+// dense pile where most of the time goes to the narrow phase.
+void ThreadBenchmark(const Settings& settings)
+{
+	printf("%-16s %-8s %8s %12s %10s %10s %10s\n", "scene", "threads", "islands", "ms/step", "speedup", "callbacks", "matches");
+
+	RunScene(settings, "Pyramids");
+	RunScene(settings, "LargePyramid");
+}
@@ -71,6 +71,8 @@ Test::Test()
 	m_bombSpawning = false;
 
 	m_stepCount = 0;
+	m_maxProfile.SetZero();
+	m_totalProfile.SetZero();
 }
 
 Test::~Test()
@@ -299,6 +301,7 @@ void Test::Step(Settings* settings)
 
 	m_world->SetWarmStarting(settings->enableWarmStarting > 0);
 	m_world->SetContinuousPhysics(settings->enableContinuous > 0);
+	m_world->SetContactBatching(settings->enableContactBatching > 0);
 
 	m_pointCount = 0;
 
@@ -307,6 +310,10 @@ void Test::Step(Settings* settings)
 	if (timeStep > 0.0f)
 	{
 		++m_stepCount;
+
+		const b2Profile& profile = m_world->GetProfile();
+		m_maxProfile.Max(profile);
+		m_totalProfile.Add(profile);
 	}
 
 	m_world->Validate();
@@ -320,8 +327,8 @@ void Test::Step(Settings* settings)
 	if (settings->drawStats)
 	{
 		m_debugDraw.DrawString(5, m_textLine, "proxies(max) = %d(%d), pairs(max) = %d(%d)",
-			m_world->GetProxyCount(), b2_maxProxies,
-			m_world->GetPairCount(), b2_maxPairs);
+			m_world->GetProxyCount(), m_world->GetMaxProxyCount(),
+			m_world->GetPairCount(), m_world->GetMaxPairCount());
 		m_textLine += 15;
 
 		m_debugDraw.DrawString(5, m_textLine, "bodies/contacts/joints = %d/%d/%d",
@@ -332,6 +339,40 @@ void Test::Step(Settings* settings)
 		m_textLine += 15;
 	}
 
+	if (settings->drawProfile)
+	{
+		const b2Profile& p = m_world->GetProfile();
+
+		b2Profile ave = m_totalProfile;
+		if (m_stepCount > 0)
+		{
+			ave.Scale(1.0f / m_stepCount);
+		}
+
+		m_debugDraw.DrawString(5, m_textLine, "ms: last [average] (max)");
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "step = %5.2f [%6.2f] (%6.2f)", p.step, ave.step, m_maxProfile.step);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "collide = %5.2f [%6.2f] (%6.2f)", p.collide, ave.collide, m_maxProfile.collide);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "solve = %5.2f [%6.2f] (%6.2f)", p.solve, ave.solve, m_maxProfile.solve);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "islands = %5.2f [%6.2f] (%6.2f)", p.islands, ave.islands, m_maxProfile.islands);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "solve init = %5.2f [%6.2f] (%6.2f)", p.solveInit, ave.solveInit, m_maxProfile.solveInit);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "solve velocity = %5.2f [%6.2f] (%6.2f)", p.solveVelocity, ave.solveVelocity, m_maxProfile.solveVelocity);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "solve position = %5.2f [%6.2f] (%6.2f)", p.solvePosition, ave.solvePosition, m_maxProfile.solvePosition);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "synchronize = %5.2f [%6.2f] (%6.2f)", p.synchronize, ave.synchronize, m_maxProfile.synchronize);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "broad-phase = %5.2f [%6.2f] (%6.2f)", p.broadphase, ave.broadphase, m_maxProfile.broadphase);
+		m_textLine += 15;
+		m_debugDraw.DrawString(5, m_textLine, "solve TOI = %5.2f [%6.2f] (%6.2f)", p.solveTOI, ave.solveTOI, m_maxProfile.solveTOI);
+		m_textLine += 15;
+	}
+
 	if (m_mouseJoint)
 	{
 		b2Body* body = m_mouseJoint->GetBody2();
@@ -57,6 +57,7 @@ struct Settings
 		velocityIterations(10),
 		positionIterations(8),
 		drawStats(0),
+		drawProfile(0),
 		drawShapes(1),
 		drawJoints(1),
 		drawControllers(1),
@@ -71,6 +72,7 @@ struct Settings
 		drawCOMs(0),
 		enableWarmStarting(1),
 		enableContinuous(1),
+		enableContactBatching(0),
 		pause(0),
 		singleStep(0)
 		{}
@@ -91,8 +93,10 @@ struct Settings
 	int32 drawFrictionForces;
 	int32 drawCOMs;
 	int32 drawStats;
+	int32 drawProfile;
 	int32 enableWarmStarting;
 	int32 enableContinuous;
+	int32 enableContactBatching;
 	int32 pause;
 	int32 singleStep;
 };
@@ -189,6 +193,8 @@ protected:
 	bool m_bombSpawning;
 	b2Vec2 m_mouseWorld;
 	int32 m_stepCount;
+	b2Profile m_maxProfile;
+	b2Profile m_totalProfile;
 };
 
 #endif
@@ -87,7 +87,7 @@ BroadPhaseTest::BroadPhaseTest()
 	m_overlapCountExact = 0;
 	m_callback.m_test = this;
 
-	m_broadPhase = new b2BroadPhase(worldAABB, &m_callback);
+	m_broadPhase = new b2SAPBroadPhase(worldAABB, &m_callback);
 
 	memset(m_overlaps, 0, sizeof(m_overlaps));
 
@@ -185,7 +185,7 @@ void BroadPhaseTest::MoveProxy()
 		}
 
 		MoveAABB(&actor->aabb);
-		m_broadPhase->MoveProxy(actor->proxyId, actor->aabb);
+		m_broadPhase->MoveProxy(actor->proxyId, actor->aabb, b2Vec2_zero);
 		return;
 	}
 }
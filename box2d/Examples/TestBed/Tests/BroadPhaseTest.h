@@ -47,7 +47,7 @@ public:
 	{
 		b2AABB aabb;
 		int32 overlapCount;
-		uint16 proxyId;
+		int32 proxyId;
 	};
 
 	static Test* Create();
@@ -79,7 +79,7 @@ private:
 	int32 m_overlapCountExact;
 
 	Callback m_callback;
-	b2BroadPhase* m_broadPhase;
+	b2SAPBroadPhase* m_broadPhase;
 	Actor m_actors[e_actorCount];
 	bool m_overlaps[e_actorCount][e_actorCount];
 	bool m_automated;
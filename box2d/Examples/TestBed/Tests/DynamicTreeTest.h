@@ -151,15 +151,15 @@ public:
 		}
 	}
 
-	void QueryCallback(const b2AABB& aabb, void* userData)
+	void QueryCallback(int32 proxyId)
 	{
-		Actor* actor = (Actor*)userData;
-		actor->overlap = b2TestOverlap(aabb, actor->aabb);
+		Actor* actor = (Actor*)m_tree.GetProxy(proxyId);
+		actor->overlap = b2TestOverlap(m_queryAABB, actor->aabb);
 	}
 
-	void RayCastCallback(b2RayCastOutput* pOutput, const b2RayCastInput& input, void* userData)
+	void RayCastCallback(b2RayCastOutput* pOutput, const b2RayCastInput& input, int32 proxyId)
 	{
-		Actor* actor = (Actor*)userData;
+		Actor* actor = (Actor*)m_tree.GetProxy(proxyId);
 
 		actor->aabb.RayCast(pOutput, input);
 
@@ -178,7 +178,7 @@ private:
 		b2AABB aabb;
 		float32 fraction;
 		bool overlap;
-		uint16 proxyId;
+		int32 proxyId;
 	};
 
 	void GetRandomAABB(b2AABB* aabb)
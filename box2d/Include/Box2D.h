@@ -32,14 +32,18 @@ For discussion please visit http://www.box2d.org/forum
 // These include files constitute the main Box2D API
 
 #include "../Source/Common/b2Settings.h"
+#include "../Source/Common/b2TaskScheduler.h"
+#include "../Source/Common/b2ThreadPool.h"
 
 #include "../Source/Collision/Shapes/b2CircleShape.h"
 #include "../Source/Collision/Shapes/b2PolygonShape.h"
 #include "../Source/Collision/Shapes/b2EdgeShape.h"
-#include "../Source/Collision/b2BroadPhase.h"
+#include "../Source/Collision/b2SAPBroadPhase.h"
+#include "../Source/Collision/b2DynamicTreeBroadPhase.h"
 #include "../Source/Collision/b2Distance.h"
 #include "../Source/Collision/b2DynamicTree.h"
 #include "../Source/Collision/b2TimeOfImpact.h"
+#include "../Source/Dynamics/b2BakedLevel.h"
 #include "../Source/Dynamics/b2Body.h"
 #include "../Source/Dynamics/b2EdgeChain.h"
 #include "../Source/Dynamics/b2Fixture.h"
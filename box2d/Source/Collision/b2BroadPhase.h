@@ -19,140 +19,143 @@
 #ifndef B2_BROAD_PHASE_H
 #define B2_BROAD_PHASE_H
 
-/*
-This broad phase uses the Sweep and Prune algorithm as described in:
-Collision Detection in Interactive 3D Environments by Gino van den Bergen
-Also, some ideas, such as using integral values for fast compares comes from
-Bullet (http:/www.bulletphysics.com).
-*/
-
 #include "../Common/b2Settings.h"
 #include "b2Collision.h"
 #include "b2PairManager.h"
-#include <climits>
-
-#ifdef TARGET_FLOAT32_IS_FIXED
-#define	B2BROADPHASE_MAX	(USHRT_MAX/2)
-#else
-#define	B2BROADPHASE_MAX	USHRT_MAX
 
-#endif
-
-const uint16 b2_invalid = B2BROADPHASE_MAX;
-const uint16 b2_nullEdge = B2BROADPHASE_MAX;
-struct b2BoundValues;
-
-struct b2Bound
+/// The broad-phase algorithms available to a world.
+enum b2BroadPhaseType
 {
-	bool IsLower() const { return (value & 1) == 0; }
-	bool IsUpper() const { return (value & 1) == 1; }
-
-	uint16 value;
-	uint16 proxyId;
-	uint16 stabbingCount;
-};
-
-struct b2Proxy
-{
-	uint16 GetNext() const { return lowerBounds[0]; }
-	void SetNext(uint16 next) { lowerBounds[0] = next; }
-	bool IsValid() const { return overlapCount != b2_invalid; }
-
-	uint16 lowerBounds[2], upperBounds[2];
-	uint16 overlapCount;
-	uint16 timeStamp;
-	void* userData;
+	e_sweepAndPruneBroadPhase,	///< quantized sweep and prune, bounded by the world AABB
+	e_dynamicTreeBroadPhase,	///< dynamic AABB tree, unbounded
 };
 
 typedef float32 (*SortKeyFunc)(void* shape);
 
+/// The broad-phase keeps a proxy for every fixture and reports overlapping
+/// proxy pairs through the pair manager to a b2PairCallback. Concrete
+/// broad-phases implement the proxy storage and the pair finding.
 class b2BroadPhase
 {
 public:
-	b2BroadPhase(const b2AABB& worldAABB, b2PairCallback* callback);
-	~b2BroadPhase();
 
-	// Use this to see if your proxy is in range. If it is not in range,
-	// it should be destroyed. Otherwise you may get O(m^2) pairs, where m
-	// is the number of proxies that are out of range.
-	bool InRange(const b2AABB& aabb) const;
+	/// Create a broad-phase of the given type. The memory comes from b2Alloc.
+	/// @param worldAABB the bounds of the world, only used by the sweep and prune.
+	static b2BroadPhase* Create(b2BroadPhaseType type, const b2AABB& worldAABB, b2PairCallback* callback);
 
-	// Create and destroy proxies. These call Flush first.
-	uint16 CreateProxy(const b2AABB& aabb, void* userData);
-	void DestroyProxy(int32 proxyId);
+	/// Destroy a broad-phase created with Create.
+	static void Destroy(b2BroadPhase* broadPhase);
 
-	// Call MoveProxy as many times as you like, then when you are done
-	// call Commit to finalized the proxy pairs (for your time step).
-	void MoveProxy(int32 proxyId, const b2AABB& aabb);
-	void Commit();
+	virtual ~b2BroadPhase() {}
 
-	// Get a single proxy. Returns NULL if the id is invalid.
-	b2Proxy* GetProxy(int32 proxyId);
+	/// Get the type of this broad-phase.
+	b2BroadPhaseType GetType() const;
 
-	// Query an AABB for overlapping proxies, returns the user data and
-	// the count, up to the supplied maximum count.
-	int32 Query(const b2AABB& aabb, void** userData, int32 maxCount);
+	/// Use this to see if your proxy is in range. If it is not in range,
+	/// it should be destroyed. Otherwise you may get O(m^2) pairs, where m
+	/// is the number of proxies that are out of range.
+	virtual bool InRange(const b2AABB& aabb) const = 0;
 
-	// Query a segment for overlapping proxies, returns the user data and
-	// the count, up to the supplied maximum count.
-	// If sortKey is provided, then it is a function mapping from proxy userDatas to distances along the segment (between 0 & 1)
-	// Then the returned proxies are sorted on that, before being truncated to maxCount
-	// The sortKey of a proxy is assumed to be larger than the closest point inside the proxy along the segment, this allows for early exits
-	// Proxies with a negative sortKey are discarded
-	int32 QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey);
+	/// Create a proxy with a tight fitting AABB.
+	virtual int32 CreateProxy(const b2AABB& aabb, void* userData) = 0;
 
-	void Validate();
-	void ValidatePairs();
+	/// Create many proxies at once, for example when a level is loaded. The
+	/// proxy ids are written in the order of the AABBs. The default creates
+	/// them one by one.
+	virtual void CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
 
-private:
-	void ComputeBounds(uint16* lowerValues, uint16* upperValues, const b2AABB& aabb);
+	/// Create many proxies from AABBs returned by GetProxyAABB, for restoring a
+	/// world snapshot. The proxies get the same bounds they had, so the same
+	/// pairs are found. The default calls CreateProxies.
+	virtual void RestoreProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
 
-	bool TestOverlap(b2Proxy* p1, b2Proxy* p2);
-	bool TestOverlap(const b2BoundValues& b, b2Proxy* p);
+	/// Destroy a proxy. Pairs involving the proxy are removed immediately.
+	virtual void DestroyProxy(int32 proxyId) = 0;
 
-	void Query(int32* lowerIndex, int32* upperIndex, uint16 lowerValue, uint16 upperValue,
-				b2Bound* bounds, int32 boundCount, int32 axis);
-	void IncrementOverlapCount(int32 proxyId);
-	void IncrementTimeStamp();
-	void AddProxyResult(uint16 proxyId, b2Proxy* proxy, int32 maxCount, SortKeyFunc sortKey);
+	/// Call MoveProxy as many times as you like, then when you are done
+	/// call Commit to finalized the proxy pairs (for your time step).
+	/// The displacement of the proxy in this step predicts where it goes next,
+	/// the sweep and prune broad-phase stretches the fat bounds along it.
+	virtual void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement) = 0;
+	virtual void Commit() = 0;
 
-public:
-	friend class b2PairManager;
+	/// Move many proxies at once, for example when bodies are teleported. A proxy
+	/// given more than once takes its last AABB. Call Commit afterwards like for
+	/// MoveProxy. The default moves them one by one.
+	virtual void MoveProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count);
 
-	b2PairManager m_pairManager;
+	/// Get the user data of a proxy.
+	virtual void* GetUserData(int32 proxyId) const = 0;
+
+	/// Get the AABB stored by the broad-phase for a proxy. This is
+	/// usually larger than the AABB given to CreateProxy/MoveProxy.
+	virtual b2AABB GetProxyAABB(int32 proxyId) const = 0;
+
+	/// Test the overlap of two proxies as seen by the broad-phase.
+	virtual bool TestOverlap(int32 proxyIdA, int32 proxyIdB) = 0;
 
-	b2Proxy m_proxyPool[b2_maxProxies];
-	uint16 m_freeProxy;
+	/// Query an AABB for overlapping proxies, returns the user data and
+	/// the count, up to the supplied maximum count.
+	virtual int32 Query(const b2AABB& aabb, void** userData, int32 maxCount) = 0;
 
-	b2Bound m_bounds[2][2*b2_maxProxies];
+	/// Query a segment for overlapping proxies, returns the user data and
+	/// the count, up to the supplied maximum count.
+	/// If sortKey is provided, then it is a function mapping from proxy userDatas to distances along the segment (between 0 & 1)
+	/// Then the returned proxies are sorted on that, before being truncated to maxCount
+	/// Proxies with a negative sortKey are discarded
+	virtual int32 QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey) = 0;
 
-	uint16 m_queryResults[b2_maxProxies];
-	float32 m_querySortKeys[b2_maxProxies];
-	int32 m_queryResultCount;
+	/// Perform validation of the internal data structures.
+	virtual void Validate() = 0;
 
-	b2AABB m_worldAABB;
-	b2Vec2 m_quantizationFactor;
+	/// Get the number of proxies.
+	int32 GetProxyCount() const;
+
+	/// Get the number of pairs.
+	int32 GetPairCount() const;
+
+	/// Get the largest number of proxies that existed at once.
+	int32 GetMaxProxyCount() const;
+
+	/// Get the largest number of pairs that existed at once.
+	int32 GetMaxPairCount() const;
+
+protected:
+	b2BroadPhase(b2BroadPhaseType type, b2PairCallback* callback);
+
+	b2BroadPhaseType m_type;
+
+public:
+	b2PairManager m_pairManager;
 	int32 m_proxyCount;
-	uint16 m_timeStamp;
+	int32 m_maxProxyCount;
 
 	static bool s_validate;
 };
 
+inline b2BroadPhaseType b2BroadPhase::GetType() const
+{
+	return m_type;
+}
 
-inline bool b2BroadPhase::InRange(const b2AABB& aabb) const
+inline int32 b2BroadPhase::GetProxyCount() const
 {
-	b2Vec2 d = b2Max(aabb.lowerBound - m_worldAABB.upperBound, m_worldAABB.lowerBound - aabb.upperBound);
-	return b2Max(d.x, d.y) < 0.0f;
+	return m_proxyCount;
 }
 
-inline b2Proxy* b2BroadPhase::GetProxy(int32 proxyId)
+inline int32 b2BroadPhase::GetPairCount() const
 {
-	if (proxyId == b2_nullProxy || m_proxyPool[proxyId].IsValid() == false)
-	{
-		return NULL;
-	}
+	return m_pairManager.m_pairCount;
+}
 
-	return m_proxyPool + proxyId;
+inline int32 b2BroadPhase::GetMaxProxyCount() const
+{
+	return m_maxProxyCount;
+}
+
+inline int32 b2BroadPhase::GetMaxPairCount() const
+{
+	return m_pairManager.m_maxPairCount;
 }
 
 #endif
@@ -21,20 +21,29 @@
 #include <string.h>
 #include <float.h>
 
+// Clear the nodes [first, count) and build a linked list for the free list.
+// The parent pointer becomes the "next" pointer.
+static void b2InitFreeNodes(b2DynamicTreeNode* nodes, int32 first, int32 count)
+{
+	for (int32 i = first; i < count; ++i)
+	{
+		b2DynamicTreeNode* node = nodes + i;
+		node->userData = NULL;
+		node->aabb.lowerBound.SetZero();
+		node->aabb.upperBound.SetZero();
+		node->parent = i + 1;
+		node->child1 = b2_nullNode;
+		node->child2 = b2_nullNode;
+	}
+	nodes[count-1].parent = b2_nullNode;
+}
+
 b2DynamicTree::b2DynamicTree()
 {
 	m_root = b2_nullNode;
 	m_nodeCount = b2Max(b2_nodePoolSize, 1);
 	m_nodes = (b2DynamicTreeNode*)b2Alloc(m_nodeCount * sizeof(b2DynamicTreeNode));
-	memset(m_nodes, 0, m_nodeCount * sizeof(b2DynamicTreeNode));
-
-	// Build a linked list for the free list. The parent
-	// pointer becomes the "next" pointer.
-	for (int32 i = 0; i < m_nodeCount - 1; ++i)
-	{
-		m_nodes[i].parent = uint16(i + 1);
-	}
-	m_nodes[m_nodeCount-1].parent = b2_nullNode;
+	b2InitFreeNodes(m_nodes, 0, m_nodeCount);
 	m_freeList = 0;
 
 	m_path = 0;
@@ -47,12 +56,12 @@ b2DynamicTree::~b2DynamicTree()
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
-uint16 b2DynamicTree::AllocateNode()
+int32 b2DynamicTree::AllocateNode()
 {
 	// Peel a node off the free list.
 	if (m_freeList != b2_nullNode)
 	{
-		uint16 node = m_freeList;
+		int32 node = m_freeList;
 		m_freeList = m_nodes[node].parent;
 		m_nodes[node].parent = b2_nullNode;
 		m_nodes[node].child1 = b2_nullNode;
@@ -61,35 +70,32 @@ uint16 b2DynamicTree::AllocateNode()
 	}
 
 	// The free list is empty. Rebuild a bigger pool.
-	int32 newPoolCount = b2Min(2 * m_nodeCount, (int)USHRT_MAX - 1);
-	b2Assert(newPoolCount > m_nodeCount);
+	int32 newPoolCount = 2 * m_nodeCount;
 	b2DynamicTreeNode* newPool = (b2DynamicTreeNode*)b2Alloc(newPoolCount * sizeof(b2DynamicTreeNode));
-	memcpy(newPool, m_nodes, m_nodeCount * sizeof(b2DynamicTreeNode));
-	memset(newPool + m_nodeCount, 0, (newPoolCount - m_nodeCount) * sizeof(b2DynamicTreeNode));
-
-	// Build a linked list for the free list. The parent
-	// pointer becomes the "next" pointer.
-	for (int32 i = m_nodeCount; i < newPoolCount - 1; ++i)
+	for (int32 i = 0; i < m_nodeCount; ++i)
 	{
-		newPool[i].parent = uint16(i + 1);
+		newPool[i] = m_nodes[i];
 	}
-	newPool[newPoolCount-1].parent = b2_nullNode;
-	m_freeList = uint16(m_nodeCount);
+	b2InitFreeNodes(newPool, m_nodeCount, newPoolCount);
+	m_freeList = m_nodeCount;
 
 	b2Free(m_nodes);
 	m_nodes = newPool;
 	m_nodeCount = newPoolCount;
 
 	// Finally peel a node off the new free list.
-	uint16 node = m_freeList;
+	int32 node = m_freeList;
 	m_freeList = m_nodes[node].parent;
+	m_nodes[node].parent = b2_nullNode;
+	m_nodes[node].child1 = b2_nullNode;
+	m_nodes[node].child2 = b2_nullNode;
 	return node;
 }
 
 // Return a node to the pool.
-void b2DynamicTree::FreeNode(uint16 node)
+void b2DynamicTree::FreeNode(int32 node)
 {
-	b2Assert(node < USHRT_MAX);
+	b2Assert(0 <= node && node < m_nodeCount);
 	m_nodes[node].parent = m_freeList;
 	m_freeList = node;
 }
@@ -97,9 +103,9 @@ void b2DynamicTree::FreeNode(uint16 node)
 // Create a proxy in the tree as a leaf node. We return the index
 // of the node instead of a pointer so that we can grow
 // the node pool.
-uint16 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
+int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 {
-	uint16 node = AllocateNode();
+	int32 node = AllocateNode();
 
 	// Fatten the aabb.
 	b2Vec2 center = aabb.GetCenter();
@@ -113,24 +119,156 @@ uint16 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	return node;
 }
 
-void b2DynamicTree::DestroyProxy(uint16 proxyId)
+void b2DynamicTree::CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds, bool fatten)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 node = AllocateNode();
+
+		if (fatten)
+		{
+			// Fatten the aabb.
+			b2Vec2 center = aabbs[i].GetCenter();
+			b2Vec2 extents = b2_fatAABBFactor * aabbs[i].GetExtents();
+			m_nodes[node].aabb.lowerBound = center - extents;
+			m_nodes[node].aabb.upperBound = center + extents;
+		}
+		else
+		{
+			m_nodes[node].aabb = aabbs[i];
+		}
+		m_nodes[node].userData = userData[i];
+		proxyIds[i] = node;
+	}
+
+	int32* leaves = (int32*)b2Alloc(count * sizeof(int32));
+	memcpy(leaves, proxyIds, count * sizeof(int32));
+	int32 subtree = BuildTopDown(leaves, count);
+	b2Free(leaves);
+
+	if (m_root == b2_nullNode)
+	{
+		m_root = subtree;
+		m_nodes[m_root].parent = b2_nullNode;
+		return;
+	}
+
+	// Join the new subtree and the existing tree under a new root.
+	int32 root = AllocateNode();
+	m_nodes[root].userData = NULL;
+	m_nodes[root].aabb.Combine(m_nodes[m_root].aabb, m_nodes[subtree].aabb);
+	m_nodes[root].child1 = m_root;
+	m_nodes[root].child2 = subtree;
+	m_nodes[m_root].parent = root;
+	m_nodes[subtree].parent = root;
+	m_root = root;
+}
+
+// Twice the center of the node AABB along an axis.
+static inline float32 b2GetCenterKey(const b2DynamicTreeNode* node, int32 axis)
 {
-	b2Assert(proxyId < m_nodeCount);
+	const b2AABB& aabb = node->aabb;
+	return axis == 0 ? aabb.lowerBound.x + aabb.upperBound.x : aabb.lowerBound.y + aabb.upperBound.y;
+}
+
+int32 b2DynamicTree::BuildTopDown(int32* leaves, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	// Split along the longest axis of the leaf centers.
+	b2Vec2 lower = m_nodes[leaves[0]].aabb.GetCenter();
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Vec2 center = m_nodes[leaves[i]].aabb.GetCenter();
+		lower = b2Min(lower, center);
+		upper = b2Max(upper, center);
+	}
+	int32 axis = upper.x - lower.x >= upper.y - lower.y ? 0 : 1;
+
+	// Partially sort the leaves so the first half has the smaller centers.
+	int32 half = count / 2;
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low < high)
+	{
+		float32 pivot = b2GetCenterKey(m_nodes + leaves[(low + high) >> 1], axis);
+		int32 i = low;
+		int32 j = high;
+		while (i <= j)
+		{
+			while (b2GetCenterKey(m_nodes + leaves[i], axis) < pivot)
+			{
+				++i;
+			}
+			while (b2GetCenterKey(m_nodes + leaves[j], axis) > pivot)
+			{
+				--j;
+			}
+			if (i <= j)
+			{
+				int32 leaf = leaves[i];
+				leaves[i] = leaves[j];
+				leaves[j] = leaf;
+				++i;
+				--j;
+			}
+		}
+
+		if (half <= j)
+		{
+			high = j;
+		}
+		else if (half >= i)
+		{
+			low = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	int32 child1 = BuildTopDown(leaves, half);
+	int32 child2 = BuildTopDown(leaves + half, count - half);
+
+	// The pool may have moved, so only use indices above.
+	int32 node = AllocateNode();
+	m_nodes[node].userData = NULL;
+	m_nodes[node].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodes[node].child1 = child1;
+	m_nodes[node].child2 = child2;
+	m_nodes[child1].parent = node;
+	m_nodes[child2].parent = node;
+	return node;
+}
+
+void b2DynamicTree::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCount);
 	b2Assert(m_nodes[proxyId].IsLeaf());
 
 	RemoveLeaf(proxyId);
 	FreeNode(proxyId);
 }
 
-void b2DynamicTree::MoveProxy(uint16 proxyId, const b2AABB& aabb)
+bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb)
 {
-	b2Assert(proxyId < m_nodeCount);
+	b2Assert(0 <= proxyId && proxyId < m_nodeCount);
 
 	b2Assert(m_nodes[proxyId].IsLeaf());
 
 	if (m_nodes[proxyId].aabb.Contains(aabb))
 	{
-		return;
+		return false;
 	}
 
 	RemoveLeaf(proxyId);
@@ -142,11 +280,12 @@ void b2DynamicTree::MoveProxy(uint16 proxyId, const b2AABB& aabb)
 	m_nodes[proxyId].aabb.upperBound = center + extents;
 
 	InsertLeaf(proxyId);
+	return true;
 }
 
-void* b2DynamicTree::GetProxy(uint16 proxyId)
+void* b2DynamicTree::GetProxy(int32 proxyId) const
 {
-	if (proxyId < m_nodeCount)
+	if (0 <= proxyId && proxyId < m_nodeCount)
 	{
 		return m_nodes[proxyId].userData;
 	}
@@ -156,7 +295,7 @@ void* b2DynamicTree::GetProxy(uint16 proxyId)
 	}
 }
 
-void b2DynamicTree::InsertLeaf(uint16 leaf)
+void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	if (m_root == b2_nullNode)
 	{
@@ -167,13 +306,13 @@ void b2DynamicTree::InsertLeaf(uint16 leaf)
 
 	// Find the best sibling for this node.
 	b2Vec2 center = m_nodes[leaf].aabb.GetCenter();
-	uint16 sibling = m_root;
+	int32 sibling = m_root;
 	if (m_nodes[sibling].IsLeaf() == false)
 	{
 		do 
 		{
-			uint16 child1 = m_nodes[sibling].child1;
-			uint16 child2 = m_nodes[sibling].child2;
+			int32 child1 = m_nodes[sibling].child1;
+			int32 child2 = m_nodes[sibling].child2;
 
 			b2Vec2 delta1 = b2Abs(m_nodes[child1].aabb.GetCenter() - center);
 			b2Vec2 delta2 = b2Abs(m_nodes[child2].aabb.GetCenter() - center);
@@ -195,8 +334,8 @@ void b2DynamicTree::InsertLeaf(uint16 leaf)
 	}
 
 	// Create a parent for the siblings.
-	uint16 node1 = m_nodes[sibling].parent;
-	uint16 node2 = AllocateNode();
+	int32 node1 = m_nodes[sibling].parent;
+	int32 node2 = AllocateNode();
 	m_nodes[node2].parent = node1;
 	m_nodes[node2].userData = NULL;
 	m_nodes[node2].aabb.Combine(m_nodes[leaf].aabb, m_nodes[sibling].aabb);
@@ -240,7 +379,7 @@ void b2DynamicTree::InsertLeaf(uint16 leaf)
 	}
 }
 
-void b2DynamicTree::RemoveLeaf(uint16 leaf)
+void b2DynamicTree::RemoveLeaf(int32 leaf)
 {
 	if (leaf == m_root)
 	{
@@ -248,9 +387,9 @@ void b2DynamicTree::RemoveLeaf(uint16 leaf)
 		return;
 	}
 
-	uint16 node2 = m_nodes[leaf].parent;
-	uint16 node1 = m_nodes[node2].parent;
-	uint16 sibling;
+	int32 node2 = m_nodes[leaf].parent;
+	int32 node1 = m_nodes[node2].parent;
+	int32 sibling;
 	if (m_nodes[node2].child1 == leaf)
 	{
 		sibling = m_nodes[node2].child2;
@@ -305,12 +444,12 @@ void b2DynamicTree::Rebalance(int32 iterations)
 
 	for (int32 i = 0; i < iterations; ++i)
 	{
-		uint16 node = m_root;
+		int32 node = m_root;
 
 		uint32 bit = 0;
 		while (m_nodes[node].IsLeaf() == false)
 		{
-			uint16* children = &m_nodes[node].child1;
+			int32* children = &m_nodes[node].child1;
 			node = children[(m_path >> bit) & 1];
 			bit = (bit + 1) & (8* sizeof(uint32) - 1);
 		}
@@ -320,3 +459,37 @@ void b2DynamicTree::Rebalance(int32 iterations)
 		InsertLeaf(node);
 	}
 }
+
+void b2DynamicTree::Validate() const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2Assert(m_nodes[m_root].parent == b2_nullNode);
+	Validate(m_root);
+}
+
+void b2DynamicTree::Validate(int32 node) const
+{
+	const b2DynamicTreeNode* n = m_nodes + node;
+	if (n->IsLeaf())
+	{
+		b2Assert(n->child2 == b2_nullNode);
+		return;
+	}
+
+	const b2DynamicTreeNode* child1 = m_nodes + n->child1;
+	const b2DynamicTreeNode* child2 = m_nodes + n->child2;
+
+	b2Assert(child1->parent == node);
+	b2Assert(child2->parent == node);
+
+	b2AABB aabb = n->aabb;
+	b2Assert(aabb.Contains(child1->aabb));
+	b2Assert(aabb.Contains(child2->aabb));
+
+	Validate(n->child1);
+	Validate(n->child2);
+}
@@ -20,11 +20,12 @@
 #define B2_DYNAMIC_TREE_H
 
 #include "b2Collision.h"
+#include "../Common/b2GrowableStack.h"
 
-#define b2_nullNode USHRT_MAX
+#define b2_nullNode (-1)
 
 /// A node in the dynamic tree. The client does not interact with this directly.
-/// 4 + 8 + 6 = 18 bytes on a 32bit machine.
+/// 4 + 16 + 12 = 32 bytes on a 32bit machine.
 struct b2DynamicTreeNode
 {
 	bool IsLeaf() const
@@ -34,9 +35,9 @@ struct b2DynamicTreeNode
 
 	void* userData;
 	b2AABB aabb;
-	uint16 parent;
-	uint16 child1;
-	uint16 child2;
+	int32 parent;
+	int32 child1;
+	int32 child2;
 };
 
 /// A callback for AABB queries.
@@ -84,25 +85,39 @@ public:
 	~b2DynamicTree();
 
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
-	uint16 CreateProxy(const b2AABB& aabb, void* userData);
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Create many proxies at once. They are built into a balanced subtree
+	/// by splitting at the median center along the longest axis, which is
+	/// faster and gives a better tree than inserting them one by one.
+	/// @param proxyIds receives the proxy ids in the order of the AABBs.
+	/// @param fatten fatten the AABBs like CreateProxy, or use them as fat AABBs.
+	void CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds, bool fatten);
 
 	/// Destroy a proxy. This asserts if the id is invalid.
-	void DestroyProxy(uint16 proxyId);
+	void DestroyProxy(int32 proxyId);
 
 	/// Move a proxy. If the proxy has moved outside of its fattened AABB,
 	/// then the proxy is removed from the tree and re-inserted. Otherwise
 	/// the function returns immediately.
-	void MoveProxy(uint16 proxyId, const b2AABB& aabb);
+	/// @return true if the proxy was re-inserted.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb);
 
 	/// Perform some iterations to re-balance the tree.
 	void Rebalance(int32 iterations);
 
 	/// Get proxy user data.
 	/// @return the proxy user data or NULL if the id is invalid.
-	void* GetProxy(uint16 proxyId);
+	void* GetProxy(int32 proxyId) const;
+
+	/// Get the fat AABB of a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Validate the parent links and the bounds of the tree.
+	void Validate() const;
 
 	/// Query an AABB for overlapping proxies. The callback class
-	/// is called for each proxy that overlaps the supplied AABB.
+	/// is called with the id of each proxy that overlaps the supplied AABB.
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
@@ -112,24 +127,29 @@ public:
 	/// roughly equal to k * log(n), where k is the number of collisions and n is the
 	/// number of proxies in the tree.
 	/// @param input the ray-cast input data. The ray extends from p1 to p1 + maxFraction * (p2 - p1).
-	/// @param callback a callback class that is called for each proxy that is hit by the ray.
+	/// @param callback a callback class that is called with the id of each proxy that is hit by the ray.
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
 private:
 
-	uint16 AllocateNode();
-	void FreeNode(uint16 node);
+	int32 AllocateNode();
+	void FreeNode(int32 node);
+
+	void InsertLeaf(int32 node);
+	void RemoveLeaf(int32 node);
+
+	// Build a subtree over the leaves, returns its root. Reorders the leaves.
+	int32 BuildTopDown(int32* leaves, int32 count);
 
-	void InsertLeaf(uint16 node);
-	void RemoveLeaf(uint16 node);
+	void Validate(int32 node) const;
 
-	uint16 m_root;
+	int32 m_root;
 
 	b2DynamicTreeNode* m_nodes;
 	int32 m_nodeCount;
 
-	uint16 m_freeList;
+	int32 m_freeList;
 
 	/// This is used incrementally traverse the tree for re-balancing.
 	uint32 m_path;
@@ -138,32 +158,29 @@ private:
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 {
-	if (m_root == NULL)
+	if (m_root == b2_nullNode)
 	{
 		return;
 	}
 
-	const int32 k_stackSize = 32;
-	uint16 stack[k_stackSize];
+	b2GrowableStack<int32, 64> stack;
+	stack.Push(m_root);
 
-	int32 count = 0;
-	stack[count++] = m_root;
-
-	while (count > 0)
+	while (stack.GetCount() > 0)
 	{
-		const b2DynamicTreeNode* node = m_nodes + stack[--count];
+		int32 nodeId = stack.Pop();
+		const b2DynamicTreeNode* node = m_nodes + nodeId;
 
 		if (b2TestOverlap(node->aabb, aabb))
 		{
 			if (node->IsLeaf())
 			{
-				callback->QueryCallback(aabb, node->userData);
+				callback->QueryCallback(nodeId);
 			}
 			else
 			{
-				b2Assert(count + 1 < k_stackSize);
-				stack[count++] = node->child1;
-				stack[count++] = node->child2;
+				stack.Push(node->child1);
+				stack.Push(node->child2);
 			}
 		}
 	}
@@ -172,7 +189,7 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 template <typename T>
 inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	if (m_root == NULL)
+	if (m_root == b2_nullNode)
 	{
 		return;
 	}
@@ -200,15 +217,13 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 		segmentAABB.upperBound = b2Max(p1, t);
 	}
 
-	const int32 k_stackSize = 32;
-	uint16 stack[k_stackSize];
-
-	int32 count = 0;
-	stack[count++] = m_root;
+	b2GrowableStack<int32, 64> stack;
+	stack.Push(m_root);
 
-	while (count > 0)
+	while (stack.GetCount() > 0)
 	{
-		const b2DynamicTreeNode* node = m_nodes + stack[--count];
+		int32 nodeId = stack.Pop();
+		const b2DynamicTreeNode* node = m_nodes + nodeId;
 
 		if (b2TestOverlap(node->aabb, segmentAABB) == false)
 		{
@@ -234,7 +249,7 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 
 			b2RayCastOutput output;
 
-			callback->RayCastCallback(&output, subInput, node->userData);
+			callback->RayCastCallback(&output, subInput, nodeId);
 
 			if (output.hit)
 			{
@@ -256,11 +271,16 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 		}
 		else
 		{
-			b2Assert(count + 1 < k_stackSize);
-			stack[count++] = node->child1;
-			stack[count++] = node->child2;
+			stack.Push(node->child1);
+			stack.Push(node->child2);
 		}
 	}
 }
 
+inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCount);
+	return m_nodes[proxyId].aabb;
+}
+
 #endif
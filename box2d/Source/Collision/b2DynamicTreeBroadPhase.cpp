@@ -0,0 +1,344 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2DynamicTreeBroadPhase.h"
+
+#include <cstring>
+
+// Notes:
+// - the pair manager invariant is: a pair exists only if the fat AABBs of its
+//   proxies overlap. MoveProxy keeps this by removing the pairs that the old
+//   fat AABB had and the new one lost before the move is buffered.
+// - new pairs are found in Commit by querying the tree with the fat AABB of
+//   each buffered proxy. Existing pairs reported again are ignored by the
+//   pair manager.
+
+b2DynamicTreeBroadPhase::b2DynamicTreeBroadPhase(b2PairCallback* callback)
+: b2BroadPhase(e_dynamicTreeBroadPhase, callback)
+{
+	m_moveCapacity = 16;
+	m_moveCount = 0;
+	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_queryMode = e_collectProxies;
+	m_queryProxyId = b2_nullProxy;
+	m_queryResults = NULL;
+	m_querySortKeyCapacity = 0;
+	m_querySortKeys = NULL;
+	m_queryResultCount = 0;
+	m_queryMaxCount = 0;
+	m_querySortKey = NULL;
+}
+
+b2DynamicTreeBroadPhase::~b2DynamicTreeBroadPhase()
+{
+	b2Free(m_moveBuffer);
+
+	if (m_querySortKeys)
+	{
+		b2Free(m_querySortKeys);
+	}
+}
+
+void b2DynamicTreeBroadPhase::BufferMove(int32 proxyId)
+{
+	if (m_moveCount == m_moveCapacity)
+	{
+		int32* oldBuffer = m_moveBuffer;
+		m_moveCapacity *= 2;
+		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+		memcpy(m_moveBuffer, oldBuffer, m_moveCount * sizeof(int32));
+		b2Free(oldBuffer);
+	}
+
+	m_moveBuffer[m_moveCount] = proxyId;
+	++m_moveCount;
+}
+
+void b2DynamicTreeBroadPhase::UnBufferMove(int32 proxyId)
+{
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		if (m_moveBuffer[i] == proxyId)
+		{
+			m_moveBuffer[i] = b2_nullProxy;
+		}
+	}
+}
+
+int32 b2DynamicTreeBroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	++m_proxyCount;
+	m_maxProxyCount = b2Max(m_maxProxyCount, m_proxyCount);
+	BufferMove(proxyId);
+	return proxyId;
+}
+
+void b2DynamicTreeBroadPhase::CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds)
+{
+	m_tree.CreateProxies(aabbs, userData, count, proxyIds, true);
+	m_proxyCount += count;
+	m_maxProxyCount = b2Max(m_maxProxyCount, m_proxyCount);
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
+void b2DynamicTreeBroadPhase::RestoreProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds)
+{
+	m_tree.CreateProxies(aabbs, userData, count, proxyIds, false);
+	m_proxyCount += count;
+	m_maxProxyCount = b2Max(m_maxProxyCount, m_proxyCount);
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
+void b2DynamicTreeBroadPhase::DestroyProxy(int32 proxyId)
+{
+	b2Assert(m_proxyCount > 0);
+
+	UnBufferMove(proxyId);
+
+	// Every pair of this proxy overlaps its fat AABB.
+	m_queryMode = e_removePairs;
+	m_queryProxyId = proxyId;
+	m_queryAABB = m_tree.GetFatAABB(proxyId);
+	m_tree.Query(this, m_queryAABB);
+
+	m_pairManager.Commit();
+
+	m_tree.DestroyProxy(proxyId);
+	--m_proxyCount;
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+void b2DynamicTreeBroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	B2_NOT_USED(displacement);
+
+	if (aabb.IsValid() == false)
+	{
+		b2Assert(false);
+		return;
+	}
+
+	b2AABB oldAABB = m_tree.GetFatAABB(proxyId);
+
+	if (m_tree.MoveProxy(proxyId, aabb) == false)
+	{
+		// Still inside the fat AABB, the pairs are unchanged.
+		return;
+	}
+
+	// Remove the pairs of the old fat AABB that the new one doesn't overlap.
+	m_queryMode = e_removeSeparatedPairs;
+	m_queryProxyId = proxyId;
+	m_queryAABB = m_tree.GetFatAABB(proxyId);
+	m_tree.Query(this, oldAABB);
+
+	BufferMove(proxyId);
+}
+
+void b2DynamicTreeBroadPhase::Commit()
+{
+	m_queryMode = e_addPairs;
+
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		m_queryProxyId = m_moveBuffer[i];
+		if (m_queryProxyId == b2_nullProxy)
+		{
+			continue;
+		}
+
+		m_queryAABB = m_tree.GetFatAABB(m_queryProxyId);
+		m_tree.Query(this, m_queryAABB);
+	}
+
+	m_moveCount = 0;
+
+	m_pairManager.Commit();
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+bool b2DynamicTreeBroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB)
+{
+	return b2TestOverlap(m_tree.GetFatAABB(proxyIdA), m_tree.GetFatAABB(proxyIdB));
+}
+
+void b2DynamicTreeBroadPhase::QueryCallback(int32 proxyId)
+{
+	switch (m_queryMode)
+	{
+	case e_addPairs:
+		if (proxyId != m_queryProxyId)
+		{
+			m_pairManager.AddBufferedPair(m_queryProxyId, proxyId);
+		}
+		break;
+
+	case e_removePairs:
+		if (proxyId != m_queryProxyId)
+		{
+			m_pairManager.RemoveBufferedPair(m_queryProxyId, proxyId);
+		}
+		break;
+
+	case e_removeSeparatedPairs:
+		// m_queryAABB holds the new fat AABB of the query proxy.
+		if (proxyId != m_queryProxyId && b2TestOverlap(m_queryAABB, m_tree.GetFatAABB(proxyId)) == false)
+		{
+			m_pairManager.RemoveBufferedPair(m_queryProxyId, proxyId);
+		}
+		break;
+
+	case e_collectProxies:
+		AddQueryResult(m_tree.GetProxy(proxyId), 0.0f);
+		break;
+	}
+}
+
+void b2DynamicTreeBroadPhase::RayCastCallback(b2RayCastOutput* output, const b2RayCastInput& input, int32 proxyId)
+{
+	B2_NOT_USED(input);
+
+	// Keep going, the sort key does the exact test.
+	output->hit = false;
+
+	void* userData = m_tree.GetProxy(proxyId);
+	if (m_querySortKey)
+	{
+		float32 key = m_querySortKey(userData);
+
+		// Filter proxies on positive keys.
+		if (key < 0.0f)
+		{
+			return;
+		}
+
+		AddQueryResult(userData, key);
+	}
+	else
+	{
+		AddQueryResult(userData, 0.0f);
+	}
+}
+
+void b2DynamicTreeBroadPhase::AddQueryResult(void* userData, float32 key)
+{
+	if (m_querySortKey == NULL)
+	{
+		if (m_queryResultCount < m_queryMaxCount)
+		{
+			m_queryResults[m_queryResultCount] = userData;
+			++m_queryResultCount;
+		}
+		return;
+	}
+
+	// Merge the new key into the sorted list.
+	int32 i = 0;
+	while (i < m_queryResultCount && m_querySortKeys[i] < key)
+	{
+		++i;
+	}
+
+	if (i == m_queryMaxCount)
+	{
+		return;
+	}
+
+	if (m_queryResultCount == m_queryMaxCount)
+	{
+		--m_queryResultCount;
+	}
+
+	for (int32 j = m_queryResultCount; j > i; --j)
+	{
+		m_querySortKeys[j] = m_querySortKeys[j-1];
+		m_queryResults[j] = m_queryResults[j-1];
+	}
+
+	m_querySortKeys[i] = key;
+	m_queryResults[i] = userData;
+	++m_queryResultCount;
+}
+
+int32 b2DynamicTreeBroadPhase::Query(const b2AABB& aabb, void** userData, int32 maxCount)
+{
+	m_queryMode = e_collectProxies;
+	m_queryResults = userData;
+	m_queryResultCount = 0;
+	m_queryMaxCount = maxCount;
+	m_querySortKey = NULL;
+
+	m_tree.Query(this, aabb);
+
+	m_queryResults = NULL;
+	return m_queryResultCount;
+}
+
+int32 b2DynamicTreeBroadPhase::QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey)
+{
+	if (sortKey && m_querySortKeyCapacity < maxCount)
+	{
+		if (m_querySortKeys)
+		{
+			b2Free(m_querySortKeys);
+		}
+		m_querySortKeyCapacity = maxCount;
+		m_querySortKeys = (float32*)b2Alloc(m_querySortKeyCapacity * sizeof(float32));
+	}
+
+	m_queryResults = userData;
+	m_queryResultCount = 0;
+	m_queryMaxCount = maxCount;
+	m_querySortKey = sortKey;
+
+	b2RayCastInput input;
+	input.p1 = segment.p1;
+	input.p2 = segment.p2;
+	input.maxFraction = 1.0f;
+	m_tree.RayCast(this, input);
+
+	m_queryResults = NULL;
+	m_querySortKey = NULL;
+	return m_queryResultCount;
+}
+
+void b2DynamicTreeBroadPhase::Validate()
+{
+	m_tree.Validate();
+
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		b2Assert(m_moveBuffer[i] == b2_nullProxy || m_tree.GetFatAABB(m_moveBuffer[i]).IsValid());
+	}
+}
@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_DYNAMIC_TREE_BROAD_PHASE_H
+#define B2_DYNAMIC_TREE_BROAD_PHASE_H
+
+#include "b2BroadPhase.h"
+#include "b2DynamicTree.h"
+
+/// A broad-phase built on b2DynamicTree. Proxies are stored with fat AABBs,
+/// so small movements don't touch the tree. Proxies that are created or leave
+/// their fat AABB go into a move buffer, and Commit finds their new pairs by
+/// querying the tree. There is no world AABB, so proxies are never out of range.
+class b2DynamicTreeBroadPhase : public b2BroadPhase
+{
+public:
+	b2DynamicTreeBroadPhase(b2PairCallback* callback);
+	~b2DynamicTreeBroadPhase();
+
+	// Proxies are always in range.
+	bool InRange(const b2AABB& aabb) const;
+
+	// Create a proxy. Its pairs are reported at the next Commit.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	// Create many proxies as one balanced subtree. Their pairs are reported at the next Commit.
+	void CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
+
+	// Create proxies from fat AABBs, which are used as they are.
+	void RestoreProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
+
+	// Destroy a proxy. This removes its pairs immediately.
+	void DestroyProxy(int32 proxyId);
+
+	// Move a proxy. Pairs that no longer overlap are removed right away,
+	// new pairs are found in Commit. The tree fattens by b2_fatAABBFactor
+	// and doesn't use the displacement.
+	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+	void Commit();
+
+	void* GetUserData(int32 proxyId) const;
+	b2AABB GetProxyAABB(int32 proxyId) const;
+	bool TestOverlap(int32 proxyIdA, int32 proxyIdB);
+
+	int32 Query(const b2AABB& aabb, void** userData, int32 maxCount);
+	int32 QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey);
+
+	void Validate();
+
+	// These are called by b2DynamicTree::Query and b2DynamicTree::RayCast.
+	void QueryCallback(int32 proxyId);
+	void RayCastCallback(b2RayCastOutput* output, const b2RayCastInput& input, int32 proxyId);
+
+private:
+
+	enum QueryMode
+	{
+		e_addPairs,
+		e_removePairs,
+		e_removeSeparatedPairs,
+		e_collectProxies
+	};
+
+	void BufferMove(int32 proxyId);
+	void UnBufferMove(int32 proxyId);
+	void AddQueryResult(void* userData, float32 key);
+
+	b2DynamicTree m_tree;
+
+	int32* m_moveBuffer;
+	int32 m_moveCapacity;
+	int32 m_moveCount;
+
+	// State of the query in progress.
+	QueryMode m_queryMode;
+	int32 m_queryProxyId;
+	b2AABB m_queryAABB;
+	void** m_queryResults;
+	float32* m_querySortKeys;
+	int32 m_querySortKeyCapacity;
+	int32 m_queryResultCount;
+	int32 m_queryMaxCount;
+	SortKeyFunc m_querySortKey;
+};
+
+inline bool b2DynamicTreeBroadPhase::InRange(const b2AABB& aabb) const
+{
+	B2_NOT_USED(aabb);
+	return true;
+}
+
+inline void* b2DynamicTreeBroadPhase::GetUserData(int32 proxyId) const
+{
+	return m_tree.GetProxy(proxyId);
+}
+
+inline b2AABB b2DynamicTreeBroadPhase::GetProxyAABB(int32 proxyId) const
+{
+	return m_tree.GetFatAABB(proxyId);
+}
+
+#endif
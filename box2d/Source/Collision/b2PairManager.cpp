@@ -20,12 +20,13 @@
 #include "b2BroadPhase.h"
 
 #include <algorithm>
+#include <cstring>
 
 // Thomas Wang's hash, see: http://www.concentric.net/~Ttwang/tech/inthash.htm
-// This assumes proxyId1 and proxyId2 are 16-bit.
+// Ids above 16 bits overlap in the key, which only costs some collisions.
 inline uint32 Hash(uint32 proxyId1, uint32 proxyId2)
 {
-	uint32 key = (proxyId2 << 16) | proxyId1;
+	uint32 key = (proxyId2 << 16) ^ proxyId1;
 	key = ~key + (key << 15);
 	key = key ^ (key >> 12);
 	key = key + (key << 2);
@@ -64,24 +65,98 @@ inline bool operator < (const b2BufferedPair& pair1, const b2BufferedPair& pair2
 
 b2PairManager::b2PairManager()
 {
-	b2Assert(b2IsPowerOfTwo(b2_tableCapacity) == true);
-	b2Assert(b2_tableCapacity >= b2_maxPairs);
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
+	b2Assert(b2IsPowerOfTwo(b2_pairPoolSize) == true);
+
+	m_tableCapacity = b2_pairPoolSize;
+	m_tableMask = m_tableCapacity - 1;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
 	{
 		m_hashTable[i] = b2_nullPair;
 	}
-	m_freePair = 0;
-	for (int32 i = 0; i < b2_maxPairs; ++i)
+
+	m_pairCapacity = 0;
+	m_pairs = NULL;
+	m_pairBuffer = NULL;
+	m_freePair = b2_nullPair;
+	GrowPairPool();
+
+	m_pairCount = 0;
+	m_maxPairCount = 0;
+	m_pairBufferCount = 0;
+}
+
+b2PairManager::~b2PairManager()
+{
+	b2Free(m_hashTable);
+	b2Free(m_pairs);
+	b2Free(m_pairBuffer);
+}
+
+// Double the pair pool and the pair buffer. Pairs are addressed by index,
+// so they can be moved.
+void b2PairManager::GrowPairPool()
+{
+	b2Assert(m_freePair == b2_nullPair);
+
+	int32 oldCapacity = m_pairCapacity;
+	m_pairCapacity = oldCapacity > 0 ? 2 * oldCapacity : b2_pairPoolSize;
+
+	b2Pair* oldPairs = m_pairs;
+	m_pairs = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	if (oldPairs)
+	{
+		memcpy(m_pairs, oldPairs, oldCapacity * sizeof(b2Pair));
+		b2Free(oldPairs);
+	}
+
+	b2BufferedPair* oldBuffer = m_pairBuffer;
+	m_pairBuffer = (b2BufferedPair*)b2Alloc(m_pairCapacity * sizeof(b2BufferedPair));
+	if (oldBuffer)
+	{
+		memcpy(m_pairBuffer, oldBuffer, m_pairBufferCount * sizeof(b2BufferedPair));
+		b2Free(oldBuffer);
+	}
+
+	// Build a linked list for the free list.
+	for (int32 i = oldCapacity; i < m_pairCapacity; ++i)
 	{
 		m_pairs[i].proxyId1 = b2_nullProxy;
 		m_pairs[i].proxyId2 = b2_nullProxy;
 		m_pairs[i].userData = NULL;
 		m_pairs[i].status = 0;
-		m_pairs[i].next = uint16(i + 1);
+		m_pairs[i].next = i + 1;
+	}
+	m_pairs[m_pairCapacity-1].next = b2_nullPair;
+	m_freePair = oldCapacity;
+}
+
+// Double the hash table and relink the pairs into the new slots.
+void b2PairManager::GrowHashTable()
+{
+	b2Free(m_hashTable);
+
+	m_tableCapacity *= 2;
+	m_tableMask = m_tableCapacity - 1;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
+	{
+		m_hashTable[i] = b2_nullPair;
+	}
+
+	for (int32 i = 0; i < m_pairCapacity; ++i)
+	{
+		b2Pair* pair = m_pairs + i;
+		if (pair->proxyId1 == b2_nullProxy)
+		{
+			// This is on the free list.
+			continue;
+		}
+
+		int32 hash = Hash(pair->proxyId1, pair->proxyId2) & m_tableMask;
+		pair->next = m_hashTable[hash];
+		m_hashTable[hash] = i;
 	}
-	m_pairs[b2_maxPairs-1].next = b2_nullPair;
-	m_pairCount = 0;
-	m_pairBufferCount = 0;
 }
 
 void b2PairManager::Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback)
@@ -104,7 +179,7 @@ b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2, uint32 hash)
 		return NULL;
 	}
 
-	b2Assert(index < b2_maxPairs);
+	b2Assert(0 <= index && index < m_pairCapacity);
 
 	return m_pairs + index;
 }
@@ -113,7 +188,7 @@ b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2)
 {
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & m_tableMask;
 
 	return Find(proxyId1, proxyId2, hash);
 }
@@ -123,7 +198,7 @@ b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 {
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & m_tableMask;
 
 	b2Pair* pair = Find(proxyId1, proxyId2, hash);
 	if (pair != NULL)
@@ -131,14 +206,23 @@ b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 		return pair;
 	}
 
-	b2Assert(m_pairCount < b2_maxPairs && m_freePair != b2_nullPair);
+	if (m_freePair == b2_nullPair)
+	{
+		GrowPairPool();
+	}
 
-	uint16 pairIndex = m_freePair;
+	if (m_pairCount == m_tableCapacity)
+	{
+		GrowHashTable();
+		hash = Hash(proxyId1, proxyId2) & m_tableMask;
+	}
+
+	int32 pairIndex = m_freePair;
 	pair = m_pairs + pairIndex;
 	m_freePair = pair->next;
 
-	pair->proxyId1 = (uint16)proxyId1;
-	pair->proxyId2 = (uint16)proxyId2;
+	pair->proxyId1 = proxyId1;
+	pair->proxyId2 = proxyId2;
 	pair->status = 0;
 	pair->userData = NULL;
 	pair->next = m_hashTable[hash];
@@ -146,6 +230,7 @@ b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 	m_hashTable[hash] = pairIndex;
 
 	++m_pairCount;
+	m_maxPairCount = b2Max(m_maxPairCount, m_pairCount);
 
 	return pair;
 }
@@ -157,14 +242,14 @@ void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
 
 	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	int32 hash = Hash(proxyId1, proxyId2) & m_tableMask;
 
-	uint16* node = &m_hashTable[hash];
+	int32* node = &m_hashTable[hash];
 	while (*node != b2_nullPair)
 	{
 		if (Equals(m_pairs[*node], proxyId1, proxyId2))
 		{
-			uint16 index = *node;
+			int32 index = *node;
 			*node = m_pairs[*node].next;
 			
 			b2Pair* pair = m_pairs + index;
@@ -210,15 +295,18 @@ If the added pair is not a new pair, then it must be in the pair buffer (because
 void b2PairManager::AddBufferedPair(int32 id1, int32 id2)
 {
 	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
 
 	b2Pair* pair = AddPair(id1, id2);
 
 	// If this pair is not in the pair buffer ...
 	if (pair->IsBuffered() == false)
 	{
-		// This must be a newly added pair.
-		b2Assert(pair->IsFinal() == false);
+		// A broad-phase that finds pairs by querying may report a pair
+		// that is already confirmed. There is nothing to do.
+		if (pair->IsFinal() == true)
+		{
+			return;
+		}
 
 		// Add it to the pair buffer.
 		pair->SetBuffered();
@@ -242,7 +330,6 @@ void b2PairManager::AddBufferedPair(int32 id1, int32 id2)
 void b2PairManager::RemoveBufferedPair(int32 id1, int32 id2)
 {
 	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
 
 	b2Pair* pair = Find(id1, id2);
 
@@ -278,21 +365,16 @@ void b2PairManager::Commit()
 {
 	int32 removeCount = 0;
 
-	b2Proxy* proxies = m_broadPhase->m_proxyPool;
-
 	for (int32 i = 0; i < m_pairBufferCount; ++i)
 	{
 		b2Pair* pair = Find(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
 		b2Assert(pair->IsBuffered());
 		pair->ClearBuffered();
 
-		b2Assert(pair->proxyId1 < b2_maxProxies && pair->proxyId2 < b2_maxProxies);
+		b2Assert(pair->proxyId1 != b2_nullProxy && pair->proxyId2 != b2_nullProxy);
 
-		b2Proxy* proxy1 = proxies + pair->proxyId1;
-		b2Proxy* proxy2 = proxies + pair->proxyId2;
-
-		b2Assert(proxy1->IsValid());
-		b2Assert(proxy2->IsValid());
+		void* userData1 = m_broadPhase->GetUserData(pair->proxyId1);
+		void* userData2 = m_broadPhase->GetUserData(pair->proxyId2);
 
 		if (pair->IsRemoved())
 		{
@@ -301,7 +383,7 @@ void b2PairManager::Commit()
 			// the user didn't receive a matching add.
 			if (pair->IsFinal() == true)
 			{
-				m_callback->PairRemoved(proxy1->userData, proxy2->userData, pair->userData);
+				m_callback->PairRemoved(userData1, userData2, pair->userData);
 			}
 
 			// Store the ids so we can actually remove the pair below.
@@ -311,11 +393,11 @@ void b2PairManager::Commit()
 		}
 		else
 		{
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
+			b2Assert(m_broadPhase->TestOverlap(pair->proxyId1, pair->proxyId2) == true);
 
 			if (pair->IsFinal() == false)
 			{
-				pair->userData = m_callback->PairAdded(proxy1->userData, proxy2->userData);
+				pair->userData = m_callback->PairAdded(userData1, userData2);
 				pair->SetFinal();
 			}
 		}
@@ -352,14 +434,8 @@ void b2PairManager::ValidateBuffer()
 		b2Assert(pair->IsBuffered());
 
 		b2Assert(pair->proxyId1 != pair->proxyId2);
-		b2Assert(pair->proxyId1 < b2_maxProxies);
-		b2Assert(pair->proxyId2 < b2_maxProxies);
-
-		b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-		b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
-
-		b2Assert(proxy1->IsValid() == true);
-		b2Assert(proxy2->IsValid() == true);
+		b2Assert(pair->proxyId1 != b2_nullProxy);
+		b2Assert(pair->proxyId2 != b2_nullProxy);
 	}
 #endif
 }
@@ -367,9 +443,9 @@ void b2PairManager::ValidateBuffer()
 void b2PairManager::ValidateTable()
 {
 #ifdef _DEBUG
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
+	for (int32 i = 0; i < m_tableCapacity; ++i)
 	{
-		uint16 index = m_hashTable[i];
+		int32 index = m_hashTable[i];
 		while (index != b2_nullPair)
 		{
 			b2Pair* pair = m_pairs + index;
@@ -378,16 +454,10 @@ void b2PairManager::ValidateTable()
 			b2Assert(pair->IsRemoved() == false);
 
 			b2Assert(pair->proxyId1 != pair->proxyId2);
-			b2Assert(pair->proxyId1 < b2_maxProxies);
-			b2Assert(pair->proxyId2 < b2_maxProxies);
-
-			b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-			b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
-
-			b2Assert(proxy1->IsValid() == true);
-			b2Assert(proxy2->IsValid() == true);
+			b2Assert(pair->proxyId1 != b2_nullProxy);
+			b2Assert(pair->proxyId2 != b2_nullProxy);
 
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
+			b2Assert(m_broadPhase->TestOverlap(pair->proxyId1, pair->proxyId2) == true);
 
 			index = pair->next;
 		}
@@ -26,15 +26,10 @@
 #include "../Common/b2Settings.h"
 #include "../Common/b2Math.h"
 
-#include <climits>
-
 class b2BroadPhase;
-struct b2Proxy;
 
-const uint16 b2_nullPair = USHRT_MAX;
-const uint16 b2_nullProxy = USHRT_MAX;
-const int32 b2_tableCapacity = b2_maxPairs;	// must be a power of two
-const int32 b2_tableMask = b2_tableCapacity - 1;
+const int32 b2_nullPair = -1;
+const int32 b2_nullProxy = -1;
 
 struct b2Pair
 {
@@ -57,16 +52,16 @@ struct b2Pair
 	bool IsFinal()		{ return (status & e_pairFinal) == e_pairFinal; }
 
 	void* userData;
-	uint16 proxyId1;
-	uint16 proxyId2;
-	uint16 next;
+	int32 proxyId1;
+	int32 proxyId2;
+	int32 next;
 	uint16 status;
 };
 
 struct b2BufferedPair
 {
-	uint16 proxyId1;
-	uint16 proxyId2;
+	int32 proxyId1;
+	int32 proxyId2;
 };
 
 class b2PairCallback
@@ -83,10 +78,14 @@ public:
 	virtual void PairRemoved(void* proxyUserData1, void* proxyUserData2, void* pairUserData) = 0;
 };
 
+// The pair pool, the pair buffer and the hash table start small and grow
+// by doubling. The hash table is rehashed as it grows so that there is
+// at most one pair per slot on average.
 class b2PairManager
 {
 public:
 	b2PairManager();
+	~b2PairManager();
 
 	void Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback);
 
@@ -102,20 +101,28 @@ private:
 	b2Pair* AddPair(int32 proxyId1, int32 proxyId2);
 	void* RemovePair(int32 proxyId1, int32 proxyId2);
 
+	void GrowPairPool();
+	void GrowHashTable();
+
 	void ValidateBuffer();
 	void ValidateTable();
 
 public:
 	b2BroadPhase *m_broadPhase;
 	b2PairCallback *m_callback;
-	b2Pair m_pairs[b2_maxPairs];
-	uint16 m_freePair;
+	b2Pair* m_pairs;
+	int32 m_pairCapacity;
+	int32 m_freePair;
 	int32 m_pairCount;
+	int32 m_maxPairCount;
 
-	b2BufferedPair m_pairBuffer[b2_maxPairs];
+	// This has the capacity of the pair pool.
+	b2BufferedPair* m_pairBuffer;
 	int32 m_pairBufferCount;
 
-	uint16 m_hashTable[b2_tableCapacity];
+	int32* m_hashTable;
+	int32 m_tableCapacity;
+	int32 m_tableMask;
 };
 
 #endif
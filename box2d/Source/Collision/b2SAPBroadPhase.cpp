@@ -0,0 +1,1405 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2SAPBroadPhase.h"
+#include <algorithm>
+
+#include <cstdlib>
+#include <cstring>
+
+// Notes:
+// - we use bound arrays instead of linked lists for cache coherence.
+// - we use quantized integral values for fast compares.
+// - we use short indices rather than pointers to save memory.
+// - we use a stabbing count for fast overlap queries (less than order N).
+// - we also use a time stamp on each proxy to speed up the registration of
+//   overlap query results.
+// - where possible, we compare bound indices instead of values to reduce
+//   cache misses (TODO_ERIN).
+// - no broadphase is perfect and neither is this one: it is not great for huge
+//   worlds (use a multi-SAP instead), it is not great for large objects.
+
+struct b2BoundValues
+{
+	uint16 lowerValues[2];
+	uint16 upperValues[2];
+};
+
+static int32 BinarySearch(b2Bound* bounds, int32 count, uint16 value)
+{
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low <= high)
+	{
+		int32 mid = (low + high) >> 1;
+		if (bounds[mid].value > value)
+		{
+			high = mid - 1;
+		}
+		else if (bounds[mid].value < value)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			return mid;
+		}
+	}
+	
+	return low;
+}
+
+b2SAPBroadPhase::b2SAPBroadPhase(const b2AABB& worldAABB, b2PairCallback* callback)
+: b2BroadPhase(e_sweepAndPruneBroadPhase, callback)
+{
+	b2Assert(worldAABB.IsValid());
+	m_worldAABB = worldAABB;
+
+	b2Vec2 d = worldAABB.upperBound - worldAABB.lowerBound;
+	m_quantizationFactor.x = float32((int)B2BROADPHASE_MAX) / d.x;
+	m_quantizationFactor.y = float32((int)B2BROADPHASE_MAX) / d.y;
+
+	m_proxyPool = NULL;
+	m_proxyCapacity = 0;
+	m_freeProxy = b2_nullProxy;
+	m_bounds[0] = NULL;
+	m_bounds[1] = NULL;
+	m_queryResults = NULL;
+	m_querySortKeys = NULL;
+	m_queryResultCount = 0;
+	GrowProxyPool();
+
+	m_timeStamp = 1;
+}
+
+b2SAPBroadPhase::~b2SAPBroadPhase()
+{
+	b2Free(m_proxyPool);
+	b2Free(m_bounds[0]);
+	b2Free(m_bounds[1]);
+	b2Free(m_queryResults);
+	b2Free(m_querySortKeys);
+}
+
+// Double the proxy pool, the bound arrays and the query buffers. Bounds
+// refer to proxies by id and proxies refer to bounds by index, so all of
+// it can be moved.
+void b2SAPBroadPhase::GrowProxyPool()
+{
+	b2Assert(m_queryResultCount == 0);
+
+	int32 oldCapacity = m_proxyCapacity;
+	m_proxyCapacity = oldCapacity > 0 ? 2 * oldCapacity : b2_proxyPoolSize;
+
+	b2Proxy* oldPool = m_proxyPool;
+	m_proxyPool = (b2Proxy*)b2Alloc(m_proxyCapacity * sizeof(b2Proxy));
+	if (oldPool)
+	{
+		memcpy(m_proxyPool, oldPool, oldCapacity * sizeof(b2Proxy));
+		b2Free(oldPool);
+	}
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* oldBounds = m_bounds[axis];
+		m_bounds[axis] = (b2Bound*)b2Alloc(2 * m_proxyCapacity * sizeof(b2Bound));
+		if (oldBounds)
+		{
+			memcpy(m_bounds[axis], oldBounds, 2 * m_proxyCount * sizeof(b2Bound));
+			b2Free(oldBounds);
+		}
+	}
+
+	// The query buffers are empty between calls.
+	if (m_queryResults)
+	{
+		b2Free(m_queryResults);
+		b2Free(m_querySortKeys);
+	}
+	m_queryResults = (int32*)b2Alloc(m_proxyCapacity * sizeof(int32));
+	m_querySortKeys = (float32*)b2Alloc(m_proxyCapacity * sizeof(float32));
+
+	for (int32 i = oldCapacity; i < m_proxyCapacity; ++i)
+	{
+		m_proxyPool[i].SetNext(i + 1);
+		m_proxyPool[i].timeStamp = 0;
+		m_proxyPool[i].overlapCount = b2_invalid;
+		m_proxyPool[i].userData = NULL;
+	}
+	m_proxyPool[m_proxyCapacity-1].SetNext(m_freeProxy);
+	m_freeProxy = oldCapacity;
+}
+
+void* b2SAPBroadPhase::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxyPool[proxyId].userData;
+}
+
+b2AABB b2SAPBroadPhase::GetProxyAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	const b2Proxy* p = m_proxyPool + proxyId;
+	b2Assert(p->IsValid());
+
+	b2Vec2 invQ;
+	invQ.Set(1.0f / m_quantizationFactor.x, 1.0f / m_quantizationFactor.y);
+
+	b2AABB aabb;
+	aabb.lowerBound.x = m_worldAABB.lowerBound.x + invQ.x * m_bounds[0][p->lowerBounds[0]].value;
+	aabb.lowerBound.y = m_worldAABB.lowerBound.y + invQ.y * m_bounds[1][p->lowerBounds[1]].value;
+	aabb.upperBound.x = m_worldAABB.lowerBound.x + invQ.x * m_bounds[0][p->upperBounds[0]].value;
+	aabb.upperBound.y = m_worldAABB.lowerBound.y + invQ.y * m_bounds[1][p->upperBounds[1]].value;
+	return aabb;
+}
+
+bool b2SAPBroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB)
+{
+	return TestOverlap(m_proxyPool + proxyIdA, m_proxyPool + proxyIdB);
+}
+
+// This one is only used for validation.
+bool b2SAPBroadPhase::TestOverlap(b2Proxy* p1, b2Proxy* p2)
+{
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+
+		b2Assert(p1->lowerBounds[axis] < 2 * m_proxyCount);
+		b2Assert(p1->upperBounds[axis] < 2 * m_proxyCount);
+		b2Assert(p2->lowerBounds[axis] < 2 * m_proxyCount);
+		b2Assert(p2->upperBounds[axis] < 2 * m_proxyCount);
+
+		if (bounds[p1->lowerBounds[axis]].value > bounds[p2->upperBounds[axis]].value)
+			return false;
+
+		if (bounds[p1->upperBounds[axis]].value < bounds[p2->lowerBounds[axis]].value)
+			return false;
+	}
+
+	return true;
+}
+
+bool b2SAPBroadPhase::ContainsBounds(const b2Proxy* p, const b2BoundValues& b) const
+{
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		const b2Bound* bounds = m_bounds[axis];
+		if (b.lowerValues[axis] < bounds[p->lowerBounds[axis]].value ||
+			bounds[p->upperBounds[axis]].value < b.upperValues[axis])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool b2SAPBroadPhase::TestOverlap(const b2BoundValues& b, b2Proxy* p)
+{
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+
+		b2Assert(p->lowerBounds[axis] < 2 * m_proxyCount);
+		b2Assert(p->upperBounds[axis] < 2 * m_proxyCount);
+
+		if (b.lowerValues[axis] > bounds[p->upperBounds[axis]].value)
+			return false;
+
+		if (b.upperValues[axis] < bounds[p->lowerBounds[axis]].value)
+			return false;
+	}
+
+	return true;
+}
+
+// Enlarge an AABB by b2_aabbExtension on each side and stretch it along the
+// predicted displacement, so the proxy can move a while before its bounds do.
+static b2AABB b2FattenAABB(const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b2AABB fatAABB;
+	fatAABB.lowerBound = aabb.lowerBound - r;
+	fatAABB.upperBound = aabb.upperBound + r;
+
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+
+	if (d.x < 0.0f)
+	{
+		fatAABB.lowerBound.x += d.x;
+	}
+	else
+	{
+		fatAABB.upperBound.x += d.x;
+	}
+
+	if (d.y < 0.0f)
+	{
+		fatAABB.lowerBound.y += d.y;
+	}
+	else
+	{
+		fatAABB.upperBound.y += d.y;
+	}
+
+	return fatAABB;
+}
+
+void b2SAPBroadPhase::ComputeBounds(uint16* lowerValues, uint16* upperValues, const b2AABB& aabb)
+{
+	b2Assert(aabb.upperBound.x >= aabb.lowerBound.x);
+	b2Assert(aabb.upperBound.y >= aabb.lowerBound.y);
+
+	b2Vec2 minVertex = b2Clamp(aabb.lowerBound, m_worldAABB.lowerBound, m_worldAABB.upperBound);
+	b2Vec2 maxVertex = b2Clamp(aabb.upperBound, m_worldAABB.lowerBound, m_worldAABB.upperBound);
+
+	// Bump lower bounds downs and upper bounds up. This ensures correct sorting of
+	// lower/upper bounds that would have equal values.
+	// TODO_ERIN implement fast float to uint16 conversion.
+	lowerValues[0] = (uint16)(m_quantizationFactor.x * (minVertex.x - m_worldAABB.lowerBound.x)) & (B2BROADPHASE_MAX - 1);
+	upperValues[0] = (uint16)(m_quantizationFactor.x * (maxVertex.x - m_worldAABB.lowerBound.x)) | 1;
+
+	lowerValues[1] = (uint16)(m_quantizationFactor.y * (minVertex.y - m_worldAABB.lowerBound.y)) & (B2BROADPHASE_MAX - 1);
+	upperValues[1] = (uint16)(m_quantizationFactor.y * (maxVertex.y - m_worldAABB.lowerBound.y)) | 1;
+}
+
+void b2SAPBroadPhase::IncrementTimeStamp()
+{
+	if (m_timeStamp == B2BROADPHASE_MAX)
+	{
+		for (int32 i = 0; i < m_proxyCapacity; ++i)
+		{
+			m_proxyPool[i].timeStamp = 0;
+		}
+		m_timeStamp = 1;
+	}
+	else
+	{
+		++m_timeStamp;
+	}
+}
+
+void b2SAPBroadPhase::IncrementOverlapCount(int32 proxyId)
+{
+	b2Proxy* proxy = m_proxyPool + proxyId;
+	if (proxy->timeStamp < m_timeStamp)
+	{
+		proxy->timeStamp = m_timeStamp;
+		proxy->overlapCount = 1;
+	}
+	else
+	{
+		proxy->overlapCount = 2;
+		b2Assert(m_queryResultCount < m_proxyCapacity);
+		m_queryResults[m_queryResultCount] = proxyId;
+		++m_queryResultCount;
+	}
+}
+
+void b2SAPBroadPhase::Query(int32* lowerQueryOut, int32* upperQueryOut,
+					   uint16 lowerValue, uint16 upperValue,
+					   b2Bound* bounds, int32 boundCount, int32 axis)
+{
+	int32 lowerQuery = BinarySearch(bounds, boundCount, lowerValue);
+	int32 upperQuery = BinarySearch(bounds, boundCount, upperValue);
+
+	// Easy case: lowerQuery <= lowerIndex(i) < upperQuery
+	// Solution: search query range for min bounds.
+	for (int32 i = lowerQuery; i < upperQuery; ++i)
+	{
+		if (bounds[i].IsLower())
+		{
+			IncrementOverlapCount(bounds[i].proxyId);
+		}
+	}
+
+	// Hard case: lowerIndex(i) < lowerQuery < upperIndex(i)
+	// Solution: use the stabbing count to search down the bound array.
+	if (lowerQuery > 0)
+	{
+		int32 i = lowerQuery - 1;
+		int32 s = bounds[i].stabbingCount;
+
+		// Find the s overlaps.
+		while (s)
+		{
+			b2Assert(i >= 0);
+
+			if (bounds[i].IsLower())
+			{
+				b2Proxy* proxy = m_proxyPool + bounds[i].proxyId;
+				if (lowerQuery <= proxy->upperBounds[axis])
+				{
+					IncrementOverlapCount(bounds[i].proxyId);
+					--s;
+				}
+			}
+			--i;
+		}
+	}
+
+	*lowerQueryOut = lowerQuery;
+	*upperQueryOut = upperQuery;
+}
+
+int32 b2SAPBroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_freeProxy == b2_nullProxy)
+	{
+		GrowProxyPool();
+	}
+
+	int32 proxyId = m_freeProxy;
+	b2Proxy* proxy = m_proxyPool + proxyId;
+	m_freeProxy = proxy->GetNext();
+
+	proxy->overlapCount = 0;
+	proxy->userData = userData;
+
+	int32 boundCount = 2 * m_proxyCount;
+
+	uint16 lowerValues[2], upperValues[2];
+	ComputeBounds(lowerValues, upperValues, b2FattenAABB(aabb, b2Vec2_zero));
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+		int32 lowerIndex, upperIndex;
+		Query(&lowerIndex, &upperIndex, lowerValues[axis], upperValues[axis], bounds, boundCount, axis);
+
+		memmove(bounds + upperIndex + 2, bounds + upperIndex, (boundCount - upperIndex) * sizeof(b2Bound));
+		memmove(bounds + lowerIndex + 1, bounds + lowerIndex, (upperIndex - lowerIndex) * sizeof(b2Bound));
+
+		// The upper index has increased because of the lower bound insertion.
+		++upperIndex;
+
+		// Copy in the new bounds.
+		bounds[lowerIndex].value = lowerValues[axis];
+		bounds[lowerIndex].proxyId = proxyId;
+		bounds[upperIndex].value = upperValues[axis];
+		bounds[upperIndex].proxyId = proxyId;
+
+		bounds[lowerIndex].stabbingCount = lowerIndex == 0 ? 0 : bounds[lowerIndex-1].stabbingCount;
+		bounds[upperIndex].stabbingCount = bounds[upperIndex-1].stabbingCount;
+
+		// Adjust the stabbing count between the new bounds.
+		for (int32 index = lowerIndex; index < upperIndex; ++index)
+		{
+			++bounds[index].stabbingCount;
+		}
+
+		// Adjust the all the affected bound indices.
+		for (int32 index = lowerIndex; index < boundCount + 2; ++index)
+		{
+			b2Proxy* proxy = m_proxyPool + bounds[index].proxyId;
+			if (bounds[index].IsLower())
+			{
+				proxy->lowerBounds[axis] = index;
+			}
+			else
+			{
+				proxy->upperBounds[axis] = index;
+			}
+		}
+	}
+
+	++m_proxyCount;
+	m_maxProxyCount = b2Max(m_maxProxyCount, m_proxyCount);
+
+	b2Assert(m_queryResultCount < m_proxyCapacity);
+
+	// Create pairs if the AABB is in range.
+	for (int32 i = 0; i < m_queryResultCount; ++i)
+	{
+		b2Assert(m_queryResults[i] < m_proxyCapacity);
+		b2Assert(m_proxyPool[m_queryResults[i]].IsValid());
+
+		m_pairManager.AddBufferedPair(proxyId, m_queryResults[i]);
+	}
+
+	m_pairManager.Commit();
+
+	if (s_validate)
+	{
+		Validate();
+	}
+
+	// Prepare for next query.
+	m_queryResultCount = 0;
+	IncrementTimeStamp();
+
+	return proxyId;
+}
+
+// Equal values are ordered by proxy so the order doesn't depend on qsort.
+static int b2CompareBounds(const void* a, const void* b)
+{
+	const b2Bound* boundA = (const b2Bound*)a;
+	const b2Bound* boundB = (const b2Bound*)b;
+	if (boundA->value != boundB->value)
+	{
+		return boundA->value < boundB->value ? -1 : 1;
+	}
+
+	if (boundA->proxyId != boundB->proxyId)
+	{
+		return boundA->proxyId < boundB->proxyId ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// Sort the new bounds and merge them into the first boundCount bounds of an
+// axis, which has room for them. Then recompute the stabbing counts and the
+// bound indices in one pass.
+void b2SAPBroadPhase::InsertBounds(int32 axis, b2Bound* newBounds, int32 newCount, int32 boundCount)
+{
+	qsort(newBounds, newCount, sizeof(b2Bound), b2CompareBounds);
+
+	// Merge from the back.
+	b2Bound* bounds = m_bounds[axis];
+	int32 i = boundCount - 1;
+	int32 j = newCount - 1;
+	for (int32 k = boundCount + newCount - 1; j >= 0; --k)
+	{
+		if (i >= 0 && bounds[i].value > newBounds[j].value)
+		{
+			bounds[k] = bounds[i--];
+		}
+		else
+		{
+			bounds[k] = newBounds[j--];
+		}
+	}
+
+	int32 stabbingCount = 0;
+	for (int32 index = 0; index < boundCount + newCount; ++index)
+	{
+		b2Proxy* proxy = m_proxyPool + bounds[index].proxyId;
+		if (bounds[index].IsLower())
+		{
+			++stabbingCount;
+			proxy->lowerBounds[axis] = index;
+		}
+		else
+		{
+			--stabbingCount;
+			proxy->upperBounds[axis] = index;
+		}
+		bounds[index].stabbingCount = (uint16)stabbingCount;
+	}
+	b2Assert(stabbingCount == 0);
+}
+
+// Sweep the x-axis keeping the proxies whose x-interval is open, and buffer
+// every overlapping pair that has a marked proxy for addition or removal.
+// Lower bound values are even and upper ones odd, so the bound order decides
+// the x-overlap and only the y-axis needs a test.
+void b2SAPBroadPhase::BufferPairs(const bool* marked, bool add)
+{
+	int32 boundCount = 2 * m_proxyCount;
+
+	// The open proxies, and the slot of each proxy id in that list.
+	int32* active = (int32*)b2Alloc(b2Max(m_proxyCount, 1) * sizeof(int32));
+	int32* slots = (int32*)b2Alloc(m_proxyCapacity * sizeof(int32));
+	int32 activeCount = 0;
+
+	b2Bound* boundsX = m_bounds[0];
+	b2Bound* boundsY = m_bounds[1];
+	for (int32 index = 0; index < boundCount; ++index)
+	{
+		int32 proxyId = boundsX[index].proxyId;
+		b2Proxy* proxy = m_proxyPool + proxyId;
+
+		if (boundsX[index].IsUpper())
+		{
+			int32 slot = slots[proxyId];
+			--activeCount;
+			active[slot] = active[activeCount];
+			slots[active[slot]] = slot;
+			continue;
+		}
+
+		for (int32 k = 0; k < activeCount; ++k)
+		{
+			int32 otherId = active[k];
+			if (marked[proxyId] == false && marked[otherId] == false)
+			{
+				continue;
+			}
+
+			const b2Proxy* other = m_proxyPool + otherId;
+			if (boundsY[proxy->lowerBounds[1]].value <= boundsY[other->upperBounds[1]].value &&
+				boundsY[other->lowerBounds[1]].value <= boundsY[proxy->upperBounds[1]].value)
+			{
+				if (add)
+				{
+					m_pairManager.AddBufferedPair(proxyId, otherId);
+				}
+				else
+				{
+					m_pairManager.RemoveBufferedPair(proxyId, otherId);
+				}
+			}
+		}
+
+		slots[proxyId] = activeCount;
+		active[activeCount++] = proxyId;
+	}
+	b2Assert(activeCount == 0);
+
+	b2Free(slots);
+	b2Free(active);
+}
+
+void b2SAPBroadPhase::CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds)
+{
+	InsertProxies(aabbs, userData, count, proxyIds, true);
+}
+
+// Sort the new bounds once and merge them into the bound arrays, then find
+// the pairs of the new proxies with one sweep along the x-axis. This avoids
+// the memmove and the bound index fix up of CreateProxy for every proxy.
+void b2SAPBroadPhase::InsertProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds, bool fatten)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	while (m_proxyCapacity - m_proxyCount < count)
+	{
+		GrowProxyPool();
+	}
+
+	int32 oldBoundCount = 2 * m_proxyCount;
+
+	// Scratch space: the bound values and the sorted bounds of the new proxies.
+	b2Bound* newBounds = (b2Bound*)b2Alloc(2 * count * sizeof(b2Bound));
+	uint16* values = (uint16*)b2Alloc(4 * count * sizeof(uint16));
+	uint16* lowerValues[2] = {values, values + count};
+	uint16* upperValues[2] = {values + 2 * count, values + 3 * count};
+
+	bool* isNew = (bool*)b2Alloc(m_proxyCapacity * sizeof(bool));
+	memset(isNew, 0, m_proxyCapacity * sizeof(bool));
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = m_freeProxy;
+		b2Proxy* proxy = m_proxyPool + proxyId;
+		m_freeProxy = proxy->GetNext();
+
+		proxy->overlapCount = 0;
+		proxy->userData = userData[i];
+		proxyIds[i] = proxyId;
+		isNew[proxyId] = true;
+
+		uint16 lower[2], upper[2];
+		ComputeBounds(lower, upper, fatten ? b2FattenAABB(aabbs[i], b2Vec2_zero) : aabbs[i]);
+		for (int32 axis = 0; axis < 2; ++axis)
+		{
+			lowerValues[axis][i] = lower[axis];
+			upperValues[axis][i] = upper[axis];
+		}
+	}
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			newBounds[2 * i].value = lowerValues[axis][i];
+			newBounds[2 * i].proxyId = proxyIds[i];
+			newBounds[2 * i + 1].value = upperValues[axis][i];
+			newBounds[2 * i + 1].proxyId = proxyIds[i];
+		}
+
+		InsertBounds(axis, newBounds, 2 * count, oldBoundCount);
+	}
+
+	m_proxyCount += count;
+	m_maxProxyCount = b2Max(m_maxProxyCount, m_proxyCount);
+
+	BufferPairs(isNew, true);
+
+	b2Free(isNew);
+	b2Free(values);
+	b2Free(newBounds);
+
+	m_pairManager.Commit();
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+void b2SAPBroadPhase::RestoreProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds)
+{
+	// GetProxyAABB gives the start of each quantization step. Rounding can put
+	// that value into the step below, so aim for the middle.
+	b2Vec2 halfStep;
+	halfStep.Set(0.5f / m_quantizationFactor.x, 0.5f / m_quantizationFactor.y);
+
+	b2AABB* restored = (b2AABB*)b2Alloc(count * sizeof(b2AABB));
+	for (int32 i = 0; i < count; ++i)
+	{
+		restored[i].lowerBound = aabbs[i].lowerBound + halfStep;
+		restored[i].upperBound = aabbs[i].upperBound + halfStep;
+	}
+
+	// The bounds are fat already.
+	InsertProxies(restored, userData, count, proxyIds, false);
+
+	b2Free(restored);
+}
+
+void b2SAPBroadPhase::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 < m_proxyCount && m_proxyCount <= m_proxyCapacity);
+	b2Proxy* proxy = m_proxyPool + proxyId;
+	b2Assert(proxy->IsValid());
+
+	int32 boundCount = 2 * m_proxyCount;
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+
+		int32 lowerIndex = proxy->lowerBounds[axis];
+		int32 upperIndex = proxy->upperBounds[axis];
+		uint16 lowerValue = bounds[lowerIndex].value;
+		uint16 upperValue = bounds[upperIndex].value;
+
+		memmove(bounds + lowerIndex, bounds + lowerIndex + 1, (upperIndex - lowerIndex - 1) * sizeof(b2Bound));
+		memmove(bounds + upperIndex-1, bounds + upperIndex + 1, (boundCount - upperIndex - 1) * sizeof(b2Bound));
+
+		// Fix bound indices.
+		for (int32 index = lowerIndex; index < boundCount - 2; ++index)
+		{
+			b2Proxy* proxy = m_proxyPool + bounds[index].proxyId;
+			if (bounds[index].IsLower())
+			{
+				proxy->lowerBounds[axis] = index;
+			}
+			else
+			{
+				proxy->upperBounds[axis] = index;
+			}
+		}
+
+		// Fix stabbing count.
+		for (int32 index = lowerIndex; index < upperIndex - 1; ++index)
+		{
+			--bounds[index].stabbingCount;
+		}
+
+		// Query for pairs to be removed. lowerIndex and upperIndex are not needed.
+		Query(&lowerIndex, &upperIndex, lowerValue, upperValue, bounds, boundCount - 2, axis);
+	}
+
+	b2Assert(m_queryResultCount < m_proxyCapacity);
+
+	for (int32 i = 0; i < m_queryResultCount; ++i)
+	{
+		b2Assert(m_proxyPool[m_queryResults[i]].IsValid());
+		m_pairManager.RemoveBufferedPair(proxyId, m_queryResults[i]);
+	}
+
+	m_pairManager.Commit();
+
+	// Prepare for next query.
+	m_queryResultCount = 0;
+	IncrementTimeStamp();
+
+	// Return the proxy to the pool.
+	proxy->userData = NULL;
+	proxy->overlapCount = b2_invalid;
+	proxy->lowerBounds[0] = b2_invalid;
+	proxy->lowerBounds[1] = b2_invalid;
+	proxy->upperBounds[0] = b2_invalid;
+	proxy->upperBounds[1] = b2_invalid;
+
+	proxy->SetNext(m_freeProxy);
+	m_freeProxy = proxyId;
+	--m_proxyCount;
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+void b2SAPBroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	if (proxyId < 0 || m_proxyCapacity <= proxyId)
+	{
+		b2Assert(false);
+		return;
+	}
+
+	if (aabb.IsValid() == false)
+	{
+		b2Assert(false);
+		return;
+	}
+
+	int32 boundCount = 2 * m_proxyCount;
+
+	b2Proxy* proxy = m_proxyPool + proxyId;
+
+	// Get new bound values
+	b2BoundValues newValues;
+	ComputeBounds(newValues.lowerValues, newValues.upperValues, aabb);
+
+	// Nothing changes while the proxy stays inside its fat bounds.
+	if (ContainsBounds(proxy, newValues))
+	{
+		return;
+	}
+
+	ComputeBounds(newValues.lowerValues, newValues.upperValues, b2FattenAABB(aabb, displacement));
+
+	// Get old bound values
+	b2BoundValues oldValues;
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		oldValues.lowerValues[axis] = m_bounds[axis][proxy->lowerBounds[axis]].value;
+		oldValues.upperValues[axis] = m_bounds[axis][proxy->upperBounds[axis]].value;
+	}
+
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+
+		int32 lowerIndex = proxy->lowerBounds[axis];
+		int32 upperIndex = proxy->upperBounds[axis];
+
+		uint16 lowerValue = newValues.lowerValues[axis];
+		uint16 upperValue = newValues.upperValues[axis];
+
+		int32 deltaLower = lowerValue - bounds[lowerIndex].value;
+		int32 deltaUpper = upperValue - bounds[upperIndex].value;
+
+		bounds[lowerIndex].value = lowerValue;
+		bounds[upperIndex].value = upperValue;
+
+		//
+		// Expanding adds overlaps
+		//
+
+		// Should we move the lower bound down?
+		if (deltaLower < 0)
+		{
+			int32 index = lowerIndex;
+			while (index > 0 && lowerValue < bounds[index-1].value)
+			{
+				b2Bound* bound = bounds + index;
+				b2Bound* prevBound = bound - 1;
+
+				int32 prevProxyId = prevBound->proxyId;
+				b2Proxy* prevProxy = m_proxyPool + prevBound->proxyId;
+
+				++prevBound->stabbingCount;
+
+				if (prevBound->IsUpper() == true)
+				{
+					if (TestOverlap(newValues, prevProxy))
+					{
+						m_pairManager.AddBufferedPair(proxyId, prevProxyId);
+					}
+
+					++prevProxy->upperBounds[axis];
+					++bound->stabbingCount;
+				}
+				else
+				{
+					++prevProxy->lowerBounds[axis];
+					--bound->stabbingCount;
+				}
+
+				--proxy->lowerBounds[axis];
+				b2Swap(*bound, *prevBound);
+				--index;
+			}
+		}
+
+		// Should we move the upper bound up?
+		if (deltaUpper > 0)
+		{
+			int32 index = upperIndex;
+			while (index < boundCount-1 && bounds[index+1].value <= upperValue)
+			{
+				b2Bound* bound = bounds + index;
+				b2Bound* nextBound = bound + 1;
+				int32 nextProxyId = nextBound->proxyId;
+				b2Proxy* nextProxy = m_proxyPool + nextProxyId;
+
+				++nextBound->stabbingCount;
+
+				if (nextBound->IsLower() == true)
+				{
+					if (TestOverlap(newValues, nextProxy))
+					{
+						m_pairManager.AddBufferedPair(proxyId, nextProxyId);
+					}
+
+					--nextProxy->lowerBounds[axis];
+					++bound->stabbingCount;
+				}
+				else
+				{
+					--nextProxy->upperBounds[axis];
+					--bound->stabbingCount;
+				}
+
+				++proxy->upperBounds[axis];
+				b2Swap(*bound, *nextBound);
+				++index;
+			}
+		}
+
+		//
+		// Shrinking removes overlaps
+		//
+
+		// Should we move the lower bound up?
+		if (deltaLower > 0)
+		{
+			int32 index = lowerIndex;
+			while (index < boundCount-1 && bounds[index+1].value <= lowerValue)
+			{
+				b2Bound* bound = bounds + index;
+				b2Bound* nextBound = bound + 1;
+
+				int32 nextProxyId = nextBound->proxyId;
+				b2Proxy* nextProxy = m_proxyPool + nextProxyId;
+
+				--nextBound->stabbingCount;
+
+				if (nextBound->IsUpper())
+				{
+					if (TestOverlap(oldValues, nextProxy))
+					{
+						m_pairManager.RemoveBufferedPair(proxyId, nextProxyId);
+					}
+
+					--nextProxy->upperBounds[axis];
+					--bound->stabbingCount;
+				}
+				else
+				{
+					--nextProxy->lowerBounds[axis];
+					++bound->stabbingCount;
+				}
+
+				++proxy->lowerBounds[axis];
+				b2Swap(*bound, *nextBound);
+				++index;
+			}
+		}
+
+		// Should we move the upper bound down?
+		if (deltaUpper < 0)
+		{
+			int32 index = upperIndex;
+			while (index > 0 && upperValue < bounds[index-1].value)
+			{
+				b2Bound* bound = bounds + index;
+				b2Bound* prevBound = bound - 1;
+
+				int32 prevProxyId = prevBound->proxyId;
+				b2Proxy* prevProxy = m_proxyPool + prevProxyId;
+
+				--prevBound->stabbingCount;
+
+				if (prevBound->IsLower() == true)
+				{
+					if (TestOverlap(oldValues, prevProxy))
+					{
+						m_pairManager.RemoveBufferedPair(proxyId, prevProxyId);
+					}
+
+					++prevProxy->lowerBounds[axis];
+					--bound->stabbingCount;
+				}
+				else
+				{
+					++prevProxy->upperBounds[axis];
+					++bound->stabbingCount;
+				}
+
+				--proxy->upperBounds[axis];
+				b2Swap(*bound, *prevBound);
+				--index;
+			}
+		}
+	}
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+// Moving a bound costs the distance it travels in the bound arrays, so a
+// teleported proxy walks past most of the others. When a large part of the
+// proxies moves, take their bounds out, merge the new ones in and sweep for
+// the pair changes instead. The pairs a moved proxy has before the move are
+// buffered for removal, and the ones it has after are buffered again, which
+// cancels the removal of the pairs that still overlap.
+void b2SAPBroadPhase::MoveProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count)
+{
+	// Find the proxies that leave their fat bounds. A proxy given more than once
+	// takes its last AABB, like consecutive MoveProxy calls, so walk backwards
+	// and skip the proxies seen already.
+	bool* isMoved = (bool*)b2Alloc(m_proxyCapacity * sizeof(bool));
+	memset(isMoved, 0, m_proxyCapacity * sizeof(bool));
+	int32* moved = (int32*)b2Alloc(b2Max(count, 1) * sizeof(int32));
+	int32 movedCount = 0;
+	for (int32 i = count - 1; i >= 0; --i)
+	{
+		int32 proxyId = proxyIds[i];
+		b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+		b2Assert(m_proxyPool[proxyId].IsValid());
+		b2Assert(aabbs[i].IsValid());
+
+		if (isMoved[proxyId])
+		{
+			continue;
+		}
+		isMoved[proxyId] = true;
+
+		b2BoundValues newValues;
+		ComputeBounds(newValues.lowerValues, newValues.upperValues, aabbs[i]);
+		if (ContainsBounds(m_proxyPool + proxyId, newValues))
+		{
+			continue;
+		}
+
+		moved[movedCount++] = i;
+	}
+
+	// Restore the call order and flag only the proxies that leave their bounds.
+	for (int32 i = 0; i < movedCount / 2; ++i)
+	{
+		int32 index = moved[i];
+		moved[i] = moved[movedCount - 1 - i];
+		moved[movedCount - 1 - i] = index;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		isMoved[proxyIds[i]] = false;
+	}
+
+	if (8 * movedCount < m_proxyCount)
+	{
+		for (int32 i = 0; i < movedCount; ++i)
+		{
+			MoveProxy(proxyIds[moved[i]], aabbs[moved[i]], b2Vec2_zero);
+		}
+
+		b2Free(moved);
+		b2Free(isMoved);
+		return;
+	}
+
+	uint16* values = (uint16*)b2Alloc(b2Max(4 * movedCount, 1) * sizeof(uint16));
+	for (int32 i = 0; i < movedCount; ++i)
+	{
+		ComputeBounds(values + 4 * i, values + 4 * i + 2, b2FattenAABB(aabbs[moved[i]], b2Vec2_zero));
+		isMoved[proxyIds[moved[i]]] = true;
+	}
+
+	BufferPairs(isMoved, false);
+
+	int32 boundCount = 2 * m_proxyCount;
+	b2Bound* newBounds = (b2Bound*)b2Alloc(2 * movedCount * sizeof(b2Bound));
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		// Drop the old bounds of the moved proxies.
+		b2Bound* bounds = m_bounds[axis];
+		int32 keptCount = 0;
+		for (int32 index = 0; index < boundCount; ++index)
+		{
+			if (isMoved[bounds[index].proxyId] == false)
+			{
+				bounds[keptCount++] = bounds[index];
+			}
+		}
+
+		for (int32 i = 0; i < movedCount; ++i)
+		{
+			int32 proxyId = proxyIds[moved[i]];
+			newBounds[2 * i].value = values[4 * i + axis];
+			newBounds[2 * i].proxyId = proxyId;
+			newBounds[2 * i + 1].value = values[4 * i + 2 + axis];
+			newBounds[2 * i + 1].proxyId = proxyId;
+		}
+
+		InsertBounds(axis, newBounds, 2 * movedCount, keptCount);
+	}
+
+	BufferPairs(isMoved, true);
+
+	b2Free(newBounds);
+	b2Free(values);
+	b2Free(moved);
+	b2Free(isMoved);
+
+	if (s_validate)
+	{
+		Validate();
+	}
+}
+
+void b2SAPBroadPhase::Commit()
+{
+	m_pairManager.Commit();
+}
+
+int32 b2SAPBroadPhase::Query(const b2AABB& aabb, void** userData, int32 maxCount)
+{
+	uint16 lowerValues[2];
+	uint16 upperValues[2];
+	ComputeBounds(lowerValues, upperValues, aabb);
+
+	int32 lowerIndex, upperIndex;
+
+	Query(&lowerIndex, &upperIndex, lowerValues[0], upperValues[0], m_bounds[0], 2*m_proxyCount, 0);
+	Query(&lowerIndex, &upperIndex, lowerValues[1], upperValues[1], m_bounds[1], 2*m_proxyCount, 1);
+
+	b2Assert(m_queryResultCount < m_proxyCapacity);
+
+	int32 count = 0;
+	for (int32 i = 0; i < m_queryResultCount && count < maxCount; ++i, ++count)
+	{
+		b2Assert(m_queryResults[i] < m_proxyCapacity);
+		b2Proxy* proxy = m_proxyPool + m_queryResults[i];
+		b2Assert(proxy->IsValid());
+		userData[i] = proxy->userData;
+	}
+
+	// Prepare for next query.
+	m_queryResultCount = 0;
+	IncrementTimeStamp();
+
+	return count;
+}
+
+void b2SAPBroadPhase::Validate()
+{
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		b2Bound* bounds = m_bounds[axis];
+
+		int32 boundCount = 2 * m_proxyCount;
+		uint16 stabbingCount = 0;
+
+		for (int32 i = 0; i < boundCount; ++i)
+		{
+			b2Bound* bound = bounds + i;
+			b2Assert(i == 0 || bounds[i-1].value <= bound->value);
+			b2Assert(bound->proxyId != b2_nullProxy);
+			b2Assert(m_proxyPool[bound->proxyId].IsValid());
+
+			if (bound->IsLower() == true)
+			{
+				b2Assert(m_proxyPool[bound->proxyId].lowerBounds[axis] == i);
+				++stabbingCount;
+			}
+			else
+			{
+				b2Assert(m_proxyPool[bound->proxyId].upperBounds[axis] == i);
+				--stabbingCount;
+			}
+
+			b2Assert(bound->stabbingCount == stabbingCount);
+		}
+	}
+}
+
+
+int32 b2SAPBroadPhase::QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey)
+{
+	float32 maxLambda = 1;
+
+	float32 dx = (segment.p2.x-segment.p1.x)*m_quantizationFactor.x;
+	float32 dy = (segment.p2.y-segment.p1.y)*m_quantizationFactor.y;
+
+	int32 sx = dx<-B2_FLT_EPSILON ? -1 : (dx>B2_FLT_EPSILON ? 1 : 0);
+	int32 sy = dy<-B2_FLT_EPSILON ? -1 : (dy>B2_FLT_EPSILON ? 1 : 0);
+
+	b2Assert(sx!=0||sy!=0);
+
+	float32 p1x = (segment.p1.x-m_worldAABB.lowerBound.x)*m_quantizationFactor.x;
+	float32 p1y = (segment.p1.y-m_worldAABB.lowerBound.y)*m_quantizationFactor.y;
+
+	uint16 startValues[2];
+	uint16 startValues2[2];
+
+	int32 xIndex;
+	int32 yIndex;
+
+	int32 proxyId;
+	b2Proxy* proxy;
+	
+	// TODO_ERIN implement fast float to uint16 conversion.
+	startValues[0] = (uint16)(p1x) & (B2BROADPHASE_MAX - 1);
+	startValues2[0] = (uint16)(p1x) | 1;
+
+	startValues[1] = (uint16)(p1y) & (B2BROADPHASE_MAX - 1);
+	startValues2[1] = (uint16)(p1y) | 1;
+
+	//First deal with all the proxies that contain segment.p1
+	int32 lowerIndex;
+	int32 upperIndex;
+	Query(&lowerIndex,&upperIndex,startValues[0],startValues2[0],m_bounds[0],2*m_proxyCount,0);
+	if(sx>=0)	xIndex = upperIndex-1;
+	else		xIndex = lowerIndex;
+	Query(&lowerIndex,&upperIndex,startValues[1],startValues2[1],m_bounds[1],2*m_proxyCount,1);
+	if(sy>=0)	yIndex = upperIndex-1;
+	else		yIndex = lowerIndex;
+
+	//If we are using sortKey, then sort what we have so far, filtering negative keys
+	if(sortKey)
+	{
+		//Fill keys
+		for(int32 i=0;i<m_queryResultCount;i++)
+		{
+			m_querySortKeys[i] = sortKey(m_proxyPool[m_queryResults[i]].userData);
+		}
+		//Bubble sort keys
+		//Sorting negative values to the top, so we can easily remove them
+		int32 i = 0;
+		while(i<m_queryResultCount-1)
+		{
+			float32 a = m_querySortKeys[i];
+			float32 b = m_querySortKeys[i+1];
+			if((a<0)?(b>=0):(a>b&&b>=0))
+			{
+				m_querySortKeys[i+1] = a;
+				m_querySortKeys[i]   = b;
+				int32 tempValue = m_queryResults[i+1];
+				m_queryResults[i+1] = m_queryResults[i];
+				m_queryResults[i] = tempValue;
+				i--;
+				if(i==-1) i=1;
+			}
+			else
+			{
+				i++;
+			}
+		}
+		//Skim off negative values
+		while(m_queryResultCount>0 && m_querySortKeys[m_queryResultCount-1]<0)
+			m_queryResultCount--;
+	}
+
+	//Now work through the rest of the segment
+	for (;;)
+	{
+		float32 xProgress = 0;
+		float32 yProgress = 0;
+		//Move on to the next bound
+		xIndex += sx>=0?1:-1;
+		if(xIndex<0||xIndex>=m_proxyCount*2)
+			break;
+		if(sx!=0)
+			xProgress = ((float32)m_bounds[0][xIndex].value-p1x)/dx;
+		//Move on to the next bound
+		yIndex += sy>=0?1:-1;
+		if(yIndex<0||yIndex>=m_proxyCount*2)
+			break;
+		if(sy!=0)
+			yProgress = ((float32)m_bounds[1][yIndex].value-p1y)/dy;
+		for(;;)
+		{
+			if(sy==0||(sx!=0&&xProgress<yProgress))
+			{
+				if(xProgress>maxLambda)
+					break;
+
+				//Check that we are entering a proxy, not leaving
+				if(sx>0?m_bounds[0][xIndex].IsLower():m_bounds[0][xIndex].IsUpper()){
+					//Check the other axis of the proxy
+					proxyId = m_bounds[0][xIndex].proxyId;
+					proxy = m_proxyPool+proxyId;
+					if(sy>=0)
+					{
+						if(proxy->lowerBounds[1]<=yIndex-1&&proxy->upperBounds[1]>=yIndex)
+						{
+							//Add the proxy
+							if(sortKey)
+							{
+								AddProxyResult(proxyId,proxy,maxCount,sortKey);
+							}
+							else
+							{
+								m_queryResults[m_queryResultCount] = proxyId;
+								++m_queryResultCount;
+							}
+						}
+					}
+					else
+					{
+						if(proxy->lowerBounds[1]<=yIndex&&proxy->upperBounds[1]>=yIndex+1)
+						{
+							//Add the proxy
+							if(sortKey)
+							{
+								AddProxyResult(proxyId,proxy,maxCount,sortKey);
+							}
+							else
+							{
+								m_queryResults[m_queryResultCount] = proxyId;
+								++m_queryResultCount;
+							}
+						}
+					}
+				}
+
+				//Early out
+				if(sortKey && m_queryResultCount==maxCount && m_queryResultCount>0 && xProgress>m_querySortKeys[m_queryResultCount-1])
+					break;
+
+				//Move on to the next bound
+				if(sx>0)
+				{
+					xIndex++;
+					if(xIndex==m_proxyCount*2)
+						break;
+				}
+				else
+				{
+					xIndex--;
+					if(xIndex<0)
+						break;
+				}
+				xProgress = ((float32)m_bounds[0][xIndex].value - p1x) / dx;
+			}
+			else
+			{
+				if(yProgress>maxLambda)
+					break;
+
+				//Check that we are entering a proxy, not leaving
+				if(sy>0?m_bounds[1][yIndex].IsLower():m_bounds[1][yIndex].IsUpper()){
+					//Check the other axis of the proxy
+					proxyId = m_bounds[1][yIndex].proxyId;
+					proxy = m_proxyPool+proxyId;
+					if(sx>=0)
+					{
+						if(proxy->lowerBounds[0]<=xIndex-1&&proxy->upperBounds[0]>=xIndex)
+						{
+							//Add the proxy
+							if(sortKey)
+							{
+								AddProxyResult(proxyId,proxy,maxCount,sortKey);
+							}
+							else
+							{
+								m_queryResults[m_queryResultCount] = proxyId;
+								++m_queryResultCount;
+							}
+						}
+					}
+					else
+					{
+						if(proxy->lowerBounds[0]<=xIndex&&proxy->upperBounds[0]>=xIndex+1)
+						{
+							//Add the proxy
+							if(sortKey)
+							{
+								AddProxyResult(proxyId,proxy,maxCount,sortKey);
+							}
+							else
+							{
+								m_queryResults[m_queryResultCount] = proxyId;
+								++m_queryResultCount;
+							}
+						}
+					}
+				}
+
+				//Early out
+				if(sortKey && m_queryResultCount==maxCount && m_queryResultCount>0 && yProgress>m_querySortKeys[m_queryResultCount-1])
+					break;
+
+				//Move on to the next bound
+				if(sy>0)
+				{
+					yIndex++;
+					if(yIndex==m_proxyCount*2)
+						break;
+				}
+				else
+				{
+					yIndex--;
+					if(yIndex<0)
+						break;
+				}
+				yProgress = ((float32)m_bounds[1][yIndex].value - p1y) / dy;
+			}
+		}
+
+		break;
+	}
+
+	int32 count = 0;
+	for(int32 i=0;i < m_queryResultCount && count<maxCount; ++i, ++count)
+	{
+		b2Assert(m_queryResults[i] < m_proxyCapacity);
+		b2Proxy* proxy = m_proxyPool + m_queryResults[i];
+		b2Assert(proxy->IsValid());
+		userData[i] = proxy->userData;
+	}
+
+	// Prepare for next query.
+	m_queryResultCount = 0;
+	IncrementTimeStamp();
+	
+	return count;
+
+}
+void b2SAPBroadPhase::AddProxyResult(int32 proxyId, b2Proxy* proxy, int32 maxCount, SortKeyFunc sortKey)
+{
+	float32 key = sortKey(proxy->userData);
+	//Filter proxies on positive keys
+	if(key<0)
+		return;
+	//Merge the new key into the sorted list.
+	//float32* p = std::lower_bound(m_querySortKeys,m_querySortKeys+m_queryResultCount,key);
+	float32* p = m_querySortKeys;
+	while(p<m_querySortKeys+m_queryResultCount&&*p<key)
+		p++;
+	int32 i = (int32)(p-m_querySortKeys);
+	if(maxCount==m_queryResultCount&&i==m_queryResultCount)
+		return;
+	if(maxCount==m_queryResultCount)
+		m_queryResultCount--;
+	//std::copy_backward
+	for(int32 j=m_queryResultCount;j>i;--j){
+		m_querySortKeys[j] = m_querySortKeys[j-1];
+		m_queryResults[j]  = m_queryResults[j-1];
+	}
+	m_querySortKeys[i] = key;
+	m_queryResults[i] = proxyId;
+	m_queryResultCount++;
+}
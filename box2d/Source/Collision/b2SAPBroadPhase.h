@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SAP_BROAD_PHASE_H
+#define B2_SAP_BROAD_PHASE_H
+
+/*
+This broad phase uses the Sweep and Prune algorithm as described in:
+Collision Detection in Interactive 3D Environments by Gino van den Bergen
+Also, some ideas, such as using integral values for fast compares comes from
+Bullet (http:/www.bulletphysics.com).
+*/
+
+#include "b2BroadPhase.h"
+#include <climits>
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+#define	B2BROADPHASE_MAX	(USHRT_MAX/2)
+#else
+#define	B2BROADPHASE_MAX	USHRT_MAX
+
+#endif
+
+const uint16 b2_invalid = B2BROADPHASE_MAX;
+const uint16 b2_nullEdge = B2BROADPHASE_MAX;
+struct b2BoundValues;
+
+struct b2Bound
+{
+	bool IsLower() const { return (value & 1) == 0; }
+	bool IsUpper() const { return (value & 1) == 1; }
+
+	uint16 value;
+	uint16 stabbingCount;
+	int32 proxyId;
+};
+
+struct b2Proxy
+{
+	int32 GetNext() const { return lowerBounds[0]; }
+	void SetNext(int32 next) { lowerBounds[0] = next; }
+	bool IsValid() const { return overlapCount != b2_invalid; }
+
+	int32 lowerBounds[2], upperBounds[2];
+	uint16 overlapCount;
+	uint16 timeStamp;
+	void* userData;
+};
+
+/// A sweep and prune broad-phase. Bounds are quantized against a fixed world AABB
+/// and kept in sorted arrays. The proxy pool starts at b2_proxyPoolSize and grows
+/// by doubling. The bounds are fattened by b2_aabbExtension and the predicted
+/// displacement, and only move when the AABB leaves them.
+class b2SAPBroadPhase : public b2BroadPhase
+{
+public:
+	b2SAPBroadPhase(const b2AABB& worldAABB, b2PairCallback* callback);
+	~b2SAPBroadPhase();
+
+	// Use this to see if your proxy is in range. If it is not in range,
+	// it should be destroyed. Otherwise you may get O(m^2) pairs, where m
+	// is the number of proxies that are out of range.
+	bool InRange(const b2AABB& aabb) const;
+
+	// Create and destroy proxies. These call Flush first.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	void DestroyProxy(int32 proxyId);
+
+	// Create many proxies by sorting their bounds once and sweeping for pairs.
+	void CreateProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
+
+	// Create proxies from dequantized bounds. They are moved to the middle of the
+	// quantization step so they round to the same values.
+	void RestoreProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds);
+
+	// Call MoveProxy as many times as you like, then when you are done
+	// call Commit to finalized the proxy pairs (for your time step).
+	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+	void Commit();
+
+	// Move many proxies. Large batches rebuild the bound arrays.
+	void MoveProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count);
+
+	// Get a single proxy. Returns NULL if the id is invalid.
+	b2Proxy* GetProxy(int32 proxyId);
+
+	// Get the user data and the (quantized) bounds of a proxy.
+	void* GetUserData(int32 proxyId) const;
+	b2AABB GetProxyAABB(int32 proxyId) const;
+
+	// Test the overlap of two proxies using their bound values.
+	bool TestOverlap(int32 proxyIdA, int32 proxyIdB);
+
+	// Query an AABB for overlapping proxies, returns the user data and
+	// the count, up to the supplied maximum count.
+	int32 Query(const b2AABB& aabb, void** userData, int32 maxCount);
+
+	// Query a segment for overlapping proxies, returns the user data and
+	// the count, up to the supplied maximum count.
+	// If sortKey is provided, then it is a function mapping from proxy userDatas to distances along the segment (between 0 & 1)
+	// Then the returned proxies are sorted on that, before being truncated to maxCount
+	// The sortKey of a proxy is assumed to be larger than the closest point inside the proxy along the segment, this allows for early exits
+	// Proxies with a negative sortKey are discarded
+	int32 QuerySegment(const b2Segment& segment, void** userData, int32 maxCount, SortKeyFunc sortKey);
+
+	void Validate();
+	void ValidatePairs();
+
+private:
+	void ComputeBounds(uint16* lowerValues, uint16* upperValues, const b2AABB& aabb);
+
+	bool TestOverlap(b2Proxy* p1, b2Proxy* p2);
+	bool TestOverlap(const b2BoundValues& b, b2Proxy* p);
+
+	// Are the bound values inside the current bounds of the proxy?
+	bool ContainsBounds(const b2Proxy* p, const b2BoundValues& b) const;
+
+	void Query(int32* lowerIndex, int32* upperIndex, uint16 lowerValue, uint16 upperValue,
+				b2Bound* bounds, int32 boundCount, int32 axis);
+	void IncrementOverlapCount(int32 proxyId);
+	void IncrementTimeStamp();
+	void AddProxyResult(int32 proxyId, b2Proxy* proxy, int32 maxCount, SortKeyFunc sortKey);
+	void GrowProxyPool();
+
+	void InsertProxies(const b2AABB* aabbs, void** userData, int32 count, int32* proxyIds, bool fatten);
+	void InsertBounds(int32 axis, b2Bound* newBounds, int32 newCount, int32 boundCount);
+	void BufferPairs(const bool* marked, bool add);
+
+public:
+	b2Proxy* m_proxyPool;
+	int32 m_proxyCapacity;
+	int32 m_freeProxy;
+
+	// Each axis has 2 * m_proxyCapacity bounds.
+	b2Bound* m_bounds[2];
+
+	// These have room for m_proxyCapacity results.
+	int32* m_queryResults;
+	float32* m_querySortKeys;
+	int32 m_queryResultCount;
+
+	b2AABB m_worldAABB;
+	b2Vec2 m_quantizationFactor;
+	uint16 m_timeStamp;
+};
+
+
+inline bool b2SAPBroadPhase::InRange(const b2AABB& aabb) const
+{
+	b2Vec2 d = b2Max(aabb.lowerBound - m_worldAABB.upperBound, m_worldAABB.lowerBound - aabb.upperBound);
+	return b2Max(d.x, d.y) < 0.0f;
+}
+
+inline b2Proxy* b2SAPBroadPhase::GetProxy(int32 proxyId)
+{
+	if (proxyId < 0 || m_proxyCapacity <= proxyId || m_proxyPool[proxyId].IsValid() == false)
+	{
+		return NULL;
+	}
+
+	return m_proxyPool + proxyId;
+}
+
+#endif
@@ -406,6 +406,12 @@ float32 b2TimeOfImpact(const b2TOIInput* input, const TA* shapeA, const TB* shap
 				{
 					// Secant rule to improve convergence.
 					x = x1 + (target - f1) * (x2 - x1) / (f2 - f1);
+
+					// Rounding can put the secant outside the bracket in fixed point.
+					if (x <= x1 || x >= x2)
+					{
+						x = 0.5f * (x1 + x2);
+					}
 				}
 				else
 				{
@@ -438,7 +444,13 @@ float32 b2TimeOfImpact(const b2TOIInput* input, const TA* shapeA, const TB* shap
 
 				++rootIterCount;
 
-				b2Assert(rootIterCount < 50);
+				// Fixed point can't always get the root within the tolerance.
+				// The lower bracket is still separated, so stop there.
+				if (rootIterCount == 50)
+				{
+					newAlpha = x1;
+					break;
+				}
 			}
 
 			b2_maxToiRootIters = b2Max(b2_maxToiRootIters, rootIterCount);
@@ -41,6 +41,19 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #define G_1_DIV_PI		20861
 
+// Radians to a 32 bit phase, where 2^32 is one full turn: 2^32 / (2 * pi) in 16.16.
+#define G_PHASE_PER_RADIAN	683565276LL
+
+#define G_PI			205887
+#define G_PI_2			102944
+
+#ifndef TARGET_IS_NDS
+// Quarter wave sine and [0, 1] arctangent tables in 16.16, see b2FixedMath.cpp.
+// Both carry one guard entry past the end so interpolation never branches.
+extern const int b2_fixedSinTable[258];
+extern const int b2_fixedAtanTable[258];
+#endif
+
 class Fixed {
 
 	private:
@@ -72,7 +85,8 @@ class Fixed {
 		Fixed& operator =(int a);
 		Fixed& operator =(long a);
 	
-		int raw() { return g; }
+		int raw() const { return g; }
+		static Fixed FromRaw(int guts) { return Fixed(RAW, guts); }
 
 		operator float();
 		operator double();
@@ -165,9 +179,9 @@ class Fixed {
 	
 		Fixed abs();
 		Fixed sqrt();
-#ifdef TARGET_IS_NDS
 		Fixed cosf();
 		Fixed sinf();
+#ifdef TARGET_IS_NDS
 		Fixed tanf();
 #endif
 };
@@ -250,23 +264,23 @@ inline Fixed Fixed::operator /(const Fixed a) const
 #else
 inline Fixed Fixed::operator /(const Fixed a) const
 {
-	return Fixed(RAW, int( (((long long)g << BP2) / (long long)(a.g)) >> BP) );
-	//return Fixed(RAW, int( (((long long)g << BP) / (long long)(a.g)) ) );
+	return Fixed(RAW, int( ((long long)g << BP) / (long long)(a.g) ) );
 }
 #endif
 
-inline Fixed Fixed::operator *(unsigned short a) const { return operator*(Fixed(a)); }
-inline Fixed Fixed::operator *(int a) const { return operator*(Fixed(a)); }
+// Integer scale is exact, no need to widen.
+inline Fixed Fixed::operator *(unsigned short a) const { return Fixed(RAW, g * (int)a); }
+inline Fixed Fixed::operator *(int a) const { return Fixed(RAW, g * a); }
 
 inline Fixed Fixed::operator +(float a) const { return Fixed(RAW, g + Fixed(a).g); }
 inline Fixed Fixed::operator -(float a) const { return Fixed(RAW, g - Fixed(a).g); }
-inline Fixed Fixed::operator *(float a) const { return Fixed(RAW, (g>>BPhalf) * (Fixed(a).g>>BPhalf) ); }
+inline Fixed Fixed::operator *(float a) const { return operator*(Fixed(a)); }
 //inline Fixed Fixed::operator /(float a) const { return Fixed(RAW, int( (((long long)g << BP2) / (long long)(Fixed(a).g)) >> BP) ); }
 inline Fixed Fixed::operator /(float a) const { return operator/(Fixed(a)); }
 
 inline Fixed Fixed::operator +(double a) const { return Fixed(RAW, g + Fixed(a).g); }
 inline Fixed Fixed::operator -(double a) const { return Fixed(RAW, g - Fixed(a).g); }
-inline Fixed Fixed::operator *(double a) const { return Fixed(RAW, (g>>BPhalf) * (Fixed(a).g>>BPhalf) ); }
+inline Fixed Fixed::operator *(double a) const { return operator*(Fixed(a)); }
 //inline Fixed Fixed::operator /(double a) const { return Fixed(RAW, int( (((long long)g << BP2) / (long long)(Fixed(a).g)) >> BP) ); }
 inline Fixed Fixed::operator /(double a) const { return operator/(Fixed(a)); }
 
@@ -385,10 +399,10 @@ inline double& operator -=(double& a, const Fixed b) { a = a - b; return a; }
 inline double& operator *=(double& a, const Fixed b) { a = a * b; return a; }
 inline double& operator /=(double& a, const Fixed b) { a = a / b; return a; }
 
-inline Fixed Fixed::abs() { return (g>0) ? Fixed(RAW, g) : Fixed(RAW, -g); }
+inline Fixed Fixed::abs() { int m = g >> 31; return Fixed(RAW, (g ^ m) - m); }
 inline Fixed abs(Fixed f) { return f.abs(); }
 
-//inline Fixed atan2(Fixed a, Fixed b) { return atan2f((float) a, (float) b); }
+#ifdef TARGET_IS_NDS
 inline Fixed atan2(Fixed y, Fixed x)
 {
 	Fixed abs_y = y.abs() + FIXED_EPSILON;	// avoid 0/0
@@ -404,6 +418,34 @@ inline Fixed atan2(Fixed y, Fixed x)
 	angle += Fixed(0.1963) * (r * r * r) - Fixed(0.9817) * r;
 	return (y < 0) ? -angle : angle;
 }
+#else
+// Fold into the first octant, look up atan(min / max) and unfold.
+inline Fixed atan2(Fixed y, Fixed x)
+{
+	int gy = y.raw(), gx = x.raw();
+	int sy = gy >> 31, sx = gx >> 31;
+	unsigned int ay = (unsigned int)((gy ^ sy) - sy);
+	unsigned int ax = (unsigned int)((gx ^ sx) - sx);
+	int steep = -(int)(ay > ax);
+	unsigned int lo = (ay & ~steep) | (ax & steep);
+	unsigned int hi = (ax & ~steep) | (ay & steep);
+
+	// Normalize so a 32 bit divide keeps 15 bits of the ratio, then move it
+	// to 8.24 so the top bits index the table and the rest interpolate.
+	hi += (hi == 0);
+	int n = __builtin_clz(hi);
+	hi <<= n;
+	lo <<= n;
+	unsigned int t = (lo / (hi >> 15)) << 9;
+	int i = t >> 16, f = t & 0xffff;
+	int a = b2_fixedAtanTable[i];
+	a += (int)(((long long)(b2_fixedAtanTable[i + 1] - a) * f) >> 16);
+
+	a = ((G_PI_2 - a) & steep) | (a & ~steep);
+	a = ((G_PI - a) & sx) | (a & ~sx);
+	return Fixed::FromRaw((a ^ sy) - sy);
+}
+#endif
 
 #if TARGET_IS_NDS
 
@@ -433,17 +475,53 @@ inline Fixed Fixed::sqrt()
 	return Fixed(RAW, nds_sqrt64(((long long)(g))<<BP));
 }
 #else
+// Turkowski's fixed point square root, two bits of the radicand per step.
+// Negative inputs return zero.
 inline Fixed Fixed::sqrt()
 {
-	long long m, root = 0, left = (long long)g<<FIXED_BP;
-	for ( m = (long long)1<<( (sizeof(long long)<<3) - 2); m; m >>= 2 )
+	unsigned int root = 0, remHi = 0, remLo = (unsigned int)(g & ~(g >> 31));
+
+	// Leading zero bit pairs leave the root at zero, skip them.
+	int skip = __builtin_clz(remLo | 1) >> 1;
+	remLo <<= skip << 1;
+	for (int count = 15 + (BP >> 1) - skip; count >= 0; --count)
 	{
-		if ( ( left & -m ) > root ) 
-			left -= ( root += m ), root += m;
-		root >>= 1;
+		remHi = (remHi << 2) | (remLo >> 30);
+		remLo <<= 2;
+		root <<= 1;
+		unsigned int testDiv = (root << 1) + 1;
+		unsigned int take = -(unsigned int)(remHi >= testDiv);
+		remHi -= testDiv & take;
+		root += 1 & take;
 	}
-	return Fixed(RAW, root);
+	return Fixed(RAW, (int)root);
+}
+
+// Sine of a 32 bit phase from the quarter wave table. The odd quadrants
+// run the table backwards and the lower half circle flips the sign.
+inline int b2FixedSinPhase(unsigned int phase)
+{
+	int odd = -(int)((phase >> 30) & 1);
+	int neg = -(int)(phase >> 31);
+	unsigned int u = phase & 0x3fffffff;
+	u = ((0x40000000 - u) & odd) | (u & ~odd);
+	int i = u >> 22, f = (u >> 6) & 0xffff;
+	int s = b2_fixedSinTable[i];
+	s += ((b2_fixedSinTable[i + 1] - s) * f) >> 16;
+	return (s ^ neg) - neg;
+}
+
+inline Fixed Fixed::sinf()
+{
+	return Fixed(RAW, b2FixedSinPhase((unsigned int)(((long long)g * G_PHASE_PER_RADIAN) >> BP)));
+}
+inline Fixed sinf(Fixed x) { return x.sinf(); }
+
+inline Fixed Fixed::cosf()
+{
+	return Fixed(RAW, b2FixedSinPhase((unsigned int)(((long long)g * G_PHASE_PER_RADIAN) >> BP) + 0x40000000));
 }
+inline Fixed cosf(Fixed x) { return x.cosf(); }
 #endif
 
 inline Fixed sqrt(Fixed a) { return a.sqrt(); }
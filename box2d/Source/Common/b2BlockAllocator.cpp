@@ -23,7 +23,7 @@
 
 #include <cstring>
 
-int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] = 
+const int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] = 
 {
 	16,		// 0
 	32,		// 1
@@ -40,8 +40,24 @@ int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] =
 	512,	// 12
 	640,	// 13
 };
-uint8 b2BlockAllocator::s_blockSizeLookup[b2_maxBlockSize + 1];
-bool b2BlockAllocator::s_blockSizeLookupInitialized;
+
+// All block sizes are multiples of 16, so the size class of a size is
+// s_blockSizeLookup[(size + 15) / 16]. The table is constant so that
+// allocators can be created on several threads.
+const uint8 b2BlockAllocator::s_blockSizeLookup[b2_maxBlockSize / 16 + 1] =
+{
+	0,						// 0
+	0, 1, 2, 2,				// 16 - 64
+	3, 3, 4, 4,				// 80 - 128
+	5, 5, 6, 6,				// 144 - 192
+	7, 7, 8, 8,				// 208 - 256
+	9, 9, 9, 9,				// 272 - 320
+	10, 10, 10, 10,			// 336 - 384
+	11, 11, 11, 11,			// 400 - 448
+	12, 12, 12, 12,			// 464 - 512
+	13, 13, 13, 13,			// 528 - 576
+	13, 13, 13, 13,			// 592 - 640
+};
 
 struct b2Chunk
 {
@@ -64,26 +80,8 @@ b2BlockAllocator::b2BlockAllocator()
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
-
-	if (s_blockSizeLookupInitialized == false)
-	{
-		int32 j = 0;
-		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
-		{
-			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
-			{
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-			else
-			{
-				++j;
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-		}
-
-		s_blockSizeLookupInitialized = true;
-	}
+	memset(m_liveCounts, 0, sizeof(m_liveCounts));
+	memset(m_chunkCounts, 0, sizeof(m_chunkCounts));
 }
 
 b2BlockAllocator::~b2BlockAllocator()
@@ -103,50 +101,83 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 	b2Assert(0 < size && size <= b2_maxBlockSize);
 
-	int32 index = s_blockSizeLookup[size];
+	int32 index = s_blockSizeLookup[(size + 15) >> 4];
 	b2Assert(0 <= index && index < b2_blockSizes);
+	b2Assert(size <= s_blockSizes[index]);
+
+	++m_liveCounts[index];
 
-	if (m_freeLists[index])
+	if (m_freeLists[index] == NULL)
 	{
-		b2Block* block = m_freeLists[index];
-		m_freeLists[index] = block->next;
-		return block;
+		AddChunk(index);
 	}
-	else
+
+	b2Block* block = m_freeLists[index];
+	m_freeLists[index] = block->next;
+	return block;
+}
+
+void b2BlockAllocator::Reserve(int32 size, int32 count)
+{
+	if (size == 0 || count <= 0)
 	{
-		if (m_chunkCount == m_chunkSpace)
-		{
-			b2Chunk* oldChunks = m_chunks;
-			m_chunkSpace += b2_chunkArrayIncrement;
-			m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
-			memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
-			memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
-			b2Free(oldChunks);
-		}
+		return;
+	}
+
+	b2Assert(0 < size && size <= b2_maxBlockSize);
+
+	int32 index = s_blockSizeLookup[(size + 15) >> 4];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+	int32 freeCount = 0;
+	for (b2Block* block = m_freeLists[index]; block && freeCount < count; block = block->next)
+	{
+		++freeCount;
+	}
 
-		b2Chunk* chunk = m_chunks + m_chunkCount;
-		chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
+	int32 blockCount = b2_chunkSize / s_blockSizes[index];
+	while (freeCount < count)
+	{
+		AddChunk(index);
+		freeCount += blockCount;
+	}
+}
+
+void b2BlockAllocator::AddChunk(int32 index)
+{
+	if (m_chunkCount == m_chunkSpace)
+	{
+		b2Chunk* oldChunks = m_chunks;
+		m_chunkSpace += b2_chunkArrayIncrement;
+		m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+		memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
+		memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
+		b2Free(oldChunks);
+	}
+
+	b2Chunk* chunk = m_chunks + m_chunkCount;
+	chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
 #if defined(_DEBUG)
-		memset(chunk->blocks, 0xcd, b2_chunkSize);
+	memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
-		int32 blockSize = s_blockSizes[index];
-		chunk->blockSize = blockSize;
-		int32 blockCount = b2_chunkSize / blockSize;
-		b2Assert(blockCount * blockSize <= b2_chunkSize);
-		for (int32 i = 0; i < blockCount - 1; ++i)
-		{
-			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
-			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
-			block->next = next;
-		}
-		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
-		last->next = NULL;
+	int32 blockSize = s_blockSizes[index];
+	chunk->blockSize = blockSize;
+	int32 blockCount = b2_chunkSize / blockSize;
+	b2Assert(blockCount * blockSize <= b2_chunkSize);
+	for (int32 i = 0; i < blockCount - 1; ++i)
+	{
+		b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
+		b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
+		block->next = next;
+	}
 
-		m_freeLists[index] = chunk->blocks->next;
-		++m_chunkCount;
+	// Put the new blocks in front of the free list.
+	b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
+	last->next = m_freeLists[index];
 
-		return chunk->blocks;
-	}
+	m_freeLists[index] = chunk->blocks;
+	++m_chunkCount;
+	++m_chunkCounts[index];
 }
 
 void b2BlockAllocator::Free(void* p, int32 size)
@@ -158,8 +189,11 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	b2Assert(0 < size && size <= b2_maxBlockSize);
 
-	int32 index = s_blockSizeLookup[size];
+	int32 index = s_blockSizeLookup[(size + 15) >> 4];
 	b2Assert(0 <= index && index < b2_blockSizes);
+	b2Assert(m_liveCounts[index] > 0);
+
+	--m_liveCounts[index];
 
 #ifdef _DEBUG
 	// Verify the memory address and size is valid.
@@ -204,4 +238,123 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_liveCounts, 0, sizeof(m_liveCounts));
+	memset(m_chunkCounts, 0, sizeof(m_chunkCounts));
+}
+
+static int b2CompareChunks(const void* a, const void* b)
+{
+	const b2Chunk* chunkA = *(const b2Chunk* const*)a;
+	const b2Chunk* chunkB = *(const b2Chunk* const*)b;
+	if (chunkA->blocks < chunkB->blocks)
+	{
+		return -1;
+	}
+	return chunkA->blocks > chunkB->blocks ? 1 : 0;
+}
+
+// Find the chunk holding a block in chunks sorted by address.
+static b2Chunk* b2FindChunk(b2Chunk** sorted, int32 count, void* p)
+{
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low < high)
+	{
+		int32 mid = (low + high + 1) >> 1;
+		if ((int8*)sorted[mid]->blocks <= (int8*)p)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	b2Chunk* chunk = sorted[low];
+	b2Assert((int8*)chunk->blocks <= (int8*)p && (int8*)p < (int8*)chunk->blocks + b2_chunkSize);
+	return chunk;
+}
+
+int32 b2BlockAllocator::Trim()
+{
+	if (m_chunkCount == 0)
+	{
+		return 0;
+	}
+
+	// Sort the chunks by address so that each free block can find its chunk.
+	b2Chunk** sorted = (b2Chunk**)b2Alloc(m_chunkCount * sizeof(b2Chunk*));
+	int32* freeCounts = (int32*)b2Alloc(m_chunkCount * sizeof(int32));
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		sorted[i] = m_chunks + i;
+		freeCounts[i] = 0;
+	}
+	qsort(sorted, m_chunkCount, sizeof(b2Chunk*), b2CompareChunks);
+
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		for (b2Block* block = m_freeLists[i]; block; block = block->next)
+		{
+			b2Chunk* chunk = b2FindChunk(sorted, m_chunkCount, block);
+			++freeCounts[chunk - m_chunks];
+		}
+	}
+
+	// Unlink the blocks of the chunks that have no live blocks.
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		b2Block** link = m_freeLists + i;
+		while (*link)
+		{
+			b2Chunk* chunk = b2FindChunk(sorted, m_chunkCount, *link);
+			if (freeCounts[chunk - m_chunks] == b2_chunkSize / chunk->blockSize)
+			{
+				*link = (*link)->next;
+			}
+			else
+			{
+				link = &(*link)->next;
+			}
+		}
+	}
+
+	// Release those chunks and compact the chunk array.
+	int32 released = 0;
+	int32 count = 0;
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Chunk* chunk = m_chunks + i;
+		if (freeCounts[i] == b2_chunkSize / chunk->blockSize)
+		{
+			--m_chunkCounts[s_blockSizeLookup[chunk->blockSize >> 4]];
+			b2Free(chunk->blocks);
+			released += b2_chunkSize;
+		}
+		else
+		{
+			m_chunks[count++] = *chunk;
+		}
+	}
+
+	memset(m_chunks + count, 0, (m_chunkCount - count) * sizeof(b2Chunk));
+	m_chunkCount = count;
+
+	b2Free(freeCounts);
+	b2Free(sorted);
+
+	return released;
+}
+
+void b2BlockAllocator::GetStats(b2BlockAllocatorStats* stats) const
+{
+	stats->chunkCount = m_chunkCount;
+	stats->liveBlockCount = 0;
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		stats->liveBlockCount += m_liveCounts[i];
+		stats->liveBytes[i] = m_liveCounts[i] * s_blockSizes[i];
+		stats->chunkBytes[i] = m_chunkCounts[i] * b2_chunkSize;
+	}
 }
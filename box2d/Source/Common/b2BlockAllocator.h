@@ -29,9 +29,20 @@ const int32 b2_chunkArrayIncrement = 128;
 struct b2Block;
 struct b2Chunk;
 
+/// Block allocator usage, to size and trim the allocator in production.
+struct b2BlockAllocatorStats
+{
+	int32 chunkCount;							///< chunks held by the allocator
+	int32 liveBlockCount;						///< blocks allocated and not freed
+	int32 liveBytes[b2_blockSizes];				///< bytes of the live blocks of each size class
+	int32 chunkBytes[b2_blockSizes];			///< bytes of the chunks of each size class
+};
+
 // This is a small object allocator used for allocating small
 // objects that persist for more than one time step.
 // See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
+// Allocators share no mutable state, so different allocators can be used
+// on different threads at the same time. One allocator is not thread safe.
 class b2BlockAllocator
 {
 public:
@@ -43,17 +54,41 @@ public:
 
 	void Clear();
 
+	// Make sure the next count allocations of this size don't need to
+	// allocate chunks, so a bulk load fills whole chunks up front.
+	void Reserve(int32 size, int32 count);
+
+	// Release the chunks that have no live blocks.
+	// @return the number of bytes released.
+	int32 Trim();
+
+	void GetStats(b2BlockAllocatorStats* stats) const;
+
+	// The block size of a size class.
+	static int32 GetBlockSize(int32 sizeClass);
+
 private:
 
+	// Allocate a chunk for a size class and push its blocks on the free list.
+	void AddChunk(int32 index);
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizes];
 
-	static int32 s_blockSizes[b2_blockSizes];
-	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
-	static bool s_blockSizeLookupInitialized;
+	int32 m_liveCounts[b2_blockSizes];
+	int32 m_chunkCounts[b2_blockSizes];
+
+	static const int32 s_blockSizes[b2_blockSizes];
+	static const uint8 s_blockSizeLookup[b2_maxBlockSize / 16 + 1];
 };
 
+inline int32 b2BlockAllocator::GetBlockSize(int32 sizeClass)
+{
+	b2Assert(0 <= sizeClass && sizeClass < b2_blockSizes);
+	return s_blockSizes[sizeClass];
+}
+
 #endif
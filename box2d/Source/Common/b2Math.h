@@ -151,7 +151,7 @@ struct b2Vec2
 	float32 Length() const
 	{
 #ifdef TARGET_FLOAT32_IS_FIXED
-		float est = b2Abs(x) + b2Abs(y);
+		float32 est = b2Abs(x) + b2Abs(y);
 		if(est == 0.0f) {
 			return 0.0;
 		} else if(est < 0.1) {
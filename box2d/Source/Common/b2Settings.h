@@ -81,14 +81,22 @@ typedef float float32;
 /// objects to move a small amount without needing to adjust the tree.
 #define b2_fatAABBFactor			1.5f
 
+/// Margin in meters added to the bounds of the sweep and prune broad-phase. This
+/// allows proxies to move a small amount without moving their bounds.
+#define b2_aabbExtension			0.1f
+
+/// The sweep and prune broad-phase also stretches the bounds along the last
+/// displacement of a proxy, times this factor, to predict its movement.
+#define b2_aabbMultiplier			2.0f
+
 /// The initial pool size for the dynamic tree.
 #define b2_nodePoolSize				50
 
-/// This must be a power of two
-#define b2_maxProxies				512
+/// The initial proxy pool size for the sweep and prune broad-phase.
+#define b2_proxyPoolSize			64
 
-/// This must be a power of two
-#define b2_maxPairs					(8 * b2_maxProxies)
+/// The initial pair pool size for the pair manager. This must be a power of two.
+#define b2_pairPoolSize				256
 
 /// A small length used as a collision and constraint tolerance. Usually it is
 /// chosen to be numerically significant, but visually insignificant.
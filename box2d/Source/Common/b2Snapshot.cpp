@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2Snapshot.h"
+
+#include <cstring>
+
+b2SnapshotWriter::b2SnapshotWriter(void* buffer, int32 capacity)
+{
+	m_buffer = (uint8*)buffer;
+	m_capacity = buffer ? capacity : 0;
+	m_size = 0;
+}
+
+void b2SnapshotWriter::Write(const void* data, int32 size)
+{
+	if (m_size + size <= m_capacity)
+	{
+		memcpy(m_buffer + m_size, data, size);
+	}
+	m_size += size;
+}
+
+void b2SnapshotWriter::WriteInt32(int32 value)
+{
+	Write(&value, sizeof(int32));
+}
+
+void b2SnapshotWriter::WriteFloat32(float32 value)
+{
+	b2Assert(sizeof(float32) == 4);
+	Write(&value, sizeof(float32));
+}
+
+void b2SnapshotWriter::WriteBool(bool value)
+{
+	WriteInt32(value ? 1 : 0);
+}
+
+void b2SnapshotWriter::WriteVec2(const b2Vec2& value)
+{
+	WriteFloat32(value.x);
+	WriteFloat32(value.y);
+}
+
+b2SnapshotReader::b2SnapshotReader(const void* data, int32 size)
+{
+	m_data = (const uint8*)data;
+	m_size = data ? size : 0;
+	m_position = 0;
+	m_valid = true;
+}
+
+void b2SnapshotReader::Read(void* data, int32 size)
+{
+	if (m_position + size > m_size)
+	{
+		memset(data, 0, size);
+		m_position = m_size;
+		m_valid = false;
+		return;
+	}
+
+	memcpy(data, m_data + m_position, size);
+	m_position += size;
+}
+
+int32 b2SnapshotReader::ReadInt32()
+{
+	int32 value;
+	Read(&value, sizeof(int32));
+	return value;
+}
+
+float32 b2SnapshotReader::ReadFloat32()
+{
+	float32 value;
+	Read(&value, sizeof(float32));
+	return value;
+}
+
+bool b2SnapshotReader::ReadBool()
+{
+	return ReadInt32() != 0;
+}
+
+b2Vec2 b2SnapshotReader::ReadVec2()
+{
+	b2Vec2 value;
+	value.x = ReadFloat32();
+	value.y = ReadFloat32();
+	return value;
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "b2Math.h"
+
+/// Writes the values of a world snapshot to a memory buffer. Values are
+/// stored as 4 bytes in native byte order, float32 as its raw bits, so a
+/// snapshot can only be read by a build with the same math type.
+/// Writing past the capacity only counts the bytes, so a NULL buffer
+/// measures the size of a snapshot.
+class b2SnapshotWriter
+{
+public:
+	b2SnapshotWriter(void* buffer, int32 capacity);
+
+	void WriteInt32(int32 value);
+	void WriteFloat32(float32 value);
+	void WriteBool(bool value);
+	void WriteVec2(const b2Vec2& value);
+
+	/// Get the number of bytes written, including those that didn't fit.
+	int32 GetSize() const;
+
+	/// Did all the bytes fit in the buffer?
+	bool IsComplete() const;
+
+private:
+	void Write(const void* data, int32 size);
+
+	uint8* m_buffer;
+	int32 m_capacity;
+	int32 m_size;
+};
+
+/// Reads the values written by b2SnapshotWriter. Reading past the end
+/// returns zeros and marks the reader as failed.
+class b2SnapshotReader
+{
+public:
+	b2SnapshotReader(const void* data, int32 size);
+
+	int32 ReadInt32();
+	float32 ReadFloat32();
+	bool ReadBool();
+	b2Vec2 ReadVec2();
+
+	/// Were all reads inside the data?
+	bool IsValid() const;
+
+private:
+	void Read(void* data, int32 size);
+
+	const uint8* m_data;
+	int32 m_size;
+	int32 m_position;
+	bool m_valid;
+};
+
+inline int32 b2SnapshotWriter::GetSize() const
+{
+	return m_size;
+}
+
+inline bool b2SnapshotWriter::IsComplete() const
+{
+	return m_size <= m_capacity;
+}
+
+inline bool b2SnapshotReader::IsValid() const
+{
+	return m_valid;
+}
+
+#endif
@@ -19,11 +19,15 @@
 #include "b2StackAllocator.h"
 #include "b2Math.h"
 
-b2StackAllocator::b2StackAllocator()
+b2StackAllocator::b2StackAllocator(int32 capacity)
 {
+	b2Assert(capacity > 0);
+	m_capacity = capacity;
+	m_data = (char*)b2Alloc(m_capacity);
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_overflowCount = 0;
 	m_entryCount = 0;
 }
 
@@ -31,6 +35,7 @@ b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+	b2Free(m_data);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
@@ -39,10 +44,11 @@ void* b2StackAllocator::Allocate(int32 size)
 
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_capacity)
 	{
 		entry->data = (char*)b2Alloc(size);
 		entry->usedMalloc = true;
+		++m_overflowCount;
 	}
 	else
 	{
@@ -77,7 +83,35 @@ void b2StackAllocator::Free(void* p)
 	p = NULL;
 }
 
+void b2StackAllocator::Grow()
+{
+	b2Assert(m_entryCount == 0);
+
+	if (m_maxAllocation > m_capacity)
+	{
+		while (m_capacity < m_maxAllocation)
+		{
+			m_capacity *= 2;
+		}
+
+		b2Free(m_data);
+		m_data = (char*)b2Alloc(m_capacity);
+	}
+
+	m_maxAllocation = 0;
+}
+
 int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+int32 b2StackAllocator::GetOverflowCount() const
+{
+	return m_overflowCount;
+}
@@ -34,24 +34,39 @@ struct b2StackEntry
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// Allocations that don't fit the arena fall back to b2Alloc. Call
+// Grow between steps so the next step fits.
 class b2StackAllocator
 {
 public:
-	b2StackAllocator();
+	b2StackAllocator(int32 capacity = b2_stackSize);
 	~b2StackAllocator();
 
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	// Grow the arena to hold the peak allocation since the last call, then
+	// reset the peak. Nothing may be allocated.
+	void Grow();
+
+	// The peak allocation since the last call to Grow.
 	int32 GetMaxAllocation() const;
 
+	// The size of the arena.
+	int32 GetCapacity() const;
+
+	// The number of allocations that did not fit the arena.
+	int32 GetOverflowCount() const;
+
 private:
 
-	char m_data[b2_stackSize];
+	char* m_data;
+	int32 m_capacity;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_overflowCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
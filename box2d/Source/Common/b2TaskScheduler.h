@@ -0,0 +1,47 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TASK_SCHEDULER_H
+#define B2_TASK_SCHEDULER_H
+
+#include "b2Settings.h"
+
+/// A task function. The index identifies the work item, the thread index
+/// is in [0, b2TaskScheduler::GetThreadCount()) and identifies the thread
+/// running the task. Index 0 is the thread that called ParallelFor.
+typedef void b2TaskFcn(void* context, int32 index, int32 threadIndex);
+
+/// Implement this interface to let Box2D run work on your job system.
+/// Box2D only calls ParallelFor from inside b2World::Step.
+/// @see b2World::SetTaskScheduler, b2ThreadPool
+class b2TaskScheduler
+{
+public:
+	virtual ~b2TaskScheduler() {}
+
+	/// Get the number of threads that may run tasks, including the calling thread.
+	/// This must not change while the scheduler is attached to a world.
+	virtual int32 GetThreadCount() const = 0;
+
+	/// Call task(context, i, threadIndex) once for each i in [0, count) and
+	/// return when all calls are done. Calls may run in any order and at
+	/// the same time, but two calls never share a thread index at the same time.
+	virtual void ParallelFor(b2TaskFcn* task, void* context, int32 count) = 0;
+};
+
+#endif
@@ -0,0 +1,300 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2ThreadPool.h"
+#include "b2Math.h"
+
+#ifndef TARGET_IS_NDS
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+// Notes:
+// - each worker has an auto-reset start event, so it runs a call only once.
+// - task indices are handed out with interlocked increments.
+
+b2ThreadPool::b2ThreadPool(int32 threadCount)
+{
+	if (threadCount <= 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		threadCount = (int32)info.dwNumberOfProcessors;
+	}
+	m_threadCount = b2Max(threadCount, 1);
+
+	m_doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_busyCount = 0;
+	m_next = 0;
+	m_exit = false;
+
+	m_task = NULL;
+	m_context = NULL;
+	m_count = 0;
+
+	// Thread 0 is the caller of ParallelFor.
+	m_workers = (Worker*)b2Alloc((m_threadCount - 1) * sizeof(Worker));
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		Worker* worker = m_workers + i;
+		worker->pool = this;
+		worker->threadIndex = i + 1;
+		worker->startEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		worker->thread = CreateThread(NULL, 0, WorkerMain, worker, 0, NULL);
+	}
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	m_exit = true;
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		SetEvent(m_workers[i].startEvent);
+	}
+
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		WaitForSingleObject(m_workers[i].thread, INFINITE);
+		CloseHandle(m_workers[i].thread);
+		CloseHandle(m_workers[i].startEvent);
+	}
+	b2Free(m_workers);
+
+	CloseHandle(m_doneEvent);
+}
+
+unsigned long __stdcall b2ThreadPool::WorkerMain(void* data)
+{
+	Worker* worker = (Worker*)data;
+	b2ThreadPool* pool = worker->pool;
+
+	for (;;)
+	{
+		// Waiting and signaling are full barriers, so the call is visible here.
+		WaitForSingleObject(worker->startEvent, INFINITE);
+
+		if (pool->m_exit)
+		{
+			break;
+		}
+
+		pool->RunTasks(worker->threadIndex);
+
+		if (InterlockedDecrement(&pool->m_busyCount) == 0)
+		{
+			SetEvent(pool->m_doneEvent);
+		}
+	}
+
+	return 0;
+}
+
+void b2ThreadPool::RunTasks(int32 threadIndex)
+{
+	for (;;)
+	{
+		int32 index = (int32)InterlockedIncrement(&m_next) - 1;
+		if (index >= m_count)
+		{
+			return;
+		}
+
+		m_task(m_context, index, threadIndex);
+	}
+}
+
+void b2ThreadPool::ParallelFor(b2TaskFcn* task, void* context, int32 count)
+{
+	if (m_threadCount == 1 || count <= 1)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			task(context, i, 0);
+		}
+		return;
+	}
+
+	m_task = task;
+	m_context = context;
+	m_count = count;
+	m_next = 0;
+	m_busyCount = m_threadCount - 1;
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		SetEvent(m_workers[i].startEvent);
+	}
+
+	RunTasks(0);
+
+	// Wait for the workers to finish their last task.
+	WaitForSingleObject(m_doneEvent, INFINITE);
+}
+
+#else
+
+#include <unistd.h>
+
+// Notes:
+// - task indices are handed out under the mutex. Older ARM targets don't
+//   have atomic instructions, and the tasks are coarse (whole islands).
+// - each ParallelFor bumps m_generation so a worker runs a call only once.
+
+b2ThreadPool::b2ThreadPool(int32 threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = (int32)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	m_threadCount = b2Max(threadCount, 1);
+
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_startCondition, NULL);
+	pthread_cond_init(&m_doneCondition, NULL);
+
+	m_generation = 0;
+	m_busyCount = 0;
+	m_exit = false;
+
+	m_task = NULL;
+	m_context = NULL;
+	m_count = 0;
+	m_next = 0;
+
+	// Thread 0 is the caller of ParallelFor.
+	m_workers = (Worker*)b2Alloc((m_threadCount - 1) * sizeof(Worker));
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		Worker* worker = m_workers + i;
+		worker->pool = this;
+		worker->threadIndex = i + 1;
+		pthread_create(&worker->thread, NULL, WorkerMain, worker);
+	}
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_exit = true;
+	pthread_cond_broadcast(&m_startCondition);
+	pthread_mutex_unlock(&m_mutex);
+
+	for (int32 i = 0; i < m_threadCount - 1; ++i)
+	{
+		pthread_join(m_workers[i].thread, NULL);
+	}
+	b2Free(m_workers);
+
+	pthread_cond_destroy(&m_doneCondition);
+	pthread_cond_destroy(&m_startCondition);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void* b2ThreadPool::WorkerMain(void* data)
+{
+	Worker* worker = (Worker*)data;
+	b2ThreadPool* pool = worker->pool;
+
+	int32 generation = 0;
+
+	pthread_mutex_lock(&pool->m_mutex);
+	for (;;)
+	{
+		while (pool->m_generation == generation && pool->m_exit == false)
+		{
+			pthread_cond_wait(&pool->m_startCondition, &pool->m_mutex);
+		}
+
+		if (pool->m_exit)
+		{
+			break;
+		}
+
+		generation = pool->m_generation;
+		pthread_mutex_unlock(&pool->m_mutex);
+
+		pool->RunTasks(worker->threadIndex);
+
+		pthread_mutex_lock(&pool->m_mutex);
+		--pool->m_busyCount;
+		if (pool->m_busyCount == 0)
+		{
+			pthread_cond_signal(&pool->m_doneCondition);
+		}
+	}
+	pthread_mutex_unlock(&pool->m_mutex);
+
+	return NULL;
+}
+
+void b2ThreadPool::RunTasks(int32 threadIndex)
+{
+	for (;;)
+	{
+		pthread_mutex_lock(&m_mutex);
+		int32 index = m_next;
+		if (index < m_count)
+		{
+			++m_next;
+		}
+		pthread_mutex_unlock(&m_mutex);
+
+		if (index >= m_count)
+		{
+			return;
+		}
+
+		m_task(m_context, index, threadIndex);
+	}
+}
+
+void b2ThreadPool::ParallelFor(b2TaskFcn* task, void* context, int32 count)
+{
+	if (m_threadCount == 1 || count <= 1)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			task(context, i, 0);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_task = task;
+	m_context = context;
+	m_count = count;
+	m_next = 0;
+	m_busyCount = m_threadCount - 1;
+	++m_generation;
+	pthread_cond_broadcast(&m_startCondition);
+	pthread_mutex_unlock(&m_mutex);
+
+	RunTasks(0);
+
+	// Wait for the workers to finish their last task.
+	pthread_mutex_lock(&m_mutex);
+	while (m_busyCount > 0)
+	{
+		pthread_cond_wait(&m_doneCondition, &m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include "b2TaskScheduler.h"
+
+#ifndef TARGET_IS_NDS
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+/// A simple task scheduler built on POSIX threads, or Win32 threads on Windows.
+/// The calling thread takes part in ParallelFor, so a pool of N threads starts
+/// N - 1 workers. Workers sleep between calls.
+class b2ThreadPool : public b2TaskScheduler
+{
+public:
+	/// Start the pool. A thread count of zero uses one thread per processor.
+	b2ThreadPool(int32 threadCount = 0);
+
+	/// Stop and join the worker threads.
+	~b2ThreadPool();
+
+	int32 GetThreadCount() const;
+
+	void ParallelFor(b2TaskFcn* task, void* context, int32 count);
+
+private:
+
+#if defined(_WIN32)
+	// The handles are kept as void* so this header doesn't need windows.h.
+	struct Worker
+	{
+		b2ThreadPool* pool;
+		int32 threadIndex;
+		void* thread;
+		void* startEvent;
+	};
+
+	static unsigned long __stdcall WorkerMain(void* worker);
+#else
+	struct Worker
+	{
+		b2ThreadPool* pool;
+		int32 threadIndex;
+		pthread_t thread;
+	};
+
+	static void* WorkerMain(void* worker);
+#endif
+
+	void RunTasks(int32 threadIndex);
+
+	Worker* m_workers;
+	int32 m_threadCount;
+
+#if defined(_WIN32)
+	// Signaled by the last worker to finish a call.
+	void* m_doneEvent;
+
+	// Updated with interlocked operations.
+	volatile long m_busyCount;
+	volatile long m_next;
+	bool m_exit;
+#else
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_startCondition;
+	pthread_cond_t m_doneCondition;
+
+	// Protected by m_mutex.
+	int32 m_generation;
+	int32 m_busyCount;
+	bool m_exit;
+	int32 m_next;
+#endif
+
+	b2TaskFcn* m_task;
+	void* m_context;
+	int32 m_count;
+};
+
+inline int32 b2ThreadPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2Timer.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+static double s_invFrequency = 0.0;
+
+b2Timer::b2Timer()
+{
+	if (s_invFrequency == 0.0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		s_invFrequency = 1000.0 / double(frequency.QuadPart);
+	}
+
+	Reset();
+}
+
+void b2Timer::Reset()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	m_start = counter.QuadPart;
+}
+
+float b2Timer::GetMilliseconds() const
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return float(double(counter.QuadPart - m_start) * s_invFrequency);
+}
+
+#elif defined(__APPLE__) || defined(TARGET_IS_NDS)
+
+// No monotonic clock_gettime here.
+#include <sys/time.h>
+
+b2Timer::b2Timer()
+{
+	Reset();
+}
+
+void b2Timer::Reset()
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	m_startSec = t.tv_sec;
+	m_startNsec = t.tv_usec * 1000;
+}
+
+float b2Timer::GetMilliseconds() const
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	return 1000.0f * float(t.tv_sec - m_startSec) + 0.000001f * float(t.tv_usec * 1000 - m_startNsec);
+}
+
+#else
+
+#include <time.h>
+
+b2Timer::b2Timer()
+{
+	Reset();
+}
+
+void b2Timer::Reset()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	m_startSec = t.tv_sec;
+	m_startNsec = t.tv_nsec;
+}
+
+float b2Timer::GetMilliseconds() const
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return 1000.0f * float(t.tv_sec - m_startSec) + 0.000001f * float(t.tv_nsec - m_startNsec);
+}
+
+#endif
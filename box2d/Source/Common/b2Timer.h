@@ -1,5 +1,5 @@
 /*
-* Copyright (c) 2006-2009 Erin Catto http://www.gphysics.com
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
 *
 * This software is provided 'as-is', without any express or implied
 * warranty.  In no event will the authors be held liable for any damages
@@ -16,25 +16,35 @@
 * 3. This notice may not be removed or altered from any source distribution.
 */
 
-#ifndef POLY_AND_EDGE_CONTACT_H
-#define POLY_AND_EDGE_CONTACT_H
+#ifndef B2_TIMER_H
+#define B2_TIMER_H
 
-#include "b2Contact.h"
+#include "b2Settings.h"
 
-class b2BlockAllocator;
-
-class b2PolyAndEdgeContact : public b2Contact
+/// A high resolution wall clock timer for profiling. The time is a plain
+/// float even in fixed point builds, profiles can add up to more than
+/// the fixed point range.
+class b2Timer
 {
 public:
-	static b2Contact* Create(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAllocator* allocator);
-	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
 
-	b2PolyAndEdgeContact(b2Fixture* fixtureA, b2Fixture* fixtureB);
-	~b2PolyAndEdgeContact() {}
+	/// The timer starts at construction.
+	b2Timer();
+
+	/// Restart the timer.
+	void Reset();
 
-	void Evaluate();
+	/// Milliseconds since construction or the last Reset.
+	float GetMilliseconds() const;
 
-	float32 ComputeTOI(const b2Sweep& sweepA, const b2Sweep& sweepB) const;
+private:
+
+#if defined(_WIN32)
+	long long m_start;
+#else
+	long m_startSec;
+	long m_startNsec;
+#endif
 };
 
 #endif
@@ -17,46 +17,53 @@
 */
 
 #include "b2Contact.h"
-#include "b2CircleContact.h"
-#include "b2PolyAndCircleContact.h"
-#include "b2PolyContact.h"
-#include "b2EdgeAndCircleContact.h"
-#include "b2PolyAndEdgeContact.h"
 #include "b2ContactSolver.h"
 #include "../../Collision/b2Collision.h"
+#include "../../Collision/b2TimeOfImpact.h"
 #include "../../Collision/Shapes/b2Shape.h"
+#include "../../Collision/Shapes/b2CircleShape.h"
+#include "../../Collision/Shapes/b2PolygonShape.h"
+#include "../../Collision/Shapes/b2EdgeShape.h"
 #include "../../Common/b2BlockAllocator.h"
 #include "../b2World.h"
 #include "../b2Body.h"
 #include "../b2Fixture.h"
 
+#include <new>
+
 b2ContactRegister b2Contact::s_registers[b2_shapeTypeCount][b2_shapeTypeCount];
 bool b2Contact::s_initialized = false;
 
 void b2Contact::InitializeRegisters()
 {
-	AddType(b2CircleContact::Create, b2CircleContact::Destroy, b2_circleShape, b2_circleShape);
-	AddType(b2PolyAndCircleContact::Create, b2PolyAndCircleContact::Destroy, b2_polygonShape, b2_circleShape);
-	AddType(b2PolygonContact::Create, b2PolygonContact::Destroy, b2_polygonShape, b2_polygonShape);
+	for (int32 i = 0; i < b2_shapeTypeCount; ++i)
+	{
+		for (int32 j = 0; j < b2_shapeTypeCount; ++j)
+		{
+			s_registers[i][j].type = e_unknownContact;
+			s_registers[i][j].primary = false;
+		}
+	}
+
+	AddType(e_circleContact, b2_circleShape, b2_circleShape);
+	AddType(e_polyAndCircleContact, b2_polygonShape, b2_circleShape);
+	AddType(e_polygonContact, b2_polygonShape, b2_polygonShape);
 	
-	AddType(b2EdgeAndCircleContact::Create, b2EdgeAndCircleContact::Destroy, b2_edgeShape, b2_circleShape);
-	AddType(b2PolyAndEdgeContact::Create, b2PolyAndEdgeContact::Destroy, b2_polygonShape, b2_edgeShape);
+	AddType(e_edgeAndCircleContact, b2_edgeShape, b2_circleShape);
+	AddType(e_polyAndEdgeContact, b2_polygonShape, b2_edgeShape);
 }
 
-void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
-					  b2ShapeType type1, b2ShapeType type2)
+void b2Contact::AddType(int32 type, b2ShapeType type1, b2ShapeType type2)
 {
 	b2Assert(b2_unknownShape < type1 && type1 < b2_shapeTypeCount);
 	b2Assert(b2_unknownShape < type2 && type2 < b2_shapeTypeCount);
 	
-	s_registers[type1][type2].createFcn = createFcn;
-	s_registers[type1][type2].destroyFcn = destoryFcn;
+	s_registers[type1][type2].type = type;
 	s_registers[type1][type2].primary = true;
 
 	if (type1 != type2)
 	{
-		s_registers[type2][type1].createFcn = createFcn;
-		s_registers[type2][type1].destroyFcn = destoryFcn;
+		s_registers[type2][type1].type = type;
 		s_registers[type2][type1].primary = false;
 	}
 }
@@ -75,48 +82,42 @@ b2Contact* b2Contact::Create(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAl
 	b2Assert(b2_unknownShape < type1 && type1 < b2_shapeTypeCount);
 	b2Assert(b2_unknownShape < type2 && type2 < b2_shapeTypeCount);
 	
-	b2ContactCreateFcn* createFcn = s_registers[type1][type2].createFcn;
-	if (createFcn)
+	const b2ContactRegister& reg = s_registers[type1][type2];
+	if (reg.type == e_unknownContact)
 	{
-		if (s_registers[type1][type2].primary)
-		{
-			return createFcn(fixtureA, fixtureB, allocator);
-		}
-		else
-		{
-			return createFcn(fixtureB, fixtureA, allocator);
-		}
+		return NULL;
+	}
+
+	void* mem = allocator->Allocate(sizeof(b2Contact));
+	if (reg.primary)
+	{
+		return new (mem) b2Contact(fixtureA, fixtureB, reg.type);
 	}
 	else
 	{
-		return NULL;
+		return new (mem) b2Contact(fixtureB, fixtureA, reg.type);
 	}
 }
 
 void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
-{
-	Destroy(contact, contact->GetFixtureA()->GetType(), contact->GetFixtureB()->GetType(), allocator);
-}
-void b2Contact::Destroy(b2Contact* contact, b2ShapeType typeA, b2ShapeType typeB, b2BlockAllocator* allocator)
 {
 	b2Assert(s_initialized == true);
 
-	if (contact->m_manifold.m_pointCount > 0)
+	// A contact marked for destruction woke its bodies when it was marked.
+	if (contact->m_manifold.m_pointCount > 0 && (contact->m_flags & e_destroyFlag) == 0)
 	{
 		contact->GetFixtureA()->GetBody()->WakeUp();
 		contact->GetFixtureB()->GetBody()->WakeUp();
 	}
 
-	b2Assert(b2_unknownShape < typeA && typeB < b2_shapeTypeCount);
-	b2Assert(b2_unknownShape < typeA && typeB < b2_shapeTypeCount);
-
-	b2ContactDestroyFcn* destroyFcn = s_registers[typeA][typeB].destroyFcn;
-	destroyFcn(contact, allocator);
+	contact->~b2Contact();
+	allocator->Free(contact, sizeof(b2Contact));
 }
 
-b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB)
+b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB, int32 type)
 {
 	m_flags = 0;
+	m_type = type;
 
 	if (fA->IsSensor() || fB->IsSensor())
 	{
@@ -128,8 +129,10 @@ b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB)
 
 	m_manifold.m_pointCount = 0;
 
-	m_prev = NULL;
-	m_next = NULL;
+	m_toiIndex = b2_nullTOIIndex;
+
+	m_index = b2_nullContactIndex;
+	m_stamp = 0;
 
 	m_nodeA.contact = NULL;
 	m_nodeA.prev = NULL;
@@ -140,4 +143,117 @@ b2Contact::b2Contact(b2Fixture* fA, b2Fixture* fB)
 	m_nodeB.prev = NULL;
 	m_nodeB.next = NULL;
 	m_nodeB.other = NULL;
-}
\ No newline at end of file
+}
+
+b2Contact* b2Contact::GetNext()
+{
+	if (m_index == b2_nullContactIndex)
+	{
+		return NULL;
+	}
+
+	b2World* world = m_fixtureA->GetBody()->GetWorld();
+	int32 next = m_index + 1;
+	return next < world->m_contactCount ? world->m_contacts[next] : NULL;
+}
+
+// Evaluate a run of contacts of one shape pair. The collide function is a template
+// argument, so the call is direct and can be inlined.
+template <typename ShapeA, typename ShapeB,
+	void (*collide)(b2Manifold*, const ShapeA*, const b2XForm&, const ShapeB*, const b2XForm&)>
+static void b2EvaluateRun(b2Contact** contacts, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Contact* c = contacts[i];
+		b2Fixture* fixtureA = c->GetFixtureA();
+		b2Fixture* fixtureB = c->GetFixtureB();
+
+		collide(c->GetManifold(),
+				(const ShapeA*)fixtureA->GetShape(), fixtureA->GetBody()->GetXForm(),
+				(const ShapeB*)fixtureB->GetShape(), fixtureB->GetBody()->GetXForm());
+	}
+}
+
+void b2Contact::Evaluate(b2Contact** contacts, int32 count)
+{
+	int32 begin = 0;
+	while (begin < count)
+	{
+		int32 type = contacts[begin]->m_type;
+		int32 end = begin + 1;
+		while (end < count && contacts[end]->m_type == type)
+		{
+			++end;
+		}
+
+		b2Contact** run = contacts + begin;
+		int32 runCount = end - begin;
+		switch (type)
+		{
+		case e_circleContact:
+			b2EvaluateRun<b2CircleShape, b2CircleShape, b2CollideCircles>(run, runCount);
+			break;
+
+		case e_polyAndCircleContact:
+			b2EvaluateRun<b2PolygonShape, b2CircleShape, b2CollidePolygonAndCircle>(run, runCount);
+			break;
+
+		case e_polygonContact:
+			b2EvaluateRun<b2PolygonShape, b2PolygonShape, b2CollidePolygons>(run, runCount);
+			break;
+
+		case e_edgeAndCircleContact:
+			b2EvaluateRun<b2EdgeShape, b2CircleShape, b2CollideEdgeAndCircle>(run, runCount);
+			break;
+
+		case e_polyAndEdgeContact:
+			b2EvaluateRun<b2PolygonShape, b2EdgeShape, b2CollidePolyAndEdge>(run, runCount);
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+
+		begin = end;
+	}
+}
+
+template <typename ShapeA, typename ShapeB>
+static float32 b2ComputeTOI(const b2Fixture* fixtureA, const b2Fixture* fixtureB, const b2Sweep& sweepA, const b2Sweep& sweepB)
+{
+	b2TOIInput input;
+	input.sweepA = sweepA;
+	input.sweepB = sweepB;
+	input.sweepRadiusA = fixtureA->ComputeSweepRadius(sweepA.localCenter);
+	input.sweepRadiusB = fixtureB->ComputeSweepRadius(sweepB.localCenter);
+	input.tolerance = b2_linearSlop;
+
+	return b2TimeOfImpact(&input, (const ShapeA*)fixtureA->GetShape(), (const ShapeB*)fixtureB->GetShape());
+}
+
+float32 b2Contact::ComputeTOI(const b2Sweep& sweepA, const b2Sweep& sweepB) const
+{
+	switch (m_type)
+	{
+	case e_circleContact:
+		return b2ComputeTOI<b2CircleShape, b2CircleShape>(m_fixtureA, m_fixtureB, sweepA, sweepB);
+
+	case e_polyAndCircleContact:
+		return b2ComputeTOI<b2PolygonShape, b2CircleShape>(m_fixtureA, m_fixtureB, sweepA, sweepB);
+
+	case e_polygonContact:
+		return b2ComputeTOI<b2PolygonShape, b2PolygonShape>(m_fixtureA, m_fixtureB, sweepA, sweepB);
+
+	case e_edgeAndCircleContact:
+		return b2ComputeTOI<b2EdgeShape, b2CircleShape>(m_fixtureA, m_fixtureB, sweepA, sweepB);
+
+	case e_polyAndEdgeContact:
+		return b2ComputeTOI<b2PolygonShape, b2EdgeShape>(m_fixtureA, m_fixtureB, sweepA, sweepB);
+
+	default:
+		b2Assert(false);
+		return 1.0f;
+	}
+}
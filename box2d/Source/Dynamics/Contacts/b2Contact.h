@@ -32,13 +32,12 @@ class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
 
-typedef b2Contact* b2ContactCreateFcn(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAllocator* allocator);
-typedef void b2ContactDestroyFcn(b2Contact* contact, b2BlockAllocator* allocator);
+const int32 b2_nullTOIIndex = -1;
+const int32 b2_nullContactIndex = -1;
 
 struct b2ContactRegister
 {
-	b2ContactCreateFcn* createFcn;
-	b2ContactDestroyFcn* destroyFcn;
+	int32 type;
 	bool primary;
 };
 
@@ -87,7 +86,9 @@ public:
 	/// Are fixtures touching?
 	bool AreTouching() const;
 
-	/// Get the next contact in the world's contact list.
+	/// Get the next contact in the world's contact array.
+	/// @warning see b2World::GetContactList, the walk skips contacts if anything is
+	/// destroyed during it.
 	b2Contact* GetNext();
 
 	/// Get the first fixture in this contact.
@@ -109,6 +110,7 @@ protected:
 	friend class b2ContactManager;
 	friend class b2World;
 	friend class b2ContactSolver;
+	friend class b2TOIQueue;
 
 	// m_flags
 	enum
@@ -135,29 +137,47 @@ protected:
 		e_lockedFlag	= 0x0080,
 	};
 
-	static void AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destroyFcn,
-						b2ShapeType typeA, b2ShapeType typeB);
+	// m_type, the shape pair. The shapes of fixture A and B are in this order.
+	enum
+	{
+		e_unknownContact = -1,
+		e_circleContact,
+		e_polyAndCircleContact,
+		e_polygonContact,
+		e_edgeAndCircleContact,
+		e_polyAndEdgeContact,
+		e_contactTypeCount
+	};
+
+	static void AddType(int32 type, b2ShapeType typeA, b2ShapeType typeB);
 	static void InitializeRegisters();
 	static b2Contact* Create(b2Fixture* fixtureA, b2Fixture* fixtureB, b2BlockAllocator* allocator);
-    static void Destroy(b2Contact* contact, b2ShapeType typeA, b2ShapeType typeB, b2BlockAllocator* allocator);
 	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
 
-	b2Contact() : m_fixtureA(NULL), m_fixtureB(NULL) {}
-	b2Contact(b2Fixture* fixtureA, b2Fixture* fixtureB);
-	virtual ~b2Contact() {}
+	b2Contact() : m_type(e_unknownContact), m_index(b2_nullContactIndex), m_fixtureA(NULL), m_fixtureB(NULL), m_toiIndex(b2_nullTOIIndex) {}
+	b2Contact(b2Fixture* fixtureA, b2Fixture* fixtureB, int32 type);
 
-	virtual void Evaluate() = 0;
+	// Compute the manifold with the collide function of the shape pair.
+	void Evaluate();
 
-	virtual float32 ComputeTOI(const b2Sweep& sweepA, const b2Sweep& sweepB) const = 0;
+	// Evaluate contacts sorted by type. Each run of one type calls the same
+	// inlined collide function, so the narrow phase doesn't jump around.
+	static void Evaluate(b2Contact** contacts, int32 count);
+
+	float32 ComputeTOI(const b2Sweep& sweepA, const b2Sweep& sweepB) const;
 
 	static b2ContactRegister s_registers[b2_shapeTypeCount][b2_shapeTypeCount];
 	static bool s_initialized;
 
 	uint32 m_flags;
+	int32 m_type;
+
+	// Slot in the world's contact array, or b2_nullContactIndex.
+	int32 m_index;
 
-	// World pool and list pointers.
-	b2Contact* m_prev;
-	b2Contact* m_next;
+	// Taken from a counter whenever the contact is put at the front of the
+	// body contact lists, so the lists are ordered by decreasing stamp.
+	uint32 m_stamp;
 
 	// Nodes for connecting bodies.
 	b2ContactEdge m_nodeA;
@@ -169,10 +189,19 @@ protected:
 	b2Manifold m_manifold;
 
 	float32 m_toi;
+
+	// Slot in the world's TOI queue, or b2_nullTOIIndex.
+	int32 m_toiIndex;
     
     void* m_userData;
 };
 
+inline void b2Contact::Evaluate()
+{
+	b2Contact* contact = this;
+	Evaluate(&contact, 1);
+}
+
 inline b2Manifold* b2Contact::GetManifold()
 {
 	return &m_manifold;
@@ -208,11 +237,6 @@ inline bool b2Contact::AreTouching() const
 	return (m_flags & e_touchFlag) == e_touchFlag;
 }
 
-inline b2Contact* b2Contact::GetNext()
-{
-	return m_next;
-}
-
 inline b2Fixture* b2Contact::GetFixtureA()
 {
 	return m_fixtureA;
@@ -0,0 +1,612 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2ContactBatchSolver.h"
+#include "../b2Body.h"
+#include "../b2Island.h"
+#include "../../Common/b2StackAllocator.h"
+
+#include <new>
+#include <string.h>
+
+// Fixed point builds always use the plain code. Define B2_NO_SIMD to use it
+// for floats too.
+#if !defined(TARGET_FLOAT32_IS_FIXED) && !defined(B2_NO_SIMD)
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64)
+#define B2_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#define B2_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// The number of graph colors. A constraint whose bodies already use every
+// color gets a batch of its own.
+const int32 b2_contactColorCount = 32;
+
+//
+// Four wide float operations. Masks are all ones or all zeros per lane.
+//
+
+#if defined(B2_SIMD_SSE)
+
+typedef __m128 b2FloatW;
+
+inline b2FloatW b2LoadW(const float32* p) { return _mm_loadu_ps(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { _mm_storeu_ps(p, a); }
+inline b2FloatW b2SplatW(float32 s) { return _mm_set1_ps(s); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm_and_ps(a, b); }
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+#elif defined(B2_SIMD_NEON)
+
+typedef float32x4_t b2FloatW;
+
+inline b2FloatW b2LoadW(const float32* p) { return vld1q_f32(p); }
+inline void b2StoreW(float32* p, b2FloatW a) { vst1q_f32(p, a); }
+inline b2FloatW b2SplatW(float32 s) { return vdupq_n_f32(s); }
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return vaddq_f32(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return vsubq_f32(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return vmulq_f32(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return vminq_f32(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return vmaxq_f32(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+
+#else
+
+// Plain code, also used for fixed point. Masks are kept as 1 or 0.
+struct b2FloatW
+{
+	float32 v[b2_contactBatchSize];
+};
+
+inline b2FloatW b2LoadW(const float32* p)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = p[i];
+	return r;
+}
+
+inline void b2StoreW(float32* p, const b2FloatW& a)
+{
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) p[i] = a.v[i];
+}
+
+inline b2FloatW b2SplatW(float32 s)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = s;
+	return r;
+}
+
+inline b2FloatW b2AddW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = a.v[i] + b.v[i];
+	return r;
+}
+
+inline b2FloatW b2SubW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = a.v[i] - b.v[i];
+	return r;
+}
+
+inline b2FloatW b2MulW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = a.v[i] * b.v[i];
+	return r;
+}
+
+inline b2FloatW b2MinW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = b2Min(a.v[i], b.v[i]);
+	return r;
+}
+
+inline b2FloatW b2MaxW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = b2Max(a.v[i], b.v[i]);
+	return r;
+}
+
+inline b2FloatW b2GreaterEqualW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = a.v[i] >= b.v[i] ? 1.0f : 0.0f;
+	return r;
+}
+
+inline b2FloatW b2AndW(const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f;
+	return r;
+}
+
+inline b2FloatW b2SelectW(const b2FloatW& mask, const b2FloatW& a, const b2FloatW& b)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_contactBatchSize; ++i) r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+	return r;
+}
+
+#endif
+
+// The velocities of one side of a batch.
+struct b2VelocityW
+{
+	b2FloatW vx, vy, w;
+};
+
+static void b2GatherVelocities(b2VelocityW* out, const b2Velocity* velocities, const int32* indices)
+{
+	float32 vx[b2_contactBatchSize], vy[b2_contactBatchSize], w[b2_contactBatchSize];
+	for (int32 i = 0; i < b2_contactBatchSize; ++i)
+	{
+		const b2Velocity* v = velocities + indices[i];
+		vx[i] = v->v.x;
+		vy[i] = v->v.y;
+		w[i] = v->w;
+	}
+
+	out->vx = b2LoadW(vx);
+	out->vy = b2LoadW(vy);
+	out->w = b2LoadW(w);
+}
+
+static void b2ScatterVelocities(b2Velocity* velocities, const int32* indices, const b2VelocityW& in)
+{
+	float32 vx[b2_contactBatchSize], vy[b2_contactBatchSize], w[b2_contactBatchSize];
+	b2StoreW(vx, in.vx);
+	b2StoreW(vy, in.vy);
+	b2StoreW(w, in.w);
+
+	for (int32 i = 0; i < b2_contactBatchSize; ++i)
+	{
+		b2Velocity* v = velocities + indices[i];
+		v->v.Set(vx[i], vy[i]);
+		v->w = w[i];
+	}
+}
+
+// Apply the impulse P = (px, py) at rA and rB.
+inline void b2ApplyImpulseW(b2VelocityW* vA, b2VelocityW* vB,
+							const b2FloatW& invMassA, const b2FloatW& invIA, const b2FloatW& invMassB, const b2FloatW& invIB,
+							const b2FloatW& rAX, const b2FloatW& rAY, const b2FloatW& rBX, const b2FloatW& rBY,
+							const b2FloatW& px, const b2FloatW& py)
+{
+	vA->vx = b2SubW(vA->vx, b2MulW(invMassA, px));
+	vA->vy = b2SubW(vA->vy, b2MulW(invMassA, py));
+	vA->w = b2SubW(vA->w, b2MulW(invIA, b2SubW(b2MulW(rAX, py), b2MulW(rAY, px))));
+
+	vB->vx = b2AddW(vB->vx, b2MulW(invMassB, px));
+	vB->vy = b2AddW(vB->vy, b2MulW(invMassB, py));
+	vB->w = b2AddW(vB->w, b2MulW(invIB, b2SubW(b2MulW(rBX, py), b2MulW(rBY, px))));
+}
+
+// Relative velocity at the contact point, dv = vB + wB x rB - vA - wA x rA.
+inline void b2RelativeVelocityW(b2FloatW* dvX, b2FloatW* dvY, const b2VelocityW& vA, const b2VelocityW& vB,
+								const b2FloatW& rAX, const b2FloatW& rAY, const b2FloatW& rBX, const b2FloatW& rBY)
+{
+	*dvX = b2SubW(b2SubW(vB.vx, b2MulW(vB.w, rBY)), b2SubW(vA.vx, b2MulW(vA.w, rAY)));
+	*dvY = b2SubW(b2AddW(vB.vy, b2MulW(vB.w, rBX)), b2AddW(vA.vy, b2MulW(vA.w, rAX)));
+}
+
+// Solve the friction constraint of one point of each lane.
+static void b2SolveTangentW(b2VelocityW* vA, b2VelocityW* vB, b2ContactBatch* batch,
+							const float32* rAX, const float32* rAY, const float32* rBX, const float32* rBY,
+							const float32* tangentMass, const float32* normalImpulse, float32* tangentImpulse)
+{
+	b2FloatW invMassA = b2LoadW(batch->invMassA);
+	b2FloatW invIA = b2LoadW(batch->invIA);
+	b2FloatW invMassB = b2LoadW(batch->invMassB);
+	b2FloatW invIB = b2LoadW(batch->invIB);
+
+	// tangent = b2Cross(normal, 1.0f)
+	b2FloatW tX = b2LoadW(batch->normalY);
+	b2FloatW tY = b2SubW(b2SplatW(0.0f), b2LoadW(batch->normalX));
+
+	b2FloatW rax = b2LoadW(rAX);
+	b2FloatW ray = b2LoadW(rAY);
+	b2FloatW rbx = b2LoadW(rBX);
+	b2FloatW rby = b2LoadW(rBY);
+
+	b2FloatW dvX, dvY;
+	b2RelativeVelocityW(&dvX, &dvY, *vA, *vB, rax, ray, rbx, rby);
+
+	b2FloatW vt = b2AddW(b2MulW(dvX, tX), b2MulW(dvY, tY));
+	b2FloatW lambda = b2SubW(b2SplatW(0.0f), b2MulW(b2LoadW(tangentMass), vt));
+
+	b2FloatW maxFriction = b2MulW(b2LoadW(batch->friction), b2LoadW(normalImpulse));
+	b2FloatW oldImpulse = b2LoadW(tangentImpulse);
+	b2FloatW newImpulse = b2AddW(oldImpulse, lambda);
+	newImpulse = b2MaxW(b2SubW(b2SplatW(0.0f), maxFriction), b2MinW(newImpulse, maxFriction));
+	lambda = b2SubW(newImpulse, oldImpulse);
+
+	b2ApplyImpulseW(vA, vB, invMassA, invIA, invMassB, invIB, rax, ray, rbx, rby,
+		b2MulW(lambda, tX), b2MulW(lambda, tY));
+
+	b2StoreW(tangentImpulse, newImpulse);
+}
+
+// Same as b2ContactSolver::SolveVelocityConstraints for one point contacts.
+static void b2SolvePointBatch(b2ContactBatch* batch, b2Velocity* velocities)
+{
+	b2VelocityW vA, vB;
+	b2GatherVelocities(&vA, velocities, batch->indexA);
+	b2GatherVelocities(&vB, velocities, batch->indexB);
+
+	b2SolveTangentW(&vA, &vB, batch, batch->rA1X, batch->rA1Y, batch->rB1X, batch->rB1Y,
+		batch->tangentMass1, batch->normalImpulse1, batch->tangentImpulse1);
+
+	b2FloatW invMassA = b2LoadW(batch->invMassA);
+	b2FloatW invIA = b2LoadW(batch->invIA);
+	b2FloatW invMassB = b2LoadW(batch->invMassB);
+	b2FloatW invIB = b2LoadW(batch->invIB);
+	b2FloatW nX = b2LoadW(batch->normalX);
+	b2FloatW nY = b2LoadW(batch->normalY);
+
+	b2FloatW rax = b2LoadW(batch->rA1X);
+	b2FloatW ray = b2LoadW(batch->rA1Y);
+	b2FloatW rbx = b2LoadW(batch->rB1X);
+	b2FloatW rby = b2LoadW(batch->rB1Y);
+
+	b2FloatW dvX, dvY;
+	b2RelativeVelocityW(&dvX, &dvY, vA, vB, rax, ray, rbx, rby);
+
+	b2FloatW vn = b2AddW(b2MulW(dvX, nX), b2MulW(dvY, nY));
+	b2FloatW lambda = b2SubW(b2SplatW(0.0f), b2MulW(b2LoadW(batch->normalMass1), b2SubW(vn, b2LoadW(batch->velocityBias1))));
+
+	b2FloatW oldImpulse = b2LoadW(batch->normalImpulse1);
+	b2FloatW newImpulse = b2MaxW(b2AddW(oldImpulse, lambda), b2SplatW(0.0f));
+	lambda = b2SubW(newImpulse, oldImpulse);
+
+	b2ApplyImpulseW(&vA, &vB, invMassA, invIA, invMassB, invIB, rax, ray, rbx, rby,
+		b2MulW(lambda, nX), b2MulW(lambda, nY));
+
+	b2StoreW(batch->normalImpulse1, newImpulse);
+
+	b2ScatterVelocities(velocities, batch->indexA, vA);
+	b2ScatterVelocities(velocities, batch->indexB, vB);
+}
+
+// Same as b2ContactSolver::SolveVelocityConstraints for two point contacts. All
+// four cases of the block solver are computed and the first valid one is kept.
+static void b2SolveBlockBatch(b2ContactBatch* batch, b2Velocity* velocities)
+{
+	b2VelocityW vA, vB;
+	b2GatherVelocities(&vA, velocities, batch->indexA);
+	b2GatherVelocities(&vB, velocities, batch->indexB);
+
+	b2SolveTangentW(&vA, &vB, batch, batch->rA1X, batch->rA1Y, batch->rB1X, batch->rB1Y,
+		batch->tangentMass1, batch->normalImpulse1, batch->tangentImpulse1);
+	b2SolveTangentW(&vA, &vB, batch, batch->rA2X, batch->rA2Y, batch->rB2X, batch->rB2Y,
+		batch->tangentMass2, batch->normalImpulse2, batch->tangentImpulse2);
+
+	b2FloatW zero = b2SplatW(0.0f);
+	b2FloatW invMassA = b2LoadW(batch->invMassA);
+	b2FloatW invIA = b2LoadW(batch->invIA);
+	b2FloatW invMassB = b2LoadW(batch->invMassB);
+	b2FloatW invIB = b2LoadW(batch->invIB);
+	b2FloatW nX = b2LoadW(batch->normalX);
+	b2FloatW nY = b2LoadW(batch->normalY);
+
+	b2FloatW ra1x = b2LoadW(batch->rA1X);
+	b2FloatW ra1y = b2LoadW(batch->rA1Y);
+	b2FloatW rb1x = b2LoadW(batch->rB1X);
+	b2FloatW rb1y = b2LoadW(batch->rB1Y);
+	b2FloatW ra2x = b2LoadW(batch->rA2X);
+	b2FloatW ra2y = b2LoadW(batch->rA2Y);
+	b2FloatW rb2x = b2LoadW(batch->rB2X);
+	b2FloatW rb2y = b2LoadW(batch->rB2Y);
+
+	b2FloatW k11 = b2LoadW(batch->k11);
+	b2FloatW k12 = b2LoadW(batch->k12);
+	b2FloatW k22 = b2LoadW(batch->k22);
+
+	b2FloatW a1 = b2LoadW(batch->normalImpulse1);
+	b2FloatW a2 = b2LoadW(batch->normalImpulse2);
+
+	// Normal velocities.
+	b2FloatW dvX, dvY;
+	b2RelativeVelocityW(&dvX, &dvY, vA, vB, ra1x, ra1y, rb1x, rb1y);
+	b2FloatW vn1 = b2AddW(b2MulW(dvX, nX), b2MulW(dvY, nY));
+	b2RelativeVelocityW(&dvX, &dvY, vA, vB, ra2x, ra2y, rb2x, rb2y);
+	b2FloatW vn2 = b2AddW(b2MulW(dvX, nX), b2MulW(dvY, nY));
+
+	// b = vn - velocityBias - K * a
+	b2FloatW b1 = b2SubW(b2SubW(vn1, b2LoadW(batch->velocityBias1)), b2AddW(b2MulW(k11, a1), b2MulW(k12, a2)));
+	b2FloatW b2 = b2SubW(b2SubW(vn2, b2LoadW(batch->velocityBias2)), b2AddW(b2MulW(k12, a1), b2MulW(k22, a2)));
+
+	// Case 1: vn = 0, x = -inv(K) * b
+	b2FloatW x1Case1 = b2SubW(zero, b2AddW(b2MulW(b2LoadW(batch->m11), b1), b2MulW(b2LoadW(batch->m12), b2)));
+	b2FloatW x2Case1 = b2SubW(zero, b2AddW(b2MulW(b2LoadW(batch->m21), b1), b2MulW(b2LoadW(batch->m22), b2)));
+	b2FloatW case1 = b2AndW(b2GreaterEqualW(x1Case1, zero), b2GreaterEqualW(x2Case1, zero));
+
+	// Case 2: vn1 = 0 and x2 = 0
+	b2FloatW x1Case2 = b2SubW(zero, b2MulW(b2LoadW(batch->normalMass1), b1));
+	b2FloatW vn2Case2 = b2AddW(b2MulW(k12, x1Case2), b2);
+	b2FloatW case2 = b2AndW(b2GreaterEqualW(x1Case2, zero), b2GreaterEqualW(vn2Case2, zero));
+
+	// Case 3: x1 = 0 and vn2 = 0
+	b2FloatW x2Case3 = b2SubW(zero, b2MulW(b2LoadW(batch->normalMass2), b2));
+	b2FloatW vn1Case3 = b2AddW(b2MulW(k12, x2Case3), b1);
+	b2FloatW case3 = b2AndW(b2GreaterEqualW(x2Case3, zero), b2GreaterEqualW(vn1Case3, zero));
+
+	// Case 4: x1 = 0 and x2 = 0
+	b2FloatW case4 = b2AndW(b2GreaterEqualW(b1, zero), b2GreaterEqualW(b2, zero));
+
+	// Keep the first valid case. If there is none keep the old impulse.
+	b2FloatW x1 = b2SelectW(case4, zero, a1);
+	b2FloatW x2 = b2SelectW(case4, zero, a2);
+	x1 = b2SelectW(case3, zero, x1);
+	x2 = b2SelectW(case3, x2Case3, x2);
+	x1 = b2SelectW(case2, x1Case2, x1);
+	x2 = b2SelectW(case2, zero, x2);
+	x1 = b2SelectW(case1, x1Case1, x1);
+	x2 = b2SelectW(case1, x2Case1, x2);
+
+	// Apply the incremental impulse.
+	b2FloatW d1 = b2SubW(x1, a1);
+	b2FloatW d2 = b2SubW(x2, a2);
+	b2ApplyImpulseW(&vA, &vB, invMassA, invIA, invMassB, invIB, ra1x, ra1y, rb1x, rb1y,
+		b2MulW(d1, nX), b2MulW(d1, nY));
+	b2ApplyImpulseW(&vA, &vB, invMassA, invIA, invMassB, invIB, ra2x, ra2y, rb2x, rb2y,
+		b2MulW(d2, nX), b2MulW(d2, nY));
+
+	b2StoreW(batch->normalImpulse1, x1);
+	b2StoreW(batch->normalImpulse2, x2);
+
+	b2ScatterVelocities(velocities, batch->indexA, vA);
+	b2ScatterVelocities(velocities, batch->indexB, vB);
+}
+
+// Copy a constraint into a batch lane.
+void b2ContactBatchSolver::SetLane(b2ContactBatch* batch, int32 lane, int32 constraintIndex, const b2ContactConstraint* c)
+{
+	batch->constraintIndex[lane] = constraintIndex;
+	batch->indexA[lane] = c->indexA;
+	batch->indexB[lane] = c->indexB;
+
+	batch->normalX[lane] = c->normal.x;
+	batch->normalY[lane] = c->normal.y;
+	batch->friction[lane] = c->friction;
+	batch->invMassA[lane] = c->invMassA;
+	batch->invIA[lane] = c->invIA;
+	batch->invMassB[lane] = c->invMassB;
+	batch->invIB[lane] = c->invIB;
+
+	const b2ContactConstraintPoint* cp1 = c->points + 0;
+	batch->rA1X[lane] = cp1->rA.x;
+	batch->rA1Y[lane] = cp1->rA.y;
+	batch->rB1X[lane] = cp1->rB.x;
+	batch->rB1Y[lane] = cp1->rB.y;
+	batch->normalMass1[lane] = cp1->normalMass;
+	batch->tangentMass1[lane] = cp1->tangentMass;
+	batch->velocityBias1[lane] = cp1->velocityBias;
+	batch->normalImpulse1[lane] = cp1->normalImpulse;
+	batch->tangentImpulse1[lane] = cp1->tangentImpulse;
+
+	if (c->pointCount == 2)
+	{
+		const b2ContactConstraintPoint* cp2 = c->points + 1;
+		batch->rA2X[lane] = cp2->rA.x;
+		batch->rA2Y[lane] = cp2->rA.y;
+		batch->rB2X[lane] = cp2->rB.x;
+		batch->rB2Y[lane] = cp2->rB.y;
+		batch->normalMass2[lane] = cp2->normalMass;
+		batch->tangentMass2[lane] = cp2->tangentMass;
+		batch->velocityBias2[lane] = cp2->velocityBias;
+		batch->normalImpulse2[lane] = cp2->normalImpulse;
+		batch->tangentImpulse2[lane] = cp2->tangentImpulse;
+
+		batch->k11[lane] = c->K.col1.x;
+		batch->k12[lane] = c->K.col1.y;
+		batch->k22[lane] = c->K.col2.y;
+		batch->m11[lane] = c->normalMass.col1.x;
+		batch->m12[lane] = c->normalMass.col2.x;
+		batch->m21[lane] = c->normalMass.col1.y;
+		batch->m22[lane] = c->normalMass.col2.y;
+	}
+}
+
+// Clear a batch. Empty lanes have zero mass and point at the spare slot. Value
+// initialization zeroes the lanes, in fixed point too.
+static void b2ClearBatch(b2ContactBatch* batch, int32 spareIndex)
+{
+	new (batch) b2ContactBatch();
+	for (int32 i = 0; i < b2_contactBatchSize; ++i)
+	{
+		batch->constraintIndex[i] = -1;
+		batch->indexA[i] = spareIndex;
+		batch->indexB[i] = spareIndex;
+	}
+}
+
+int32 b2ContactBatchSolver::GetStackSize(int32 constraintCount, int32 bodyCount)
+{
+	// The body colors are freed before the batches are allocated.
+	int32 colorSize = constraintCount * sizeof(int32);
+	int32 bodyColorSize = bodyCount * sizeof(uint32);
+	int32 batchSize = constraintCount * sizeof(b2ContactBatch);
+	return colorSize + b2Max(bodyColorSize, batchSize);
+}
+
+b2ContactBatchSolver::b2ContactBatchSolver(b2ContactSolver* solver, b2Velocity* velocities, int32 bodyCount,
+										   int32 spareIndex, b2StackAllocator* allocator)
+{
+	m_solver = solver;
+	m_velocities = velocities;
+	m_allocator = allocator;
+
+	// Empty lanes share the spare slot. They have zero mass, so it stays at rest.
+	m_velocities[spareIndex].v.SetZero();
+	m_velocities[spareIndex].w = 0.0f;
+
+	int32 constraintCount = solver->m_constraintCount;
+	const b2ContactConstraint* constraints = solver->m_constraints;
+
+	// Color the constraints with a greedy pass over the constraint graph. Each
+	// island body keeps a bit mask of the colors it is used in. The states past
+	// the island bodies belong to a single constraint, so they are not tracked.
+	// Color b2_contactColorCount means no color was free.
+	m_colors = (int32*)m_allocator->Allocate(constraintCount * sizeof(int32));
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, bodyCount * sizeof(uint32));
+
+	// Constraints per color, for one and two points.
+	int32 colorCounts[2][b2_contactColorCount + 1];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	for (int32 i = 0; i < constraintCount; ++i)
+	{
+		const b2ContactConstraint* c = constraints + i;
+		uint32* maskA = c->indexA < bodyCount ? bodyColors + c->indexA : NULL;
+		uint32* maskB = c->indexB < bodyCount ? bodyColors + c->indexB : NULL;
+		uint32 used = (maskA ? *maskA : 0) | (maskB ? *maskB : 0);
+
+		int32 color = 0;
+		while (color < b2_contactColorCount && (used & (1u << color)))
+		{
+			++color;
+		}
+
+		if (color < b2_contactColorCount)
+		{
+			if (maskA) *maskA |= 1u << color;
+			if (maskB) *maskB |= 1u << color;
+		}
+
+		m_colors[i] = color;
+		++colorCounts[c->pointCount - 1][color];
+	}
+
+	m_allocator->Free(bodyColors);
+
+	// Count the batches. Uncolored constraints get a batch each.
+	int32 batchStarts[2][b2_contactColorCount + 1];
+	m_batchCount = 0;
+	for (int32 k = 0; k < 2; ++k)
+	{
+		for (int32 color = 0; color <= b2_contactColorCount; ++color)
+		{
+			batchStarts[k][color] = m_batchCount;
+			int32 count = colorCounts[k][color];
+			if (color == b2_contactColorCount)
+			{
+				m_batchCount += count;
+			}
+			else
+			{
+				m_batchCount += (count + b2_contactBatchSize - 1) / b2_contactBatchSize;
+			}
+		}
+
+		if (k == 0)
+		{
+			m_pointBatchCount = m_batchCount;
+		}
+	}
+
+	m_batches = (b2ContactBatch*)m_allocator->Allocate(m_batchCount * sizeof(b2ContactBatch));
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		b2ClearBatch(m_batches + i, spareIndex);
+	}
+
+	// Fill the lanes in constraint order.
+	int32 laneCounts[2][b2_contactColorCount + 1];
+	memset(laneCounts, 0, sizeof(laneCounts));
+	for (int32 i = 0; i < constraintCount; ++i)
+	{
+		const b2ContactConstraint* c = constraints + i;
+		int32 k = c->pointCount - 1;
+		int32 color = m_colors[i];
+		int32 slot = laneCounts[k][color]++;
+
+		if (color == b2_contactColorCount)
+		{
+			SetLane(m_batches + batchStarts[k][color] + slot, 0, i, c);
+		}
+		else
+		{
+			b2ContactBatch* batch = m_batches + batchStarts[k][color] + slot / b2_contactBatchSize;
+			SetLane(batch, slot % b2_contactBatchSize, i, c);
+		}
+	}
+
+}
+
+b2ContactBatchSolver::~b2ContactBatchSolver()
+{
+	m_allocator->Free(m_batches);
+	m_allocator->Free(m_colors);
+}
+
+void b2ContactBatchSolver::SolveVelocityConstraints()
+{
+	for (int32 i = 0; i < m_pointBatchCount; ++i)
+	{
+		b2SolvePointBatch(m_batches + i, m_velocities);
+	}
+
+	for (int32 i = m_pointBatchCount; i < m_batchCount; ++i)
+	{
+		b2SolveBlockBatch(m_batches + i, m_velocities);
+	}
+}
+
+void b2ContactBatchSolver::StoreImpulses()
+{
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		const b2ContactBatch* batch = m_batches + i;
+		for (int32 j = 0; j < b2_contactBatchSize; ++j)
+		{
+			int32 index = batch->constraintIndex[j];
+			if (index == -1)
+			{
+				continue;
+			}
+
+			b2ContactConstraint* c = m_solver->m_constraints + index;
+			c->points[0].normalImpulse = batch->normalImpulse1[j];
+			c->points[0].tangentImpulse = batch->tangentImpulse1[j];
+
+			if (c->pointCount == 2)
+			{
+				c->points[1].normalImpulse = batch->normalImpulse2[j];
+				c->points[1].tangentImpulse = batch->tangentImpulse2[j];
+			}
+		}
+	}
+}
@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CONTACT_BATCH_SOLVER_H
+#define CONTACT_BATCH_SOLVER_H
+
+#include "b2ContactSolver.h"
+
+struct b2Velocity;
+
+// The number of constraints solved together.
+const int32 b2_contactBatchSize = 4;
+
+// A structure of arrays holding b2_contactBatchSize contact constraints that
+// don't share an island body. Unused lanes have zero mass and refer to the
+// spare velocity slot, so they don't change any velocity.
+struct b2ContactBatch
+{
+	int32 constraintIndex[b2_contactBatchSize];
+	int32 indexA[b2_contactBatchSize];
+	int32 indexB[b2_contactBatchSize];
+
+	float32 normalX[b2_contactBatchSize];
+	float32 normalY[b2_contactBatchSize];
+	float32 friction[b2_contactBatchSize];
+	float32 invMassA[b2_contactBatchSize];
+	float32 invIA[b2_contactBatchSize];
+	float32 invMassB[b2_contactBatchSize];
+	float32 invIB[b2_contactBatchSize];
+
+	float32 rA1X[b2_contactBatchSize];
+	float32 rA1Y[b2_contactBatchSize];
+	float32 rB1X[b2_contactBatchSize];
+	float32 rB1Y[b2_contactBatchSize];
+	float32 normalMass1[b2_contactBatchSize];
+	float32 tangentMass1[b2_contactBatchSize];
+	float32 velocityBias1[b2_contactBatchSize];
+	float32 normalImpulse1[b2_contactBatchSize];
+	float32 tangentImpulse1[b2_contactBatchSize];
+
+	float32 rA2X[b2_contactBatchSize];
+	float32 rA2Y[b2_contactBatchSize];
+	float32 rB2X[b2_contactBatchSize];
+	float32 rB2Y[b2_contactBatchSize];
+	float32 normalMass2[b2_contactBatchSize];
+	float32 tangentMass2[b2_contactBatchSize];
+	float32 velocityBias2[b2_contactBatchSize];
+	float32 normalImpulse2[b2_contactBatchSize];
+	float32 tangentImpulse2[b2_contactBatchSize];
+
+	// The block solver matrix and its inverse (two point batches only).
+	float32 k11[b2_contactBatchSize];
+	float32 k12[b2_contactBatchSize];
+	float32 k22[b2_contactBatchSize];
+	float32 m11[b2_contactBatchSize];
+	float32 m12[b2_contactBatchSize];
+	float32 m21[b2_contactBatchSize];
+	float32 m22[b2_contactBatchSize];
+};
+
+// Solves the velocity constraints of a b2ContactSolver against an array of
+// island velocities. The constraints are colored so that no two constraints
+// of a batch share a dynamic body, then each batch is solved with SSE or NEON
+// when available and with plain code otherwise. Constraints are solved color
+// by color, so the order differs from b2ContactSolver.
+class b2ContactBatchSolver
+{
+public:
+	// The velocities are the island state indexed by the constraints. The
+	// spare slot is not used by any constraint, it is used by empty lanes.
+	b2ContactBatchSolver(b2ContactSolver* solver, b2Velocity* velocities, int32 bodyCount,
+						 int32 spareIndex, b2StackAllocator* allocator);
+	~b2ContactBatchSolver();
+
+	// The most stack memory the constructor can take. Uncolored constraints
+	// take a batch each, so there are at most as many batches as constraints.
+	static int32 GetStackSize(int32 constraintCount, int32 bodyCount);
+
+	void SolveVelocityConstraints();
+
+	// Copy the accumulated impulses back to the contact solver constraints.
+	void StoreImpulses();
+
+	// Copy a constraint into a batch lane.
+	static void SetLane(b2ContactBatch* batch, int32 lane, int32 constraintIndex,
+						const b2ContactConstraint* c);
+
+	b2ContactSolver* m_solver;
+	b2Velocity* m_velocities;
+	b2StackAllocator* m_allocator;
+
+	// The color of each constraint.
+	int32* m_colors;
+
+	b2ContactBatch* m_batches;
+	int32 m_batchCount;
+
+	// Batches [0, m_pointBatchCount) have one point, the rest have two.
+	int32 m_pointBatchCount;
+};
+
+#endif
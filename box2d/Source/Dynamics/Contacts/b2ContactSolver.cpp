@@ -21,14 +21,17 @@
 #include "../b2Body.h"
 #include "../b2Fixture.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 #include "../../Common/b2StackAllocator.h"
 
 #define B2_DEBUG_SOLVER 0
 
-b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator)
+b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2Island* island)
 {
 	m_step = step;
-	m_allocator = allocator;
+	m_allocator = island->m_allocator;
+	m_positions = island->m_positions;
+	m_velocities = island->m_velocities;
 
 	m_constraintCount = contactCount;
 	m_constraints = (b2ContactConstraint*)m_allocator->Allocate(m_constraintCount * sizeof(b2ContactConstraint));
@@ -50,10 +53,13 @@ b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, i
 		float32 friction = b2MixFriction(fixtureA->GetFriction(), fixtureB->GetFriction());
 		float32 restitution = b2MixRestitution(fixtureA->GetRestitution(), fixtureB->GetRestitution());
 
-		b2Vec2 vA = bodyA->m_linearVelocity;
-		b2Vec2 vB = bodyB->m_linearVelocity;
-		float32 wA = bodyA->m_angularVelocity;
-		float32 wB = bodyB->m_angularVelocity;
+		int32 indexA = island->GetStateIndex(bodyA);
+		int32 indexB = island->GetStateIndex(bodyB);
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wA = m_velocities[indexA].w;
+		float32 wB = m_velocities[indexB].w;
 
 		b2Assert(manifold->m_pointCount > 0);
 
@@ -63,6 +69,16 @@ b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, i
 		b2ContactConstraint* cc = m_constraints + i;
 		cc->bodyA = bodyA;
 		cc->bodyB = bodyB;
+		cc->indexA = indexA;
+		cc->indexB = indexB;
+		cc->localCenterA = bodyA->GetLocalCenter();
+		cc->localCenterB = bodyB->GetLocalCenter();
+		cc->invMassA = bodyA->m_invMass;
+		cc->invIA = bodyA->m_invI;
+		cc->invMassB = bodyB->m_invMass;
+		cc->invIB = bodyB->m_invI;
+		cc->massA = bodyA->m_mass;
+		cc->massB = bodyB->m_mass;
 		cc->manifold = manifold;
 		cc->normal = worldManifold.m_normal;
 		cc->pointCount = manifold->m_pointCount;
@@ -175,27 +191,27 @@ void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 	{
 		b2ContactConstraint* c = m_constraints + i;
 
-		b2Body* bodyA = c->bodyA;
-		b2Body* bodyB = c->bodyB;
-		float32 invMassA = bodyA->m_invMass;
-		float32 invIA = bodyA->m_invI;
-		float32 invMassB = bodyB->m_invMass;
-		float32 invIB = bodyB->m_invI;
+		float32 invMassA = c->invMassA;
+		float32 invIA = c->invIA;
+		float32 invMassB = c->invMassB;
+		float32 invIB = c->invIB;
 		b2Vec2 normal = c->normal;
 		b2Vec2 tangent = b2Cross(normal, 1.0f);
 
 		if (step.warmStarting)
 		{
+			b2Velocity* velocityA = m_velocities + c->indexA;
+			b2Velocity* velocityB = m_velocities + c->indexB;
 			for (int32 j = 0; j < c->pointCount; ++j)
 			{
 				b2ContactConstraintPoint* ccp = c->points + j;
 				ccp->normalImpulse *= step.dtRatio;
 				ccp->tangentImpulse *= step.dtRatio;
 				b2Vec2 P = ccp->normalImpulse * normal + ccp->tangentImpulse * tangent;
-				bodyA->m_angularVelocity -= invIA * b2Cross(ccp->rA, P);
-				bodyA->m_linearVelocity -= invMassA * P;
-				bodyB->m_angularVelocity += invIB * b2Cross(ccp->rB, P);
-				bodyB->m_linearVelocity += invMassB * P;
+				velocityA->w -= invIA * b2Cross(ccp->rA, P);
+				velocityA->v -= invMassA * P;
+				velocityB->w += invIB * b2Cross(ccp->rB, P);
+				velocityB->v += invMassB * P;
 			}
 		}
 		else
@@ -215,16 +231,14 @@ void b2ContactSolver::SolveVelocityConstraints()
 	for (int32 i = 0; i < m_constraintCount; ++i)
 	{
 		b2ContactConstraint* c = m_constraints + i;
-		b2Body* bodyA = c->bodyA;
-		b2Body* bodyB = c->bodyB;
-		float32 wA = bodyA->m_angularVelocity;
-		float32 wB = bodyB->m_angularVelocity;
-		b2Vec2 vA = bodyA->m_linearVelocity;
-		b2Vec2 vB = bodyB->m_linearVelocity;
-		float32 invMassA = bodyA->m_invMass;
-		float32 invIA = bodyA->m_invI;
-		float32 invMassB = bodyB->m_invMass;
-		float32 invIB = bodyB->m_invI;
+		float32 wA = m_velocities[c->indexA].w;
+		float32 wB = m_velocities[c->indexB].w;
+		b2Vec2 vA = m_velocities[c->indexA].v;
+		b2Vec2 vB = m_velocities[c->indexB].v;
+		float32 invMassA = c->invMassA;
+		float32 invIA = c->invIA;
+		float32 invMassB = c->invMassB;
+		float32 invIB = c->invIB;
 		b2Vec2 normal = c->normal;
 		b2Vec2 tangent = b2Cross(normal, 1.0f);
 		float32 friction = c->friction;
@@ -502,10 +516,10 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		bodyA->m_linearVelocity = vA;
-		bodyA->m_angularVelocity = wA;
-		bodyB->m_linearVelocity = vB;
-		bodyB->m_angularVelocity = wB;
+		m_velocities[c->indexA].v = vA;
+		m_velocities[c->indexA].w = wA;
+		m_velocities[c->indexB].v = vB;
+		m_velocities[c->indexB].w = wB;
 	}
 }
 
@@ -587,7 +601,7 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 
 struct b2PositionSolverManifold
 {
-	void Initialize(b2ContactConstraint* cc)
+	void Initialize(b2ContactConstraint* cc, const b2XForm& xfA, const b2XForm& xfB)
 	{
 		b2Assert(cc->pointCount > 0);
 
@@ -595,8 +609,8 @@ struct b2PositionSolverManifold
 		{
 		case b2Manifold::e_circles:
 			{
-				b2Vec2 pointA = cc->bodyA->GetWorldPoint(cc->localPoint);
-				b2Vec2 pointB = cc->bodyB->GetWorldPoint(cc->points[0].localPoint);
+				b2Vec2 pointA = b2Mul(xfA, cc->localPoint);
+				b2Vec2 pointB = b2Mul(xfB, cc->points[0].localPoint);
 				if (b2DistanceSquared(pointA, pointB) > B2_FLT_EPSILON * B2_FLT_EPSILON)
 				{
 					m_normal = pointB - pointA;
@@ -614,12 +628,12 @@ struct b2PositionSolverManifold
 
 		case b2Manifold::e_faceA:
 			{
-				m_normal = cc->bodyA->GetWorldVector(cc->localPlaneNormal);
-				b2Vec2 planePoint = cc->bodyA->GetWorldPoint(cc->localPoint);
+				m_normal = b2Mul(xfA.R, cc->localPlaneNormal);
+				b2Vec2 planePoint = b2Mul(xfA, cc->localPoint);
 
 				for (int32 i = 0; i < cc->pointCount; ++i)
 				{
-					b2Vec2 clipPoint = cc->bodyB->GetWorldPoint(cc->points[i].localPoint);
+					b2Vec2 clipPoint = b2Mul(xfB, cc->points[i].localPoint);
 					m_separations[i] = b2Dot(clipPoint - planePoint, m_normal) - cc->radius;
 					m_points[i] = clipPoint;
 				}
@@ -628,12 +642,12 @@ struct b2PositionSolverManifold
 
 		case b2Manifold::e_faceB:
 			{
-				m_normal = cc->bodyB->GetWorldVector(cc->localPlaneNormal);
-				b2Vec2 planePoint = cc->bodyB->GetWorldPoint(cc->localPoint);
+				m_normal = b2Mul(xfB.R, cc->localPlaneNormal);
+				b2Vec2 planePoint = b2Mul(xfB, cc->localPoint);
 
 				for (int32 i = 0; i < cc->pointCount; ++i)
 				{
-					b2Vec2 clipPoint = cc->bodyA->GetWorldPoint(cc->points[i].localPoint);
+					b2Vec2 clipPoint = b2Mul(xfA, cc->points[i].localPoint);
 					m_separations[i] = b2Dot(clipPoint - planePoint, m_normal) - cc->radius;
 					m_points[i] = clipPoint;
 				}
@@ -658,16 +672,25 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 	for (int32 i = 0; i < m_constraintCount; ++i)
 	{
 		b2ContactConstraint* c = m_constraints + i;
-		b2Body* bodyA = c->bodyA;
-		b2Body* bodyB = c->bodyB;
 
-		float32 invMassA = bodyA->m_mass * bodyA->m_invMass;
-		float32 invIA = bodyA->m_mass * bodyA->m_invI;
-		float32 invMassB = bodyB->m_mass * bodyB->m_invMass;
-		float32 invIB = bodyB->m_mass * bodyB->m_invI;
+		b2Vec2 cA = m_positions[c->indexA].x;
+		float32 aA = m_positions[c->indexA].a;
+		b2Vec2 cB = m_positions[c->indexB].x;
+		float32 aB = m_positions[c->indexB].a;
+
+		float32 invMassA = c->massA * c->invMassA;
+		float32 invIA = c->massA * c->invIA;
+		float32 invMassB = c->massB * c->invMassB;
+		float32 invIB = c->massB * c->invIB;
+
+		b2XForm xfA, xfB;
+		xfA.R.Set(aA);
+		xfB.R.Set(aB);
+		xfA.position = cA - b2Mul(xfA.R, c->localCenterA);
+		xfB.position = cB - b2Mul(xfB.R, c->localCenterB);
 
 		b2PositionSolverManifold psm;
-		psm.Initialize(c);
+		psm.Initialize(c, xfA, xfB);
 		b2Vec2 normal = psm.m_normal;
 
 		// Solve normal constraints
@@ -678,8 +701,8 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 			b2Vec2 point = psm.m_points[j];
 			float32 separation = psm.m_separations[j];
 
-			b2Vec2 rA = point - bodyA->m_sweep.c;
-			b2Vec2 rB = point - bodyB->m_sweep.c;
+			b2Vec2 rA = point - cA;
+			b2Vec2 rB = point - cB;
 
 			// Track max constraint error.
 			minSeparation = b2Min(minSeparation, separation);
@@ -692,14 +715,17 @@ bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
 
 			b2Vec2 P = impulse * normal;
 
-			bodyA->m_sweep.c -= invMassA * P;
-			bodyA->m_sweep.a -= invIA * b2Cross(rA, P);
-			bodyA->SynchronizeTransform();
+			cA -= invMassA * P;
+			aA -= invIA * b2Cross(rA, P);
 
-			bodyB->m_sweep.c += invMassB * P;
-			bodyB->m_sweep.a += invIB * b2Cross(rB, P);
-			bodyB->SynchronizeTransform();
+			cB += invMassB * P;
+			aB += invIB * b2Cross(rB, P);
 		}
+
+		m_positions[c->indexA].x = cA;
+		m_positions[c->indexA].a = aA;
+		m_positions[c->indexB].x = cB;
+		m_positions[c->indexB].a = aB;
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
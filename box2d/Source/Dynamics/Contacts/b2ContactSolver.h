@@ -27,6 +27,8 @@ class b2Contact;
 class b2Body;
 class b2Island;
 class b2StackAllocator;
+struct b2Position;
+struct b2Velocity;
 
 struct b2ContactConstraintPoint
 {
@@ -51,6 +53,13 @@ struct b2ContactConstraint
 	b2Mat22 K;
 	b2Body* bodyA;
 	b2Body* bodyB;
+	int32 indexA;
+	int32 indexB;
+	b2Vec2 localCenterA;
+	b2Vec2 localCenterB;
+	float32 invMassA, invIA;
+	float32 invMassB, invIB;
+	float32 massA, massB;
 	b2Manifold::Type type;
 	float32 radius;
 	float32 friction;
@@ -62,7 +71,8 @@ struct b2ContactConstraint
 class b2ContactSolver
 {
 public:
-	b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator);
+	// The solver works on the island state, see b2Island::GetStateIndex.
+	b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2Island* island);
 	~b2ContactSolver();
 
 	void InitVelocityConstraints(const b2TimeStep& step);
@@ -73,6 +83,8 @@ public:
 
 	b2TimeStep m_step;
 	b2StackAllocator* m_allocator;
+	b2Position* m_positions;
+	b2Velocity* m_velocities;
 	b2ContactConstraint* m_constraints;
 	int m_constraintCount;
 };
@@ -22,17 +22,11 @@
 #include "../../Common/b2Math.h"
 #include "b2Contact.h"
 
+// The pair user data of filtered pairs. It is never evaluated.
 class b2NullContact : public b2Contact
 {
 public:
 	b2NullContact() {}
-	void Evaluate() {}
-	float32 ComputeTOI(const b2Sweep& sweepA, const b2Sweep& sweepB) const
-	{
-		B2_NOT_USED(sweepA);
-		B2_NOT_USED(sweepB);
-		return 1.0f;
-	}
 };
 
 #endif
@@ -77,13 +77,16 @@ public:
 
 	b2DistanceJoint(const b2DistanceJointDef* data);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
-	bool SolvePositionConstraints(float32 baumgarte);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+	void WriteState(b2SnapshotWriter* writer) const;
+	void ReadState(b2SnapshotReader* reader);
 
 	b2Vec2 m_localAnchor1;
 	b2Vec2 m_localAnchor2;
 	b2Vec2 m_u;
+	b2Vec2 m_r1, m_r2;
 	float32 m_frequencyHz;
 	float32 m_dampingRatio;
 	float32 m_gamma;
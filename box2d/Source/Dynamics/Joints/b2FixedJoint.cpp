@@ -1,6 +1,8 @@
 #include "b2FixedJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "../b2Body.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 
 void b2FixedJointDef::Initialize(b2Body* b1, b2Body* b2)
 {
@@ -26,37 +28,54 @@ b2FixedJoint::b2FixedJoint(const b2FixedJointDef* def)
 	m_lambda_p_a = 0.0f;
 }
 
-void b2FixedJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2FixedJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	// Get bodies
 	b2Body* b1 = m_body1;
 	b2Body* b2 = m_body2;
 
+	// Cache the mass data for the solver
+	m_invMass1 = b1->m_invMass;
+	m_invI1 = b1->m_invI;
+	m_invMass2 = b2->m_invMass;
+	m_invI2 = b2->m_invI;
+
 	// Get d for this step
 	m_d = m_dp - b1->m_sweep.localCenter + b2Mul(m_R0, b2->m_sweep.localCenter);
 
 	// Calculate effective mass for angle constraint
-	float32 invMass = b1->m_invMass + b2->m_invMass;
+	float32 invMass = m_invMass1 + m_invMass2;
 	b2Assert(invMass > B2_FLT_EPSILON);
 	m_mass = 1.0f / invMass;
 
 	// Calculate effective inertia for angle constraint
-	float32 invInertia = b1->m_invI + b2->m_invI;
+	float32 invInertia = m_invI1 + m_invI2;
 	b2Assert(invInertia > B2_FLT_EPSILON);
 	m_inertia = 1.0f / invInertia;
 
-	if (step.warmStarting)
+	if (data.step.warmStarting)
 	{
+		float32 a1 = data.positions[m_index1].a;
+		b2Vec2 v1 = data.velocities[m_index1].v;
+		float32 w1 = data.velocities[m_index1].w;
+		b2Vec2 v2 = data.velocities[m_index2].v;
+		float32 w2 = data.velocities[m_index2].w;
+
 		// Take results of previous frame for angular constraint
-		b1->m_angularVelocity -= b1->m_invI * m_lambda_a;
-		b2->m_angularVelocity += b2->m_invI * m_lambda_a;
+		w1 -= m_invI1 * m_lambda_a;
+		w2 += m_invI2 * m_lambda_a;
 
 		// Take results of previous frame for position constraint
-		float32 s = sinf(b1->m_sweep.a), c = cosf(b1->m_sweep.a);
+		float32 s = sinf(a1), c = cosf(a1);
 		b2Vec2 A(-s * m_d.x - c * m_d.y, c * m_d.x - s * m_d.y);
-		b1->m_linearVelocity -= b1->m_invMass * m_lambda_p;
-		b1->m_angularVelocity -= b1->m_invI * b2Dot(m_lambda_p, A);
-		b2->m_linearVelocity += b2->m_invMass * m_lambda_p;
+		v1 -= m_invMass1 * m_lambda_p;
+		w1 -= m_invI1 * b2Dot(m_lambda_p, A);
+		v2 += m_invMass2 * m_lambda_p;
+
+		data.velocities[m_index1].v = v1;
+		data.velocities[m_index1].w = w1;
+		data.velocities[m_index2].v = v2;
+		data.velocities[m_index2].w = w2;
 	}
 	else
 	{
@@ -67,60 +86,70 @@ void b2FixedJoint::InitVelocityConstraints(const b2TimeStep& step)
 	}
 }
 
-void b2FixedJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2FixedJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	B2_NOT_USED(step);
-
-	// Get bodies
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	// Get the island state
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
 
 	// Angle constraint: w2 - w1 = 0
-	float32 Cdot_a = b2->m_angularVelocity - b1->m_angularVelocity;
+	float32 Cdot_a = w2 - w1;
 	float32 lambda_a = -m_inertia * Cdot_a;
 	m_lambda_a += lambda_a;
-	b1->m_angularVelocity -= b1->m_invI * lambda_a;
-	b2->m_angularVelocity += b2->m_invI * lambda_a;
+	w1 -= m_invI1 * lambda_a;
+	w2 += m_invI2 * lambda_a;
 
 	// Position constraint: v2 - v1 - d/dt R(a1) d = v2 - v1 - A w1 = 0
-	float32 s = sinf(b1->m_sweep.a), c = cosf(b1->m_sweep.a);
+	float32 s = sinf(a1), c = cosf(a1);
 	b2Vec2 A(-s * m_d.x - c * m_d.y, c * m_d.x - s * m_d.y);
-	b2Vec2 Cdot_p = b2->m_linearVelocity - b1->m_linearVelocity - b1->m_angularVelocity * A;
-	b2Vec2 mc_p(1.0f / (b1->m_invMass + b1->m_invI * A.x * A.x + b2->m_invMass), 1.0f / (b1->m_invMass + b1->m_invI * A.y * A.y + b2->m_invMass));
+	b2Vec2 Cdot_p = v2 - v1 - w1 * A;
+	b2Vec2 mc_p(1.0f / (m_invMass1 + m_invI1 * A.x * A.x + m_invMass2), 1.0f / (m_invMass1 + m_invI1 * A.y * A.y + m_invMass2));
 	b2Vec2 lambda_p(-mc_p.x * Cdot_p.x, -mc_p.y * Cdot_p.y);
 	m_lambda_p += lambda_p;
 	float32 lambda_p_a = b2Dot(A, lambda_p);
 	m_lambda_p_a += lambda_p_a;
-	b1->m_linearVelocity -= b1->m_invMass * lambda_p;
-	b1->m_angularVelocity -= b1->m_invI * lambda_p_a;
-	b2->m_linearVelocity += b2->m_invMass * lambda_p;
+	v1 -= m_invMass1 * lambda_p;
+	w1 -= m_invI1 * lambda_p_a;
+	v2 += m_invMass2 * lambda_p;
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-bool b2FixedJoint::SolvePositionConstraints(float32 baumgarte)
+bool b2FixedJoint::SolvePositionConstraints(const b2SolverData& data, float32 baumgarte)
 {
 	B2_NOT_USED(baumgarte);
 
-	// Get bodies
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	// Get the island state
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
 
 	// Angle constraint: a2 - a1 - a0 = 0
-	float32 C_a = b2->m_sweep.a - b1->m_sweep.a - m_a;
+	float32 C_a = a2 - a1 - m_a;
 	float32 lambda_a = -m_inertia * C_a;
-	b1->m_sweep.a -= b1->m_invI * lambda_a;
-	b2->m_sweep.a += b2->m_invI * lambda_a;
+	a1 -= m_invI1 * lambda_a;
+	a2 += m_invI2 * lambda_a;
 
 	// Position constraint: x2 - x1 - R(a1) d = 0
-	float32 s = sinf(b1->m_sweep.a), c = cosf(b1->m_sweep.a);
+	float32 s = sinf(a1), c = cosf(a1);
 	b2Vec2 Rd(c * m_d.x - s * m_d.y, s * m_d.x + c * m_d.y);
-	b2Vec2 C_p = b2->m_sweep.c - b1->m_sweep.c - Rd;
+	b2Vec2 C_p = c2 - c1 - Rd;
 	b2Vec2 lambda_p = -m_mass * C_p;
-	b1->m_sweep.c -= b1->m_invMass * lambda_p;
-	b2->m_sweep.c += b2->m_invMass * lambda_p;
+	c1 -= m_invMass1 * lambda_p;
+	c2 += m_invMass2 * lambda_p;
 
-	// Push the changes to the transforms
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	// Push the changes to the island state
+	data.positions[m_index1].x = c1;
+	data.positions[m_index1].a = a1;
+	data.positions[m_index2].x = c2;
+	data.positions[m_index2].a = a2;
 
 	// Constraint is satisfied if all constraint equations are nearly zero
 	return b2Abs(C_p.x) < b2_linearSlop && b2Abs(C_p.y) < b2_linearSlop && b2Abs(C_a) < b2_linearSlop;
@@ -147,3 +176,25 @@ float32 b2FixedJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * (m_lambda_a + m_lambda_p_a);
 }
+
+void b2FixedJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_dp);
+	writer->WriteFloat32(m_a);
+	writer->WriteVec2(m_R0.col1);
+	writer->WriteVec2(m_R0.col2);
+	writer->WriteFloat32(m_lambda_a);
+	writer->WriteVec2(m_lambda_p);
+	writer->WriteFloat32(m_lambda_p_a);
+}
+
+void b2FixedJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_dp = reader->ReadVec2();
+	m_a = reader->ReadFloat32();
+	m_R0.col1 = reader->ReadVec2();
+	m_R0.col2 = reader->ReadVec2();
+	m_lambda_a = reader->ReadFloat32();
+	m_lambda_p = reader->ReadVec2();
+	m_lambda_p_a = reader->ReadFloat32();
+}
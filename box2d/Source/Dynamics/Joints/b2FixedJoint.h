@@ -32,9 +32,11 @@ public:
 
 	b2FixedJoint(const b2FixedJointDef* data);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
-	bool SolvePositionConstraints(float32 baumgarte);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+	void WriteState(b2SnapshotWriter* writer) const;
+	void ReadState(b2SnapshotReader* reader);
 
 	// Initial state of the bodies
 	b2Vec2 m_dp;	//< Distance between body->GetXForm().position between the two bodies at rest in the reference frame of body1
@@ -17,10 +17,12 @@
 */
 
 #include "b2GearJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "b2RevoluteJoint.h"
 #include "b2PrismaticJoint.h"
 #include "../b2Body.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 
 // Gear Joint:
 // C0 = (coordinate1 + ratio * coordinate2)_initial
@@ -101,122 +103,156 @@ b2GearJoint::b2GearJoint(const b2GearJointDef* def)
 	m_impulse = 0.0f;
 }
 
-void b2GearJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2GearJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	b2Body* g1 = m_ground1;
 	b2Body* g2 = m_ground2;
 	b2Body* b1 = m_body1;
 	b2Body* b2 = m_body2;
 
+	m_localCenter1 = b1->GetLocalCenter();
+	m_localCenter2 = b2->GetLocalCenter();
+	m_invMass1 = b1->m_invMass;
+	m_invI1 = b1->m_invI;
+	m_invMass2 = b2->m_invMass;
+	m_invI2 = b2->m_invI;
+
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+
+	float32 a2 = data.positions[m_index2].a;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
+
 	float32 K = 0.0f;
 	m_J.SetZero();
 
 	if (m_revolute1)
 	{
 		m_J.angular1 = -1.0f;
-		K += b1->m_invI;
+		K += m_invI1;
 	}
 	else
 	{
+		// The ground bodies are static, so they are not part of the island state.
 		b2Vec2 ug = b2Mul(g1->GetXForm().R, m_prismatic1->m_localXAxis1);
-		b2Vec2 r = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
+		b2Vec2 r = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
 		float32 crug = b2Cross(r, ug);
 		m_J.linear1 = -ug;
 		m_J.angular1 = -crug;
-		K += b1->m_invMass + b1->m_invI * crug * crug;
+		K += m_invMass1 + m_invI1 * crug * crug;
 	}
 
 	if (m_revolute2)
 	{
 		m_J.angular2 = -m_ratio;
-		K += m_ratio * m_ratio * b2->m_invI;
+		K += m_ratio * m_ratio * m_invI2;
 	}
 	else
 	{
 		b2Vec2 ug = b2Mul(g2->GetXForm().R, m_prismatic2->m_localXAxis1);
-		b2Vec2 r = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+		b2Vec2 r = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
 		float32 crug = b2Cross(r, ug);
 		m_J.linear2 = -m_ratio * ug;
 		m_J.angular2 = -m_ratio * crug;
-		K += m_ratio * m_ratio * (b2->m_invMass + b2->m_invI * crug * crug);
+		K += m_ratio * m_ratio * (m_invMass2 + m_invI2 * crug * crug);
 	}
 
 	// Compute effective mass.
 	b2Assert(K > 0.0f);
 	m_mass = 1.0f / K;
 
-	if (step.warmStarting)
+	if (data.step.warmStarting)
 	{
 		// Warm starting.
-		b1->m_linearVelocity += b1->m_invMass * m_impulse * m_J.linear1;
-		b1->m_angularVelocity += b1->m_invI * m_impulse * m_J.angular1;
-		b2->m_linearVelocity += b2->m_invMass * m_impulse * m_J.linear2;
-		b2->m_angularVelocity += b2->m_invI * m_impulse * m_J.angular2;
+		v1 += m_invMass1 * m_impulse * m_J.linear1;
+		w1 += m_invI1 * m_impulse * m_J.angular1;
+		v2 += m_invMass2 * m_impulse * m_J.linear2;
+		w2 += m_invI2 * m_impulse * m_J.angular2;
 	}
 	else
 	{
 		m_impulse = 0.0f;
 	}
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-void b2GearJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2GearJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	B2_NOT_USED(step);
-
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
 
-	float32 Cdot = m_J.Compute(	b1->m_linearVelocity, b1->m_angularVelocity,
-								b2->m_linearVelocity, b2->m_angularVelocity);
+	float32 Cdot = m_J.Compute(v1, w1, v2, w2);
 
 	float32 impulse = m_mass * (-Cdot);
 	m_impulse += impulse;
 
-	b1->m_linearVelocity += b1->m_invMass * impulse * m_J.linear1;
-	b1->m_angularVelocity += b1->m_invI * impulse * m_J.angular1;
-	b2->m_linearVelocity += b2->m_invMass * impulse * m_J.linear2;
-	b2->m_angularVelocity += b2->m_invI * impulse * m_J.angular2;
+	v1 += m_invMass1 * impulse * m_J.linear1;
+	w1 += m_invI1 * impulse * m_J.angular1;
+	v2 += m_invMass2 * impulse * m_J.linear2;
+	w2 += m_invI2 * impulse * m_J.angular2;
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
+}
+
+// The joint coordinate of a revolute or prismatic joint from the island state of
+// its second body. The first body of these joints is static.
+float32 b2GearJoint::GetJointCoordinate(b2RevoluteJoint* revolute, b2PrismaticJoint* prismatic,
+										const b2Vec2& localCenter, const b2Vec2& c, float32 a)
+{
+	if (revolute)
+	{
+		return a - revolute->GetBody1()->m_sweep.a - revolute->m_referenceAngle;
+	}
+
+	b2Body* ground = prismatic->GetBody1();
+	b2XForm xf;
+	xf.R.Set(a);
+	xf.position = c - b2Mul(xf.R, localCenter);
+
+	b2Vec2 p1 = ground->GetWorldPoint(prismatic->m_localAnchor1);
+	b2Vec2 p2 = b2Mul(xf, prismatic->m_localAnchor2);
+	b2Vec2 axis = ground->GetWorldVector(prismatic->m_localXAxis1);
+	return b2Dot(p2 - p1, axis);
 }
 
-bool b2GearJoint::SolvePositionConstraints(float32 baumgarte)
+bool b2GearJoint::SolvePositionConstraints(const b2SolverData& data, float32 baumgarte)
 {
 	B2_NOT_USED(baumgarte);
 	
 	float32 linearError = 0.0f;
 
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
-
-	float32 coordinate1, coordinate2;
-	if (m_revolute1)
-	{
-		coordinate1 = m_revolute1->GetJointAngle();
-	}
-	else
-	{
-		coordinate1 = m_prismatic1->GetJointTranslation();
-	}
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
 
-	if (m_revolute2)
-	{
-		coordinate2 = m_revolute2->GetJointAngle();
-	}
-	else
-	{
-		coordinate2 = m_prismatic2->GetJointTranslation();
-	}
+	float32 coordinate1 = GetJointCoordinate(m_revolute1, m_prismatic1, m_localCenter1, c1, a1);
+	float32 coordinate2 = GetJointCoordinate(m_revolute2, m_prismatic2, m_localCenter2, c2, a2);
 
 	float32 C = m_constant - (coordinate1 + m_ratio * coordinate2);
 
 	float32 impulse = m_mass * (-C);
 
-	b1->m_sweep.c += b1->m_invMass * impulse * m_J.linear1;
-	b1->m_sweep.a += b1->m_invI * impulse * m_J.angular1;
-	b2->m_sweep.c += b2->m_invMass * impulse * m_J.linear2;
-	b2->m_sweep.a += b2->m_invI * impulse * m_J.angular2;
+	c1 += m_invMass1 * impulse * m_J.linear1;
+	a1 += m_invI1 * impulse * m_J.angular1;
+	c2 += m_invMass2 * impulse * m_J.linear2;
+	a2 += m_invI2 * impulse * m_J.angular2;
 
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	data.positions[m_index1].x = c1;
+	data.positions[m_index1].a = a1;
+	data.positions[m_index2].x = c2;
+	data.positions[m_index2].a = a2;
 
 	// TODO_ERIN not implemented
 	return linearError < b2_linearSlop;
@@ -253,5 +289,24 @@ float32 b2GearJoint::GetRatio() const
 	return m_ratio;
 }
 
+void b2GearJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_groundAnchor1);
+	writer->WriteVec2(m_groundAnchor2);
+	writer->WriteVec2(m_localAnchor1);
+	writer->WriteVec2(m_localAnchor2);
+	writer->WriteFloat32(m_constant);
+	writer->WriteFloat32(m_ratio);
+	writer->WriteFloat32(m_impulse);
+}
 
-
+void b2GearJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_groundAnchor1 = reader->ReadVec2();
+	m_groundAnchor2 = reader->ReadVec2();
+	m_localAnchor1 = reader->ReadVec2();
+	m_localAnchor2 = reader->ReadVec2();
+	m_constant = reader->ReadFloat32();
+	m_ratio = reader->ReadFloat32();
+	m_impulse = reader->ReadFloat32();
+}
@@ -73,9 +73,14 @@ public:
 
 	b2GearJoint(const b2GearJointDef* data);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
-	bool SolvePositionConstraints(float32 baumgarte);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+	void WriteState(b2SnapshotWriter* writer) const;
+	void ReadState(b2SnapshotReader* reader);
+
+	static float32 GetJointCoordinate(b2RevoluteJoint* revolute, b2PrismaticJoint* prismatic,
+									  const b2Vec2& localCenter, const b2Vec2& c, float32 a);
 
 	b2Body* m_ground1;
 	b2Body* m_ground2;
@@ -23,8 +23,10 @@
 
 class b2Body;
 class b2Joint;
-struct b2TimeStep;
+struct b2SolverData;
 class b2BlockAllocator;
+class b2SnapshotWriter;
+class b2SnapshotReader;
 
 enum b2JointType
 {
@@ -148,11 +150,17 @@ protected:
 	b2Joint(const b2JointDef* def);
 	virtual ~b2Joint() {}
 
-	virtual void InitVelocityConstraints(const b2TimeStep& step) = 0;
-	virtual void SolveVelocityConstraints(const b2TimeStep& step) = 0;
+	// The solvers work on the island state, the bodies are updated by the island.
+	virtual void InitVelocityConstraints(const b2SolverData& data) = 0;
+	virtual void SolveVelocityConstraints(const b2SolverData& data) = 0;
 
 	// This returns true if the position errors are within tolerance.
-	virtual bool SolvePositionConstraints(float32 baumgarte) = 0;
+	virtual bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte) = 0;
+
+	// Write and read the state of the joint for b2World::WriteSnapshot. The joint
+	// is created from a default definition and then reads its state.
+	virtual void WriteState(b2SnapshotWriter* writer) const = 0;
+	virtual void ReadState(b2SnapshotReader* reader) = 0;
 
 	void ComputeXForm(b2XForm* xf, const b2Vec2& center, const b2Vec2& localCenter, float32 angle) const;
 
@@ -170,6 +178,7 @@ protected:
 	void* m_userData;
 
 	// Cache here per time step to reduce cache misses.
+	int32 m_index1, m_index2;
 	b2Vec2 m_localCenter1, m_localCenter2;
 	float32 m_invMass1, m_invI1;
 	float32 m_invMass2, m_invI2;
@@ -131,9 +131,11 @@ public:
 
 	b2LineJoint(const b2LineJointDef* def);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
-	bool SolvePositionConstraints(float32 baumgarte);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+	void WriteState(b2SnapshotWriter* writer) const;
+	void ReadState(b2SnapshotReader* reader);
 
 	b2Vec2 m_localAnchor1;
 	b2Vec2 m_localAnchor2;
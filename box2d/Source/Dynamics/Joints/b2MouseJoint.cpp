@@ -17,8 +17,10 @@
 */
 
 #include "b2MouseJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "../b2Body.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 
 // p = attached point, m = mouse point
 // C = p - m
@@ -53,10 +55,19 @@ void b2MouseJoint::SetTarget(const b2Vec2& target)
 	m_target = target;
 }
 
-void b2MouseJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	b2Body* b = m_body2;
 
+	m_localCenter2 = b->GetLocalCenter();
+	m_invMass2 = b->m_invMass;
+	m_invI2 = b->m_invI;
+
+	b2Vec2 c = data.positions[m_index2].x;
+	float32 a = data.positions[m_index2].a;
+	b2Vec2 v = data.velocities[m_index2].v;
+	float32 w = data.velocities[m_index2].w;
+
 	float32 mass = b->GetMass();
 
 	// Frequency
@@ -71,18 +82,20 @@ void b2MouseJoint::InitVelocityConstraints(const b2TimeStep& step)
 	// magic formulas
 	// gamma has units of inverse mass.
 	// beta has units of inverse time.
+	const b2TimeStep& step = data.step;
 	b2Assert(d + step.dt * k > B2_FLT_EPSILON);
 	m_gamma = 1.0f / (step.dt * (d + step.dt * k));
 	m_beta = step.dt * k * m_gamma;
 
 	// Compute the effective mass matrix.
-	b2Vec2 r = b2Mul(b->GetXForm().R, m_localAnchor - b->GetLocalCenter());
+	m_r = b2Mul(b2Mat22(a), m_localAnchor - m_localCenter2);
+	b2Vec2 r = m_r;
 
 	// K    = [(1/m1 + 1/m2) * eye(2) - skew(r1) * invI1 * skew(r1) - skew(r2) * invI2 * skew(r2)]
 	//      = [1/m1+1/m2     0    ] + invI1 * [r1.y*r1.y -r1.x*r1.y] + invI2 * [r1.y*r1.y -r1.x*r1.y]
 	//        [    0     1/m1+1/m2]           [-r1.x*r1.y r1.x*r1.x]           [-r1.x*r1.y r1.x*r1.x]
-	float32 invMass = b->m_invMass;
-	float32 invI = b->m_invI;
+	float32 invMass = m_invMass2;
+	float32 invI = m_invI2;
 
 	b2Mat22 K1;
 	K1.col1.x = invMass;	K1.col2.x = 0.0f;
@@ -98,38 +111,43 @@ void b2MouseJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 	m_mass = K.GetInverse();
 
-	m_C = b->m_sweep.c + r - m_target;
+	m_C = c + r - m_target;
 
 	// Cheat with some damping
-	b->m_angularVelocity *= 0.98f;
+	w *= 0.98f;
 
 	// Warm starting.
 	m_impulse *= step.dtRatio;
-	b->m_linearVelocity += invMass * m_impulse;
-	b->m_angularVelocity += invI * b2Cross(r, m_impulse);
+	v += invMass * m_impulse;
+	w += invI * b2Cross(r, m_impulse);
+
+	data.velocities[m_index2].v = v;
+	data.velocities[m_index2].w = w;
 }
 
-void b2MouseJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	b2Body* b = m_body2;
-
-	b2Vec2 r = b2Mul(b->GetXForm().R, m_localAnchor - b->GetLocalCenter());
+	b2Vec2 v = data.velocities[m_index2].v;
+	float32 w = data.velocities[m_index2].w;
 
 	// Cdot = v + cross(w, r)
-	b2Vec2 Cdot = b->m_linearVelocity + b2Cross(b->m_angularVelocity, r);
+	b2Vec2 Cdot = v + b2Cross(w, m_r);
 	b2Vec2 impulse = b2Mul(m_mass, -(Cdot + m_beta * m_C + m_gamma * m_impulse));
 
 	b2Vec2 oldImpulse = m_impulse;
 	m_impulse += impulse;
-	float32 maxImpulse = step.dt * m_maxForce;
+	float32 maxImpulse = data.step.dt * m_maxForce;
 	if (m_impulse.LengthSquared() > maxImpulse * maxImpulse)
 	{
 		m_impulse *= maxImpulse / m_impulse.Length();
 	}
 	impulse = m_impulse - oldImpulse;
 
-	b->m_linearVelocity += b->m_invMass * impulse;
-	b->m_angularVelocity += b->m_invI * b2Cross(r, impulse);
+	v += m_invMass2 * impulse;
+	w += m_invI2 * b2Cross(m_r, impulse);
+
+	data.velocities[m_index2].v = v;
+	data.velocities[m_index2].w = w;
 }
 
 b2Vec2 b2MouseJoint::GetAnchor1() const
@@ -151,3 +169,23 @@ float32 b2MouseJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * 0.0f;
 }
+
+void b2MouseJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_localAnchor);
+	writer->WriteVec2(m_target);
+	writer->WriteVec2(m_impulse);
+	writer->WriteFloat32(m_maxForce);
+	writer->WriteFloat32(m_frequencyHz);
+	writer->WriteFloat32(m_dampingRatio);
+}
+
+void b2MouseJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_localAnchor = reader->ReadVec2();
+	m_target = reader->ReadVec2();
+	m_impulse = reader->ReadVec2();
+	m_maxForce = reader->ReadFloat32();
+	m_frequencyHz = reader->ReadFloat32();
+	m_dampingRatio = reader->ReadFloat32();
+}
@@ -17,8 +17,10 @@
 */
 
 #include "b2PrismaticJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "../b2Body.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 
 // Linear constraint (point-to-line)
 // d = p2 - p1 = x2 + r2 - x1 - r1
@@ -122,7 +124,7 @@ b2PrismaticJoint::b2PrismaticJoint(const b2PrismaticJointDef* def)
 	m_perp.SetZero();
 }
 
-void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2PrismaticJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	b2Body* b1 = m_body1;
 	b2Body* b2 = m_body2;
@@ -134,13 +136,22 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
 	m_localCenter1 = b1->GetLocalCenter();
 	m_localCenter2 = b2->GetLocalCenter();
 
-	b2XForm xf1 = b1->GetXForm();
-	b2XForm xf2 = b2->GetXForm();
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
+
+	b2Mat22 R1(a1), R2(a2);
 
 	// Compute the effective masses.
-	b2Vec2 r1 = b2Mul(xf1.R, m_localAnchor1 - m_localCenter1);
-	b2Vec2 r2 = b2Mul(xf2.R, m_localAnchor2 - m_localCenter2);
-	b2Vec2 d = b2->m_sweep.c + r2 - b1->m_sweep.c - r1;
+	b2Vec2 r1 = b2Mul(R1, m_localAnchor1 - m_localCenter1);
+	b2Vec2 r2 = b2Mul(R2, m_localAnchor2 - m_localCenter2);
+	b2Vec2 d = c2 + r2 - c1 - r1;
 
 	m_invMass1 = b1->m_invMass;
 	m_invI1 = b1->m_invI;
@@ -149,7 +160,7 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 	// Compute motor Jacobian and effective mass.
 	{
-		m_axis = b2Mul(xf1.R, m_localXAxis1);
+		m_axis = b2Mul(R1, m_localXAxis1);
 		m_a1 = b2Cross(d + r1, m_axis);
 		m_a2 = b2Cross(r2, m_axis);
 
@@ -160,7 +171,7 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 	// Prismatic constraint.
 	{
-		m_perp = b2Mul(xf1.R, m_localYAxis1);
+		m_perp = b2Mul(R1, m_localYAxis1);
 
 		m_s1 = b2Cross(d + r1, m_perp);
 		m_s2 = b2Cross(r2, m_perp);
@@ -220,38 +231,40 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2TimeStep& step)
 		m_motorImpulse = 0.0f;
 	}
 
-	if (step.warmStarting)
+	if (data.step.warmStarting)
 	{
 		// Account for variable time step.
-		m_impulse *= step.dtRatio;
-		m_motorImpulse *= step.dtRatio;
+		m_impulse *= data.step.dtRatio;
+		m_motorImpulse *= data.step.dtRatio;
 
 		b2Vec2 P = m_impulse.x * m_perp + (m_motorImpulse + m_impulse.z) * m_axis;
 		float32 L1 = m_impulse.x * m_s1 + m_impulse.y + (m_motorImpulse + m_impulse.z) * m_a1;
 		float32 L2 = m_impulse.x * m_s2 + m_impulse.y + (m_motorImpulse + m_impulse.z) * m_a2;
 
-		b1->m_linearVelocity -= m_invMass1 * P;
-		b1->m_angularVelocity -= m_invI1 * L1;
+		v1 -= m_invMass1 * P;
+		w1 -= m_invI1 * L1;
 
-		b2->m_linearVelocity += m_invMass2 * P;
-		b2->m_angularVelocity += m_invI2 * L2;
+		v2 += m_invMass2 * P;
+		w2 += m_invI2 * L2;
 	}
 	else
 	{
 		m_impulse.SetZero();
 		m_motorImpulse = 0.0f;
 	}
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2PrismaticJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
-
-	b2Vec2 v1 = b1->m_linearVelocity;
-	float32 w1 = b1->m_angularVelocity;
-	b2Vec2 v2 = b2->m_linearVelocity;
-	float32 w2 = b2->m_angularVelocity;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
 
 	// Solve linear motor constraint.
 	if (m_enableMotor && m_limitState != e_equalLimits)
@@ -259,7 +272,7 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		float32 Cdot = b2Dot(m_axis, v2 - v1) + m_a2 * w2 - m_a1 * w1;
 		float32 impulse = m_motorMass * (m_motorSpeed - Cdot);
 		float32 oldImpulse = m_motorImpulse;
-		float32 maxImpulse = step.dt * m_maxMotorForce;
+		float32 maxImpulse = data.step.dt * m_maxMotorForce;
 		m_motorImpulse = b2Clamp(m_motorImpulse + impulse, -maxImpulse, maxImpulse);
 		impulse = m_motorImpulse - oldImpulse;
 
@@ -334,24 +347,21 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		w2 += m_invI2 * L2;
 	}
 
-	b1->m_linearVelocity = v1;
-	b1->m_angularVelocity = w1;
-	b2->m_linearVelocity = v2;
-	b2->m_angularVelocity = w2;
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-bool b2PrismaticJoint::SolvePositionConstraints(float32 baumgarte)
+bool b2PrismaticJoint::SolvePositionConstraints(const b2SolverData& data, float32 baumgarte)
 {
 	B2_NOT_USED(baumgarte);
 
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
-
-	b2Vec2 c1 = b1->m_sweep.c;
-	float32 a1 = b1->m_sweep.a;
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
 
-	b2Vec2 c2 = b2->m_sweep.c;
-	float32 a2 = b2->m_sweep.a;
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
 
 	// Solve linear limit constraint.
 	float32 linearError = 0.0f, angularError = 0.0f;
@@ -458,13 +468,10 @@ bool b2PrismaticJoint::SolvePositionConstraints(float32 baumgarte)
 	c2 += m_invMass2 * P;
 	a2 += m_invI2 * L2;
 
-	// TODO_ERIN remove need for this.
-	b1->m_sweep.c = c1;
-	b1->m_sweep.a = a1;
-	b2->m_sweep.c = c2;
-	b2->m_sweep.a = a2;
-	b1->SynchronizeTransform();
-	b2->SynchronizeTransform();
+	data.positions[m_index1].x = c1;
+	data.positions[m_index1].a = a1;
+	data.positions[m_index2].x = c2;
+	data.positions[m_index2].a = a2;
 	
 	return linearError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -585,3 +592,43 @@ float32 b2PrismaticJoint::GetMotorForce() const
 {
 	return m_motorImpulse;
 }
+
+void b2PrismaticJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_localAnchor1);
+	writer->WriteVec2(m_localAnchor2);
+	writer->WriteVec2(m_localXAxis1);
+	writer->WriteVec2(m_localYAxis1);
+	writer->WriteFloat32(m_refAngle);
+	writer->WriteFloat32(m_impulse.x);
+	writer->WriteFloat32(m_impulse.y);
+	writer->WriteFloat32(m_impulse.z);
+	writer->WriteFloat32(m_motorImpulse);
+	writer->WriteFloat32(m_lowerTranslation);
+	writer->WriteFloat32(m_upperTranslation);
+	writer->WriteFloat32(m_maxMotorForce);
+	writer->WriteFloat32(m_motorSpeed);
+	writer->WriteBool(m_enableLimit);
+	writer->WriteBool(m_enableMotor);
+	writer->WriteInt32((int32)m_limitState);
+}
+
+void b2PrismaticJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_localAnchor1 = reader->ReadVec2();
+	m_localAnchor2 = reader->ReadVec2();
+	m_localXAxis1 = reader->ReadVec2();
+	m_localYAxis1 = reader->ReadVec2();
+	m_refAngle = reader->ReadFloat32();
+	m_impulse.x = reader->ReadFloat32();
+	m_impulse.y = reader->ReadFloat32();
+	m_impulse.z = reader->ReadFloat32();
+	m_motorImpulse = reader->ReadFloat32();
+	m_lowerTranslation = reader->ReadFloat32();
+	m_upperTranslation = reader->ReadFloat32();
+	m_maxMotorForce = reader->ReadFloat32();
+	m_motorSpeed = reader->ReadFloat32();
+	m_enableLimit = reader->ReadBool();
+	m_enableMotor = reader->ReadBool();
+	m_limitState = (b2LimitState)reader->ReadInt32();
+}
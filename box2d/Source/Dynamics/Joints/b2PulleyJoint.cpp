@@ -17,8 +17,10 @@
 */
 
 #include "b2PulleyJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "../b2Body.h"
 #include "../b2World.h"
+#include "../b2Island.h"
 
 // Pulley:
 // length1 = norm(p1 - s1)
@@ -83,16 +85,33 @@ b2PulleyJoint::b2PulleyJoint(const b2PulleyJointDef* def)
 	m_limitImpulse2 = 0.0f;
 }
 
-void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2PulleyJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	b2Body* b1 = m_body1;
 	b2Body* b2 = m_body2;
 
-	b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-	b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+	m_localCenter1 = b1->GetLocalCenter();
+	m_localCenter2 = b2->GetLocalCenter();
+	m_invMass1 = b1->m_invMass;
+	m_invI1 = b1->m_invI;
+	m_invMass2 = b2->m_invMass;
+	m_invI2 = b2->m_invI;
 
-	b2Vec2 p1 = b1->m_sweep.c + r1;
-	b2Vec2 p2 = b2->m_sweep.c + r2;
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
+
+	m_r1 = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
+	m_r2 = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
+
+	b2Vec2 p1 = c1 + m_r1;
+	b2Vec2 p2 = c2 + m_r2;
 
 	b2Vec2 s1 = m_ground->GetXForm().position + m_groundAnchor1;
 	b2Vec2 s2 = m_ground->GetXForm().position + m_groundAnchor2;
@@ -154,11 +173,11 @@ void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
 	}
 
 	// Compute effective mass.
-	float32 cr1u1 = b2Cross(r1, m_u1);
-	float32 cr2u2 = b2Cross(r2, m_u2);
+	float32 cr1u1 = b2Cross(m_r1, m_u1);
+	float32 cr2u2 = b2Cross(m_r2, m_u2);
 
-	m_limitMass1 = b1->m_invMass + b1->m_invI * cr1u1 * cr1u1;
-	m_limitMass2 = b2->m_invMass + b2->m_invI * cr2u2 * cr2u2;
+	m_limitMass1 = m_invMass1 + m_invI1 * cr1u1 * cr1u1;
+	m_limitMass2 = m_invMass2 + m_invI2 * cr2u2 * cr2u2;
 	m_pulleyMass = m_limitMass1 + m_ratio * m_ratio * m_limitMass2;
 	b2Assert(m_limitMass1 > B2_FLT_EPSILON);
 	b2Assert(m_limitMass2 > B2_FLT_EPSILON);
@@ -167,20 +186,20 @@ void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
 	m_limitMass2 = 1.0f / m_limitMass2;
 	m_pulleyMass = 1.0f / m_pulleyMass;
 
-	if (step.warmStarting)
+	if (data.step.warmStarting)
 	{
 		// Scale impulses to support variable time steps.
-		m_impulse *= step.dtRatio;
-		m_limitImpulse1 *= step.dtRatio;
-		m_limitImpulse2 *= step.dtRatio;
+		m_impulse *= data.step.dtRatio;
+		m_limitImpulse1 *= data.step.dtRatio;
+		m_limitImpulse2 *= data.step.dtRatio;
 
 		// Warm starting.
 		b2Vec2 P1 = -(m_impulse + m_limitImpulse1) * m_u1;
 		b2Vec2 P2 = (-m_ratio * m_impulse - m_limitImpulse2) * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		v1 += m_invMass1 * P1;
+		w1 += m_invI1 * b2Cross(m_r1, P1);
+		v2 += m_invMass2 * P2;
+		w2 += m_invI2 * b2Cross(m_r2, P2);
 	}
 	else
 	{
@@ -188,24 +207,26 @@ void b2PulleyJoint::InitVelocityConstraints(const b2TimeStep& step)
 		m_limitImpulse1 = 0.0f;
 		m_limitImpulse2 = 0.0f;
 	}
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2PulleyJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	B2_NOT_USED(step);
-
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
-
-	b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-	b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
 
 	if (m_state == e_atUpperLimit)
 	{
-		b2Vec2 v1 = b1->m_linearVelocity + b2Cross(b1->m_angularVelocity, r1);
-		b2Vec2 v2 = b2->m_linearVelocity + b2Cross(b2->m_angularVelocity, r2);
+		b2Vec2 vp1 = v1 + b2Cross(w1, m_r1);
+		b2Vec2 vp2 = v2 + b2Cross(w2, m_r2);
 
-		float32 Cdot = -b2Dot(m_u1, v1) - m_ratio * b2Dot(m_u2, v2);
+		float32 Cdot = -b2Dot(m_u1, vp1) - m_ratio * b2Dot(m_u2, vp2);
 		float32 impulse = m_pulleyMass * (-Cdot);
 		float32 oldImpulse = m_impulse;
 		m_impulse = b2Max(0.0f, m_impulse + impulse);
@@ -213,49 +234,56 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2TimeStep& step)
 
 		b2Vec2 P1 = -impulse * m_u1;
 		b2Vec2 P2 = -m_ratio * impulse * m_u2;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		v1 += m_invMass1 * P1;
+		w1 += m_invI1 * b2Cross(m_r1, P1);
+		v2 += m_invMass2 * P2;
+		w2 += m_invI2 * b2Cross(m_r2, P2);
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
 	{
-		b2Vec2 v1 = b1->m_linearVelocity + b2Cross(b1->m_angularVelocity, r1);
+		b2Vec2 vp1 = v1 + b2Cross(w1, m_r1);
 
-		float32 Cdot = -b2Dot(m_u1, v1);
+		float32 Cdot = -b2Dot(m_u1, vp1);
 		float32 impulse = -m_limitMass1 * Cdot;
 		float32 oldImpulse = m_limitImpulse1;
 		m_limitImpulse1 = b2Max(0.0f, m_limitImpulse1 + impulse);
 		impulse = m_limitImpulse1 - oldImpulse;
 
 		b2Vec2 P1 = -impulse * m_u1;
-		b1->m_linearVelocity += b1->m_invMass * P1;
-		b1->m_angularVelocity += b1->m_invI * b2Cross(r1, P1);
+		v1 += m_invMass1 * P1;
+		w1 += m_invI1 * b2Cross(m_r1, P1);
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
 	{
-		b2Vec2 v2 = b2->m_linearVelocity + b2Cross(b2->m_angularVelocity, r2);
+		b2Vec2 vp2 = v2 + b2Cross(w2, m_r2);
 
-		float32 Cdot = -b2Dot(m_u2, v2);
+		float32 Cdot = -b2Dot(m_u2, vp2);
 		float32 impulse = -m_limitMass2 * Cdot;
 		float32 oldImpulse = m_limitImpulse2;
 		m_limitImpulse2 = b2Max(0.0f, m_limitImpulse2 + impulse);
 		impulse = m_limitImpulse2 - oldImpulse;
 
 		b2Vec2 P2 = -impulse * m_u2;
-		b2->m_linearVelocity += b2->m_invMass * P2;
-		b2->m_angularVelocity += b2->m_invI * b2Cross(r2, P2);
+		v2 += m_invMass2 * P2;
+		w2 += m_invI2 * b2Cross(m_r2, P2);
 	}
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
+bool b2PulleyJoint::SolvePositionConstraints(const b2SolverData& data, float32 baumgarte)
 {
 	B2_NOT_USED(baumgarte);
 
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
 
 	b2Vec2 s1 = m_ground->GetXForm().position + m_groundAnchor1;
 	b2Vec2 s2 = m_ground->GetXForm().position + m_groundAnchor2;
@@ -264,11 +292,11 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 
 	if (m_state == e_atUpperLimit)
 	{
-		b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-		b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+		b2Vec2 r1 = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
+		b2Vec2 r2 = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
 
-		b2Vec2 p1 = b1->m_sweep.c + r1;
-		b2Vec2 p2 = b2->m_sweep.c + r2;
+		b2Vec2 p1 = c1 + r1;
+		b2Vec2 p2 = c2 + r2;
 
 		// Get the pulley axes.
 		m_u1 = p1 - s1;
@@ -304,19 +332,16 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		b2Vec2 P1 = -impulse * m_u1;
 		b2Vec2 P2 = -m_ratio * impulse * m_u2;
 
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
-
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		c1 += m_invMass1 * P1;
+		a1 += m_invI1 * b2Cross(r1, P1);
+		c2 += m_invMass2 * P2;
+		a2 += m_invI2 * b2Cross(r2, P2);
 	}
 
 	if (m_limitState1 == e_atUpperLimit)
 	{
-		b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-		b2Vec2 p1 = b1->m_sweep.c + r1;
+		b2Vec2 r1 = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
+		b2Vec2 p1 = c1 + r1;
 
 		m_u1 = p1 - s1;
 		float32 length1 = m_u1.Length();
@@ -336,16 +361,14 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		float32 impulse = -m_limitMass1 * C;
 
 		b2Vec2 P1 = -impulse * m_u1;
-		b1->m_sweep.c += b1->m_invMass * P1;
-		b1->m_sweep.a += b1->m_invI * b2Cross(r1, P1);
-
-		b1->SynchronizeTransform();
+		c1 += m_invMass1 * P1;
+		a1 += m_invI1 * b2Cross(r1, P1);
 	}
 
 	if (m_limitState2 == e_atUpperLimit)
 	{
-		b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
-		b2Vec2 p2 = b2->m_sweep.c + r2;
+		b2Vec2 r2 = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
+		b2Vec2 p2 = c2 + r2;
 
 		m_u2 = p2 - s2;
 		float32 length2 = m_u2.Length();
@@ -365,12 +388,15 @@ bool b2PulleyJoint::SolvePositionConstraints(float32 baumgarte)
 		float32 impulse = -m_limitMass2 * C;
 
 		b2Vec2 P2 = -impulse * m_u2;
-		b2->m_sweep.c += b2->m_invMass * P2;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, P2);
-
-		b2->SynchronizeTransform();
+		c2 += m_invMass2 * P2;
+		a2 += m_invI2 * b2Cross(r2, P2);
 	}
 
+	data.positions[m_index1].x = c1;
+	data.positions[m_index1].a = a1;
+	data.positions[m_index2].x = c2;
+	data.positions[m_index2].a = a2;
+
 	return linearError < b2_linearSlop;
 }
 
@@ -426,3 +452,39 @@ float32 b2PulleyJoint::GetRatio() const
 {
 	return m_ratio;
 }
+
+void b2PulleyJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_groundAnchor1);
+	writer->WriteVec2(m_groundAnchor2);
+	writer->WriteVec2(m_localAnchor1);
+	writer->WriteVec2(m_localAnchor2);
+	writer->WriteFloat32(m_constant);
+	writer->WriteFloat32(m_ratio);
+	writer->WriteFloat32(m_maxLength1);
+	writer->WriteFloat32(m_maxLength2);
+	writer->WriteFloat32(m_impulse);
+	writer->WriteFloat32(m_limitImpulse1);
+	writer->WriteFloat32(m_limitImpulse2);
+	writer->WriteInt32((int32)m_state);
+	writer->WriteInt32((int32)m_limitState1);
+	writer->WriteInt32((int32)m_limitState2);
+}
+
+void b2PulleyJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_groundAnchor1 = reader->ReadVec2();
+	m_groundAnchor2 = reader->ReadVec2();
+	m_localAnchor1 = reader->ReadVec2();
+	m_localAnchor2 = reader->ReadVec2();
+	m_constant = reader->ReadFloat32();
+	m_ratio = reader->ReadFloat32();
+	m_maxLength1 = reader->ReadFloat32();
+	m_maxLength2 = reader->ReadFloat32();
+	m_impulse = reader->ReadFloat32();
+	m_limitImpulse1 = reader->ReadFloat32();
+	m_limitImpulse2 = reader->ReadFloat32();
+	m_state = (b2LimitState)reader->ReadInt32();
+	m_limitState1 = (b2LimitState)reader->ReadInt32();
+	m_limitState2 = (b2LimitState)reader->ReadInt32();
+}
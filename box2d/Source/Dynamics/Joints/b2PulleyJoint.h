@@ -111,9 +111,11 @@ public:
 
 	b2PulleyJoint(const b2PulleyJointDef* data);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
-	bool SolvePositionConstraints(float32 baumgarte);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+	void WriteState(b2SnapshotWriter* writer) const;
+	void ReadState(b2SnapshotReader* reader);
 
 	b2Body* m_ground;
 	b2Vec2 m_groundAnchor1;
@@ -123,6 +125,8 @@ public:
 
 	b2Vec2 m_u1;
 	b2Vec2 m_u2;
+	b2Vec2 m_r1;
+	b2Vec2 m_r2;
 	
 	float32 m_constant;
 	float32 m_ratio;
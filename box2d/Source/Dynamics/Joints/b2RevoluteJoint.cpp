@@ -17,6 +17,7 @@
 */
 
 #include "b2RevoluteJoint.h"
+#include "../../Common/b2Snapshot.h"
 #include "../b2Body.h"
 #include "../b2World.h"
 
@@ -63,7 +64,7 @@ b2RevoluteJoint::b2RevoluteJoint(const b2RevoluteJointDef* def)
 	m_limitState = e_inactiveLimit;
 }
 
-void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
+void b2RevoluteJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	b2Body* b1 = m_body1;
 	b2Body* b2 = m_body2;
@@ -75,9 +76,26 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 		b2Assert(b1->m_invI > 0.0f || b2->m_invI > 0.0f);
 	}
 
+	m_localCenter1 = b1->GetLocalCenter();
+	m_localCenter2 = b2->GetLocalCenter();
+	m_invMass1 = b1->m_invMass;
+	m_invI1 = b1->m_invI;
+	m_invMass2 = b2->m_invMass;
+	m_invI2 = b2->m_invI;
+
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+
+	float32 a2 = data.positions[m_index2].a;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
+
 	// Compute the effective mass matrix.
-	b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-	b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+	m_r1 = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
+	m_r2 = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
+	b2Vec2 r1 = m_r1;
+	b2Vec2 r2 = m_r2;
 
 	// J = [-I -r1_skew I r2_skew]
 	//     [ 0       -1 0       1]
@@ -88,8 +106,8 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 	//     [  -r1y*i1*r1x-r2y*i2*r2x, m1+r1x^2*i1+m2+r2x^2*i2,           r1x*i1+r2x*i2]
 	//     [          -r1y*i1-r2y*i2,           r1x*i1+r2x*i2,                   i1+i2]
 
-	float32 m1 = b1->m_invMass, m2 = b2->m_invMass;
-	float32 i1 = b1->m_invI, i2 = b2->m_invI;
+	float32 m1 = m_invMass1, m2 = m_invMass2;
+	float32 i1 = m_invI1, i2 = m_invI2;
 
 	m_mass.col1.x = m1 + m2 + r1.y * r1.y * i1 + r2.y * r2.y * i2;
 	m_mass.col2.x = -r1.y * r1.x * i1 - r2.y * r2.x * i2;
@@ -110,7 +128,7 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 
 	if (m_enableLimit)
 	{
-		float32 jointAngle = b2->m_sweep.a - b1->m_sweep.a - m_referenceAngle;
+		float32 jointAngle = a2 - a1 - m_referenceAngle;
 		if (b2Abs(m_upperAngle - m_lowerAngle) < 2.0f * b2_angularSlop)
 		{
 			m_limitState = e_equalLimits;
@@ -142,39 +160,41 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
 		m_limitState = e_inactiveLimit;
 	}
 
-	if (step.warmStarting)
+	if (data.step.warmStarting)
 	{
 		// Scale impulses to support a variable time step.
-		m_impulse *= step.dtRatio;
-		m_motorImpulse *= step.dtRatio;
+		m_impulse *= data.step.dtRatio;
+		m_motorImpulse *= data.step.dtRatio;
 
 		b2Vec2 P(m_impulse.x, m_impulse.y);
 
-		b1->m_linearVelocity -= m1 * P;
-		b1->m_angularVelocity -= i1 * (b2Cross(r1, P) + m_motorImpulse + m_impulse.z);
+		v1 -= m1 * P;
+		w1 -= i1 * (b2Cross(r1, P) + m_motorImpulse + m_impulse.z);
 
-		b2->m_linearVelocity += m2 * P;
-		b2->m_angularVelocity += i2 * (b2Cross(r2, P) + m_motorImpulse + m_impulse.z);
+		v2 += m2 * P;
+		w2 += i2 * (b2Cross(r2, P) + m_motorImpulse + m_impulse.z);
 	}
 	else
 	{
 		m_impulse.SetZero();
 		m_motorImpulse = 0.0f;
 	}
+
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
+void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	b2Vec2 v1 = data.velocities[m_index1].v;
+	float32 w1 = data.velocities[m_index1].w;
+	b2Vec2 v2 = data.velocities[m_index2].v;
+	float32 w2 = data.velocities[m_index2].w;
 
-	b2Vec2 v1 = b1->m_linearVelocity;
-	float32 w1 = b1->m_angularVelocity;
-	b2Vec2 v2 = b2->m_linearVelocity;
-	float32 w2 = b2->m_angularVelocity;
-
-	float32 m1 = b1->m_invMass, m2 = b2->m_invMass;
-	float32 i1 = b1->m_invI, i2 = b2->m_invI;
+	float32 m1 = m_invMass1, m2 = m_invMass2;
+	float32 i1 = m_invI1, i2 = m_invI2;
 
 	// Solve motor constraint.
 	if (m_enableMotor && m_limitState != e_equalLimits)
@@ -182,7 +202,7 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		float32 Cdot = w2 - w1 - m_motorSpeed;
 		float32 impulse = m_motorMass * (-Cdot);
 		float32 oldImpulse = m_motorImpulse;
-		float32 maxImpulse = step.dt * m_maxMotorTorque;
+		float32 maxImpulse = data.step.dt * m_maxMotorTorque;
 		m_motorImpulse = b2Clamp(m_motorImpulse + impulse, -maxImpulse, maxImpulse);
 		impulse = m_motorImpulse - oldImpulse;
 
@@ -193,8 +213,8 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	// Solve limit constraint.
 	if (m_enableLimit && m_limitState != e_inactiveLimit)
 	{
-		b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-		b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+		b2Vec2 r1 = m_r1;
+		b2Vec2 r2 = m_r2;
 
 		// Solve point-to-point constraint
 		b2Vec2 Cdot1 = v2 + b2Cross(w2, r2) - v1 - b2Cross(w1, r1);
@@ -246,8 +266,8 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 	}
 	else
 	{
-		b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-		b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+		b2Vec2 r1 = m_r1;
+		b2Vec2 r2 = m_r2;
 
 		// Solve point-to-point constraint
 		b2Vec2 Cdot = v2 + b2Cross(w2, r2) - v1 - b2Cross(w1, r1);
@@ -263,20 +283,22 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2TimeStep& step)
 		w2 += i2 * b2Cross(r2, impulse);
 	}
 
-	b1->m_linearVelocity = v1;
-	b1->m_angularVelocity = w1;
-	b2->m_linearVelocity = v2;
-	b2->m_angularVelocity = w2;
+	data.velocities[m_index1].v = v1;
+	data.velocities[m_index1].w = w1;
+	data.velocities[m_index2].v = v2;
+	data.velocities[m_index2].w = w2;
 }
 
-bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
+bool b2RevoluteJoint::SolvePositionConstraints(const b2SolverData& data, float32 baumgarte)
 {
 	// TODO_ERIN block solve with limit.
 
 	B2_NOT_USED(baumgarte);
 
-	b2Body* b1 = m_body1;
-	b2Body* b2 = m_body2;
+	b2Vec2 c1 = data.positions[m_index1].x;
+	float32 a1 = data.positions[m_index1].a;
+	b2Vec2 c2 = data.positions[m_index2].x;
+	float32 a2 = data.positions[m_index2].a;
 
 	float32 angularError = 0.0f;
 	float32 positionError = 0.0f;
@@ -284,7 +306,7 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 	// Solve angular limit constraint.
 	if (m_enableLimit && m_limitState != e_inactiveLimit)
 	{
-		float32 angle = b2->m_sweep.a - b1->m_sweep.a - m_referenceAngle;
+		float32 angle = a2 - a1 - m_referenceAngle;
 		float32 limitImpulse = 0.0f;
 
 		if (m_limitState == e_equalLimits)
@@ -313,23 +335,20 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 			limitImpulse = -m_motorMass * C;
 		}
 
-		b1->m_sweep.a -= b1->m_invI * limitImpulse;
-		b2->m_sweep.a += b2->m_invI * limitImpulse;
-
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		a1 -= m_invI1 * limitImpulse;
+		a2 += m_invI2 * limitImpulse;
 	}
 
 	// Solve point-to-point constraint.
 	{
-		b2Vec2 r1 = b2Mul(b1->GetXForm().R, m_localAnchor1 - b1->GetLocalCenter());
-		b2Vec2 r2 = b2Mul(b2->GetXForm().R, m_localAnchor2 - b2->GetLocalCenter());
+		b2Vec2 r1 = b2Mul(b2Mat22(a1), m_localAnchor1 - m_localCenter1);
+		b2Vec2 r2 = b2Mul(b2Mat22(a2), m_localAnchor2 - m_localCenter2);
 
-		b2Vec2 C = b2->m_sweep.c + r2 - b1->m_sweep.c - r1;
+		b2Vec2 C = c2 + r2 - c1 - r1;
 		positionError = C.Length();
 
-		float32 invMass1 = b1->m_invMass, invMass2 = b2->m_invMass;
-		float32 invI1 = b1->m_invI, invI2 = b2->m_invI;
+		float32 invMass1 = m_invMass1, invMass2 = m_invMass2;
+		float32 invI1 = m_invI1, invI2 = m_invI2;
 
 		// Handle large detachment.
 		const float32 k_allowedStretch = 10.0f * b2_linearSlop;
@@ -342,10 +361,10 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 			float32 m = 1.0f / k;
 			b2Vec2 impulse = m * (-C);
 			const float32 k_beta = 0.5f;
-			b1->m_sweep.c -= k_beta * invMass1 * impulse;
-			b2->m_sweep.c += k_beta * invMass2 * impulse;
+			c1 -= k_beta * invMass1 * impulse;
+			c2 += k_beta * invMass2 * impulse;
 
-			C = b2->m_sweep.c + r2 - b1->m_sweep.c - r1;
+			C = c2 + r2 - c1 - r1;
 		}
 
 		b2Mat22 K1;
@@ -363,15 +382,17 @@ bool b2RevoluteJoint::SolvePositionConstraints(float32 baumgarte)
 		b2Mat22 K = K1 + K2 + K3;
 		b2Vec2 impulse = K.Solve(-C);
 
-		b1->m_sweep.c -= b1->m_invMass * impulse;
-		b1->m_sweep.a -= b1->m_invI * b2Cross(r1, impulse);
-
-		b2->m_sweep.c += b2->m_invMass * impulse;
-		b2->m_sweep.a += b2->m_invI * b2Cross(r2, impulse);
+		c1 -= invMass1 * impulse;
+		a1 -= invI1 * b2Cross(r1, impulse);
 
-		b1->SynchronizeTransform();
-		b2->SynchronizeTransform();
+		c2 += invMass2 * impulse;
+		a2 += invI2 * b2Cross(r2, impulse);
 	}
+
+	data.positions[m_index1].x = c1;
+	data.positions[m_index1].a = a1;
+	data.positions[m_index2].x = c2;
+	data.positions[m_index2].a = a2;
 	
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -472,3 +493,39 @@ void b2RevoluteJoint::SetLimits(float32 lower, float32 upper)
 	m_lowerAngle = lower;
 	m_upperAngle = upper;
 }
+
+void b2RevoluteJoint::WriteState(b2SnapshotWriter* writer) const
+{
+	writer->WriteVec2(m_localAnchor1);
+	writer->WriteVec2(m_localAnchor2);
+	writer->WriteFloat32(m_referenceAngle);
+	writer->WriteFloat32(m_impulse.x);
+	writer->WriteFloat32(m_impulse.y);
+	writer->WriteFloat32(m_impulse.z);
+	writer->WriteFloat32(m_motorImpulse);
+	writer->WriteBool(m_enableMotor);
+	writer->WriteFloat32(m_maxMotorTorque);
+	writer->WriteFloat32(m_motorSpeed);
+	writer->WriteBool(m_enableLimit);
+	writer->WriteFloat32(m_lowerAngle);
+	writer->WriteFloat32(m_upperAngle);
+	writer->WriteInt32((int32)m_limitState);
+}
+
+void b2RevoluteJoint::ReadState(b2SnapshotReader* reader)
+{
+	m_localAnchor1 = reader->ReadVec2();
+	m_localAnchor2 = reader->ReadVec2();
+	m_referenceAngle = reader->ReadFloat32();
+	m_impulse.x = reader->ReadFloat32();
+	m_impulse.y = reader->ReadFloat32();
+	m_impulse.z = reader->ReadFloat32();
+	m_motorImpulse = reader->ReadFloat32();
+	m_enableMotor = reader->ReadBool();
+	m_maxMotorTorque = reader->ReadFloat32();
+	m_motorSpeed = reader->ReadFloat32();
+	m_enableLimit = reader->ReadBool();
+	m_lowerAngle = reader->ReadFloat32();
+	m_upperAngle = reader->ReadFloat32();
+	m_limitState = (b2LimitState)reader->ReadInt32();
+}
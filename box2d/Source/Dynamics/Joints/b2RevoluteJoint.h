@@ -138,13 +138,18 @@ public:
 	//--------------- Internals Below -------------------
 	b2RevoluteJoint(const b2RevoluteJointDef* def);
 
-	void InitVelocityConstraints(const b2TimeStep& step);
-	void SolveVelocityConstraints(const b2TimeStep& step);
+	void InitVelocityConstraints(const b2SolverData& data);
+	void SolveVelocityConstraints(const b2SolverData& data);
 
-	bool SolvePositionConstraints(float32 baumgarte);
+	bool SolvePositionConstraints(const b2SolverData& data, float32 baumgarte);
+
+	void WriteState(b2SnapshotWriter* writer) const;
+
+	void ReadState(b2SnapshotReader* reader);
 
 	b2Vec2 m_localAnchor1;	// relative
 	b2Vec2 m_localAnchor2;
+	b2Vec2 m_r1, m_r2;
 	b2Vec3 m_impulse;
 	float32 m_motorImpulse;
 
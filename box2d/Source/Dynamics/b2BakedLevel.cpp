@@ -0,0 +1,553 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2BakedLevel.h"
+#include "b2World.h"
+#include "b2Body.h"
+#include "b2Fixture.h"
+#include "../Collision/b2BroadPhase.h"
+#include "../Collision/Shapes/b2CircleShape.h"
+#include "../Collision/Shapes/b2PolygonShape.h"
+#include "../Collision/Shapes/b2EdgeShape.h"
+
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+static const int32 b2_bakedLevelMagic = 0x62324c56;
+static const int32 b2_bakedLevelVersion = 1;
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+static const int32 b2_bakedLevelMathType = 1;
+#else
+static const int32 b2_bakedLevelMathType = 0;
+#endif
+
+// Maps an edge shape to its index in the level.
+struct b2BakedEdgeKey
+{
+	const b2EdgeShape* edge;
+	int32 index;
+};
+
+// Edges are unique, so the keys have a total order.
+static int b2CompareBakedEdgeKeys(const void* a, const void* b)
+{
+	const b2BakedEdgeKey* keyA = (const b2BakedEdgeKey*)a;
+	const b2BakedEdgeKey* keyB = (const b2BakedEdgeKey*)b;
+	if (keyA->edge < keyB->edge)
+	{
+		return -1;
+	}
+	return keyA->edge > keyB->edge ? 1 : 0;
+}
+
+static int32 b2FindBakedEdge(const b2BakedEdgeKey* keys, int32 count, const b2EdgeShape* edge)
+{
+	if (edge == NULL)
+	{
+		return -1;
+	}
+
+	b2BakedEdgeKey key;
+	key.edge = edge;
+	key.index = -1;
+	const b2BakedEdgeKey* k = (const b2BakedEdgeKey*)bsearch(&key, keys, count, sizeof(b2BakedEdgeKey), b2CompareBakedEdgeKeys);
+	return k != NULL ? k->index : -1;
+}
+
+static bool b2ShouldBake(b2World* world, b2Body* body, bool staticOnly)
+{
+	return body != world->GetGroundBody() && (staticOnly == false || body->IsStatic());
+}
+
+int32 b2BakeLevel(b2World* world, void* buffer, int32 capacity, bool staticOnly)
+{
+	// Collect the bodies tail first, so loading them by prepending restores the list order.
+	int32 bodyCount = 0;
+	b2Body** sourceBodies = (b2Body**)b2Alloc(world->GetBodyCount() * sizeof(b2Body*));
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b2ShouldBake(world, b, staticOnly))
+		{
+			sourceBodies[bodyCount++] = b;
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount / 2; ++i)
+	{
+		b2Body* b = sourceBodies[i];
+		sourceBodies[i] = sourceBodies[bodyCount - 1 - i];
+		sourceBodies[bodyCount - 1 - i] = b;
+	}
+
+	// Count the shapes to lay out the arrays.
+	int32 fixtureCount = 0;
+	int32 circleCount = 0, polygonCount = 0, edgeCount = 0;
+	for (int32 bodyIndex = 0; bodyIndex < bodyCount; ++bodyIndex)
+	{
+		b2Body* b = sourceBodies[bodyIndex];
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			++fixtureCount;
+			switch (f->GetType())
+			{
+			case b2_circleShape:
+				++circleCount;
+				break;
+
+			case b2_polygonShape:
+				++polygonCount;
+				break;
+
+			case b2_edgeShape:
+				++edgeCount;
+				break;
+
+			default:
+				b2Assert(false);
+				break;
+			}
+		}
+	}
+
+	b2BakedLevelHeader header;
+	header.magic = b2_bakedLevelMagic;
+	header.version = b2_bakedLevelVersion;
+	header.mathType = b2_bakedLevelMathType;
+	header.bodyCount = bodyCount;
+	header.bodyOffset = sizeof(b2BakedLevelHeader);
+	header.fixtureCount = fixtureCount;
+	header.fixtureOffset = header.bodyOffset + bodyCount * sizeof(b2BakedBody);
+	header.circleCount = circleCount;
+	header.circleOffset = header.fixtureOffset + fixtureCount * sizeof(b2BakedFixture);
+	header.polygonCount = polygonCount;
+	header.polygonOffset = header.circleOffset + circleCount * sizeof(b2BakedCircle);
+	header.edgeCount = edgeCount;
+	header.edgeOffset = header.polygonOffset + polygonCount * sizeof(b2BakedPolygon);
+	header.size = header.edgeOffset + edgeCount * sizeof(b2BakedEdge);
+
+	if (buffer == NULL || capacity < header.size)
+	{
+		b2Free(sourceBodies);
+		return header.size;
+	}
+
+	uint8* data = (uint8*)buffer;
+	memcpy(data, &header, sizeof(header));
+	b2BakedBody* bodies = (b2BakedBody*)(data + header.bodyOffset);
+	b2BakedFixture* fixtures = (b2BakedFixture*)(data + header.fixtureOffset);
+	b2BakedCircle* circles = (b2BakedCircle*)(data + header.circleOffset);
+	b2BakedPolygon* polygons = (b2BakedPolygon*)(data + header.polygonOffset);
+	b2BakedEdge* edges = (b2BakedEdge*)(data + header.edgeOffset);
+
+	// Edge neighbours are pointers, look them up once all edges are numbered.
+	b2BakedEdgeKey* edgeKeys = (b2BakedEdgeKey*)b2Alloc(edgeCount * sizeof(b2BakedEdgeKey));
+	const b2EdgeShape** edgeShapes = (const b2EdgeShape**)b2Alloc(edgeCount * sizeof(b2EdgeShape*));
+
+	int32 fixtureIndex = 0;
+	int32 circleIndex = 0, polygonIndex = 0, edgeIndex = 0;
+	for (int32 bodyIndex = 0; bodyIndex < bodyCount; ++bodyIndex)
+	{
+		b2Body* b = sourceBodies[bodyIndex];
+		b2BakedBody* bb = bodies + bodyIndex;
+		bb->position = b->GetPosition();
+		bb->angle = b->GetAngle();
+		bb->massData.mass = b->GetMass();
+		bb->massData.center = b->GetLocalCenter();
+		bb->massData.I = b->GetInertia();
+		bb->linearDamping = b->GetLinearDamping();
+		bb->angularDamping = b->GetAngularDamping();
+		bb->flags = 0;
+		if (b->IsAllowSleeping())
+		{
+			bb->flags |= b2BakedBody::e_allowSleep;
+		}
+		if (b->IsFixedRotation())
+		{
+			bb->flags |= b2BakedBody::e_fixedRotation;
+		}
+		if (b->IsBullet())
+		{
+			bb->flags |= b2BakedBody::e_bullet;
+		}
+		bb->fixtureStart = fixtureIndex;
+		bb->fixtureCount = 0;
+
+		// The world prepends fixtures, so bake them tail first to load them in the same order.
+		int32 count = 0;
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			++count;
+		}
+		bb->fixtureCount = count;
+
+		int32 i = fixtureIndex + count;
+		for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+		{
+			b2BakedFixture* bf = fixtures + --i;
+			bf->type = f->GetType();
+			bf->friction = f->GetFriction();
+			bf->restitution = f->GetRestitution();
+			bf->density = f->GetDensity();
+			bf->categoryBits = f->GetFilterData().categoryBits;
+			bf->maskBits = f->GetFilterData().maskBits;
+			bf->groupIndex = f->GetFilterData().groupIndex;
+			bf->isSensor = f->IsSensor() ? 1 : 0;
+			f->GetShape()->ComputeAABB(&bf->aabb, b->GetXForm());
+
+			switch (f->GetType())
+			{
+			case b2_circleShape:
+				{
+					const b2CircleShape* circle = (const b2CircleShape*)f->GetShape();
+					b2BakedCircle* bc = circles + circleIndex;
+					bc->p = circle->m_p;
+					bc->radius = circle->m_radius;
+					bf->shapeIndex = circleIndex++;
+				}
+				break;
+
+			case b2_polygonShape:
+				{
+					const b2PolygonShape* polygon = (const b2PolygonShape*)f->GetShape();
+					b2BakedPolygon* bp = polygons + polygonIndex;
+					bp->centroid = polygon->m_centroid;
+					bp->vertexCount = polygon->m_vertexCount;
+					for (int32 k = 0; k < polygon->m_vertexCount; ++k)
+					{
+						bp->vertices[k] = polygon->m_vertices[k];
+						bp->normals[k] = polygon->m_normals[k];
+					}
+
+					// Zero the unused slots so the baked bytes are deterministic.
+					for (int32 k = polygon->m_vertexCount; k < b2_maxPolygonVertices; ++k)
+					{
+						bp->vertices[k].SetZero();
+						bp->normals[k].SetZero();
+					}
+					bf->shapeIndex = polygonIndex++;
+				}
+				break;
+
+			case b2_edgeShape:
+				{
+					const b2EdgeShape* edge = (const b2EdgeShape*)f->GetShape();
+					b2BakedEdge* be = edges + edgeIndex;
+					be->v1 = edge->m_v1;
+					be->v2 = edge->m_v2;
+					be->normal = edge->m_normal;
+					be->direction = edge->m_direction;
+					be->length = edge->m_length;
+					be->cornerDir1 = edge->m_cornerDir1;
+					be->cornerDir2 = edge->m_cornerDir2;
+					be->cornerConvex1 = edge->m_cornerConvex1 ? 1 : 0;
+					be->cornerConvex2 = edge->m_cornerConvex2 ? 1 : 0;
+					edgeKeys[edgeIndex].edge = edge;
+					edgeKeys[edgeIndex].index = edgeIndex;
+					edgeShapes[edgeIndex] = edge;
+					bf->shapeIndex = edgeIndex++;
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		fixtureIndex += count;
+	}
+
+	qsort(edgeKeys, edgeCount, sizeof(b2BakedEdgeKey), b2CompareBakedEdgeKeys);
+	for (int32 i = 0; i < edgeCount; ++i)
+	{
+		edges[i].prevEdge = b2FindBakedEdge(edgeKeys, edgeCount, edgeShapes[i]->m_prevEdge);
+		edges[i].nextEdge = b2FindBakedEdge(edgeKeys, edgeCount, edgeShapes[i]->m_nextEdge);
+	}
+
+	b2Free(edgeShapes);
+	b2Free(edgeKeys);
+	b2Free(sourceBodies);
+
+	return header.size;
+}
+
+static bool b2IsValidSection(const b2BakedLevelHeader* header, int32 count, int32 offset, int32 elementSize)
+{
+	return count >= 0 && offset >= (int32)sizeof(b2BakedLevelHeader) && (offset & 3) == 0 &&
+		offset <= header->size && count <= (header->size - offset) / elementSize;
+}
+
+bool b2IsValidBakedLevel(const void* level, int32 size)
+{
+	if (level == NULL || size < (int32)sizeof(b2BakedLevelHeader))
+	{
+		return false;
+	}
+
+	const b2BakedLevelHeader* header = (const b2BakedLevelHeader*)level;
+	if (header->magic != b2_bakedLevelMagic ||
+		header->version != b2_bakedLevelVersion ||
+		header->mathType != b2_bakedLevelMathType ||
+		header->size > size)
+	{
+		return false;
+	}
+
+	if (b2IsValidSection(header, header->bodyCount, header->bodyOffset, sizeof(b2BakedBody)) == false ||
+		b2IsValidSection(header, header->fixtureCount, header->fixtureOffset, sizeof(b2BakedFixture)) == false ||
+		b2IsValidSection(header, header->circleCount, header->circleOffset, sizeof(b2BakedCircle)) == false ||
+		b2IsValidSection(header, header->polygonCount, header->polygonOffset, sizeof(b2BakedPolygon)) == false ||
+		b2IsValidSection(header, header->edgeCount, header->edgeOffset, sizeof(b2BakedEdge)) == false)
+	{
+		return false;
+	}
+
+	// Check the indices, so loading needs no checks.
+	const uint8* data = (const uint8*)level;
+	const b2BakedBody* bodies = (const b2BakedBody*)(data + header->bodyOffset);
+	for (int32 i = 0; i < header->bodyCount; ++i)
+	{
+		const b2BakedBody* bb = bodies + i;
+		if (bb->fixtureStart < 0 || bb->fixtureCount < 0 || bb->fixtureStart > header->fixtureCount - bb->fixtureCount)
+		{
+			return false;
+		}
+	}
+
+	const b2BakedFixture* fixtures = (const b2BakedFixture*)(data + header->fixtureOffset);
+	for (int32 i = 0; i < header->fixtureCount; ++i)
+	{
+		const b2BakedFixture* bf = fixtures + i;
+		int32 shapeCount;
+		switch (bf->type)
+		{
+		case b2_circleShape:
+			shapeCount = header->circleCount;
+			break;
+
+		case b2_polygonShape:
+			shapeCount = header->polygonCount;
+			break;
+
+		case b2_edgeShape:
+			shapeCount = header->edgeCount;
+			break;
+
+		default:
+			return false;
+		}
+
+		if (bf->shapeIndex < 0 || bf->shapeIndex >= shapeCount)
+		{
+			return false;
+		}
+	}
+
+	const b2BakedPolygon* polygons = (const b2BakedPolygon*)(data + header->polygonOffset);
+	for (int32 i = 0; i < header->polygonCount; ++i)
+	{
+		if (polygons[i].vertexCount < 3 || polygons[i].vertexCount > b2_maxPolygonVertices)
+		{
+			return false;
+		}
+	}
+
+	const b2BakedEdge* edges = (const b2BakedEdge*)(data + header->edgeOffset);
+	for (int32 i = 0; i < header->edgeCount; ++i)
+	{
+		if (edges[i].prevEdge < -1 || edges[i].prevEdge >= header->edgeCount ||
+			edges[i].nextEdge < -1 || edges[i].nextEdge >= header->edgeCount)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool b2World::CreateBakedBodies(const void* level, int32 size, b2Body** bodies)
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
+	{
+		return false;
+	}
+
+	if (b2IsValidBakedLevel(level, size) == false)
+	{
+		return false;
+	}
+
+	const uint8* data = (const uint8*)level;
+	const b2BakedLevelHeader* header = (const b2BakedLevelHeader*)level;
+	const b2BakedBody* bakedBodies = (const b2BakedBody*)(data + header->bodyOffset);
+	const b2BakedFixture* bakedFixtures = (const b2BakedFixture*)(data + header->fixtureOffset);
+	const b2BakedCircle* bakedCircles = (const b2BakedCircle*)(data + header->circleOffset);
+	const b2BakedPolygon* bakedPolygons = (const b2BakedPolygon*)(data + header->polygonOffset);
+	const b2BakedEdge* bakedEdges = (const b2BakedEdge*)(data + header->edgeOffset);
+
+	m_blockAllocator.Reserve(sizeof(b2Body), header->bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2Fixture), header->fixtureCount);
+	m_blockAllocator.Reserve(sizeof(b2CircleShape), header->circleCount);
+	m_blockAllocator.Reserve(sizeof(b2PolygonShape), header->polygonCount);
+	m_blockAllocator.Reserve(sizeof(b2EdgeShape), header->edgeCount);
+
+	int32 fixtureCount = header->fixtureCount;
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(fixtureCount * sizeof(b2AABB));
+	void** proxyFixtures = (void**)m_stackAllocator.Allocate(fixtureCount * sizeof(void*));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(fixtureCount * sizeof(int32));
+	b2EdgeShape** edges = (b2EdgeShape**)m_stackAllocator.Allocate(header->edgeCount * sizeof(b2EdgeShape*));
+	memset(edges, 0, header->edgeCount * sizeof(b2EdgeShape*));
+	int32 proxyCount = 0;
+
+	for (int32 i = 0; i < header->bodyCount; ++i)
+	{
+		const b2BakedBody* bb = bakedBodies + i;
+
+		// The body computes its type and inverse mass from the baked mass.
+		b2BodyDef bd;
+		bd.position = bb->position;
+		bd.angle = bb->angle;
+		bd.massData = bb->massData;
+		bd.linearDamping = bb->linearDamping;
+		bd.angularDamping = bb->angularDamping;
+		bd.allowSleep = (bb->flags & b2BakedBody::e_allowSleep) != 0;
+		bd.fixedRotation = (bb->flags & b2BakedBody::e_fixedRotation) != 0;
+		bd.isBullet = (bb->flags & b2BakedBody::e_bullet) != 0;
+
+		b2Body* b = CreateBody(&bd);
+		if (bodies)
+		{
+			bodies[i] = b;
+		}
+
+		for (int32 j = 0; j < bb->fixtureCount; ++j)
+		{
+			const b2BakedFixture* bf = bakedFixtures + bb->fixtureStart + j;
+
+			void* mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* fixture = new (mem) b2Fixture;
+			fixture->m_type = (b2ShapeType)bf->type;
+			fixture->m_body = b;
+			fixture->m_userData = NULL;
+			fixture->m_friction = bf->friction;
+			fixture->m_restitution = bf->restitution;
+			fixture->m_density = bf->density;
+			fixture->m_filter.categoryBits = (uint16)bf->categoryBits;
+			fixture->m_filter.maskBits = (uint16)bf->maskBits;
+			fixture->m_filter.groupIndex = (int16)bf->groupIndex;
+			fixture->m_isSensor = bf->isSensor != 0;
+			fixture->m_proxyId = b2_nullProxy;
+
+			switch (bf->type)
+			{
+			case b2_circleShape:
+				{
+					const b2BakedCircle* bc = bakedCircles + bf->shapeIndex;
+					void* shapeMem = m_blockAllocator.Allocate(sizeof(b2CircleShape));
+					b2CircleShape* circle = new (shapeMem) b2CircleShape;
+					circle->m_p = bc->p;
+					circle->m_radius = bc->radius;
+					fixture->m_shape = circle;
+				}
+				break;
+
+			case b2_polygonShape:
+				{
+					const b2BakedPolygon* bp = bakedPolygons + bf->shapeIndex;
+					void* shapeMem = m_blockAllocator.Allocate(sizeof(b2PolygonShape));
+					b2PolygonShape* polygon = new (shapeMem) b2PolygonShape;
+					polygon->m_centroid = bp->centroid;
+					polygon->m_vertexCount = bp->vertexCount;
+					for (int32 k = 0; k < bp->vertexCount; ++k)
+					{
+						polygon->m_vertices[k] = bp->vertices[k];
+						polygon->m_normals[k] = bp->normals[k];
+					}
+					fixture->m_shape = polygon;
+				}
+				break;
+
+			default:
+				{
+					const b2BakedEdge* be = bakedEdges + bf->shapeIndex;
+					void* shapeMem = m_blockAllocator.Allocate(sizeof(b2EdgeShape));
+					b2EdgeShape* edge = new (shapeMem) b2EdgeShape;
+					edge->m_v1 = be->v1;
+					edge->m_v2 = be->v2;
+					edge->m_normal = be->normal;
+					edge->m_direction = be->direction;
+					edge->m_length = be->length;
+					edge->m_cornerDir1 = be->cornerDir1;
+					edge->m_cornerDir2 = be->cornerDir2;
+					edge->m_cornerConvex1 = be->cornerConvex1 != 0;
+					edge->m_cornerConvex2 = be->cornerConvex2 != 0;
+					edges[bf->shapeIndex] = edge;
+					fixture->m_shape = edge;
+				}
+				break;
+			}
+
+			fixture->m_index = b->m_fixtureCount;
+			fixture->m_next = b->m_fixtureList;
+			b->m_fixtureList = fixture;
+			++b->m_fixtureCount;
+
+			// You are creating a shape outside the world box.
+			bool inRange = m_broadPhase->InRange(bf->aabb);
+			b2Assert(inRange);
+
+			if (inRange)
+			{
+				aabbs[proxyCount] = bf->aabb;
+				proxyFixtures[proxyCount] = fixture;
+				++proxyCount;
+			}
+		}
+	}
+
+	// Link the edge chains.
+	for (int32 i = 0; i < header->edgeCount; ++i)
+	{
+		b2EdgeShape* edge = edges[i];
+		if (edge == NULL)
+		{
+			continue;
+		}
+
+		int32 prev = bakedEdges[i].prevEdge;
+		int32 next = bakedEdges[i].nextEdge;
+		edge->m_prevEdge = prev >= 0 ? edges[prev] : NULL;
+		edge->m_nextEdge = next >= 0 ? edges[next] : NULL;
+	}
+
+	m_broadPhase->CreateProxies(aabbs, proxyFixtures, proxyCount, proxyIds);
+
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		((b2Fixture*)proxyFixtures[i])->m_proxyId = proxyIds[i];
+	}
+
+	m_stackAllocator.Free(edges);
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(proxyFixtures);
+	m_stackAllocator.Free(aabbs);
+
+	return true;
+}
@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_BAKED_LEVEL_H
+#define B2_BAKED_LEVEL_H
+
+#include "../Common/b2Math.h"
+#include "../Collision/b2Collision.h"
+#include "../Collision/Shapes/b2Shape.h"
+
+class b2World;
+
+/// A baked level holds bodies with the shape data already computed: polygon
+/// normals and centroids, edge directions and corners, body mass and the
+/// AABB of every fixture. Loading it with b2World::CreateBakedBodies copies
+/// that data into the shapes and builds the broad-phase in one pass, without
+/// the convexity checks and mass computation of CreateFixture.
+///
+/// The level is a header followed by arrays of the structs below, at byte
+/// offsets from the start of the level. Everything is 4 byte values in native
+/// byte order, so a level file can be memory mapped and loaded in place. It
+/// can only be loaded by a build with the same math type.
+struct b2BakedLevelHeader
+{
+	int32 magic;
+	int32 version;
+	int32 mathType;
+
+	/// The size of the level in bytes.
+	int32 size;
+
+	int32 bodyCount;
+	int32 bodyOffset;
+	int32 fixtureCount;
+	int32 fixtureOffset;
+	int32 circleCount;
+	int32 circleOffset;
+	int32 polygonCount;
+	int32 polygonOffset;
+	int32 edgeCount;
+	int32 edgeOffset;
+};
+
+/// A body and the range of its fixtures.
+struct b2BakedBody
+{
+	enum
+	{
+		e_allowSleep		= 0x0001,
+		e_fixedRotation		= 0x0002,
+		e_bullet			= 0x0004,
+	};
+
+	b2Vec2 position;
+	float32 angle;
+	b2MassData massData;
+	float32 linearDamping;
+	float32 angularDamping;
+	int32 flags;
+	int32 fixtureStart;
+	int32 fixtureCount;
+};
+
+/// A fixture. The shape is an index into the array of its type. The AABB is
+/// in world coordinates at the baked body position.
+struct b2BakedFixture
+{
+	int32 type;
+	int32 shapeIndex;
+	float32 friction;
+	float32 restitution;
+	float32 density;
+	int32 categoryBits;
+	int32 maskBits;
+	int32 groupIndex;
+	int32 isSensor;
+	b2AABB aabb;
+};
+
+struct b2BakedCircle
+{
+	b2Vec2 p;
+	float32 radius;
+};
+
+/// The vertices, normals and centroid as computed by b2PolygonShape::Set.
+struct b2BakedPolygon
+{
+	b2Vec2 centroid;
+	b2Vec2 vertices[b2_maxPolygonVertices];
+	b2Vec2 normals[b2_maxPolygonVertices];
+	int32 vertexCount;
+};
+
+/// An edge with its corners. The neighbours are indices into the edge array,
+/// or -1.
+struct b2BakedEdge
+{
+	b2Vec2 v1, v2;
+	b2Vec2 normal;
+	b2Vec2 direction;
+	float32 length;
+	b2Vec2 cornerDir1, cornerDir2;
+	int32 cornerConvex1, cornerConvex2;
+	int32 prevEdge, nextEdge;
+};
+
+/// Bake the bodies of a world into a level, for example after building it from
+/// b2CreateEdgeChain and convex decomposition in a tool. The ground body is
+/// skipped. Joints, velocities and user data are not baked.
+/// @param buffer the buffer, may be NULL to get the size.
+/// @param capacity the size of the buffer in bytes.
+/// @param staticOnly only bake the static bodies.
+/// @return the size of the level in bytes. Nothing was written if this is
+/// larger than capacity.
+int32 b2BakeLevel(b2World* world, void* buffer, int32 capacity, bool staticOnly);
+
+/// Check the header and the array bounds of a baked level.
+bool b2IsValidBakedLevel(const void* level, int32 size);
+
+#endif
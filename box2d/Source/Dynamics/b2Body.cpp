@@ -19,6 +19,7 @@
 #include "b2Body.h"
 #include "b2Fixture.h"
 #include "b2World.h"
+#include "b2IslandManager.h"
 #include "Controllers/b2Controller.h"
 #include "Joints/b2Joint.h"
 
@@ -59,6 +60,12 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_prev = NULL;
 	m_next = NULL;
 
+	m_islandIndex = 0;
+	m_index = -1;
+	m_island = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+
 	m_linearVelocity = bd->linearVelocity;
 	m_angularVelocity = bd->angularVelocity;
 
@@ -120,6 +127,7 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 	b2Fixture* fixture = new (mem) b2Fixture;
 	fixture->Create(allocator, broadPhase, this, m_xf, def);
 
+	fixture->m_index = m_fixtureCount;
 	fixture->m_next = m_fixtureList;
 	m_fixtureList = fixture;
 	++m_fixtureCount;
@@ -133,7 +141,8 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 {
 	b2Assert(fixture->m_body == this);
 
-	// Remove the fixture from this body's singly linked list.
+	// Remove the fixture from this body's singly linked list. The fixtures in
+	// front of it were created later and move down one index.
 	b2Assert(m_fixtureCount > 0);
 	b2Fixture** node = &m_fixtureList;
 	bool found = false;
@@ -146,6 +155,7 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 			break;
 		}
 
+		--(*node)->m_index;
 		node = &(*node)->m_next;
 	}
 
@@ -206,6 +216,8 @@ void b2Body::SetMassData(const b2MassData* massData)
 		{
 			f->RefilterProxy(m_world->m_broadPhase, m_xf);
 		}
+
+		m_world->m_islandManager.UpdateBody(this);
 	}
 }
 
@@ -269,6 +281,8 @@ void b2Body::SetMassFromShapes()
 		{
 			f->RefilterProxy(m_world->m_broadPhase, m_xf);
 		}
+
+		m_world->m_islandManager.UpdateBody(this);
 	}
 }
 
@@ -289,6 +303,8 @@ void b2Body::SetStatic()
 	{
 		f->RefilterProxy(m_world->m_broadPhase, m_xf);
 	}
+
+	m_world->m_islandManager.UpdateBody(this);
 }
 
 bool b2Body::IsConnected(const b2Body* other) const
@@ -334,6 +350,7 @@ bool b2Body::SetXForm(const b2Vec2& position, float32 angle)
 		m_flags |= e_frozenFlag;
 		m_linearVelocity.SetZero();
 		m_angularVelocity = 0.0f;
+		m_world->m_islandManager.RemoveBody(this);
 
 		// Failure
 		return false;
@@ -341,6 +358,7 @@ bool b2Body::SetXForm(const b2Vec2& position, float32 angle)
 
 	// Success
 	m_world->m_broadPhase->Commit();
+	m_world->m_contactManager.SortNewContacts();
 	return true;
 }
 
@@ -365,6 +383,7 @@ bool b2Body::SynchronizeFixtures()
 		m_flags |= e_frozenFlag;
 		m_linearVelocity.SetZero();
 		m_angularVelocity = 0.0f;
+		m_world->m_islandManager.RemoveBody(this);
 
 		// Failure
 		return false;
@@ -373,3 +392,15 @@ bool b2Body::SynchronizeFixtures()
 	// Success
 	return true;
 }
+
+void b2Body::WakeUp()
+{
+	m_flags &= ~e_sleepFlag;
+	m_sleepTime = 0.0f;
+
+	// The whole island wakes up with this body.
+	if (m_island && m_island->awake == false)
+	{
+		m_world->m_islandManager.WakeIsland(m_island);
+	}
+}
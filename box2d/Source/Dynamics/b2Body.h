@@ -33,6 +33,7 @@ struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
 struct b2ControllerEdge;
+struct b2PersistentIsland;
 
 /// A body definition holds all the data needed to construct a rigid body.
 /// You can safely re-use body definitions.
@@ -339,10 +340,15 @@ public:
 	/// Get the parent world of this body.
 	b2World* GetWorld();
 
+	/// Get the index of this body. It doesn't change while the body exists and
+	/// is reused after the body is destroyed. See b2World::GetBodyStates.
+	int32 GetIndex() const;
+
 private:
 
 	friend class b2World;
 	friend class b2Island;
+	friend class b2IslandManager;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
 	
@@ -394,6 +400,14 @@ private:
 
 	int32 m_islandIndex;
 
+	// Stable index for b2World::GetBodyStates.
+	int32 m_index;
+
+	// The persistent island of this body, NULL for static and frozen bodies.
+	b2PersistentIsland* m_island;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
 	b2XForm m_xf;		// the body origin transform
 	b2Sweep m_sweep;	// the swept motion for CCD
 
@@ -426,6 +440,11 @@ private:
 	void* m_userData;
 };
 
+inline int32 b2Body::GetIndex() const
+{
+	return m_index;
+}
+
 inline const b2XForm& b2Body::GetXForm() const
 {
 	return m_xf;
@@ -636,12 +655,6 @@ inline void b2Body::AllowSleeping(bool flag)
 	}
 }
 
-inline void b2Body::WakeUp()
-{
-	m_flags &= ~e_sleepFlag;
-	m_sleepTime = 0.0f;
-}
-
 inline void b2Body::PutToSleep()
 {
 	m_flags |= e_sleepFlag;
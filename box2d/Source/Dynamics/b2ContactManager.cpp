@@ -21,6 +21,9 @@
 #include "b2Body.h"
 #include "b2Fixture.h"
 
+#include <cstdlib>
+#include <cstring>
+
 // This is a callback from the broad-phase when two AABB proxies begin
 // to overlap. We create a b2Contact to manage the narrow phase.
 void* b2ContactManager::PairAdded(void* proxyUserDataA, void* proxyUserDataB)
@@ -51,6 +54,13 @@ void* b2ContactManager::PairAdded(void* proxyUserDataA, void* proxyUserDataB)
 		return &m_nullContact;
 	}
 
+	// The broad-phase reports a pair in proxy order. Use the fixture ids instead, so
+	// fixtures of the same shape type always end up in the same contact order.
+	if (m_world->m_deterministic && FixtureIdLess(fixtureB, fixtureA))
+	{
+		b2Swap(fixtureA, fixtureB);
+	}
+
 	// Call the factory.
 	b2Contact* c = b2Contact::Create(fixtureA, fixtureB, &m_world->m_blockAllocator);
 
@@ -66,15 +76,10 @@ void* b2ContactManager::PairAdded(void* proxyUserDataA, void* proxyUserDataB)
 	bodyB = fixtureB->GetBody();
 
 	// Insert into the world.
-	c->m_prev = NULL;
-	c->m_next = m_world->m_contactList;
-	if (m_world->m_contactList != NULL)
-	{
-		m_world->m_contactList->m_prev = c;
-	}
-	m_world->m_contactList = c;
+	AddContact(c);
 
 	// Connect to island graph.
+	c->m_stamp = m_stamp++;
 
 	// Connect to body A
 	c->m_nodeA.contact = c;
@@ -100,7 +105,21 @@ void* b2ContactManager::PairAdded(void* proxyUserDataA, void* proxyUserDataB)
 	}
 	bodyB->m_contactList = &c->m_nodeB;
 
-	++m_world->m_contactCount;
+	// Remember the contact so SortNewContacts can put it in id order.
+	if (m_world->m_deterministic)
+	{
+		if (m_newContactCount == m_newContactCapacity)
+		{
+			b2Contact** oldContacts = m_newContacts;
+			m_newContactCapacity = b2Max(2 * m_newContactCapacity, 16);
+			m_newContacts = (b2Contact**)b2Alloc(m_newContactCapacity * sizeof(b2Contact*));
+			memcpy(m_newContacts, oldContacts, m_newContactCount * sizeof(b2Contact*));
+			b2Free(oldContacts);
+		}
+
+		m_newContacts[m_newContactCount++] = c;
+	}
+
 	return c;
 }
 
@@ -134,27 +153,33 @@ void b2ContactManager::Destroy(b2Contact* c)
 	b2Body* bodyA = fixtureA->GetBody();
 	b2Body* bodyB = fixtureB->GetBody();
 
-	if (c->m_manifold.m_pointCount > 0)
-	{
-		m_world->m_contactListener->EndContact(c);
-	}
+	// The contact may be waiting for a TOI event.
+	m_world->m_toiQueue.Remove(c);
 
-	// Remove from the world.
-	if (c->m_prev)
+	// The contact may be waiting for SortNewContacts.
+	for (int32 i = 0; i < m_newContactCount; ++i)
 	{
-		c->m_prev->m_next = c->m_next;
+		if (m_newContacts[i] == c)
+		{
+			m_newContacts[i] = m_newContacts[--m_newContactCount];
+			break;
+		}
 	}
 
-	if (c->m_next)
+	if (c->m_manifold.m_pointCount > 0)
 	{
-		c->m_next->m_prev = c->m_prev;
+		m_world->m_contactListener->EndContact(c);
 	}
 
-	if (c == m_world->m_contactList)
+	// A touching contact held the island together.
+	if ((c->m_flags & (b2Contact::e_touchFlag | b2Contact::e_nonSolidFlag)) == b2Contact::e_touchFlag)
 	{
-		m_world->m_contactList = c->m_next;
+		m_world->m_islandManager.Unlink(bodyA, bodyB);
 	}
 
+	// Remove from the world.
+	RemoveContact(c);
+
 	// Remove from body 1
 	if (c->m_nodeA.prev)
 	{
@@ -187,28 +212,118 @@ void b2ContactManager::Destroy(b2Contact* c)
 		bodyB->m_contactList = c->m_nodeB.next;
 	}
 
-	if (m_nextContact == c)
-	{
-		m_nextContact = c->GetNext();
-	}
 	// Call the factory.
 	if( c->m_flags & b2Contact::e_lockedFlag)
 	{
 		// We cannot destroy the current contact - it's being worked on.
 		// Instead mark it for deferred destruction.
 		// Collide() will handle calling Destroy slightly later
+		// Wake the bodies now, the fixtures may be freed before the contact is.
 		c->m_flags |= b2Contact::e_destroyFlag;
+		if (c->m_manifold.m_pointCount > 0)
+		{
+			bodyA->WakeUp();
+			bodyB->WakeUp();
+		}
 
 		// Also do some cleaning up so that people don't accidentally do stupid things.
         // TODO: Is this necessary or wise?
 		//c->m_fixtureA = NULL;
 		//c->m_fixtureB = NULL;
-		c->m_next = NULL;
-		c->m_prev = NULL;
 	}else{
 		b2Contact::Destroy(c, &m_world->m_blockAllocator);
 	}
-	--m_world->m_contactCount;
+}
+
+void b2ContactManager::AddContact(b2Contact* c)
+{
+	b2World* world = m_world;
+	if (world->m_contactCount == world->m_contactCapacity)
+	{
+		b2Contact** oldContacts = world->m_contacts;
+		world->m_contactCapacity = b2Max(2 * world->m_contactCapacity, 16);
+		world->m_contacts = (b2Contact**)b2Alloc(world->m_contactCapacity * sizeof(b2Contact*));
+		memcpy(world->m_contacts, oldContacts, world->m_contactCount * sizeof(b2Contact*));
+		b2Free(oldContacts);
+	}
+
+	c->m_index = world->m_contactCount;
+	world->m_contacts[world->m_contactCount++] = c;
+}
+
+void b2ContactManager::RemoveContact(b2Contact* c)
+{
+	b2World* world = m_world;
+	int32 index = c->m_index;
+	b2Assert(0 <= index && index < world->m_contactCount && world->m_contacts[index] == c);
+
+	b2Contact* last = world->m_contacts[--world->m_contactCount];
+	world->m_contacts[index] = last;
+	last->m_index = index;
+	c->m_index = b2_nullContactIndex;
+}
+
+// The number of contacts evaluated by one scheduler task.
+const int32 b2_collideTaskSize = 64;
+
+struct b2CollideTaskContext
+{
+	b2Contact** contacts;
+	b2Manifold* oldManifolds;
+	int32 count;
+};
+
+void b2ContactManager::CollideCallback(void* context, int32 index, int32 threadIndex)
+{
+	B2_NOT_USED(threadIndex);
+
+	b2CollideTaskContext* taskContext = (b2CollideTaskContext*)context;
+	int32 begin = index * b2_collideTaskSize;
+	int32 end = b2Min(begin + b2_collideTaskSize, taskContext->count);
+
+	// Evaluate only reads the body transforms and writes the contact's own manifold.
+	for (int32 i = begin; i < end; ++i)
+	{
+		taskContext->oldManifolds[i] = taskContext->contacts[i]->m_manifold;
+	}
+
+	b2Contact::Evaluate(taskContext->contacts + begin, end - begin);
+}
+
+// Every awake body belongs to an awake island, but a solved island may put single
+// bodies to sleep while the island stays awake.
+bool b2ContactManager::IsAwakeMember(const b2Body* body)
+{
+	return body->m_island != NULL && body->m_island->awake && body->IsSleeping() == false;
+}
+
+int32 b2ContactManager::GatherAwakeContacts(b2Contact** contacts) const
+{
+	int32 count = 0;
+	for (b2PersistentIsland* island = m_world->m_islandManager.m_awakeList; island; island = island->next)
+	{
+		for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+		{
+			if (b->IsSleeping())
+			{
+				continue;
+			}
+
+			// A contact between two awake bodies is taken at body A only.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* c = ce->contact;
+				b2Body* bodyA = c->GetFixtureA()->GetBody();
+				if (bodyA == b || IsAwakeMember(bodyA) == false)
+				{
+					b2Assert(count < m_world->m_contactCount);
+					contacts[count++] = c;
+				}
+			}
+		}
+	}
+
+	return count;
 }
 
 // This is the top level collision call for the time step. Here
@@ -216,55 +331,112 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
-	// Update awake contacts.
-	// Note the use of a accessible iterator, m_nextContact, this can be updated elsewhere
-	// should that contact get deleted inside the call to m_nextContact
-	m_nextContact = m_world->m_contactList;
-	while(m_nextContact)
-	{
-		b2Contact* c  = m_nextContact;
-		m_nextContact = c->GetNext();
-		b2Body* bodyA = c->GetFixtureA()->GetBody();
-		b2Body* bodyB = c->GetFixtureB()->GetBody();
-		if (bodyA->IsSleeping() && bodyB->IsSleeping())
+	b2StackAllocator* allocator = &m_world->m_stackAllocator;
+
+	// Gather the awake contacts. They are locked so that a contact destroyed by
+	// the callbacks of an earlier contact is only marked for destruction.
+	b2Contact** contacts = (b2Contact**)allocator->Allocate(m_world->m_contactCount * sizeof(b2Contact*));
+	int32 count = GatherAwakeContacts(contacts);
+
+	// Sort the contacts by type with a counting sort, so the contacts of one
+	// type are evaluated together. The slot of a contact is its sorted index.
+	int32 offsets[b2Contact::e_contactTypeCount];
+	memset(offsets, 0, sizeof(offsets));
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Contact* c = contacts[i];
+		b2Assert((c->m_flags & b2Contact::e_lockedFlag) == 0);
+		c->m_flags |= b2Contact::e_lockedFlag;
+
+		b2Assert(0 <= c->m_type && c->m_type < b2Contact::e_contactTypeCount);
+		++offsets[c->m_type];
+	}
+
+	int32 offset = 0;
+	for (int32 i = 0; i < b2Contact::e_contactTypeCount; ++i)
+	{
+		int32 typeCount = offsets[i];
+		offsets[i] = offset;
+		offset += typeCount;
+	}
+
+	b2Contact** sorted = (b2Contact**)allocator->Allocate(count * sizeof(b2Contact*));
+	int32* slots = (int32*)allocator->Allocate(count * sizeof(int32));
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 slot = offsets[contacts[i]->m_type]++;
+		sorted[slot] = contacts[i];
+		slots[i] = slot;
+	}
+
+	b2Manifold* oldManifolds = (b2Manifold*)allocator->Allocate(count * sizeof(b2Manifold));
+
+	b2CollideTaskContext context;
+	context.contacts = sorted;
+	context.oldManifolds = oldManifolds;
+	context.count = count;
+
+	// Compute the new manifolds.
+	b2TaskScheduler* scheduler = m_world->m_taskScheduler;
+	int32 taskCount = (count + b2_collideTaskSize - 1) / b2_collideTaskSize;
+	if (scheduler != NULL && taskCount > 1)
+	{
+		scheduler->ParallelFor(CollideCallback, &context, taskCount);
+	}
+	else
+	{
+		for (int32 i = 0; i < taskCount; ++i)
 		{
-			continue;
+			CollideCallback(&context, i, 0);
 		}
+	}
 
-		Update(c);
+	// Apply the new manifolds in gather order, so the callbacks don't depend
+	// on the number of threads.
+	for (int32 i = 0; i < count; ++i)
+	{
+		Finish(contacts[i], oldManifolds[slots[i]], 0);
 	}
-    m_nextContact = NULL;
+
+	allocator->Free(oldManifolds);
+	allocator->Free(slots);
+	allocator->Free(sorted);
+	allocator->Free(contacts);
 }
 
 bool b2ContactManager::Update(b2Contact* contact)
 {
-	b2ContactListener* listener = m_world->m_contactListener;
-    
-	b2Body* bodyA = contact->m_fixtureA->GetBody();
-	b2Body* bodyB = contact->m_fixtureB->GetBody();
-    
-	b2ShapeType shapeAType = contact->m_fixtureA->GetType();
-	b2ShapeType shapeBType = contact->m_fixtureB->GetType();
-    
-    b2Manifold oldManifold = contact->m_manifold;
-    
-	uint32 oldLock = contact->m_flags & b2Contact::e_lockedFlag ;
+	b2Manifold oldManifold = contact->m_manifold;
+	uint32 oldLock = contact->m_flags & b2Contact::e_lockedFlag;
 
 	contact->m_flags |= b2Contact::e_lockedFlag;
 
 	contact->Evaluate();
-	
-	contact->m_flags &= ~b2Contact::e_invalidFlag;
 
-	if(contact->m_flags & b2Contact::e_destroyFlag)
-	{     
-		b2Contact::Destroy(contact, shapeAType, shapeBType, &m_world->m_blockAllocator);
-        return true;
+	return Finish(contact, oldManifold, oldLock);
+}
+
+bool b2ContactManager::Finish(b2Contact* contact, const b2Manifold& oldManifold, uint32 oldLock)
+{
+	// A contact destroyed while it was locked was only marked. Its fixtures and
+	// bodies may be gone already, so it must be freed before touching them.
+	if (contact->m_flags & b2Contact::e_destroyFlag)
+	{
+		b2Contact::Destroy(contact, &m_world->m_blockAllocator);
+		return true;
 	}
 
-	if(!oldLock)
-		contact->m_flags &= ~b2Contact::e_lockedFlag;
+	b2ContactListener* listener = m_world->m_contactListener;
+    
+	b2Body* bodyA = contact->m_fixtureA->GetBody();
+	b2Body* bodyB = contact->m_fixtureB->GetBody();
     
+	// Islands only follow touching solid contacts.
+	const uint32 linkMask = b2Contact::e_touchFlag | b2Contact::e_nonSolidFlag;
+	bool wasLinked = (contact->m_flags & linkMask) == b2Contact::e_touchFlag;
+	
+	contact->m_flags &= ~b2Contact::e_invalidFlag;
+
 	int32 oldCount = oldManifold.m_pointCount;
 	int32 newCount = contact->m_manifold.m_pointCount;
     
@@ -295,7 +467,7 @@ bool b2ContactManager::Update(b2Contact* contact)
 
 		for (int32 j = 0; j < oldManifold.m_pointCount; ++j)
 		{
-			b2ManifoldPoint* mp1 = oldManifold.m_points + j;
+			const b2ManifoldPoint* mp1 = oldManifold.m_points + j;
 
 			if (mp1->m_id.key == id2.key)
 			{
@@ -306,19 +478,21 @@ bool b2ContactManager::Update(b2Contact* contact)
 		}
 	}
 
+	// The contact stays locked during its own callbacks. If they destroy it, the
+	// later callbacks are skipped and it is freed below.
 	if (oldCount == 0 && newCount > 0)
 	{
 		contact->m_flags |= b2Contact::e_touchFlag;
 		listener->BeginContact(contact);
 	}
 
-	if (oldCount > 0 && newCount == 0)
+	if (oldCount > 0 && newCount == 0 && (contact->m_flags & b2Contact::e_destroyFlag) == 0)
 	{
 		contact->m_flags &= ~b2Contact::e_touchFlag;
 		listener->EndContact(contact);
 	}
 
-	if ((contact->m_flags & b2Contact::e_nonSolidFlag) == 0)
+	if ((contact->m_flags & (b2Contact::e_nonSolidFlag | b2Contact::e_destroyFlag)) == 0)
 	{
 		listener->PreSolve(contact, &oldManifold);
 
@@ -328,6 +502,151 @@ bool b2ContactManager::Update(b2Contact* contact)
 			contact->m_flags &= ~b2Contact::e_touchFlag;
 		}
 	}
+
+	// Destroy already unlinked the islands of a destroyed contact. A contact
+	// locked by the caller is freed when the caller finishes it.
+	if (contact->m_flags & b2Contact::e_destroyFlag)
+	{
+		if (oldLock)
+		{
+			return false;
+		}
+
+		b2Contact::Destroy(contact, &m_world->m_blockAllocator);
+		return true;
+	}
+
+	bool isLinked = (contact->m_flags & linkMask) == b2Contact::e_touchFlag;
+	if (isLinked && wasLinked == false)
+	{
+		m_world->m_islandManager.Link(bodyA, bodyB);
+	}
+	else if (wasLinked && isLinked == false)
+	{
+		m_world->m_islandManager.Unlink(bodyA, bodyB);
+	}
+
+	if (!oldLock)
+		contact->m_flags &= ~b2Contact::e_lockedFlag;
 	
 	return false;
 }
+
+bool b2ContactManager::FixtureIdLess(const b2Fixture* fixtureA, const b2Fixture* fixtureB)
+{
+	int32 indexA = fixtureA->m_body->m_index;
+	int32 indexB = fixtureB->m_body->m_index;
+	if (indexA != indexB)
+	{
+		return indexA < indexB;
+	}
+
+	return fixtureA->m_index < fixtureB->m_index;
+}
+
+// A fixture pair has one contact, so the order is total.
+int b2ContactManager::CompareContactIds(const void* a, const void* b)
+{
+	const b2Contact* contactA = *(const b2Contact* const*)a;
+	const b2Contact* contactB = *(const b2Contact* const*)b;
+	const b2Fixture* fixtureA = contactA->m_fixtureA;
+	const b2Fixture* fixtureB = contactB->m_fixtureA;
+	if (fixtureA == fixtureB)
+	{
+		fixtureA = contactA->m_fixtureB;
+		fixtureB = contactB->m_fixtureB;
+	}
+
+	if (fixtureA == fixtureB)
+	{
+		return 0;
+	}
+
+	return FixtureIdLess(fixtureA, fixtureB) ? -1 : 1;
+}
+
+int b2ContactManager::CompareStamps(const void* a, const void* b)
+{
+	const b2Contact* contactA = *(const b2Contact* const*)a;
+	const b2Contact* contactB = *(const b2Contact* const*)b;
+
+	// Compare the difference so the order survives the counter wrapping around.
+	int32 difference = int32(contactA->m_stamp - contactB->m_stamp);
+	if (difference < 0)
+	{
+		return -1;
+	}
+	return difference > 0 ? 1 : 0;
+}
+
+void b2ContactManager::SortNewContacts()
+{
+	if (m_newContactCount == 0)
+	{
+		return;
+	}
+
+	qsort(m_newContacts, m_newContactCount, sizeof(b2Contact*), CompareContactIds);
+
+	// Move the contacts to the front of the body lists, the largest id first.
+	for (int32 i = m_newContactCount - 1; i >= 0; --i)
+	{
+		b2Contact* c = m_newContacts[i];
+		b2Body* bodyA = c->m_fixtureA->m_body;
+		b2Body* bodyB = c->m_fixtureB->m_body;
+
+		// Remove from body 1
+		if (c->m_nodeA.prev)
+		{
+			c->m_nodeA.prev->next = c->m_nodeA.next;
+		}
+
+		if (c->m_nodeA.next)
+		{
+			c->m_nodeA.next->prev = c->m_nodeA.prev;
+		}
+
+		if (&c->m_nodeA == bodyA->m_contactList)
+		{
+			bodyA->m_contactList = c->m_nodeA.next;
+		}
+
+		// Remove from body 2
+		if (c->m_nodeB.prev)
+		{
+			c->m_nodeB.prev->next = c->m_nodeB.next;
+		}
+
+		if (c->m_nodeB.next)
+		{
+			c->m_nodeB.next->prev = c->m_nodeB.prev;
+		}
+
+		if (&c->m_nodeB == bodyB->m_contactList)
+		{
+			bodyB->m_contactList = c->m_nodeB.next;
+		}
+
+		c->m_stamp = m_stamp++;
+
+		// Insert at the front of body 1
+		c->m_nodeA.prev = NULL;
+		c->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList != NULL)
+		{
+			bodyA->m_contactList->prev = &c->m_nodeA;
+		}
+		bodyA->m_contactList = &c->m_nodeA;
+
+		// Insert at the front of body 2
+		c->m_nodeB.prev = NULL;
+		c->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList != NULL)
+		{
+			bodyB->m_contactList->prev = &c->m_nodeB;
+		}
+		bodyB->m_contactList = &c->m_nodeB;
+	}
+
+	m_newContactCount = 0;
+}
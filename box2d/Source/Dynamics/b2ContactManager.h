@@ -23,6 +23,7 @@
 #include "../Dynamics/Contacts/b2NullContact.h"
 
 class b2World;
+class b2Body;
 class b2Contact;
 struct b2TimeStep;
 
@@ -33,9 +34,14 @@ public:
 	b2ContactManager() : 
 		m_world(NULL), 
 		m_destroyImmediate(false),
-		m_nextContact(NULL)
+		m_newContacts(NULL),
+		m_newContactCount(0),
+		m_newContactCapacity(0),
+		m_stamp(0)
 		{}
 
+	~b2ContactManager() { b2Free(m_newContacts); }
+
 	// Implements PairCallback
 	void* PairAdded(void* proxyUserDataA, void* proxyUserDataB);
 
@@ -44,6 +50,22 @@ public:
 
 	void Destroy(b2Contact* c);
 
+	// Move the contacts created since the last call to the front of the body
+	// contact lists, in fixture id order. Then the list order doesn't depend on
+	// the order the broad-phase reports new pairs in. The order of the world
+	// contact array doesn't affect the simulation. Only the deterministic mode
+	// records new contacts, otherwise this does nothing.
+	void SortNewContacts();
+
+	// Store the contacts touching an awake body in the array and return their count.
+	// The awake islands are walked instead of the world contact list, so the cost
+	// grows with the activity of the world rather than its size. The array must
+	// hold the world contact count.
+	int32 GatherAwakeContacts(b2Contact** contacts) const;
+
+	// Evaluate the awake contacts in two phases. The manifolds are computed first,
+	// in type order and in parallel when the world has a task scheduler. Then the flags are updated
+	// and the listener is called on this thread in gather order.
 	void Collide();
             
 	/// Updates the contact, which includes re-evaluating it and calling user call backs.
@@ -53,15 +75,47 @@ public:
 
 private:
 	friend class b2World;
+
+	// Applies a new manifold: matches the impulses, updates the flags and islands
+	// and calls the listener.
+	// @return True if the contact has been destroyed.
+	bool Finish(b2Contact* contact, const b2Manifold& oldManifold, uint32 oldLock);
+
+	// Append the contact to the world contact array.
+	void AddContact(b2Contact* c);
+
+	// Remove the contact from the world contact array. The last contact takes its slot.
+	void RemoveContact(b2Contact* c);
+
+	static void CollideCallback(void* context, int32 index, int32 threadIndex);
+
+	// Is the body awake in an awake island?
+	static bool IsAwakeMember(const b2Body* body);
+
+	// Order fixtures by body index, then by their index in the body.
+	static bool FixtureIdLess(const b2Fixture* fixtureA, const b2Fixture* fixtureB);
+
+	// Order new contacts by their fixtures, for qsort.
+	static int CompareContactIds(const void* a, const void* b);
+
+	// Order contacts by stamp, from the back of the body lists to the front, for qsort.
+	static int CompareStamps(const void* a, const void* b);
+
 	b2World* m_world;
 
 	// This lets us provide broadphase proxy pair user data for
 	// contacts that shouldn't exist.
 	b2NullContact m_nullContact;
-    
-    b2Contact* m_nextContact;
 
 	bool m_destroyImmediate;
+
+	// The contacts created since the last sort, in the deterministic mode.
+	b2Contact** m_newContacts;
+	int32 m_newContactCount;
+	int32 m_newContactCapacity;
+
+	// The next contact stamp, see b2Contact::m_stamp.
+	uint32 m_stamp;
 };
 
 #endif
@@ -58,6 +58,7 @@ b2Fixture::b2Fixture()
 	m_userData = NULL;
 	m_body = NULL;
 	m_next = NULL;
+	m_index = 0;
 	m_proxyId = b2_nullProxy;
 	m_shape = NULL;
 }
@@ -123,6 +124,12 @@ void b2Fixture::Create(b2BlockAllocator* allocator, b2BroadPhase* broadPhase, b2
 		break;
 	}
 
+	m_proxyId = b2_nullProxy;
+	if (broadPhase == NULL)
+	{
+		return;
+	}
+
 	// Create proxy in the broad-phase.
 	b2AABB aabb;
 	m_shape->ComputeAABB(&aabb, xf);
@@ -203,7 +210,8 @@ bool b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2XForm& transform1,
 
 	if (broadPhase->InRange(aabb))
 	{
-		broadPhase->MoveProxy(m_proxyId, aabb);
+		b2Vec2 displacement = transform2.position - transform1.position;
+		broadPhase->MoveProxy(m_proxyId, aabb, displacement);
 		return true;
 	}
 	else
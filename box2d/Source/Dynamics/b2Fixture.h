@@ -246,12 +246,14 @@ protected:
 
 	friend class b2Body;
 	friend class b2World;
+	friend class b2ContactManager;
 
 	b2Fixture();
 	~b2Fixture();
 
 	// We need separation create/destroy functions from the constructor/destructor because
 	// the destructor cannot access the allocator or broad-phase (no destructor arguments allowed by C++).
+	// If broadPhase is NULL no proxy is created, so the caller can create it later.
 	void Create(b2BlockAllocator* allocator, b2BroadPhase* broadPhase, b2Body* body, const b2XForm& xf, const b2FixtureDef* def);
 	void Destroy(b2BlockAllocator* allocator, b2BroadPhase* broadPhase);
 
@@ -262,13 +264,17 @@ protected:
 	b2Fixture* m_next;
 	b2Body* m_body;
 
+	// The position in the body's fixture list counted from the tail. Together
+	// with the body index this is a stable id, used by the deterministic mode.
+	int32 m_index;
+
 	b2Shape* m_shape;
 
 	float32 m_density;
 	float32 m_friction;
 	float32 m_restitution;
 
-	uint16 m_proxyId;
+	int32 m_proxyId;
 	b2FilterData m_filter;
 
 	bool m_isSensor;
@@ -664,7 +670,7 @@ protected:
 	float32 m_friction;
 	float32 m_restitution;
 
-	uint16 m_proxyId;
+	int32 m_proxyId;
 	b2FilterData m_filter;
 
 	bool m_isSensor;
@@ -22,6 +22,7 @@
 #include "b2World.h"
 #include "Contacts/b2Contact.h"
 #include "Contacts/b2ContactSolver.h"
+#include "Contacts/b2ContactBatchSolver.h"
 #include "Joints/b2Joint.h"
 #include "../Common/b2StackAllocator.h"
 
@@ -153,9 +154,14 @@ b2Island::b2Island(
 	m_bodyCapacity = bodyCapacity;
 	m_contactCapacity = contactCapacity;
 	m_jointCapacity	 = jointCapacity;
+	m_stateCapacity = GetStateCapacity(bodyCapacity, contactCapacity, jointCapacity);
 	m_bodyCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
+	m_stateCount = 0;
+
+	m_minSleepTime = 0.0f;
+	m_maxSleepTime = 0.0f;
 
 	m_allocator = allocator;
 	m_listener = listener;
@@ -164,8 +170,8 @@ b2Island::b2Island(
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
 	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
 
-	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
-	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+	m_velocities = (b2Velocity*)m_allocator->Allocate(m_stateCapacity * sizeof(b2Velocity));
+	m_positions = (b2Position*)m_allocator->Allocate(m_stateCapacity * sizeof(b2Position));
 }
 
 b2Island::~b2Island()
@@ -178,8 +184,158 @@ b2Island::~b2Island()
 	m_allocator->Free(m_bodies);
 }
 
-void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+int32 b2Island::GetStackSize(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity, bool batching)
+{
+	int32 stateCount = GetStateCapacity(bodyCapacity, contactCapacity, jointCapacity);
+	int32 size = stateCount * (sizeof(b2Position) + sizeof(b2Velocity));
+	size += bodyCapacity * sizeof(b2Body*);
+	size += contactCapacity * (sizeof(b2Contact*) + sizeof(b2ContactConstraint));
+	size += jointCapacity * sizeof(b2Joint*);
+
+	if (batching)
+	{
+		size += b2ContactBatchSolver::GetStackSize(contactCapacity, bodyCapacity);
+	}
+
+	return size;
+}
+
+int32 b2Island::GetStateIndex(b2Body* body)
+{
+	// Static bodies are shared by islands solved in parallel, so their island
+	// index is not touched.
+	if (body->IsStatic() == false)
+	{
+		int32 index = body->m_islandIndex;
+		if (0 <= index && index < m_bodyCount && m_bodies[index] == body)
+		{
+			return index;
+		}
+	}
+
+	// The spare state is kept free.
+	b2Assert(m_stateCount < m_stateCapacity - 1);
+	int32 index = m_stateCount++;
+	m_positions[index].x = body->m_sweep.c;
+	m_positions[index].a = body->m_sweep.a;
+	m_velocities[index].v = body->m_linearVelocity;
+	m_velocities[index].w = body->m_angularVelocity;
+	return index;
+}
+
+// Copy the body states into the solver arrays and hand out the joint states.
+// The contact solver gets its states when it is built.
+void b2Island::InitializeStates()
+{
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		m_positions[i].x = b->m_sweep.c;
+		m_positions[i].a = b->m_sweep.a;
+		m_velocities[i].v = b->m_linearVelocity;
+		m_velocities[i].w = b->m_angularVelocity;
+	}
+
+	m_stateCount = m_bodyCount;
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* j = m_joints[i];
+		j->m_index1 = GetStateIndex(j->m_body1);
+		j->m_index2 = GetStateIndex(j->m_body2);
+	}
+}
+
+// Clamp the velocities and integrate the positions of the island bodies.
+void b2Island::IntegratePositions(const b2TimeStep& step)
 {
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+
+		if (b->IsStatic())
+			continue;
+
+		b2Vec2 v = m_velocities[i].v;
+		float32 w = m_velocities[i].w;
+
+		// Check for large velocities.
+		b2Vec2 translation = step.dt * v;
+		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+		{
+			translation.Normalize();
+			v = (b2_maxTranslation * step.inv_dt) * translation;
+		}
+
+		float32 rotation = step.dt * w;
+		if (rotation * rotation > b2_maxRotationSquared)
+		{
+			if (rotation < 0.0)
+			{
+				w = -step.inv_dt * b2_maxRotation;
+			}
+			else
+			{
+				w = step.inv_dt * b2_maxRotation;
+			}
+		}
+
+		// Store positions for continuous collision.
+		b->m_sweep.c0 = m_positions[i].x;
+		b->m_sweep.a0 = m_positions[i].a;
+
+		// Integrate
+		m_positions[i].x += step.dt * v;
+		m_positions[i].a += step.dt * w;
+		m_velocities[i].v = v;
+		m_velocities[i].w = w;
+	}
+}
+
+// Copy the solver arrays back to the bodies. Static bodies are not written.
+void b2Island::FinalizeStates()
+{
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+
+		if (b->IsStatic())
+			continue;
+
+		b->m_sweep.c = m_positions[i].x;
+		b->m_sweep.a = m_positions[i].a;
+		b->m_linearVelocity = m_velocities[i].v;
+		b->m_angularVelocity = m_velocities[i].w;
+
+		// Compute new transform
+		b->SynchronizeTransform();
+
+		// Note: shapes are synchronized later.
+	}
+}
+
+// Solve the contacts with the batch solver.
+void b2Island::SolveVelocityBatches(const b2SolverData& data, b2ContactSolver* contactSolver)
+{
+	b2ContactBatchSolver batchSolver(contactSolver, m_velocities, m_bodyCount, m_stateCapacity - 1, m_allocator);
+
+	for (int32 i = 0; i < data.step.velocityIterations; ++i)
+	{
+		for (int32 j = 0; j < m_jointCount; ++j)
+		{
+			m_joints[j]->SolveVelocityConstraints(data);
+		}
+
+		batchSolver.SolveVelocityConstraints();
+	}
+
+	batchSolver.StoreImpulses();
+}
+
+void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	b2Timer timer;
+
 	// Integrate velocities and apply damping.
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
@@ -207,72 +363,53 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 		b->m_angularVelocity *= b2Clamp(1.0f - step.dt * b->m_angularDamping, 0.0f, 1.0f);
 	}
 
-	b2ContactSolver contactSolver(step, m_contacts, m_contactCount, m_allocator);
+	// The solvers work on the island arrays from here on.
+	InitializeStates();
+
+	b2SolverData solverData;
+	solverData.step = step;
+	solverData.positions = m_positions;
+	solverData.velocities = m_velocities;
+
+	b2ContactSolver contactSolver(step, m_contacts, m_contactCount, this);
 
 	// Initialize velocity constraints.
 	contactSolver.InitVelocityConstraints(step);
 
 	for (int32 i = 0; i < m_jointCount; ++i)
 	{
-		m_joints[i]->InitVelocityConstraints(step);
+		m_joints[i]->InitVelocityConstraints(solverData);
 	}
 
+	profile->solveInit += timer.GetMilliseconds();
+	timer.Reset();
+
 	// Solve velocity constraints.
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	if (step.contactBatching)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
-		{
-			m_joints[j]->SolveVelocityConstraints(step);
-		}
-
-		contactSolver.SolveVelocityConstraints();
+		SolveVelocityBatches(solverData, &contactSolver);
 	}
-
-	// Post-solve (store impulses for warm starting).
-	contactSolver.FinalizeVelocityConstraints();
-
-	// Integrate positions.
-	for (int32 i = 0; i < m_bodyCount; ++i)
+	else
 	{
-		b2Body* b = m_bodies[i];
-
-		if (b->IsStatic())
-			continue;
-
-		// Check for large velocities.
-		b2Vec2 translation = step.dt * b->m_linearVelocity;
-		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+		for (int32 i = 0; i < step.velocityIterations; ++i)
 		{
-			translation.Normalize();
-			b->m_linearVelocity = (b2_maxTranslation * step.inv_dt) * translation;
-		}
-
-		float32 rotation = step.dt * b->m_angularVelocity;
-		if (rotation * rotation > b2_maxRotationSquared)
-		{
-			if (rotation < 0.0)
+			for (int32 j = 0; j < m_jointCount; ++j)
 			{
-				b->m_angularVelocity = -step.inv_dt * b2_maxRotation;
+				m_joints[j]->SolveVelocityConstraints(solverData);
 			}
-			else
-			{
-				b->m_angularVelocity = step.inv_dt * b2_maxRotation;
-			}
-		}
 
-		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
+			contactSolver.SolveVelocityConstraints();
+		}
+	}
 
-		// Integrate
-		b->m_sweep.c += step.dt * b->m_linearVelocity;
-		b->m_sweep.a += step.dt * b->m_angularVelocity;
+	// Post-solve (store impulses for warm starting).
+	contactSolver.FinalizeVelocityConstraints();
 
-		// Compute new transform
-		b->SynchronizeTransform();
+	profile->solveVelocity += timer.GetMilliseconds();
+	timer.Reset();
 
-		// Note: shapes are synchronized later.
-	}
+	// Integrate positions.
+	IntegratePositions(step);
 
 	// Iterate over constraints.
 	for (int32 i = 0; i < step.positionIterations; ++i)
@@ -282,7 +419,7 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 		bool jointsOkay = true;
 		for (int32 i = 0; i < m_jointCount; ++i)
 		{
-			bool jointOkay = m_joints[i]->SolvePositionConstraints(b2_contactBaumgarte);
+			bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData, b2_contactBaumgarte);
 			jointsOkay = jointsOkay && jointOkay;
 		}
 
@@ -293,11 +430,20 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 		}
 	}
 
+	// Write the results back to the bodies.
+	FinalizeStates();
+
+	profile->solvePosition += timer.GetMilliseconds();
+
 	Report(contactSolver.m_constraints);
 
+	m_minSleepTime = 0.0f;
+	m_maxSleepTime = 0.0f;
+
 	if (allowSleep)
 	{
 		float32 minSleepTime = B2_FLT_MAX;
+		float32 maxSleepTime = 0.0f;
 
 #ifndef TARGET_FLOAT32_IS_FIXED
 		const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
@@ -335,9 +481,13 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 			{
 				b->m_sleepTime += step.dt;
 				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				maxSleepTime = b2Max(maxSleepTime, b->m_sleepTime);
 			}
 		}
 
+		m_minSleepTime = minSleepTime;
+		m_maxSleepTime = maxSleepTime;
+
 		if (minSleepTime >= b2_timeToSleep)
 		{
 			for (int32 i = 0; i < m_bodyCount; ++i)
@@ -353,7 +503,14 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSl
 
 void b2Island::SolveTOI(b2TimeStep& subStep)
 {
-	b2ContactSolver contactSolver(subStep, m_contacts, m_contactCount, m_allocator);
+	InitializeStates();
+
+	b2SolverData solverData;
+	solverData.step = subStep;
+	solverData.positions = m_positions;
+	solverData.velocities = m_velocities;
+
+	b2ContactSolver contactSolver(subStep, m_contacts, m_contactCount, this);
 
 	// No warm starting is needed for TOI events because warm
 	// starting impulses were applied in the discrete solver.
@@ -362,7 +519,7 @@ void b2Island::SolveTOI(b2TimeStep& subStep)
 	// call this function to compute Jacobians.
 	for (int32 i = 0; i < m_jointCount; ++i)
 	{
-		m_joints[i]->InitVelocityConstraints(subStep);
+		m_joints[i]->InitVelocityConstraints(solverData);
 	}
 
 	// Solve velocity constraints.
@@ -371,7 +528,7 @@ void b2Island::SolveTOI(b2TimeStep& subStep)
 		contactSolver.SolveVelocityConstraints();
 		for (int32 j = 0; j < m_jointCount; ++j)
 		{
-			m_joints[j]->SolveVelocityConstraints(subStep);
+			m_joints[j]->SolveVelocityConstraints(solverData);
 		}
 	}
 
@@ -379,69 +536,7 @@ void b2Island::SolveTOI(b2TimeStep& subStep)
 	// because they can be quite large.
 
 	// Integrate positions.
-	for (int32 i = 0; i < m_bodyCount; ++i)
-	{
-		b2Body* b = m_bodies[i];
-
-		if (b->IsStatic())
-			continue;
-
-		// Check for large velocities.
-		b2Vec2 translation = subStep.dt * b->m_linearVelocity;
-		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
-		{
-			translation.Normalize();
-			b->m_linearVelocity = (b2_maxTranslation * subStep.inv_dt) * translation;
-		}
-
-		float32 rotation = subStep.dt * b->m_angularVelocity;
-		if (rotation * rotation > b2_maxRotationSquared)
-		{
-			if (rotation < 0.0)
-			{
-				b->m_angularVelocity = -subStep.inv_dt * b2_maxRotation;
-			}
-			else
-			{
-				b->m_angularVelocity = subStep.inv_dt * b2_maxRotation;
-			}
-		}
-
-		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
-
-		// Integrate
-		b->m_sweep.c += subStep.dt * b->m_linearVelocity;
-		b->m_sweep.a += subStep.dt * b->m_angularVelocity;
-
-		// Compute new transform
-		b->SynchronizeTransform();
-
-		// Note: shapes are synchronized later.
-	}
-
-#if 0
-	{
-		for (int32 i = 0; i < m_contactCount; ++i)
-		{
-			m_contacts[i]->Update(NULL);
-		}
-		b2ContactSolver contactSolver2(subStep, m_contacts, m_contactCount, m_allocator);
-
-		// Solve position constraints.
-		const float32 k_toiBaumgarte = 0.75f;
-		for (int32 i = 0; i < subStep.positionIterations; ++i)
-		{
-			bool contactsOkay = contactSolver2.SolvePositionConstraints(k_toiBaumgarte);
-
-			if (contactsOkay)
-			{
-				break;
-			}
-		}
-	}
-#else
+	IntegratePositions(subStep);
 
 	// Solve position constraints.
 	const float32 k_toiBaumgarte = 0.75f;
@@ -451,7 +546,7 @@ void b2Island::SolveTOI(b2TimeStep& subStep)
 		bool jointsOkay = true;
 		for (int32 j = 0; j < m_jointCount; ++j)
 		{
-			bool jointOkay = m_joints[j]->SolvePositionConstraints(k_toiBaumgarte);
+			bool jointOkay = m_joints[j]->SolvePositionConstraints(solverData, k_toiBaumgarte);
 			jointsOkay = jointsOkay && jointOkay;
 		}
 		
@@ -460,7 +555,8 @@ void b2Island::SolveTOI(b2TimeStep& subStep)
 			break;
 		}
 	}
-#endif
+
+	FinalizeStates();
 
 	Report(contactSolver.m_constraints);
 }
@@ -21,13 +21,14 @@
 
 #include "../Common/b2Math.h"
 #include "b2Body.h"
+#include "b2World.h"
 
 class b2Contact;
 class b2Joint;
 class b2StackAllocator;
 class b2ContactListener;
+class b2ContactSolver;
 struct b2ContactConstraint;
-struct b2TimeStep;
 
 struct b2Position
 {
@@ -41,6 +42,15 @@ struct b2Velocity
 	float32 w;
 };
 
+// The island state handed to the joint solvers. The arrays are indexed by
+// b2Joint::m_index1 and b2Joint::m_index2.
+struct b2SolverData
+{
+	b2TimeStep step;
+	b2Position* positions;
+	b2Velocity* velocities;
+};
+
 class b2Island
 {
 public:
@@ -55,7 +65,20 @@ public:
 		m_jointCount = 0;
 	}
 
-	void Solve(const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
+	// The number of solver states needed for an island. A contact has at most
+	// one body outside the island and a joint at most two (gear joints also
+	// refer to their ground bodies). The last state is a spare zero velocity.
+	static int32 GetStateCapacity(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity)
+	{
+		return bodyCapacity + contactCapacity + 2 * jointCapacity + 1;
+	}
+
+	// The most stack memory solving an island of this size can take,
+	// including the contact solver and the batch solver when batching.
+	static int32 GetStackSize(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity, bool batching);
+
+	// Adds the time of the solver phases to the profile.
+	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
 
 	void SolveTOI(b2TimeStep& subStep);
 
@@ -78,6 +101,17 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	// Get the solver state of a body. Bodies of the island use their island
+	// index. Static bodies and bodies outside the island get a read only copy
+	// of their state for each constraint, so islands never share a state.
+	int32 GetStateIndex(b2Body* body);
+
+	void InitializeStates();
+	void IntegratePositions(const b2TimeStep& step);
+	void FinalizeStates();
+
+	void SolveVelocityBatches(const b2SolverData& data, b2ContactSolver* contactSolver);
+
 	void Report(const b2ContactConstraint* constraints);
 
 	b2StackAllocator* m_allocator;
@@ -93,12 +127,19 @@ public:
 	int32 m_bodyCount;
 	int32 m_jointCount;
 	int32 m_contactCount;
+	int32 m_stateCount;
 
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+	int32 m_stateCapacity;
 
 	int32 m_positionIterationCount;
+
+	// The smallest and largest body sleep times after Solve. These are
+	// zero when sleeping is not allowed.
+	float32 m_minSleepTime;
+	float32 m_maxSleepTime;
 };
 
 #endif
@@ -0,0 +1,407 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2IslandManager.h"
+#include "b2World.h"
+#include "b2Body.h"
+#include "Contacts/b2Contact.h"
+#include "Joints/b2Joint.h"
+
+static void b2InsertIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	island->prev = NULL;
+	island->next = *list;
+	if (*list)
+	{
+		(*list)->prev = island;
+	}
+	*list = island;
+}
+
+static void b2RemoveIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	if (island->prev)
+	{
+		island->prev->next = island->next;
+	}
+
+	if (island->next)
+	{
+		island->next->prev = island->prev;
+	}
+
+	if (island == *list)
+	{
+		*list = island->next;
+	}
+
+	island->prev = NULL;
+	island->next = NULL;
+}
+
+b2IslandManager::b2IslandManager()
+{
+	m_world = NULL;
+	m_awakeList = NULL;
+	m_sleepList = NULL;
+	m_awakeCount = 0;
+	m_sleepCount = 0;
+}
+
+b2PersistentIsland* b2IslandManager::CreateIsland(bool awake)
+{
+	void* mem = m_world->m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->bodyList = NULL;
+	island->bodyCount = 0;
+	island->constraintRemoveCount = 0;
+	island->awake = awake;
+
+	if (awake)
+	{
+		b2InsertIsland(&m_awakeList, island);
+		++m_awakeCount;
+	}
+	else
+	{
+		b2InsertIsland(&m_sleepList, island);
+		++m_sleepCount;
+	}
+
+	return island;
+}
+
+void b2IslandManager::DestroyIsland(b2PersistentIsland* island)
+{
+	b2Assert(island->bodyCount == 0);
+
+	if (island->awake)
+	{
+		b2RemoveIsland(&m_awakeList, island);
+		--m_awakeCount;
+	}
+	else
+	{
+		b2RemoveIsland(&m_sleepList, island);
+		--m_sleepCount;
+	}
+
+	m_world->m_blockAllocator.Free(island, sizeof(b2PersistentIsland));
+}
+
+void b2IslandManager::AddToIsland(b2PersistentIsland* island, b2Body* body)
+{
+	b2Assert(body->m_island == NULL);
+
+	body->m_island = island;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = island->bodyList;
+	if (island->bodyList)
+	{
+		island->bodyList->m_islandPrev = body;
+	}
+	island->bodyList = body;
+	++island->bodyCount;
+}
+
+void b2IslandManager::UpdateBody(b2Body* body)
+{
+	bool member = body->IsStatic() == false && body->IsFrozen() == false;
+	if (member == (body->m_island != NULL))
+	{
+		return;
+	}
+
+	if (member == false)
+	{
+		RemoveBody(body);
+		return;
+	}
+
+	b2PersistentIsland* island = CreateIsland(body->IsSleeping() == false);
+	AddToIsland(island, body);
+
+	// Pick up the constraints the body already has.
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		b2Contact* c = ce->contact;
+		if (c->IsSolid() && c->AreTouching())
+		{
+			Link(body, ce->other);
+		}
+	}
+
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		Link(body, je->other);
+	}
+}
+
+void b2IslandManager::RemoveBody(b2Body* body)
+{
+	b2PersistentIsland* island = body->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
+
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
+
+	if (body == island->bodyList)
+	{
+		island->bodyList = body->m_islandNext;
+	}
+
+	body->m_island = NULL;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+	--island->bodyCount;
+
+	if (island->bodyCount == 0)
+	{
+		DestroyIsland(island);
+	}
+	else
+	{
+		// The remaining bodies may have been connected through this one.
+		++island->constraintRemoveCount;
+	}
+}
+
+void b2IslandManager::Link(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* islandA = bodyA->m_island;
+	b2PersistentIsland* islandB = bodyB->m_island;
+
+	// Constraints to static or frozen bodies don't connect islands.
+	if (islandA == NULL || islandB == NULL || islandA == islandB)
+	{
+		return;
+	}
+
+	// An awake island wakes up the island it touches.
+	if (islandA->awake != islandB->awake)
+	{
+		WakeIsland(islandA->awake ? islandB : islandA);
+	}
+
+	// Move the bodies of the smaller island.
+	if (islandA->bodyCount < islandB->bodyCount)
+	{
+		Merge(islandB, islandA);
+	}
+	else
+	{
+		Merge(islandA, islandB);
+	}
+}
+
+void b2IslandManager::Unlink(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* island = bodyA->m_island;
+	if (island != NULL && island == bodyB->m_island)
+	{
+		++island->constraintRemoveCount;
+	}
+}
+
+void b2IslandManager::Merge(b2PersistentIsland* islandA, b2PersistentIsland* islandB)
+{
+	b2Assert(islandA->awake == islandB->awake);
+
+	b2Body* tail = NULL;
+	for (b2Body* b = islandB->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_island = islandA;
+		tail = b;
+	}
+
+	if (tail)
+	{
+		tail->m_islandNext = islandA->bodyList;
+		if (islandA->bodyList)
+		{
+			islandA->bodyList->m_islandPrev = tail;
+		}
+		islandA->bodyList = islandB->bodyList;
+	}
+
+	islandA->bodyCount += islandB->bodyCount;
+	islandA->constraintRemoveCount += islandB->constraintRemoveCount;
+
+	islandB->bodyList = NULL;
+	islandB->bodyCount = 0;
+	DestroyIsland(islandB);
+}
+
+void b2IslandManager::WakeIsland(b2PersistentIsland* island)
+{
+	if (island->awake)
+	{
+		return;
+	}
+
+	b2RemoveIsland(&m_sleepList, island);
+	--m_sleepCount;
+	b2InsertIsland(&m_awakeList, island);
+	++m_awakeCount;
+	island->awake = true;
+
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_flags &= ~b2Body::e_sleepFlag;
+	}
+}
+
+void b2IslandManager::SleepIsland(b2PersistentIsland* island)
+{
+	if (island->awake == false)
+	{
+		return;
+	}
+
+	b2RemoveIsland(&m_awakeList, island);
+	--m_awakeCount;
+	b2InsertIsland(&m_sleepList, island);
+	++m_sleepCount;
+	island->awake = false;
+
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_flags |= b2Body::e_sleepFlag;
+		b->m_linearVelocity = b2Vec2_zero;
+		b->m_angularVelocity = 0.0f;
+	}
+}
+
+void b2IslandManager::RestoreIsland(b2Body** bodies, int32 count, int32 constraintRemoveCount, bool awake)
+{
+	b2PersistentIsland* island = CreateIsland(awake);
+	for (int32 i = 0; i < count; ++i)
+	{
+		AddToIsland(island, bodies[i]);
+	}
+	island->constraintRemoveCount = constraintRemoveCount;
+}
+
+void b2IslandManager::SplitIsland(b2PersistentIsland* island)
+{
+	b2StackAllocator* allocator = &m_world->m_stackAllocator;
+
+	int32 bodyCount = island->bodyCount;
+	b2Body** bodies = (b2Body**)allocator->Allocate(bodyCount * sizeof(b2Body*));
+	b2Body** stack = (b2Body**)allocator->Allocate(bodyCount * sizeof(b2Body*));
+
+	// Detach the bodies. A body without an island is one that has
+	// not been reached yet.
+	int32 count = 0;
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		bodies[count++] = b;
+	}
+	b2Assert(count == bodyCount);
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_island = NULL;
+		bodies[i]->m_islandPrev = NULL;
+		bodies[i]->m_islandNext = NULL;
+	}
+
+	bool awake = island->awake;
+	island->bodyList = NULL;
+	island->bodyCount = 0;
+	DestroyIsland(island);
+
+	// Perform a depth first search (DFS) on the constraint graph from each
+	// body that has not been reached yet.
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_island != NULL)
+		{
+			continue;
+		}
+
+		b2PersistentIsland* component = CreateIsland(awake);
+		float32 minSleepTime = B2_FLT_MAX;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		AddToIsland(component, seed);
+
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+
+			if (b->m_invMass != 0.0f)
+			{
+				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+			}
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* c = ce->contact;
+				if (c->IsSolid() == false || c->AreTouching() == false)
+				{
+					continue;
+				}
+
+				// Every other dynamic body is already in an island.
+				b2Body* other = ce->other;
+				if (other->m_island != NULL || other->IsStatic() || other->IsFrozen())
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				AddToIsland(component, other);
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Body* other = je->other;
+				if (other->m_island != NULL || other->IsStatic() || other->IsFrozen())
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				AddToIsland(component, other);
+			}
+		}
+
+		if (m_world->m_allowSleep && minSleepTime >= b2_timeToSleep)
+		{
+			SleepIsland(component);
+		}
+	}
+
+	allocator->Free(stack);
+	allocator->Free(bodies);
+}
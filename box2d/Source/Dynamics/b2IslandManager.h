@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ISLAND_MANAGER_H
+#define B2_ISLAND_MANAGER_H
+
+#include "../Common/b2Settings.h"
+
+class b2World;
+class b2Body;
+
+// A group of dynamic bodies connected by touching solid contacts and joints.
+// Persistent islands live across time steps. They are merged when a constraint
+// connects two of them, and split lazily when a constraint was removed and
+// some of the bodies are ready to sleep.
+struct b2PersistentIsland
+{
+	b2PersistentIsland* prev;
+	b2PersistentIsland* next;
+
+	// Bodies are linked through b2Body::m_islandPrev/m_islandNext.
+	b2Body* bodyList;
+	int32 bodyCount;
+
+	// The number of constraints removed since the island was built. If this
+	// is not zero the island may really be several islands.
+	int32 constraintRemoveCount;
+
+	bool awake;
+};
+
+// Delegate of b2World. Every dynamic body that is not frozen belongs to exactly
+// one persistent island. Static and frozen bodies don't belong to any island,
+// so islands don't propagate across them.
+class b2IslandManager
+{
+public:
+	b2IslandManager();
+
+	// Add or remove the body from the islands to match its type and frozen state.
+	void UpdateBody(b2Body* body);
+
+	// Remove the body from its island, if any.
+	void RemoveBody(b2Body* body);
+
+	// A constraint now connects these bodies. Merges their islands.
+	void Link(b2Body* bodyA, b2Body* bodyB);
+
+	// A constraint between these bodies was removed. Marks their island for splitting.
+	void Unlink(b2Body* bodyA, b2Body* bodyB);
+
+	// Move a sleeping island to the awake list and wake its bodies.
+	void WakeIsland(b2PersistentIsland* island);
+
+	// Move an awake island to the sleep list and put its bodies to sleep.
+	void SleepIsland(b2PersistentIsland* island);
+
+	// Recreate an island of a world snapshot. The bodies must not belong to an
+	// island yet. They are given in reverse list order, like the islands.
+	void RestoreIsland(b2Body** bodies, int32 count, int32 constraintRemoveCount, bool awake);
+
+	// Rebuild the connected components of an island that has lost constraints.
+	// Components that have rested long enough are put to sleep.
+	void SplitIsland(b2PersistentIsland* island);
+
+	b2World* m_world;
+
+	b2PersistentIsland* m_awakeList;
+	b2PersistentIsland* m_sleepList;
+	int32 m_awakeCount;
+	int32 m_sleepCount;
+
+private:
+	b2PersistentIsland* CreateIsland(bool awake);
+	void DestroyIsland(b2PersistentIsland* island);
+	void AddToIsland(b2PersistentIsland* island, b2Body* body);
+	void Merge(b2PersistentIsland* islandA, b2PersistentIsland* islandB);
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2TOIQueue.h"
+#include "Contacts/b2Contact.h"
+
+#include <string.h>
+
+b2TOIQueue::b2TOIQueue()
+{
+	m_count = 0;
+	m_capacity = 16;
+	m_heap = (b2Contact**)b2Alloc(m_capacity * sizeof(b2Contact*));
+}
+
+b2TOIQueue::~b2TOIQueue()
+{
+	Clear();
+	b2Free(m_heap);
+}
+
+void b2TOIQueue::Clear()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		m_heap[i]->m_toiIndex = b2_nullTOIIndex;
+	}
+	m_count = 0;
+}
+
+void b2TOIQueue::Push(b2Contact* contact)
+{
+	b2Assert(contact->m_toiIndex == b2_nullTOIIndex);
+
+	if (m_count == m_capacity)
+	{
+		b2Contact** oldHeap = m_heap;
+		m_capacity *= 2;
+		m_heap = (b2Contact**)b2Alloc(m_capacity * sizeof(b2Contact*));
+		memcpy(m_heap, oldHeap, m_count * sizeof(b2Contact*));
+		b2Free(oldHeap);
+	}
+
+	Place(m_count, contact);
+	++m_count;
+	SiftUp(m_count - 1);
+}
+
+b2Contact* b2TOIQueue::Pop()
+{
+	b2Assert(m_count > 0);
+	b2Contact* top = m_heap[0];
+	Remove(top);
+	return top;
+}
+
+void b2TOIQueue::Remove(b2Contact* contact)
+{
+	int32 index = contact->m_toiIndex;
+	if (index == b2_nullTOIIndex)
+	{
+		return;
+	}
+
+	b2Assert(0 <= index && index < m_count && m_heap[index] == contact);
+	contact->m_toiIndex = b2_nullTOIIndex;
+
+	--m_count;
+	if (index == m_count)
+	{
+		return;
+	}
+
+	// Move the last contact into the hole and restore the order.
+	Place(index, m_heap[m_count]);
+	Update(m_heap[index]);
+}
+
+void b2TOIQueue::Update(b2Contact* contact)
+{
+	int32 index = contact->m_toiIndex;
+	b2Assert(0 <= index && index < m_count && m_heap[index] == contact);
+
+	if (index > 0 && contact->m_toi < m_heap[(index - 1) >> 1]->m_toi)
+	{
+		SiftUp(index);
+	}
+	else
+	{
+		SiftDown(index);
+	}
+}
+
+void b2TOIQueue::SiftUp(int32 index)
+{
+	b2Contact* contact = m_heap[index];
+	while (index > 0)
+	{
+		int32 parent = (index - 1) >> 1;
+		if (m_heap[parent]->m_toi <= contact->m_toi)
+		{
+			break;
+		}
+
+		Place(index, m_heap[parent]);
+		index = parent;
+	}
+
+	Place(index, contact);
+}
+
+void b2TOIQueue::SiftDown(int32 index)
+{
+	b2Contact* contact = m_heap[index];
+	for (;;)
+	{
+		int32 child = 2 * index + 1;
+		if (child >= m_count)
+		{
+			break;
+		}
+
+		if (child + 1 < m_count && m_heap[child + 1]->m_toi < m_heap[child]->m_toi)
+		{
+			++child;
+		}
+
+		if (contact->m_toi <= m_heap[child]->m_toi)
+		{
+			break;
+		}
+
+		Place(index, m_heap[child]);
+		index = child;
+	}
+
+	Place(index, contact);
+}
+
+void b2TOIQueue::Place(int32 index, b2Contact* contact)
+{
+	m_heap[index] = contact;
+	contact->m_toiIndex = index;
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TOI_QUEUE_H
+#define B2_TOI_QUEUE_H
+
+#include "../Common/b2Settings.h"
+
+class b2Contact;
+
+// Delegate of b2World. A binary min-heap of contacts ordered by their cached
+// time of impact (b2Contact::m_toi). Each queued contact stores its heap slot in
+// b2Contact::m_toiIndex so it can be re-keyed or removed when the bodies it
+// touches are advanced or when it is destroyed during the TOI phase.
+class b2TOIQueue
+{
+public:
+	b2TOIQueue();
+	~b2TOIQueue();
+
+	// Remove all contacts from the queue. The storage is kept.
+	void Clear();
+
+	// Add a contact that is not in the queue yet.
+	void Push(b2Contact* contact);
+
+	// Remove and return the contact with the smallest TOI.
+	b2Contact* Pop();
+
+	// Remove a contact from the queue, if it is queued.
+	void Remove(b2Contact* contact);
+
+	// Restore the heap order after the TOI of a queued contact changed.
+	void Update(b2Contact* contact);
+
+	bool IsEmpty() const;
+
+	int32 GetCount() const;
+
+private:
+	void SiftUp(int32 index);
+	void SiftDown(int32 index);
+	void Place(int32 index, b2Contact* contact);
+
+	b2Contact** m_heap;
+	int32 m_count;
+	int32 m_capacity;
+};
+
+inline bool b2TOIQueue::IsEmpty() const
+{
+	return m_count == 0;
+}
+
+inline int32 b2TOIQueue::GetCount() const
+{
+	return m_count;
+}
+
+#endif
@@ -25,15 +25,18 @@
 #include "Contacts/b2ContactSolver.h"
 #include "Controllers/b2Controller.h"
 #include "../Collision/b2Collision.h"
+#include "../Collision/b2SAPBroadPhase.h"
 #include "../Collision/Shapes/b2CircleShape.h"
 #include "../Collision/Shapes/b2PolygonShape.h"
 #include "../Collision/Shapes/b2EdgeShape.h"
 #include <new>
+#include <cstring>
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
-b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
+b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep, b2BroadPhaseType broadPhaseType,
+				 int32 stackSize) : m_stackAllocator(stackSize)
 {
 	m_destructionListener = NULL;
 	m_boundaryListener = NULL;
@@ -42,10 +45,16 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 	m_debugDraw = NULL;
 
 	m_bodyList = NULL;
-	m_contactList = NULL;
+	m_contacts = NULL;
+	m_contactCapacity = 0;
 	m_jointList = NULL;
 	m_controllerList = NULL;
 
+	m_freeBodyIndices = NULL;
+	m_freeBodyIndexCount = 0;
+	m_freeBodyIndexCapacity = 0;
+	m_bodyIndexCount = 0;
+
 	m_bodyCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
@@ -53,6 +62,8 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 
 	m_warmStarting = true;
 	m_continuousPhysics = true;
+	m_contactBatching = false;
+	m_deterministic = false;
 
 	m_allowSleep = doSleep;
 	m_gravity = gravity;
@@ -61,9 +72,18 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 
 	m_inv_dt0 = 0.0f;
 
+	m_taskScheduler = NULL;
+	m_threadAllocators = NULL;
+	m_threadAllocatorCount = 0;
+
+	m_stackSize = stackSize;
+	m_stackPeak = 0;
+
+	m_profile.SetZero();
+
 	m_contactManager.m_world = this;
-	void* mem = b2Alloc(sizeof(b2BroadPhase));
-	m_broadPhase = new (mem) b2BroadPhase(worldAABB, &m_contactManager);
+	m_islandManager.m_world = this;
+	m_broadPhase = b2BroadPhase::Create(broadPhaseType, worldAABB, &m_contactManager);
 
 	b2BodyDef bd;
 	m_groundBody = CreateBody(&bd);
@@ -72,8 +92,10 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 b2World::~b2World()
 {
 	DestroyBody(m_groundBody);
-	m_broadPhase->~b2BroadPhase();
-	b2Free(m_broadPhase);
+	b2BroadPhase::Destroy(m_broadPhase);
+	SetTaskScheduler(NULL);
+	b2Free(m_freeBodyIndices);
+	b2Free(m_contacts);
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -106,6 +128,15 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
 	b2Body* b = new (mem) b2Body(def, this);
 
+	if (m_freeBodyIndexCount > 0)
+	{
+		b->m_index = m_freeBodyIndices[--m_freeBodyIndexCount];
+	}
+	else
+	{
+		b->m_index = m_bodyIndexCount++;
+	}
+
 	// Add to world doubly linked list.
 	b->m_prev = NULL;
 	b->m_next = m_bodyList;
@@ -116,6 +147,8 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	m_islandManager.UpdateBody(b);
+
 	return b;
 }
 
@@ -166,6 +199,8 @@ void b2World::DestroyBody(b2Body* b)
 		m_blockAllocator.Free(f0, sizeof(b2Fixture));
 	}
 
+	m_islandManager.RemoveBody(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -183,10 +218,203 @@ void b2World::DestroyBody(b2Body* b)
 	}
 
 	--m_bodyCount;
+
+	// Keep the index for the next body.
+	if (m_freeBodyIndexCount == m_freeBodyIndexCapacity)
+	{
+		int32* oldIndices = m_freeBodyIndices;
+		m_freeBodyIndexCapacity = b2Max(2 * m_freeBodyIndexCapacity, 16);
+		m_freeBodyIndices = (int32*)b2Alloc(m_freeBodyIndexCapacity * sizeof(int32));
+		memcpy(m_freeBodyIndices, oldIndices, m_freeBodyIndexCount * sizeof(int32));
+		b2Free(oldIndices);
+	}
+	m_freeBodyIndices[m_freeBodyIndexCount++] = b->m_index;
+
 	b->~b2Body();
 	m_blockAllocator.Free(b, sizeof(b2Body));
 }
 
+void b2World::CreateBodies(const b2BodyDef* bodyDefs, int32 bodyCount,
+						const b2FixtureDef* const* fixtureDefs, const int32* fixtureCounts, b2Body** bodies)
+{
+	// Reserve the blocks up front so the bodies, fixtures and shapes fill whole chunks.
+	int32 fixtureCount = 0;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		fixtureCount += fixtureCounts[i];
+	}
+
+	int32 circleCount = 0, polygonCount = 0, edgeCount = 0;
+	for (int32 i = 0; i < fixtureCount; ++i)
+	{
+		switch (fixtureDefs[i]->type)
+		{
+		case b2_circleShape:
+			++circleCount;
+			break;
+
+		case b2_polygonShape:
+			++polygonCount;
+			break;
+
+		case b2_edgeShape:
+			++edgeCount;
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+	}
+
+	m_blockAllocator.Reserve(sizeof(b2Body), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2Fixture), fixtureCount);
+	m_blockAllocator.Reserve(sizeof(b2CircleShape), circleCount);
+	m_blockAllocator.Reserve(sizeof(b2PolygonShape), polygonCount);
+	m_blockAllocator.Reserve(sizeof(b2EdgeShape), edgeCount);
+
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(fixtureCount * sizeof(b2AABB));
+	void** proxyFixtures = (void**)m_stackAllocator.Allocate(fixtureCount * sizeof(void*));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(fixtureCount * sizeof(int32));
+	int32 proxyCount = 0;
+
+	const b2FixtureDef* const* defs = fixtureDefs;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* b = CreateBody(bodyDefs + i);
+		if (bodies)
+		{
+			bodies[i] = b;
+		}
+
+		// Create the fixtures without proxies.
+		bool hasDensity = false;
+		for (int32 j = 0; j < fixtureCounts[i]; ++j)
+		{
+			const b2FixtureDef* def = *defs++;
+
+			void* mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* fixture = new (mem) b2Fixture;
+			fixture->Create(&m_blockAllocator, NULL, b, b->m_xf, def);
+
+			fixture->m_index = b->m_fixtureCount;
+			fixture->m_next = b->m_fixtureList;
+			b->m_fixtureList = fixture;
+			++b->m_fixtureCount;
+
+			hasDensity = hasDensity || def->density > 0.0f;
+		}
+
+		// The mass is known before the proxies exist, so they are not refiltered.
+		if (hasDensity)
+		{
+			b->SetMassFromShapes();
+		}
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			b2AABB aabb;
+			f->m_shape->ComputeAABB(&aabb, b->m_xf);
+
+			// You are creating a shape outside the world box.
+			bool inRange = m_broadPhase->InRange(aabb);
+			b2Assert(inRange);
+
+			if (inRange)
+			{
+				aabbs[proxyCount] = aabb;
+				proxyFixtures[proxyCount] = f;
+				++proxyCount;
+			}
+		}
+	}
+
+	m_broadPhase->CreateProxies(aabbs, proxyFixtures, proxyCount, proxyIds);
+
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		((b2Fixture*)proxyFixtures[i])->m_proxyId = proxyIds[i];
+	}
+
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(proxyFixtures);
+	m_stackAllocator.Free(aabbs);
+}
+
+int32 b2World::SetXForms(b2Body** bodies, const b2Vec2* positions, const float32* angles, int32 count)
+{
+	int32 proxyCapacity = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		proxyCapacity += bodies[i]->m_fixtureCount;
+	}
+
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(proxyCapacity * sizeof(int32));
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(proxyCapacity * sizeof(b2AABB));
+	int32 proxyCount = 0;
+	int32 frozenCount = 0;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* b = bodies[i];
+		if (b->IsFrozen())
+		{
+			++frozenCount;
+			continue;
+		}
+
+		b->m_xf.R.Set(angles[i]);
+		b->m_xf.position = positions[i];
+
+		b->m_sweep.c0 = b->m_sweep.c = b2Mul(b->m_xf, b->m_sweep.localCenter);
+		b->m_sweep.a0 = b->m_sweep.a = angles[i];
+
+		// Gather the new AABBs. A body that leaves the world is frozen and its proxies stay.
+		int32 firstProxy = proxyCount;
+		bool inRange = true;
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			if (f->m_proxyId == b2_nullProxy)
+			{
+				inRange = false;
+				break;
+			}
+
+			b2AABB aabb;
+			f->m_shape->ComputeAABB(&aabb, b->m_xf);
+			if (m_broadPhase->InRange(aabb) == false)
+			{
+				inRange = false;
+				break;
+			}
+
+			proxyIds[proxyCount] = f->m_proxyId;
+			aabbs[proxyCount] = aabb;
+			++proxyCount;
+		}
+
+		if (inRange == false)
+		{
+			proxyCount = firstProxy;
+			b->m_flags |= b2Body::e_frozenFlag;
+			b->m_linearVelocity.SetZero();
+			b->m_angularVelocity = 0.0f;
+			m_islandManager.RemoveBody(b);
+			++frozenCount;
+		}
+	}
+
+	// Move all proxies, then find the new pairs once.
+	m_broadPhase->MoveProxies(proxyIds, aabbs, proxyCount);
+	m_broadPhase->Commit();
+	m_contactManager.SortNewContacts();
+
+	m_stackAllocator.Free(aabbs);
+	m_stackAllocator.Free(proxyIds);
+
+	return frozenCount;
+}
+
 b2Joint* b2World::CreateJoint(const b2JointDef* def)
 {
 	b2Joint* j = b2Joint::Create(def, &m_blockAllocator);
@@ -216,6 +444,9 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 	if (j->m_body2->m_jointList) j->m_body2->m_jointList->prev = &j->m_node2;
 	j->m_body2->m_jointList = &j->m_node2;
 
+	// The joint connects the islands of its bodies.
+	m_islandManager.Link(j->m_body1, j->m_body2);
+
 	// If the joint prevents collisions, then reset collision filtering.
 	if (def->collideConnected == false)
 	{
@@ -258,6 +489,9 @@ void b2World::DestroyJoint(b2Joint* j)
 	body1->WakeUp();
 	body2->WakeUp();
 
+	// The island may come apart.
+	m_islandManager.Unlink(body1, body2);
+
 	// Remove from body 1.
 	if (j->m_node1.prev)
 	{
@@ -362,74 +596,125 @@ void b2World::Refilter(b2Fixture* fixture)
 	fixture->RefilterProxy(m_broadPhase, fixture->GetBody()->GetXForm());
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+// A run of the gathered bodies and constraints that forms one island.
+struct b2IslandTask
 {
-	// Step all controllers
-	for(b2Controller* controller = m_controllerList; controller; controller = controller->m_next)
+	b2PersistentIsland* island;
+	int32 bodyStart, bodyCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+	float32 minSleepTime, maxSleepTime;
+
+	// Solver phase times, added to the world profile after the solve.
+	b2Profile profile;
+
+	// Too big for a thread stack, solved on the calling thread.
+	bool serial;
+};
+
+struct b2IslandTaskContext
+{
+	b2World* world;
+	const b2TimeStep* step;
+	const b2Island* gathered;
+	b2IslandTask* tasks;
+	b2ContactImpulse* impulses;
+};
+
+// Records the impulses reported by an island so they can be passed to the
+// user listener on the thread calling Step.
+class b2ImpulseBuffer : public b2ContactListener
+{
+public:
+	void PostSolve(const b2Contact* contact, const b2ContactImpulse* impulse)
 	{
-		controller->Step(step);
+		B2_NOT_USED(contact);
+		m_impulses[m_count++] = *impulse;
 	}
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, m_contactListener);
+	b2ContactImpulse* m_impulses;
+	int32 m_count;
+};
 
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+void b2World::SetTaskScheduler(b2TaskScheduler* scheduler)
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
 	{
-		b->m_flags &= ~b2Body::e_islandFlag;
+		return;
 	}
-	for (b2Contact* c = m_contactList; c; c = c->m_next)
+
+	for (int32 i = 0; i < m_threadAllocatorCount; ++i)
 	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
+		m_threadAllocators[i].~b2StackAllocator();
 	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2Free(m_threadAllocators);
+	m_threadAllocators = NULL;
+	m_threadAllocatorCount = 0;
+
+	m_taskScheduler = scheduler;
+	if (scheduler == NULL)
 	{
-		j->m_islandFlag = false;
+		return;
 	}
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	m_threadAllocatorCount = scheduler->GetThreadCount();
+	b2Assert(m_threadAllocatorCount > 0);
+	m_threadAllocators = (b2StackAllocator*)b2Alloc(m_threadAllocatorCount * sizeof(b2StackAllocator));
+	for (int32 i = 0; i < m_threadAllocatorCount; ++i)
 	{
-		if (seed->m_flags & (b2Body::e_islandFlag | b2Body::e_sleepFlag | b2Body::e_frozenFlag))
+		new (m_threadAllocators + i) b2StackAllocator(m_stackSize);
+	}
+}
+
+// Add the bodies and constraints of an awake island to the solver island. Returns
+// false if the user put every body of the island to sleep.
+bool b2World::GatherIsland(b2PersistentIsland* pi, b2Island* island, b2Body** stack, int32 stackSize)
+{
+	bool awake = false;
+	for (b2Body* b = pi->bodyList; b; b = b->m_islandNext)
+	{
+		if (b->IsSleeping() == false)
 		{
-			continue;
+			awake = true;
+			break;
 		}
+	}
 
-		if (seed->IsStatic())
+	if (awake == false)
+	{
+		m_islandManager.SleepIsland(pi);
+		return false;
+	}
+
+	// Gather the bodies and constraints of the island with a depth first
+	// search (DFS), the solver converges better on a connected ordering.
+	// An island that lost constraints may be in several pieces.
+	int32 bodyStart = island->m_bodyCount;
+	for (b2Body* seed = pi->bodyList; seed; seed = seed->m_islandNext)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
 		{
 			continue;
 		}
 
-		// Reset island and stack.
-		island.Clear();
 		int32 stackCount = 0;
 		stack[stackCount++] = seed;
 		seed->m_flags |= b2Body::e_islandFlag;
 
-		// Perform a depth first search (DFS) on the constraint graph.
 		while (stackCount > 0)
 		{
 			// Grab the next body off the stack and add it to the island.
 			b2Body* b = stack[--stackCount];
-			island.Add(b);
+			island->Add(b);
 
 			// Make sure the body is awake.
 			b->m_flags &= ~b2Body::e_sleepFlag;
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->IsStatic())
-			{
-				continue;
-			}
-
 			// Search all contacts connected to this body.
 			for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
 			{
-				// Has this contact already been added to an island?
+				// Has this contact already been added to the island?
 				// Is this contact non-solid (involves a sensor).
 				if (cn->contact->m_flags & (b2Contact::e_islandFlag | b2Contact::e_nonSolidFlag | b2Contact::e_invalidFlag | b2Contact::e_destroyFlag))
 				{
@@ -442,17 +727,19 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(cn->contact);
+				island->Add(cn->contact);
 				cn->contact->m_flags |= b2Contact::e_islandFlag;
 
+				// Don't propagate across static or frozen bodies, they
+				// don't belong to any island.
 				b2Body* other = cn->other;
-
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
+				if (other->m_island == NULL || (other->m_flags & b2Body::e_islandFlag))
 				{
 					continue;
 				}
 
+				// Touching contacts between dynamic bodies are linked.
+				b2Assert(other->m_island == pi);
 				b2Assert(stackCount < stackSize);
 				stack[stackCount++] = other;
 				other->m_flags |= b2Body::e_islandFlag;
@@ -466,65 +753,324 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(jn->joint);
+				island->Add(jn->joint);
 				jn->joint->m_islandFlag = true;
 
 				b2Body* other = jn->other;
-				if (other->m_flags & b2Body::e_islandFlag)
+				if (other->m_island == NULL || (other->m_flags & b2Body::e_islandFlag))
 				{
 					continue;
 				}
 
+				b2Assert(other->m_island == pi);
 				b2Assert(stackCount < stackSize);
 				stack[stackCount++] = other;
 				other->m_flags |= b2Body::e_islandFlag;
 			}
 		}
+	}
 
-		island.Solve(step, m_gravity, m_allowSleep);
+	b2Assert(island->m_bodyCount - bodyStart == pi->bodyCount);
+	B2_NOT_USED(bodyStart);
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+	return true;
+}
+
+// Allow the bodies and constraints to be gathered again next step.
+void b2World::ClearIslandFlags(const b2Island* island)
+{
+	for (int32 i = 0; i < island->m_bodyCount; ++i)
+	{
+		island->m_bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+
+	for (int32 i = 0; i < island->m_contactCount; ++i)
+	{
+		island->m_contacts[i]->m_flags &= ~b2Contact::e_islandFlag;
+	}
+
+	for (int32 i = 0; i < island->m_jointCount; ++i)
+	{
+		island->m_joints[i]->m_islandFlag = false;
+	}
+}
+
+void b2World::FinishIsland(b2PersistentIsland* pi, float32 minSleepTime, float32 maxSleepTime)
+{
+	// Split the island lazily, only when constraints were removed
+	// and part of it may go to sleep.
+	if (pi->constraintRemoveCount > 0 && maxSleepTime >= b2_timeToSleep)
+	{
+		m_islandManager.SplitIsland(pi);
+	}
+	else if (minSleepTime >= b2_timeToSleep)
+	{
+		m_islandManager.SleepIsland(pi);
+	}
+}
+
+void b2World::SolveIslands(const b2TimeStep& step)
+{
+	// Size the island for the worst case.
+	b2Island island(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, m_contactListener);
+
+	// Simulate the awake islands. Sleeping islands are not touched. Islands
+	// that go to sleep or come apart are relinked at the head of the lists,
+	// so grab the next island first.
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	b2Timer timer;
+	b2PersistentIsland* next = NULL;
+	for (b2PersistentIsland* pi = m_islandManager.m_awakeList; pi; pi = next)
+	{
+		next = pi->next;
+
+		timer.Reset();
+		island.Clear();
+		bool awake = GatherIsland(pi, &island, stack, stackSize);
+		m_profile.islands += timer.GetMilliseconds();
+		if (awake == false)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->IsStatic())
-			{
-				b->m_flags &= ~b2Body::e_islandFlag;
-			}
+			continue;
 		}
+
+		island.Solve(&m_profile, step, m_gravity, m_allowSleep);
+
+		timer.Reset();
+		ClearIslandFlags(&island);
+		FinishIsland(pi, island.m_minSleepTime, island.m_maxSleepTime);
+		m_profile.islands += timer.GetMilliseconds();
 	}
 
 	m_stackAllocator.Free(stack);
+}
 
-	// Synchronize fixtures, check for out of range bodies.
-	for (b2Body* b = m_bodyList; b; b = b->GetNext())
+// Solve one gathered island with the given stack allocator. Tasks only write to
+// the bodies and constraints of their own island. Static bodies are shared, they
+// are only read.
+void b2World::SolveIslandTask(const b2TimeStep& step, const b2Island* gathered, b2IslandTask* task,
+							  b2ContactImpulse* impulses, b2StackAllocator* allocator)
+{
+	b2ImpulseBuffer buffer;
+	b2ContactListener* listener = NULL;
+	if (impulses)
+	{
+		buffer.m_impulses = impulses + task->contactStart;
+		buffer.m_count = 0;
+		listener = &buffer;
+	}
+
+	b2Island island(task->bodyCount, task->contactCount, task->jointCount, allocator, listener);
+
+	for (int32 i = 0; i < task->bodyCount; ++i)
+	{
+		island.Add(gathered->m_bodies[task->bodyStart + i]);
+	}
+
+	for (int32 i = 0; i < task->contactCount; ++i)
+	{
+		island.Add(gathered->m_contacts[task->contactStart + i]);
+	}
+
+	for (int32 i = 0; i < task->jointCount; ++i)
+	{
+		island.Add(gathered->m_joints[task->jointStart + i]);
+	}
+
+	island.Solve(&task->profile, step, m_gravity, m_allowSleep);
+
+	task->minSleepTime = island.m_minSleepTime;
+	task->maxSleepTime = island.m_maxSleepTime;
+}
+
+void b2World::SolveIslandCallback(void* context, int32 index, int32 threadIndex)
+{
+	b2IslandTaskContext* taskContext = (b2IslandTaskContext*)context;
+	b2World* world = taskContext->world;
+	b2IslandTask* task = taskContext->tasks + index;
+	if (task->serial)
+	{
+		return;
+	}
+
+	b2Assert(0 <= threadIndex && threadIndex < world->m_threadAllocatorCount);
+	world->SolveIslandTask(*taskContext->step, taskContext->gathered, task,
+						   taskContext->impulses, world->m_threadAllocators + threadIndex);
+}
+
+// Gather all awake islands on this thread, solve them with the task scheduler,
+// then report and finish them on this thread in island order. The results don't
+// depend on the number of threads.
+void b2World::SolveIslandsParallel(const b2TimeStep& step)
+{
+	b2Island gathered(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, NULL);
+
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+
+	int32 taskCapacity = m_islandManager.m_awakeCount;
+	b2IslandTask* tasks = (b2IslandTask*)m_stackAllocator.Allocate(taskCapacity * sizeof(b2IslandTask));
+	int32 taskCount = 0;
+
+	// Any thread may take a task, so a task must fit the smallest thread stack.
+	int32 threadStackSize = m_threadAllocators[0].GetCapacity();
+	for (int32 i = 1; i < m_threadAllocatorCount; ++i)
+	{
+		threadStackSize = b2Min(threadStackSize, m_threadAllocators[i].GetCapacity());
+	}
+
+	b2Timer timer;
+	b2PersistentIsland* next = NULL;
+	for (b2PersistentIsland* pi = m_islandManager.m_awakeList; pi; pi = next)
 	{
-		if (b->m_flags & (b2Body::e_sleepFlag | b2Body::e_frozenFlag))
+		next = pi->next;
+
+		b2Assert(taskCount < taskCapacity);
+		b2IslandTask* task = tasks + taskCount;
+		task->bodyStart = gathered.m_bodyCount;
+		task->contactStart = gathered.m_contactCount;
+		task->jointStart = gathered.m_jointCount;
+
+		if (GatherIsland(pi, &gathered, stack, stackSize) == false)
 		{
 			continue;
 		}
 
-		if (b->IsStatic())
+		task->island = pi;
+		task->bodyCount = gathered.m_bodyCount - task->bodyStart;
+		task->contactCount = gathered.m_contactCount - task->contactStart;
+		task->jointCount = gathered.m_jointCount - task->jointStart;
+		task->minSleepTime = 0.0f;
+		task->maxSleepTime = 0.0f;
+		task->profile.SetZero();
+
+		// Thread stacks fall back to b2Alloc when they overflow, which is not thread safe.
+		int32 size = b2Island::GetStackSize(task->bodyCount, task->contactCount, task->jointCount, step.contactBatching);
+		task->serial = size > threadStackSize;
+
+		++taskCount;
+	}
+
+	m_profile.islands += timer.GetMilliseconds();
+
+	// Buffer the impulses if somebody is listening.
+	b2ContactImpulse* impulses = NULL;
+	if (m_contactListener != &b2_defaultListener)
+	{
+		impulses = (b2ContactImpulse*)m_stackAllocator.Allocate(gathered.m_contactCount * sizeof(b2ContactImpulse));
+	}
+
+	b2IslandTaskContext context;
+	context.world = this;
+	context.step = &step;
+	context.gathered = &gathered;
+	context.tasks = tasks;
+	context.impulses = impulses;
+
+	m_taskScheduler->ParallelFor(SolveIslandCallback, &context, taskCount);
+
+	for (int32 i = 0; i < taskCount; ++i)
+	{
+		if (tasks[i].serial)
 		{
-			continue;
+			SolveIslandTask(step, &gathered, tasks + i, impulses, &m_stackAllocator);
 		}
-		
-		// Update fixtures (for broad-phase). If the fixtures go out of
-		// the world AABB then fixtures and contacts may be destroyed,
-		// including contacts that are
-		bool inRange = b->SynchronizeFixtures();
+	}
+
+	timer.Reset();
+	ClearIslandFlags(&gathered);
+
+	for (int32 i = 0; i < taskCount; ++i)
+	{
+		b2IslandTask* task = tasks + i;
+		m_profile.Add(task->profile);
 
-		// Did the body's fixtures leave the world?
-		if (inRange == false && m_boundaryListener != NULL)
+		if (impulses)
 		{
-			m_boundaryListener->Violation(b);
+			for (int32 j = 0; j < task->contactCount; ++j)
+			{
+				int32 index = task->contactStart + j;
+				m_contactListener->PostSolve(gathered.m_contacts[index], impulses + index);
+			}
 		}
+
+		FinishIsland(task->island, task->minSleepTime, task->maxSleepTime);
 	}
 
+	m_profile.islands += timer.GetMilliseconds();
+
+	if (impulses)
+	{
+		m_stackAllocator.Free(impulses);
+	}
+
+	m_stackAllocator.Free(tasks);
+	m_stackAllocator.Free(stack);
+}
+
+// Find islands, integrate and solve constraints, solve position constraints
+void b2World::Solve(const b2TimeStep& step)
+{
+	b2Timer timer;
+
+	// Step all controllers
+	for(b2Controller* controller = m_controllerList; controller; controller = controller->m_next)
+	{
+		controller->Step(step);
+	}
+
+	if (m_taskScheduler != NULL && m_islandManager.m_awakeCount > 1)
+	{
+		SolveIslandsParallel(step);
+	}
+	else
+	{
+		SolveIslands(step);
+	}
+
+	m_profile.solve = timer.GetMilliseconds();
+	timer.Reset();
+
+	b2PersistentIsland* next = NULL;
+
+	// Synchronize fixtures, check for out of range bodies.
+	for (b2PersistentIsland* pi = m_islandManager.m_awakeList; pi; pi = next)
+	{
+		next = pi->next;
+
+		b2Body* nextBody = NULL;
+		for (b2Body* b = pi->bodyList; b; b = nextBody)
+		{
+			// Freezing removes the body from the island.
+			nextBody = b->m_islandNext;
+
+			if (b->m_flags & (b2Body::e_sleepFlag | b2Body::e_frozenFlag))
+			{
+				continue;
+			}
+
+			// Update fixtures (for broad-phase). If the fixtures go out of
+			// the world AABB then fixtures and contacts may be destroyed,
+			// including contacts that are
+			bool inRange = b->SynchronizeFixtures();
+
+			// Did the body's fixtures leave the world?
+			if (inRange == false && m_boundaryListener != NULL)
+			{
+				m_boundaryListener->Violation(b);
+			}
+		}
+	}
+
+	m_profile.synchronize = timer.GetMilliseconds();
+	timer.Reset();
+
 	// Commit fixture proxy movements to the broad-phase so that new contacts are created.
 	// Also, some contacts can be destroyed.
 	m_broadPhase->Commit();
+	m_contactManager.SortNewContacts();
+
+	m_profile.broadphase += timer.GetMilliseconds();
 }
 
 // Find TOI contacts and solve them.
@@ -550,10 +1096,13 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b->m_sweep.t0 = 0.0f;
 	}
 
-	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	// Only contacts of awake bodies can have a TOI event.
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(m_contactCount * sizeof(b2Contact*));
+	int32 contactCount = m_contactManager.GatherAwakeContacts(contacts);
+	for (int32 i = 0; i < contactCount; ++i)
 	{
 		// Invalidate TOI
-		c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+		contacts[i]->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
 	}
 
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
@@ -561,88 +1110,21 @@ void b2World::SolveTOI(const b2TimeStep& step)
             j->m_islandFlag = false;
 	}
 
-	// Find TOI events and solve them.
-	for (;;)
+	// Compute the TOI of every contact once and queue the events.
+	m_toiQueue.Clear();
+	for (int32 i = 0; i < contactCount; ++i)
 	{
-		// Find the first TOI.
-		b2Contact* minContact = NULL;
-		float32 minTOI = 1.0f;
-
-		for (b2Contact* c = m_contactList; c; c = c->m_next)
-		{
-			if (c->m_flags & (b2Contact::e_slowFlag | b2Contact::e_nonSolidFlag | b2Contact::e_invalidFlag | b2Contact::e_destroyFlag))
-			{
-				continue;
-			}
-
-			// TODO_ERIN keep a counter on the contact, only respond to M TOIs per contact.
-
-			float32 toi = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
-			{
-				// This contact has a valid cached TOI.
-				toi = c->m_toi;
-			}
-			else
-			{
-				// Compute the TOI for this contact.
-				b2Fixture* s1 = c->GetFixtureA();
-				b2Fixture* s2 = c->GetFixtureB();
-				b2Body* b1 = s1->GetBody();
-				b2Body* b2 = s2->GetBody();
-
-				if ((b1->IsStatic() || b1->IsSleeping()) && (b2->IsStatic() || b2->IsSleeping()))
-				{
-					continue;
-				}
-
-				// Put the sweeps onto the same time interval.
-				float32 t0 = b1->m_sweep.t0;
-				
-				if (b1->m_sweep.t0 < b2->m_sweep.t0)
-				{
-					t0 = b2->m_sweep.t0;
-					b1->m_sweep.Advance(t0);
-				}
-				else if (b2->m_sweep.t0 < b1->m_sweep.t0)
-				{
-					t0 = b1->m_sweep.t0;
-					b2->m_sweep.Advance(t0);
-				}
-
-				b2Assert(t0 < 1.0f);
-
-				// Compute the time of impact.
-				toi = c->ComputeTOI(b1->m_sweep, b2->m_sweep);
-				//b2TimeOfImpact(c->m_fixtureA->GetShape(), b1->m_sweep, c->m_fixtureB->GetShape(), b2->m_sweep);
-
-				b2Assert(0.0f <= toi && toi <= 1.0f);
-
-				// If the TOI is in range ...
-				if (0.0f < toi && toi < 1.0f)
-				{
-					// Interpolate on the actual range.
-					toi = b2Min((1.0f - toi) * t0 + toi, 1.0f);
-				}
-
-
-				c->m_toi = toi;
-				c->m_flags |= b2Contact::e_toiFlag;
-			}
-
-			if (B2_FLT_EPSILON < toi && toi < minTOI)
-			{
-				// This is the minimum TOI found so far.
-				minContact = c;
-				minTOI = toi;
-			}
-		}
+		UpdateTOI(contacts[i]);
+	}
+	m_stackAllocator.Free(contacts);
 
-		if (minContact == NULL || 1.0f - 100.0f * B2_FLT_EPSILON < minTOI)
-		{
-			// No more TOI events. Done!
-			break;
-		}
+	// Solve TOI events in order. Solving an event only changes the TOIs
+	// of the contacts touching the bodies it advanced.
+	while (m_toiQueue.IsEmpty() == false)
+	{
+		// Find the first TOI.
+		b2Contact* minContact = m_toiQueue.Pop();
+		float32 minTOI = minContact->m_toi;
 
 		// Advance the bodies to the TOI.
 		b2Fixture* s1 = minContact->GetFixtureA();
@@ -670,6 +1152,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		{
 			// This shouldn't happen. Numerical error?
 			//b2Assert(false);
+			UpdateTOI(minContact);
 			continue;
 		}
 
@@ -681,6 +1164,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		}
 		if (seed->IsStatic())
 		{
+			UpdateTOI(minContact);
 			continue;
 		}
 
@@ -702,7 +1186,10 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			island.Add(b);
 
 			// Make sure the body is awake.
-			b->m_flags &= ~b2Body::e_sleepFlag;
+			if (b->IsSleeping())
+			{
+				b->WakeUp();
+			}
 
 			// To keep islands as small as possible, we don't
 			// propagate islands across static bodies.
@@ -795,6 +1282,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 		b2TimeStep subStep;
 		subStep.warmStarting = false;
+		subStep.contactBatching = false;
 		subStep.dt = (1.0f - minTOI) * step.dt;
 		subStep.inv_dt = 1.0f / subStep.dt;
 		subStep.dtRatio = 0.0f;
@@ -856,13 +1344,106 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
 		// Also, some contacts can be destroyed.
 		m_broadPhase->Commit();
+		m_contactManager.SortNewContacts();
+
+		// Recompute the invalidated TOIs. Only the island bodies moved, so
+		// they hold every changed contact, including the ones just created.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* b = island.m_bodies[i];
+			if (b->IsStatic())
+			{
+				continue;
+			}
+
+			for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
+			{
+				if ((cn->contact->m_flags & b2Contact::e_toiFlag) == 0)
+				{
+					UpdateTOI(cn->contact);
+				}
+			}
+		}
 	}
 
+	m_toiQueue.Clear();
 	m_stackAllocator.Free(queue);
 }
 
+// Compute the TOI of a contact and queue it if it is an event in this step.
+void b2World::UpdateTOI(b2Contact* c)
+{
+	if (c->m_flags & (b2Contact::e_slowFlag | b2Contact::e_nonSolidFlag | b2Contact::e_invalidFlag | b2Contact::e_destroyFlag))
+	{
+		m_toiQueue.Remove(c);
+		return;
+	}
+
+	// TODO_ERIN keep a counter on the contact, only respond to M TOIs per contact.
+
+	b2Body* b1 = c->GetFixtureA()->GetBody();
+	b2Body* b2 = c->GetFixtureB()->GetBody();
+
+	if ((b1->IsStatic() || b1->IsSleeping()) && (b2->IsStatic() || b2->IsSleeping()))
+	{
+		m_toiQueue.Remove(c);
+		return;
+	}
+
+	// Put the sweeps onto the same time interval.
+	float32 t0 = b1->m_sweep.t0;
+	
+	if (b1->m_sweep.t0 < b2->m_sweep.t0)
+	{
+		t0 = b2->m_sweep.t0;
+		b1->m_sweep.Advance(t0);
+	}
+	else if (b2->m_sweep.t0 < b1->m_sweep.t0)
+	{
+		t0 = b1->m_sweep.t0;
+		b2->m_sweep.Advance(t0);
+	}
+
+	b2Assert(t0 < 1.0f);
+
+	// Compute the time of impact.
+	float32 toi = c->ComputeTOI(b1->m_sweep, b2->m_sweep);
+
+	b2Assert(0.0f <= toi && toi <= 1.0f);
+
+	// If the TOI is in range ...
+	if (0.0f < toi && toi < 1.0f)
+	{
+		// Interpolate on the actual range.
+		toi = b2Min((1.0f - toi) * t0 + toi, 1.0f);
+	}
+
+	c->m_toi = toi;
+	c->m_flags |= b2Contact::e_toiFlag;
+
+	// TOIs at the start or the end of the step are not events.
+	if (B2_FLT_EPSILON < toi && toi <= 1.0f - 100.0f * B2_FLT_EPSILON)
+	{
+		if (c->m_toiIndex == b2_nullTOIIndex)
+		{
+			m_toiQueue.Push(c);
+		}
+		else
+		{
+			m_toiQueue.Update(c);
+		}
+	}
+	else
+	{
+		m_toiQueue.Remove(c);
+	}
+}
+
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
 {
+	b2Timer stepTimer;
+	m_profile.SetZero();
+
 	m_lock = true;
 
 	b2TimeStep step;
@@ -881,9 +1462,18 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
-	
+	step.contactBatching = m_contactBatching;
+
+	// Find the pairs of proxies created since the last step.
+	b2Timer timer;
+	m_broadPhase->Commit();
+	m_contactManager.SortNewContacts();
+	m_profile.broadphase = timer.GetMilliseconds();
+
 	// Update contacts.
+	timer.Reset();
 	m_contactManager.Collide();
+	m_profile.collide = timer.GetMilliseconds();
 
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (step.dt > 0.0f)
@@ -894,18 +1484,91 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	// Handle TOI events.
 	if (m_continuousPhysics && step.dt > 0.0f)
 	{
+		timer.Reset();
 		SolveTOI(step);
+		m_profile.solveTOI = timer.GetMilliseconds();
 	}
 
 	// Draw debug information.
 	DrawDebugData();
 
+	// Grow the stacks so the next step doesn't need b2Alloc.
+	m_stackPeak = m_stackAllocator.GetMaxAllocation();
+	m_stackAllocator.Grow();
+	for (int32 i = 0; i < m_threadAllocatorCount; ++i)
+	{
+		m_threadAllocators[i].Grow();
+	}
+
 	if (step.dt > 0.0f)
 	{
 		m_inv_dt0 = step.inv_dt;
 	}
 
 	m_lock = false;
+
+	m_profile.step = stepTimer.GetMilliseconds();
+}
+
+int32 b2World::TrimMemory()
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
+	{
+		return 0;
+	}
+
+	return m_blockAllocator.Trim();
+}
+
+int32 b2World::GetStackOverflowCount() const
+{
+	int32 count = m_stackAllocator.GetOverflowCount();
+	for (int32 i = 0; i < m_threadAllocatorCount; ++i)
+	{
+		count += m_threadAllocators[i].GetOverflowCount();
+	}
+	return count;
+}
+
+int32 b2World::GetBodyStates(float32* states, int32* indices, int32 capacity, bool includeVelocity) const
+{
+	// Awake bodies are exactly the bodies of the awake islands.
+	int32 count = 0;
+	for (b2PersistentIsland* pi = m_islandManager.m_awakeList; pi; pi = pi->next)
+	{
+		for (b2Body* b = pi->bodyList; b; b = b->m_islandNext)
+		{
+			if (count == capacity)
+			{
+				return count;
+			}
+
+			if (indices)
+			{
+				indices[count] = b->m_index;
+			}
+
+			states[0] = b->m_xf.position.x;
+			states[1] = b->m_xf.position.y;
+			states[2] = b->m_sweep.a;
+			if (includeVelocity)
+			{
+				states[3] = b->m_linearVelocity.x;
+				states[4] = b->m_linearVelocity.y;
+				states[5] = b->m_angularVelocity;
+				states += 6;
+			}
+			else
+			{
+				states += 3;
+			}
+
+			++count;
+		}
+	}
+
+	return count;
 }
 
 int32 b2World::Query(const b2AABB& aabb, b2Fixture** fixtures, int32 maxCount)
@@ -1106,31 +1769,20 @@ void b2World::DrawDebugData()
 	if (flags & b2DebugDraw::e_pairBit)
 	{
 		b2BroadPhase* bp = m_broadPhase;
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
 		b2Color color(0.9f, 0.9f, 0.3f);
 
-		for (int32 i = 0; i < b2_tableCapacity; ++i)
+		for (int32 i = 0; i < bp->m_pairManager.m_tableCapacity; ++i)
 		{
-			uint16 index = bp->m_pairManager.m_hashTable[i];
+			int32 index = bp->m_pairManager.m_hashTable[i];
 			while (index != b2_nullPair)
 			{
 				b2Pair* pair = bp->m_pairManager.m_pairs + index;
-				b2Proxy* p1 = bp->m_proxyPool + pair->proxyId1;
-				b2Proxy* p2 = bp->m_proxyPool + pair->proxyId2;
-
-				b2AABB b1, b2;
-				b1.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->lowerBounds[0]].value;
-				b1.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->lowerBounds[1]].value;
-				b1.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->upperBounds[0]].value;
-				b1.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->upperBounds[1]].value;
-				b2.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->lowerBounds[0]].value;
-				b2.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->lowerBounds[1]].value;
-				b2.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->upperBounds[0]].value;
-				b2.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->upperBounds[1]].value;
-
-				b2Vec2 x1 = 0.5f * (b1.lowerBound + b1.upperBound);
-				b2Vec2 x2 = 0.5f * (b2.lowerBound + b2.upperBound);
+
+				b2AABB b1 = bp->GetProxyAABB(pair->proxyId1);
+				b2AABB b2 = bp->GetProxyAABB(pair->proxyId2);
+
+				b2Vec2 x1 = b1.GetCenter();
+				b2Vec2 x2 = b2.GetCenter();
 
 				m_debugDraw->DrawSegment(x1, x2, color);
 
@@ -1142,41 +1794,42 @@ void b2World::DrawDebugData()
 	if (flags & b2DebugDraw::e_aabbBit)
 	{
 		b2BroadPhase* bp = m_broadPhase;
-		b2Vec2 worldLower = bp->m_worldAABB.lowerBound;
-		b2Vec2 worldUpper = bp->m_worldAABB.upperBound;
 
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
 		b2Color color(0.9f, 0.3f, 0.9f);
-		for (int32 i = 0; i < b2_maxProxies; ++i)
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			b2Proxy* p = bp->m_proxyPool + i;
-			if (p->IsValid() == false)
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
 			{
-				continue;
-			}
+				if (f->m_proxyId == b2_nullProxy)
+				{
+					continue;
+				}
 
-			b2AABB b;
-			b.lowerBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->lowerBounds[0]].value;
-			b.lowerBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->lowerBounds[1]].value;
-			b.upperBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->upperBounds[0]].value;
-			b.upperBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->upperBounds[1]].value;
+				b2AABB aabb = bp->GetProxyAABB(f->m_proxyId);
 
-			b2Vec2 vs[4];
-			vs[0].Set(b.lowerBound.x, b.lowerBound.y);
-			vs[1].Set(b.upperBound.x, b.lowerBound.y);
-			vs[2].Set(b.upperBound.x, b.upperBound.y);
-			vs[3].Set(b.lowerBound.x, b.upperBound.y);
+				b2Vec2 vs[4];
+				vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+				vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+				vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+				vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
 
-			m_debugDraw->DrawPolygon(vs, 4, color);
+				m_debugDraw->DrawPolygon(vs, 4, color);
+			}
 		}
 
-		b2Vec2 vs[4];
-		vs[0].Set(worldLower.x, worldLower.y);
-		vs[1].Set(worldUpper.x, worldLower.y);
-		vs[2].Set(worldUpper.x, worldUpper.y);
-		vs[3].Set(worldLower.x, worldUpper.y);
-		m_debugDraw->DrawPolygon(vs, 4, b2Color(0.3f, 0.9f, 0.9f));
+		if (bp->GetType() == e_sweepAndPruneBroadPhase)
+		{
+			b2SAPBroadPhase* sap = (b2SAPBroadPhase*)bp;
+			b2Vec2 worldLower = sap->m_worldAABB.lowerBound;
+			b2Vec2 worldUpper = sap->m_worldAABB.upperBound;
+
+			b2Vec2 vs[4];
+			vs[0].Set(worldLower.x, worldLower.y);
+			vs[1].Set(worldUpper.x, worldLower.y);
+			vs[2].Set(worldUpper.x, worldUpper.y);
+			vs[3].Set(worldLower.x, worldUpper.y);
+			m_debugDraw->DrawPolygon(vs, 4, b2Color(0.3f, 0.9f, 0.9f));
+		}
 	}
 
 	if (flags & b2DebugDraw::e_centerOfMassBit)
@@ -1197,12 +1850,22 @@ void b2World::Validate()
 
 int32 b2World::GetProxyCount() const
 {
-	return m_broadPhase->m_proxyCount;
+	return m_broadPhase->GetProxyCount();
 }
 
 int32 b2World::GetPairCount() const
 {
-	return m_broadPhase->m_pairManager.m_pairCount;
+	return m_broadPhase->GetPairCount();
+}
+
+int32 b2World::GetMaxProxyCount() const
+{
+	return m_broadPhase->GetMaxProxyCount();
+}
+
+int32 b2World::GetMaxPairCount() const
+{
+	return m_broadPhase->GetMaxPairCount();
 }
 
 bool b2World::InRange(const b2AABB& aabb) const
@@ -1210,6 +1873,11 @@ bool b2World::InRange(const b2AABB& aabb) const
 	return m_broadPhase->InRange(aabb);
 }
 
+b2BroadPhaseType b2World::GetBroadPhaseType() const
+{
+	return m_broadPhase->GetType();
+}
+
 float32 b2World::RaycastSortKey(void* data)
 {
 	b2Fixture* fixture = (b2Fixture*)data;
@@ -22,7 +22,11 @@
 #include "../Common/b2Math.h"
 #include "../Common/b2BlockAllocator.h"
 #include "../Common/b2StackAllocator.h"
+#include "../Common/b2TaskScheduler.h"
+#include "../Common/b2Timer.h"
 #include "b2ContactManager.h"
+#include "b2IslandManager.h"
+#include "b2TOIQueue.h"
 #include "b2WorldCallbacks.h"
 
 struct b2AABB;
@@ -35,6 +39,10 @@ class b2Contact;
 class b2BroadPhase;
 class b2Controller;
 class b2ControllerDef;
+class b2Island;
+struct b2PersistentIsland;
+struct b2IslandTask;
+struct b2ContactImpulse;
 
 struct b2TimeStep
 {
@@ -44,6 +52,36 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool contactBatching;
+};
+
+/// Time spent in the phases of b2World::Step, in milliseconds. The island
+/// phases are summed over all islands, so with a task scheduler they add up
+/// the time of every thread and may exceed the step time.
+struct b2Profile
+{
+	/// Set all times to zero.
+	void SetZero();
+
+	/// Add the times of another profile, to accumulate over steps.
+	void Add(const b2Profile& profile);
+
+	/// Keep the larger time of each phase.
+	void Max(const b2Profile& profile);
+
+	/// Multiply all times, for example by 1 / stepCount to average.
+	void Scale(float scale);
+
+	float step;				///< all of b2World::Step
+	float collide;			///< narrow phase
+	float solve;			///< controllers and islands, up to synchronize
+	float islands;			///< gathering, sleeping and splitting islands
+	float solveInit;		///< integrating velocities and initializing constraints
+	float solveVelocity;	///< velocity iterations
+	float solvePosition;	///< integrating positions and position iterations
+	float synchronize;		///< moving fixture proxies after the solve
+	float broadphase;		///< finding new pairs
+	float solveTOI;			///< continuous collision
 };
 
 /// The world class manages all physics entities, dynamic simulation,
@@ -54,9 +92,17 @@ class b2World
 public:
 	/// Construct a world object.
 	/// @param worldAABB a bounding box that completely encompasses all your shapes.
+	/// This only bounds the sweep and prune broad-phase, the dynamic tree has no limits.
 	/// @param gravity the world gravity vector.
 	/// @param doSleep improve performance by not simulating inactive bodies.
-	b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep);
+	/// @param broadPhaseType the broad-phase algorithm. Sweep and prune is the default, it
+	/// freezes bodies that leave the world AABB and reports them to the boundary listener.
+	/// The dynamic tree never freezes bodies, choose it for worlds without fixed bounds.
+	/// @param stackSize the initial size in bytes of the per step stack allocator. The
+	/// stack grows between steps to fit the peak use of the previous step.
+	b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep,
+			b2BroadPhaseType broadPhaseType = e_sweepAndPruneBroadPhase,
+			int32 stackSize = b2_stackSize);
 
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
@@ -79,6 +125,17 @@ public:
 	/// consume draw commands when you call Step().
 	void SetDebugDraw(b2DebugDraw* debugDraw);
 
+	/// Register a task scheduler to solve independent islands in parallel. By default
+	/// there is no scheduler and islands are solved on the thread calling Step.
+	/// Contact listener callbacks are always called on the thread calling Step, in
+	/// the same order for every thread count. PostSolve is called after all islands
+	/// are solved. The scheduler must outlive the world or be removed first.
+	/// @param scheduler the task scheduler, or NULL to solve serially.
+	void SetTaskScheduler(b2TaskScheduler* scheduler);
+
+	/// Get the task scheduler, if any.
+	b2TaskScheduler* GetTaskScheduler();
+
 	/// Create a rigid body given a definition. No reference to the definition
 	/// is retained.
 	/// @warning This function is locked during callbacks.
@@ -90,6 +147,41 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyBody(b2Body* body);
 
+	/// Create many bodies with their fixtures at once, for example to load a level.
+	/// This reserves allocator memory for all of them, computes the mass of each
+	/// body once from its shapes if any of its fixtures has density, and creates
+	/// all broad-phase proxies in one batch. No reference to the definitions is retained.
+	/// @param bodyDefs the body definitions.
+	/// @param bodyCount the number of bodies.
+	/// @param fixtureDefs the fixture definitions of all bodies, body after body.
+	/// @param fixtureCounts the number of fixtures of each body.
+	/// @param bodies receives the created bodies, may be NULL.
+	/// @warning This function is locked during callbacks.
+	void CreateBodies(const b2BodyDef* bodyDefs, int32 bodyCount,
+					const b2FixtureDef* const* fixtureDefs, const int32* fixtureCounts, b2Body** bodies);
+
+	/// Create the bodies of a level made by b2BakeLevel. The shape data, masses
+	/// and AABBs are copied from the level instead of being computed, and all
+	/// broad-phase proxies are created in one batch. The level is not referenced
+	/// afterwards, so a memory mapped level file can be unmapped.
+	/// @param level the baked level.
+	/// @param size the size of the level in bytes.
+	/// @param bodies receives the bodies in the order of the level, may be NULL.
+	/// @return false if the level is not valid for this build.
+	/// @warning This function is locked during callbacks.
+	bool CreateBakedBodies(const void* level, int32 size, b2Body** bodies);
+
+	/// Set the position and angle of many bodies at once, for example to respawn
+	/// pooled objects. This works like b2Body::SetXForm on each body, but commits
+	/// the broad-phase only once, after all proxies have moved.
+	/// @param bodies the bodies to move. They should be distinct, a body given more
+	/// than once is moved by each entry in turn and ends at its last transform.
+	/// @param positions the new world positions of the body origins.
+	/// @param angles the new world rotation angles in radians.
+	/// @param count the number of bodies.
+	/// @return the number of bodies that are frozen, because they left the world now or before.
+	int32 SetXForms(b2Body** bodies, const b2Vec2* positions, const float32* angles, int32 count);
+
 	/// Create a joint to constrain bodies together. No reference to the definition
 	/// is retained. This may cause the connected bodies to cease colliding.
 	/// @warning This function is locked during callbacks.
@@ -151,6 +243,9 @@ public:
 	/// Check if the AABB is within the broad-phase limits.
 	bool InRange(const b2AABB& aabb) const;
 
+	/// Get the broad-phase algorithm used by this world.
+	b2BroadPhaseType GetBroadPhaseType() const;
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A NULL body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -164,7 +259,10 @@ public:
 	/// Get the world contact list. With the returned contact, use b2Contact::GetNext to get
 	/// the next contact in the world list. A NULL contact indicates the end of the list.
 	/// @return the head of the world contact list.
-	/// @warning contacts are 
+	/// @warning the contacts are kept in an array. Destroying a contact moves the last
+	/// contact into its place, so the order changes whenever a contact goes away.
+	/// Do not destroy bodies or fixtures while walking this list, the moved contact
+	/// would be skipped. Collect what to destroy first, then destroy it after the walk.
 	b2Contact* GetContactList();
 
 	/// Get the world controller list. With the returned controller, use b2Controller::GetNext to get
@@ -181,6 +279,18 @@ public:
 	/// Enable/disable continuous physics. For testing.
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 
+	/// Enable/disable the batched contact solver. It solves groups of contacts
+	/// that don't share a body with SSE or NEON when available. The contacts are
+	/// solved in a different order, so results differ slightly. Off by default.
+	void SetContactBatching(bool flag) { m_contactBatching = flag; }
+
+	/// Enable/disable the deterministic mode for lockstep and rollback. New contacts are
+	/// ordered by body index and fixture position instead of broad-phase pair order, so
+	/// a world restored from a snapshot steps exactly like the original. Float results
+	/// only match on the same binary and CPU, use the fixed point build to match across
+	/// devices. Set it before creating the fixtures. Off by default.
+	void SetDeterministic(bool flag) { m_deterministic = flag; }
+
 	/// Perform validation of internal data structures.
 	void Validate();
 
@@ -190,6 +300,12 @@ public:
 	/// Get the number of broad-phase pairs.
 	int32 GetPairCount() const;
 
+	/// Get the largest number of broad-phase proxies since the world was created.
+	int32 GetMaxProxyCount() const;
+
+	/// Get the largest number of broad-phase pairs since the world was created.
+	int32 GetMaxPairCount() const;
+
 	/// Get the number of bodies.
 	int32 GetBodyCount() const;
 
@@ -202,6 +318,79 @@ public:
 	/// Get the number of controllers.
 	int32 GetControllerCount() const;
 
+	/// Get the number of awake islands. Only awake islands are simulated.
+	int32 GetAwakeIslandCount() const;
+
+	/// Get the number of sleeping islands.
+	int32 GetSleepingIslandCount() const;
+
+	/// Get the peak stack allocator use of the last step, in bytes.
+	int32 GetStackPeak() const;
+
+	/// Get the size of the stack allocator in bytes.
+	int32 GetStackCapacity() const;
+
+	/// Get the usage of the block allocator that holds the bodies, fixtures,
+	/// joints and contacts.
+	void GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const;
+
+	/// Release the block allocator memory that holds no live objects, for
+	/// example after destroying many bodies.
+	/// @return the number of bytes released.
+	/// @warning This function is locked during callbacks.
+	int32 TrimMemory();
+
+	/// Get the number of stack allocations that did not fit and used b2Alloc
+	/// since the world was created. Raise the initial stack size if this grows
+	/// after the first steps.
+	int32 GetStackOverflowCount() const;
+
+	/// Write the state of every awake body into caller provided buffers, for
+	/// handing the whole world to another language or thread in one copy. Static,
+	/// sleeping and frozen bodies are skipped. Each record in states holds
+	/// position x, y and angle, followed by linear velocity x, y and angular
+	/// velocity if includeVelocity is set. The values are float32, so fixed point
+	/// builds write 16.16 fixed point numbers.
+	/// @param states a user allocated array of capacity * 3 float32, or
+	/// capacity * 6 if includeVelocity is set.
+	/// @param indices receives the b2Body::GetIndex of each record, may be NULL.
+	/// @param capacity the number of records that fit in the arrays.
+	/// @param includeVelocity also write the body velocities.
+	/// @return the number of records written.
+	int32 GetBodyStates(float32* states, int32* indices, int32 capacity, bool includeVelocity) const;
+
+	/// Get the number of body indices in use, one more than the largest
+	/// b2Body::GetIndex. Use this to size arrays indexed by body.
+	int32 GetBodyIndexCount() const;
+
+	/// Write the world to a buffer: the bodies with their fixtures, the joints,
+	/// the contacts with their warm starting impulses and the islands with their
+	/// sleep state. A world restored from it steps like this one, except that the
+	/// sweep and prune broad-phase may report new pairs in a different order.
+	/// User data, controllers and listeners are not written.
+	/// @param buffer the buffer, may be NULL to get the size.
+	/// @param capacity the size of the buffer in bytes.
+	/// @return the size of the snapshot in bytes. The buffer holds no valid
+	/// snapshot if this is larger than capacity.
+	/// @warning This function is locked during callbacks.
+	int32 WriteSnapshot(void* buffer, int32 capacity);
+
+	/// Replace all bodies, joints and contacts by those of a snapshot written by
+	/// a build with the same math type. The bodies keep their b2Body::GetIndex,
+	/// so the user data can be restored from it. The destruction listener is
+	/// not called for the replaced objects.
+	/// @return false, leaving the world as it was, if the data is not a complete
+	/// snapshot of this version.
+	/// @warning This function is locked during callbacks.
+	bool ReadSnapshot(const void* data, int32 size);
+
+	/// Get a hash of the body positions, angles and velocities. Compare it after
+	/// each step to find the first step where two simulations differ.
+	uint32 GetChecksum() const;
+
+	/// Get the time spent in each phase of the last step.
+	const b2Profile& GetProfile() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 	
@@ -212,10 +401,21 @@ private:
 
 	friend class b2Body;
 	friend class b2ContactManager;
+	friend class b2IslandManager;
 	friend class b2Controller;
+	friend class b2Contact;
 
 	void Solve(const b2TimeStep& step);
+	void SolveIslands(const b2TimeStep& step);
+	void SolveIslandsParallel(const b2TimeStep& step);
+	void SolveIslandTask(const b2TimeStep& step, const b2Island* gathered, b2IslandTask* task,
+						b2ContactImpulse* impulses, b2StackAllocator* allocator);
+	static void SolveIslandCallback(void* context, int32 index, int32 threadIndex);
+	bool GatherIsland(b2PersistentIsland* pi, b2Island* island, b2Body** stack, int32 stackSize);
+	static void ClearIslandFlags(const b2Island* island);
+	void FinishIsland(b2PersistentIsland* pi, float32 minSleepTime, float32 maxSleepTime);
 	void SolveTOI(const b2TimeStep& step);
+	void UpdateTOI(b2Contact* contact);
 
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2XForm& xf, const b2Color& color);
@@ -227,13 +427,32 @@ private:
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// One stack allocator per scheduler thread.
+	b2TaskScheduler* m_taskScheduler;
+	b2StackAllocator* m_threadAllocators;
+	int32 m_threadAllocatorCount;
+
+	// The initial stack size and the peak use of the last step.
+	int32 m_stackSize;
+	int32 m_stackPeak;
+
+	b2Profile m_profile;
+
 	bool m_lock;
 
 	b2BroadPhase* m_broadPhase;
 	b2ContactManager m_contactManager;
+	b2IslandManager m_islandManager;
+	b2TOIQueue m_toiQueue;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
+
+	// Body indices freed by DestroyBody, reused before new ones are handed out.
+	int32* m_freeBodyIndices;
+	int32 m_freeBodyIndexCount;
+	int32 m_freeBodyIndexCapacity;
+	int32 m_bodyIndexCount;
 	b2Controller* m_controllerList;
 
 	b2Vec2 m_raycastNormal;
@@ -241,8 +460,10 @@ private:
 	const b2Segment* m_raycastSegment;
 	bool m_raycastSolidShape;
 
-	// Do not access
-	b2Contact* m_contactList;
+	// The contacts, in a dense array maintained by the contact manager. A
+	// contact removed from the middle is replaced by the last one.
+	b2Contact** m_contacts;
+	int32 m_contactCapacity;
 
 	int32 m_bodyCount;
 	int32 m_contactCount;
@@ -269,6 +490,10 @@ private:
 
 	// This is for debugging the solver.
 	bool m_continuousPhysics;
+
+	bool m_contactBatching;
+
+	bool m_deterministic;
 };
 
 inline b2Body* b2World::GetGroundBody()
@@ -276,11 +501,21 @@ inline b2Body* b2World::GetGroundBody()
 	return m_groundBody;
 }
 
+inline b2TaskScheduler* b2World::GetTaskScheduler()
+{
+	return m_taskScheduler;
+}
+
 inline b2Body* b2World::GetBodyList()
 {
 	return m_bodyList;
 }
 
+inline int32 b2World::GetBodyIndexCount() const
+{
+	return m_bodyIndexCount;
+}
+
 inline b2Joint* b2World::GetJointList()
 {
 	return m_jointList;
@@ -288,7 +523,7 @@ inline b2Joint* b2World::GetJointList()
 
 inline b2Contact* b2World::GetContactList()
 {
-	return m_contactList;
+	return m_contactCount > 0 ? m_contacts[0] : NULL;
 }
 
 inline b2Controller* b2World::GetControllerList()
@@ -316,6 +551,92 @@ inline int32 b2World::GetControllerCount() const
 	return m_controllerCount;
 }
 
+inline int32 b2World::GetAwakeIslandCount() const
+{
+	return m_islandManager.m_awakeCount;
+}
+
+inline int32 b2World::GetSleepingIslandCount() const
+{
+	return m_islandManager.m_sleepCount;
+}
+
+inline void b2World::GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const
+{
+	m_blockAllocator.GetStats(stats);
+}
+
+inline int32 b2World::GetStackPeak() const
+{
+	return m_stackPeak;
+}
+
+inline const b2Profile& b2World::GetProfile() const
+{
+	return m_profile;
+}
+
+inline void b2Profile::SetZero()
+{
+	step = 0.0f;
+	collide = 0.0f;
+	solve = 0.0f;
+	islands = 0.0f;
+	solveInit = 0.0f;
+	solveVelocity = 0.0f;
+	solvePosition = 0.0f;
+	synchronize = 0.0f;
+	broadphase = 0.0f;
+	solveTOI = 0.0f;
+}
+
+inline void b2Profile::Add(const b2Profile& profile)
+{
+	step += profile.step;
+	collide += profile.collide;
+	solve += profile.solve;
+	islands += profile.islands;
+	solveInit += profile.solveInit;
+	solveVelocity += profile.solveVelocity;
+	solvePosition += profile.solvePosition;
+	synchronize += profile.synchronize;
+	broadphase += profile.broadphase;
+	solveTOI += profile.solveTOI;
+}
+
+inline void b2Profile::Max(const b2Profile& profile)
+{
+	step = b2Max(step, profile.step);
+	collide = b2Max(collide, profile.collide);
+	solve = b2Max(solve, profile.solve);
+	islands = b2Max(islands, profile.islands);
+	solveInit = b2Max(solveInit, profile.solveInit);
+	solveVelocity = b2Max(solveVelocity, profile.solveVelocity);
+	solvePosition = b2Max(solvePosition, profile.solvePosition);
+	synchronize = b2Max(synchronize, profile.synchronize);
+	broadphase = b2Max(broadphase, profile.broadphase);
+	solveTOI = b2Max(solveTOI, profile.solveTOI);
+}
+
+inline void b2Profile::Scale(float scale)
+{
+	step *= scale;
+	collide *= scale;
+	solve *= scale;
+	islands *= scale;
+	solveInit *= scale;
+	solveVelocity *= scale;
+	solvePosition *= scale;
+	synchronize *= scale;
+	broadphase *= scale;
+	solveTOI *= scale;
+}
+
+inline int32 b2World::GetStackCapacity() const
+{
+	return m_stackAllocator.GetCapacity();
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
@@ -0,0 +1,898 @@
+/*
+* Copyright (c) 2009 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2World.h"
+#include "b2Body.h"
+#include "b2Fixture.h"
+#include "Contacts/b2Contact.h"
+#include "Joints/b2DistanceJoint.h"
+#include "Joints/b2FixedJoint.h"
+#include "Joints/b2GearJoint.h"
+#include "Joints/b2LineJoint.h"
+#include "Joints/b2MouseJoint.h"
+#include "Joints/b2PrismaticJoint.h"
+#include "Joints/b2PulleyJoint.h"
+#include "Joints/b2RevoluteJoint.h"
+#include "../Collision/b2BroadPhase.h"
+#include "../Collision/Shapes/b2CircleShape.h"
+#include "../Collision/Shapes/b2PolygonShape.h"
+#include "../Collision/Shapes/b2EdgeShape.h"
+#include "../Common/b2Snapshot.h"
+#include <cstdlib>
+#include <cstring>
+
+// The snapshot is a flat list of 4 byte values. Every linked list is written
+// from its tail to its head, so prepending the objects while reading restores
+// the list order, and with it the order in which the step visits them.
+
+static const int32 b2_snapshotMagic = 0x62325353;
+static const int32 b2_snapshotEndMagic = 0x62325345;
+static const int32 b2_snapshotVersion = 1;
+
+#ifdef TARGET_FLOAT32_IS_FIXED
+static const int32 b2_snapshotMathType = 1;
+#else
+static const int32 b2_snapshotMathType = 0;
+#endif
+
+// Get the position of the fixture that holds the edge, or -1.
+static int32 b2GetEdgeOrdinal(b2Fixture** fixtures, int32 count, const b2EdgeShape* edge)
+{
+	if (edge == NULL)
+	{
+		return -1;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (fixtures[i]->GetShape() == edge)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// Get the position of the joint in the snapshot, counted from the tail of the world's list.
+static int32 b2GetJointOrdinal(b2World* world, const b2Joint* joint)
+{
+	int32 i = 0;
+	for (b2Joint* j = world->GetJointList(); j; j = j->GetNext(), ++i)
+	{
+		if (j == joint)
+		{
+			return world->GetJointCount() - 1 - i;
+		}
+	}
+
+	return -1;
+}
+
+int32 b2World::WriteSnapshot(void* buffer, int32 capacity)
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
+	{
+		return 0;
+	}
+
+	b2SnapshotWriter writer(buffer, capacity);
+	const uint32 contactFlags = b2Contact::e_nonSolidFlag | b2Contact::e_slowFlag | b2Contact::e_touchFlag;
+
+	int32 fixtureCount = 0;
+	b2Body* bodyTail = NULL;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		fixtureCount += b->m_fixtureCount;
+		bodyTail = b;
+	}
+
+	writer.WriteInt32(b2_snapshotMagic);
+	writer.WriteInt32(b2_snapshotVersion);
+	writer.WriteInt32(b2_snapshotMathType);
+
+	writer.WriteVec2(m_gravity);
+	writer.WriteBool(m_allowSleep);
+	writer.WriteBool(m_warmStarting);
+	writer.WriteBool(m_continuousPhysics);
+	writer.WriteBool(m_contactBatching);
+	writer.WriteFloat32(m_inv_dt0);
+
+	writer.WriteInt32(m_bodyIndexCount);
+	writer.WriteInt32(m_freeBodyIndexCount);
+	for (int32 i = 0; i < m_freeBodyIndexCount; ++i)
+	{
+		writer.WriteInt32(m_freeBodyIndices[i]);
+	}
+	writer.WriteInt32(m_groundBody ? m_groundBody->m_index : -1);
+
+	writer.WriteInt32(m_bodyCount);
+	writer.WriteInt32(fixtureCount);
+	writer.WriteInt32(m_jointCount);
+	writer.WriteInt32(m_contactCount);
+	writer.WriteInt32(m_islandManager.m_awakeCount);
+	writer.WriteInt32(m_islandManager.m_sleepCount);
+
+	// Bodies and their fixtures.
+	int32 maxFixtureCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		maxFixtureCount = b2Max(maxFixtureCount, b->m_fixtureCount);
+	}
+	b2Fixture** fixtures = (b2Fixture**)m_stackAllocator.Allocate(maxFixtureCount * sizeof(b2Fixture*));
+
+	for (b2Body* b = bodyTail; b; b = b->m_prev)
+	{
+		writer.WriteInt32(b->m_index);
+		writer.WriteInt32(b->m_flags & ~b2Body::e_islandFlag);
+		writer.WriteInt32(b->m_type);
+		writer.WriteVec2(b->m_xf.position);
+		writer.WriteVec2(b->m_xf.R.col1);
+		writer.WriteVec2(b->m_xf.R.col2);
+		writer.WriteVec2(b->m_sweep.localCenter);
+		writer.WriteVec2(b->m_sweep.c0);
+		writer.WriteVec2(b->m_sweep.c);
+		writer.WriteFloat32(b->m_sweep.a0);
+		writer.WriteFloat32(b->m_sweep.a);
+		writer.WriteFloat32(b->m_sweep.t0);
+		writer.WriteVec2(b->m_linearVelocity);
+		writer.WriteFloat32(b->m_angularVelocity);
+		writer.WriteVec2(b->m_force);
+		writer.WriteFloat32(b->m_torque);
+		writer.WriteFloat32(b->m_mass);
+		writer.WriteFloat32(b->m_invMass);
+		writer.WriteFloat32(b->m_I);
+		writer.WriteFloat32(b->m_invI);
+		writer.WriteFloat32(b->m_linearDamping);
+		writer.WriteFloat32(b->m_angularDamping);
+		writer.WriteFloat32(b->m_sleepTime);
+
+		int32 count = b->m_fixtureCount;
+		int32 i = count;
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			fixtures[--i] = f;
+		}
+
+		writer.WriteInt32(count);
+		for (i = 0; i < count; ++i)
+		{
+			b2Fixture* f = fixtures[i];
+			writer.WriteInt32(f->m_type);
+			writer.WriteFloat32(f->m_friction);
+			writer.WriteFloat32(f->m_restitution);
+			writer.WriteFloat32(f->m_density);
+			writer.WriteInt32(f->m_filter.categoryBits);
+			writer.WriteInt32(f->m_filter.maskBits);
+			writer.WriteInt32(f->m_filter.groupIndex);
+			writer.WriteBool(f->m_isSensor);
+
+			// The broad-phase bounds, so the restored proxies find the same pairs.
+			bool hasProxy = f->m_proxyId != b2_nullProxy;
+			b2AABB aabb;
+			if (hasProxy)
+			{
+				aabb = m_broadPhase->GetProxyAABB(f->m_proxyId);
+			}
+			else
+			{
+				aabb.lowerBound.SetZero();
+				aabb.upperBound.SetZero();
+			}
+			writer.WriteBool(hasProxy);
+			writer.WriteVec2(aabb.lowerBound);
+			writer.WriteVec2(aabb.upperBound);
+
+			switch (f->m_type)
+			{
+			case b2_circleShape:
+				{
+					b2CircleShape* circle = (b2CircleShape*)f->m_shape;
+					writer.WriteVec2(circle->m_p);
+					writer.WriteFloat32(circle->m_radius);
+				}
+				break;
+
+			case b2_polygonShape:
+				{
+					b2PolygonShape* polygon = (b2PolygonShape*)f->m_shape;
+					writer.WriteInt32(polygon->m_vertexCount);
+					for (int32 k = 0; k < polygon->m_vertexCount; ++k)
+					{
+						writer.WriteVec2(polygon->m_vertices[k]);
+					}
+				}
+				break;
+
+			case b2_edgeShape:
+				{
+					b2EdgeShape* edge = (b2EdgeShape*)f->m_shape;
+					writer.WriteVec2(edge->GetVertex1());
+					writer.WriteVec2(edge->GetVertex2());
+					writer.WriteInt32(b2GetEdgeOrdinal(fixtures, count, edge->m_prevEdge));
+					writer.WriteVec2(edge->GetCorner1Vector());
+					writer.WriteBool(edge->Corner1IsConvex());
+					writer.WriteInt32(b2GetEdgeOrdinal(fixtures, count, edge->m_nextEdge));
+					writer.WriteVec2(edge->GetCorner2Vector());
+					writer.WriteBool(edge->Corner2IsConvex());
+				}
+				break;
+
+			default:
+				b2Assert(false);
+				break;
+			}
+		}
+	}
+
+	m_stackAllocator.Free(fixtures);
+
+	// Joints.
+	b2Joint* jointTail = m_jointList;
+	while (jointTail && jointTail->m_next)
+	{
+		jointTail = jointTail->m_next;
+	}
+
+	for (b2Joint* j = jointTail; j; j = j->m_prev)
+	{
+		writer.WriteInt32(j->m_type);
+		writer.WriteInt32(j->m_body1->m_index);
+		writer.WriteInt32(j->m_body2->m_index);
+		writer.WriteBool(j->m_collideConnected);
+
+		if (j->m_type == e_gearJoint)
+		{
+			b2GearJoint* gear = (b2GearJoint*)j;
+			b2Joint* joint1 = gear->m_revolute1 ? (b2Joint*)gear->m_revolute1 : (b2Joint*)gear->m_prismatic1;
+			b2Joint* joint2 = gear->m_revolute2 ? (b2Joint*)gear->m_revolute2 : (b2Joint*)gear->m_prismatic2;
+			writer.WriteInt32(b2GetJointOrdinal(this, joint1));
+			writer.WriteInt32(b2GetJointOrdinal(this, joint2));
+		}
+
+		j->WriteState(&writer);
+	}
+
+	// Contacts with their manifolds, for warm starting. They are written by
+	// increasing stamp, so the restore can rebuild the body contact lists.
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(m_contactCount * sizeof(b2Contact*));
+	memcpy(contacts, m_contacts, m_contactCount * sizeof(b2Contact*));
+	qsort(contacts, m_contactCount, sizeof(b2Contact*), b2ContactManager::CompareStamps);
+
+	for (int32 k = 0; k < m_contactCount; ++k)
+	{
+		b2Contact* c = contacts[k];
+		b2Fixture* fixtureA = c->m_fixtureA;
+		b2Fixture* fixtureB = c->m_fixtureB;
+		writer.WriteInt32(fixtureA->m_body->m_index);
+		writer.WriteInt32(fixtureA->m_index);
+		writer.WriteInt32(fixtureB->m_body->m_index);
+		writer.WriteInt32(fixtureB->m_index);
+		writer.WriteInt32(c->m_flags & contactFlags);
+
+		const b2Manifold& manifold = c->m_manifold;
+		writer.WriteInt32(manifold.m_type);
+		writer.WriteVec2(manifold.m_localPlaneNormal);
+		writer.WriteVec2(manifold.m_localPoint);
+		writer.WriteInt32(manifold.m_pointCount);
+		for (int32 i = 0; i < manifold.m_pointCount; ++i)
+		{
+			const b2ManifoldPoint& mp = manifold.m_points[i];
+			writer.WriteVec2(mp.m_localPoint);
+			writer.WriteFloat32(mp.m_normalImpulse);
+			writer.WriteFloat32(mp.m_tangentImpulse);
+			writer.WriteInt32(mp.m_id.key);
+		}
+	}
+	m_stackAllocator.Free(contacts);
+
+	// Islands, the awake ones first.
+	for (int32 listIndex = 0; listIndex < 2; ++listIndex)
+	{
+		b2PersistentIsland* tail = listIndex == 0 ? m_islandManager.m_awakeList : m_islandManager.m_sleepList;
+		while (tail && tail->next)
+		{
+			tail = tail->next;
+		}
+
+		for (b2PersistentIsland* island = tail; island; island = island->prev)
+		{
+			writer.WriteInt32(island->constraintRemoveCount);
+			writer.WriteInt32(island->bodyCount);
+
+			b2Body* last = island->bodyList;
+			while (last && last->m_islandNext)
+			{
+				last = last->m_islandNext;
+			}
+
+			for (b2Body* b = last; b; b = b->m_islandPrev)
+			{
+				writer.WriteInt32(b->m_index);
+			}
+		}
+	}
+
+	writer.WriteInt32(b2_snapshotEndMagic);
+
+	return writer.GetSize();
+}
+
+// Create a joint from a default definition of its type. The state is read afterwards.
+static b2Joint* b2CreateSnapshotJoint(b2World* world, b2JointType type, b2Body* body1, b2Body* body2,
+									bool collideConnected, b2Joint* joint1, b2Joint* joint2)
+{
+	b2DistanceJointDef distanceDef;
+	b2FixedJointDef fixedDef;
+	b2GearJointDef gearDef;
+	b2LineJointDef lineDef;
+	b2MouseJointDef mouseDef;
+	b2PrismaticJointDef prismaticDef;
+	b2PulleyJointDef pulleyDef;
+	b2RevoluteJointDef revoluteDef;
+
+	b2JointDef* def = NULL;
+	switch (type)
+	{
+	case e_distanceJoint:
+		def = &distanceDef;
+		break;
+
+	case e_fixedJoint:
+		def = &fixedDef;
+		break;
+
+	case e_gearJoint:
+		if (joint1 == NULL || joint2 == NULL)
+		{
+			return NULL;
+		}
+		gearDef.joint1 = joint1;
+		gearDef.joint2 = joint2;
+		def = &gearDef;
+		break;
+
+	case e_lineJoint:
+		def = &lineDef;
+		break;
+
+	case e_mouseJoint:
+		def = &mouseDef;
+		break;
+
+	case e_prismaticJoint:
+		def = &prismaticDef;
+		break;
+
+	case e_pulleyJoint:
+		def = &pulleyDef;
+		break;
+
+	case e_revoluteJoint:
+		def = &revoluteDef;
+		break;
+
+	default:
+		return NULL;
+	}
+
+	def->body1 = body1;
+	def->body2 = body2;
+	def->collideConnected = collideConnected;
+	return world->CreateJoint(def);
+}
+
+bool b2World::ReadSnapshot(const void* data, int32 size)
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
+	{
+		return false;
+	}
+
+	// Check both ends before the world is touched, so a truncated snapshot is rejected.
+	b2SnapshotReader reader(data, size);
+	const uint32 contactFlags = b2Contact::e_nonSolidFlag | b2Contact::e_slowFlag | b2Contact::e_touchFlag;
+	if (reader.ReadInt32() != b2_snapshotMagic ||
+		reader.ReadInt32() != b2_snapshotVersion ||
+		reader.ReadInt32() != b2_snapshotMathType)
+	{
+		return false;
+	}
+
+	int32 endMagic;
+	memcpy(&endMagic, (const uint8*)data + size - sizeof(int32), sizeof(int32));
+	if (endMagic != b2_snapshotEndMagic)
+	{
+		return false;
+	}
+
+	// Remove everything. The objects are replaced, not destroyed, so nobody says goodbye.
+	b2DestructionListener* destructionListener = m_destructionListener;
+	m_destructionListener = NULL;
+
+	while (m_jointList)
+	{
+		DestroyJoint(m_jointList);
+	}
+
+	while (m_bodyList)
+	{
+		DestroyBody(m_bodyList);
+	}
+	m_groundBody = NULL;
+
+	m_destructionListener = destructionListener;
+
+	m_gravity = reader.ReadVec2();
+	m_allowSleep = reader.ReadBool();
+	m_warmStarting = reader.ReadBool();
+	m_continuousPhysics = reader.ReadBool();
+	m_contactBatching = reader.ReadBool();
+	m_inv_dt0 = reader.ReadFloat32();
+
+	int32 bodyIndexCount = reader.ReadInt32();
+	int32 freeBodyIndexCount = reader.ReadInt32();
+	if (freeBodyIndexCount > m_freeBodyIndexCapacity)
+	{
+		b2Free(m_freeBodyIndices);
+		m_freeBodyIndexCapacity = b2Max(freeBodyIndexCount, 16);
+		m_freeBodyIndices = (int32*)b2Alloc(m_freeBodyIndexCapacity * sizeof(int32));
+	}
+	for (int32 i = 0; i < freeBodyIndexCount; ++i)
+	{
+		m_freeBodyIndices[i] = reader.ReadInt32();
+	}
+	int32 groundIndex = reader.ReadInt32();
+
+	int32 bodyCount = reader.ReadInt32();
+	int32 fixtureCount = reader.ReadInt32();
+	int32 jointCount = reader.ReadInt32();
+	int32 contactCount = reader.ReadInt32();
+	int32 awakeIslandCount = reader.ReadInt32();
+	int32 sleepIslandCount = reader.ReadInt32();
+
+	// The bodies get their indices from the snapshot.
+	m_freeBodyIndexCount = 0;
+	m_bodyIndexCount = 0;
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyIndexCount * sizeof(b2Body*));
+	int32* fixtureStarts = (int32*)m_stackAllocator.Allocate(bodyIndexCount * sizeof(int32));
+	b2Fixture** fixtures = (b2Fixture**)m_stackAllocator.Allocate(fixtureCount * sizeof(b2Fixture*));
+	int32* edgeLinks = (int32*)m_stackAllocator.Allocate(2 * fixtureCount * sizeof(int32));
+	memset(bodies, 0, bodyIndexCount * sizeof(b2Body*));
+
+	// Fixtures that had a proxy get one again in a single broad-phase build.
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(fixtureCount * sizeof(b2AABB));
+	void** proxyFixtures = (void**)m_stackAllocator.Allocate(fixtureCount * sizeof(void*));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(fixtureCount * sizeof(int32));
+	int32 proxyCount = 0;
+
+	m_blockAllocator.Reserve(sizeof(b2Body), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2Fixture), fixtureCount);
+
+	int32 fixtureIndex = 0;
+	for (int32 i = 0; i < bodyCount && reader.IsValid(); ++i)
+	{
+		// A static body without fixtures stays out of the islands until they are restored.
+		b2BodyDef bd;
+		b2Body* b = CreateBody(&bd);
+
+		int32 index = reader.ReadInt32();
+		b2Assert(0 <= index && index < bodyIndexCount);
+		b->m_index = index;
+		bodies[index] = b;
+		fixtureStarts[index] = fixtureIndex;
+
+		b->m_flags = (uint16)reader.ReadInt32();
+		b->m_type = (int16)reader.ReadInt32();
+		b->m_xf.position = reader.ReadVec2();
+		b->m_xf.R.col1 = reader.ReadVec2();
+		b->m_xf.R.col2 = reader.ReadVec2();
+		b->m_sweep.localCenter = reader.ReadVec2();
+		b->m_sweep.c0 = reader.ReadVec2();
+		b->m_sweep.c = reader.ReadVec2();
+		b->m_sweep.a0 = reader.ReadFloat32();
+		b->m_sweep.a = reader.ReadFloat32();
+		b->m_sweep.t0 = reader.ReadFloat32();
+		b->m_linearVelocity = reader.ReadVec2();
+		b->m_angularVelocity = reader.ReadFloat32();
+		b->m_force = reader.ReadVec2();
+		b->m_torque = reader.ReadFloat32();
+		b->m_mass = reader.ReadFloat32();
+		b->m_invMass = reader.ReadFloat32();
+		b->m_I = reader.ReadFloat32();
+		b->m_invI = reader.ReadFloat32();
+		b->m_linearDamping = reader.ReadFloat32();
+		b->m_angularDamping = reader.ReadFloat32();
+		b->m_sleepTime = reader.ReadFloat32();
+
+		int32 count = reader.ReadInt32();
+		b2Assert(fixtureIndex + count <= fixtureCount);
+		for (int32 j = 0; j < count && reader.IsValid(); ++j)
+		{
+			b2CircleDef circleDef;
+			b2PolygonDef polygonDef;
+			b2EdgeDef edgeDef;
+
+			b2ShapeType type = (b2ShapeType)reader.ReadInt32();
+			b2FixtureDef* def = NULL;
+			switch (type)
+			{
+			case b2_circleShape:
+				def = &circleDef;
+				break;
+
+			case b2_polygonShape:
+				def = &polygonDef;
+				break;
+
+			case b2_edgeShape:
+				def = &edgeDef;
+				break;
+
+			default:
+				b2Assert(false);
+				break;
+			}
+
+			if (def == NULL)
+			{
+				break;
+			}
+
+			def->friction = reader.ReadFloat32();
+			def->restitution = reader.ReadFloat32();
+			def->density = reader.ReadFloat32();
+			def->filter.categoryBits = (uint16)reader.ReadInt32();
+			def->filter.maskBits = (uint16)reader.ReadInt32();
+			def->filter.groupIndex = (int16)reader.ReadInt32();
+			def->isSensor = reader.ReadBool();
+			bool hasProxy = reader.ReadBool();
+			b2AABB aabb;
+			aabb.lowerBound = reader.ReadVec2();
+			aabb.upperBound = reader.ReadVec2();
+
+			int32 prevEdge = -1, nextEdge = -1;
+			b2Vec2 corner1, corner2;
+			bool convex1 = false, convex2 = false;
+			switch (type)
+			{
+			case b2_circleShape:
+				circleDef.localPosition = reader.ReadVec2();
+				circleDef.radius = reader.ReadFloat32();
+				break;
+
+			case b2_polygonShape:
+				polygonDef.vertexCount = reader.ReadInt32();
+				b2Assert(3 <= polygonDef.vertexCount && polygonDef.vertexCount <= b2_maxPolygonVertices);
+				for (int32 k = 0; k < polygonDef.vertexCount; ++k)
+				{
+					polygonDef.vertices[k] = reader.ReadVec2();
+				}
+				break;
+
+			default:
+				edgeDef.vertex1 = reader.ReadVec2();
+				edgeDef.vertex2 = reader.ReadVec2();
+				prevEdge = reader.ReadInt32();
+				corner1 = reader.ReadVec2();
+				convex1 = reader.ReadBool();
+				nextEdge = reader.ReadInt32();
+				corner2 = reader.ReadVec2();
+				convex2 = reader.ReadBool();
+				break;
+			}
+
+			void* mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* fixture = new (mem) b2Fixture;
+			fixture->Create(&m_blockAllocator, NULL, b, b->m_xf, def);
+
+			fixture->m_index = b->m_fixtureCount;
+			fixture->m_next = b->m_fixtureList;
+			b->m_fixtureList = fixture;
+			++b->m_fixtureCount;
+
+			if (type == b2_edgeShape)
+			{
+				// The neighbours are linked once all edges of the body exist.
+				b2EdgeShape* edge = (b2EdgeShape*)fixture->m_shape;
+				edge->SetPrevEdge(NULL, corner1, convex1);
+				edge->SetNextEdge(NULL, corner2, convex2);
+			}
+
+			edgeLinks[2 * fixtureIndex + 0] = prevEdge;
+			edgeLinks[2 * fixtureIndex + 1] = nextEdge;
+			fixtures[fixtureIndex++] = fixture;
+
+			if (hasProxy)
+			{
+				aabbs[proxyCount] = aabb;
+				proxyFixtures[proxyCount] = fixture;
+				++proxyCount;
+			}
+		}
+
+		// Link the edges of the body.
+		int32 start = fixtureStarts[index];
+		for (int32 j = start; j < fixtureIndex; ++j)
+		{
+			if (fixtures[j]->m_type != b2_edgeShape)
+			{
+				continue;
+			}
+
+			b2EdgeShape* edge = (b2EdgeShape*)fixtures[j]->m_shape;
+			int32 prev = start + edgeLinks[2 * j + 0];
+			int32 next = start + edgeLinks[2 * j + 1];
+			if (start <= prev && prev < fixtureIndex && fixtures[prev]->m_type == b2_edgeShape)
+			{
+				edge->m_prevEdge = (b2EdgeShape*)fixtures[prev]->m_shape;
+			}
+			if (start <= next && next < fixtureIndex && fixtures[next]->m_type == b2_edgeShape)
+			{
+				edge->m_nextEdge = (b2EdgeShape*)fixtures[next]->m_shape;
+			}
+		}
+	}
+
+	m_bodyIndexCount = bodyIndexCount;
+	m_freeBodyIndexCount = freeBodyIndexCount;
+	m_groundBody = 0 <= groundIndex && groundIndex < bodyIndexCount ? bodies[groundIndex] : NULL;
+
+	// Joints. The bodies are not in islands yet, so no islands are merged.
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(jointCount * sizeof(b2Joint*));
+	for (int32 i = 0; i < jointCount && reader.IsValid(); ++i)
+	{
+		b2JointType type = (b2JointType)reader.ReadInt32();
+		int32 index1 = reader.ReadInt32();
+		int32 index2 = reader.ReadInt32();
+		bool collideConnected = reader.ReadBool();
+
+		b2Joint* joint1 = NULL;
+		b2Joint* joint2 = NULL;
+		if (type == e_gearJoint)
+		{
+			int32 ordinal1 = reader.ReadInt32();
+			int32 ordinal2 = reader.ReadInt32();
+			joint1 = 0 <= ordinal1 && ordinal1 < i ? joints[ordinal1] : NULL;
+			joint2 = 0 <= ordinal2 && ordinal2 < i ? joints[ordinal2] : NULL;
+		}
+
+		b2Body* body1 = 0 <= index1 && index1 < bodyIndexCount ? bodies[index1] : NULL;
+		b2Body* body2 = 0 <= index2 && index2 < bodyIndexCount ? bodies[index2] : NULL;
+		b2Assert(body1 != NULL && body2 != NULL);
+		if (body1 == NULL || body2 == NULL)
+		{
+			jointCount = i;
+			break;
+		}
+
+		b2Joint* j = b2CreateSnapshotJoint(this, type, body1, body2, collideConnected, joint1, joint2);
+		b2Assert(j != NULL);
+		if (j == NULL)
+		{
+			jointCount = i;
+			break;
+		}
+
+		j->ReadState(&reader);
+		joints[i] = j;
+	}
+	m_stackAllocator.Free(joints);
+
+	// Build the broad-phase. This creates the contacts of the overlapping proxies.
+	m_broadPhase->RestoreProxies(aabbs, proxyFixtures, proxyCount, proxyIds);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		((b2Fixture*)proxyFixtures[i])->m_proxyId = proxyIds[i];
+	}
+	m_broadPhase->Commit();
+
+	// Match the contacts of the snapshot to the new ones. The island flag marks a match.
+	b2Contact** matched = (b2Contact**)m_stackAllocator.Allocate(contactCount * sizeof(b2Contact*));
+	int32 matchCount = 0;
+	for (int32 i = 0; i < contactCount && reader.IsValid(); ++i)
+	{
+		int32 indexA = reader.ReadInt32();
+		int32 ordinalA = reader.ReadInt32();
+		int32 indexB = reader.ReadInt32();
+		int32 ordinalB = reader.ReadInt32();
+		uint32 flags = (uint32)reader.ReadInt32() & contactFlags;
+
+		b2Manifold manifold;
+		manifold.m_type = (b2Manifold::Type)reader.ReadInt32();
+		manifold.m_localPlaneNormal = reader.ReadVec2();
+		manifold.m_localPoint = reader.ReadVec2();
+		manifold.m_pointCount = reader.ReadInt32();
+		b2Assert(0 <= manifold.m_pointCount && manifold.m_pointCount <= b2_maxManifoldPoints);
+		manifold.m_pointCount = b2Clamp(manifold.m_pointCount, 0, b2_maxManifoldPoints);
+		for (int32 k = 0; k < manifold.m_pointCount; ++k)
+		{
+			b2ManifoldPoint& mp = manifold.m_points[k];
+			mp.m_localPoint = reader.ReadVec2();
+			mp.m_normalImpulse = reader.ReadFloat32();
+			mp.m_tangentImpulse = reader.ReadFloat32();
+			mp.m_id.key = (uint32)reader.ReadInt32();
+		}
+
+		b2Body* bodyA = 0 <= indexA && indexA < bodyIndexCount ? bodies[indexA] : NULL;
+		b2Body* bodyB = 0 <= indexB && indexB < bodyIndexCount ? bodies[indexB] : NULL;
+		if (bodyA == NULL || bodyB == NULL ||
+			ordinalA < 0 || ordinalA >= bodyA->m_fixtureCount ||
+			ordinalB < 0 || ordinalB >= bodyB->m_fixtureCount)
+		{
+			continue;
+		}
+
+		b2Fixture* fixtureA = fixtures[fixtureStarts[indexA] + ordinalA];
+		b2Fixture* fixtureB = fixtures[fixtureStarts[indexB] + ordinalB];
+
+		// A different broad-phase may have dropped the pair.
+		b2Contact* c = NULL;
+		for (b2ContactEdge* ce = bodyA->m_contactList; ce; ce = ce->next)
+		{
+			b2Contact* candidate = ce->contact;
+			if ((candidate->m_fixtureA == fixtureA && candidate->m_fixtureB == fixtureB) ||
+				(candidate->m_fixtureA == fixtureB && candidate->m_fixtureB == fixtureA))
+			{
+				c = candidate;
+				break;
+			}
+		}
+
+		if (c == NULL || (c->m_flags & b2Contact::e_islandFlag))
+		{
+			continue;
+		}
+
+		// The proxy order decides which fixture comes first. Only same type pairs can be swapped.
+		if (c->m_fixtureA != fixtureA)
+		{
+			b2Assert(fixtureA->m_type == fixtureB->m_type);
+			c->m_fixtureA = fixtureA;
+			c->m_fixtureB = fixtureB;
+		}
+
+		c->m_manifold = manifold;
+		c->m_flags = (c->m_flags & ~contactFlags) | flags | b2Contact::e_islandFlag;
+		matched[matchCount++] = c;
+	}
+
+	// Rebuild the contact array and lists: new contacts first, so they end up
+	// behind the snapshot ones.
+	b2Contact** live = (b2Contact**)m_stackAllocator.Allocate(m_contactCount * sizeof(b2Contact*));
+	int32 newCount = 0;
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Contact* c = m_contacts[i];
+		if ((c->m_flags & b2Contact::e_islandFlag) == 0)
+		{
+			live[newCount++] = c;
+		}
+	}
+	qsort(live, newCount, sizeof(b2Contact*), b2ContactManager::CompareStamps);
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_contactList = NULL;
+	}
+
+	b2Assert(newCount + matchCount == m_contactCount);
+	for (int32 i = 0; i < newCount + matchCount; ++i)
+	{
+		b2Contact* c = i < newCount ? live[i] : matched[i - newCount];
+		c->m_flags &= ~b2Contact::e_islandFlag;
+
+		c->m_index = i;
+		c->m_stamp = m_contactManager.m_stamp++;
+		m_contacts[i] = c;
+
+		b2Body* bodyA = c->m_fixtureA->m_body;
+		b2Body* bodyB = c->m_fixtureB->m_body;
+
+		c->m_nodeA.contact = c;
+		c->m_nodeA.other = bodyB;
+		c->m_nodeA.prev = NULL;
+		c->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList)
+		{
+			bodyA->m_contactList->prev = &c->m_nodeA;
+		}
+		bodyA->m_contactList = &c->m_nodeA;
+
+		c->m_nodeB.contact = c;
+		c->m_nodeB.other = bodyA;
+		c->m_nodeB.prev = NULL;
+		c->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList)
+		{
+			bodyB->m_contactList->prev = &c->m_nodeB;
+		}
+		bodyB->m_contactList = &c->m_nodeB;
+	}
+
+	// The lists are in snapshot order now.
+	m_contactManager.m_newContactCount = 0;
+
+	m_stackAllocator.Free(live);
+	m_stackAllocator.Free(matched);
+
+	// Islands.
+	b2Body** islandBodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+	for (int32 i = 0; i < awakeIslandCount + sleepIslandCount && reader.IsValid(); ++i)
+	{
+		int32 constraintRemoveCount = reader.ReadInt32();
+		int32 count = reader.ReadInt32();
+		int32 memberCount = 0;
+		for (int32 j = 0; j < count; ++j)
+		{
+			int32 index = reader.ReadInt32();
+			b2Body* b = 0 <= index && index < bodyIndexCount ? bodies[index] : NULL;
+			if (b && b->m_island == NULL && memberCount < bodyCount)
+			{
+				islandBodies[memberCount++] = b;
+			}
+		}
+
+		if (memberCount > 0)
+		{
+			m_islandManager.RestoreIsland(islandBodies, memberCount, constraintRemoveCount, i < awakeIslandCount);
+		}
+	}
+	m_stackAllocator.Free(islandBodies);
+
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(proxyFixtures);
+	m_stackAllocator.Free(aabbs);
+	m_stackAllocator.Free(edgeLinks);
+	m_stackAllocator.Free(fixtures);
+	m_stackAllocator.Free(fixtureStarts);
+	m_stackAllocator.Free(bodies);
+
+	b2Assert(reader.ReadInt32() == b2_snapshotEndMagic);
+	return true;
+}
+
+// Mix the bytes of a value into an FNV-1a hash.
+static uint32 b2HashBytes(uint32 hash, const void* data, int32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+uint32 b2World::GetChecksum() const
+{
+	uint32 hash = 2166136261u;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hash = b2HashBytes(hash, &b->m_index, sizeof(b->m_index));
+		hash = b2HashBytes(hash, &b->m_xf.position, sizeof(b->m_xf.position));
+		hash = b2HashBytes(hash, &b->m_sweep.a, sizeof(b->m_sweep.a));
+		hash = b2HashBytes(hash, &b->m_linearVelocity, sizeof(b->m_linearVelocity));
+		hash = b2HashBytes(hash, &b->m_angularVelocity, sizeof(b->m_angularVelocity));
+	}
+
+	return hash;
+}